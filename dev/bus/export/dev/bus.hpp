@@ -20,22 +20,36 @@
 
 #include <atomic>
 #include <chrono>
+#include <type_traits>
 
 namespace ecl
 {
 
+//! Bus transaction, that can be queued with generic_bus::submit().
+//! \details Descriptor is owned by the client and must be valid until
+//! transfer complete event is delivered to its handler.
+struct bus_transaction
+{
+    const uint8_t   *tx;        //!< Data to transmit. Optional.
+    uint8_t         *rx;        //!< Buffer to receive a data. Optional.
+    size_t          tx_size;    //!< Size of TX buffer.
+    size_t          rx_size;    //!< Size of RX buffer.
+    bus_handler     handler;    //!< Event handler. Optional.
+};
+
 //! Generic bus interface.
 //! \details The generic bus is useful adapter, that allows to:
 //! - Encapsulate locking policy when multithreaded environment is used.
 //! - Hide differences between full-duplex and half-duplex busses.
 //! - Define and simplify platform-level bus interface
-//! \tparam PBus Platform-level bus driver (I2C, SPI, etc.)
+//! \tparam PBus      Platform-level bus driver (I2C, SPI, etc.)
+//! \tparam queue_len Maximum amount of transactions queued with submit().
 //!
 //! This class uses one of methods to prevent “static initialization order
 //! fiasco” to handle initialization of the static members.
 //! See https://isocpp.org/wiki/faq/ctors
 //!
-template<class PBus>
+template<class PBus, size_t queue_len = 4>
 class generic_bus
 {
 public:
@@ -136,6 +150,31 @@ public:
     //! \retval    err::busy    Device is still executing async xfer.
     static err set_buffers(size_t size, uint8_t fill_byte = 0xff);
 
+    //! Sets scatter-gather list of RX and TX buffers.
+    //! \details Segments are transferred within single xfer, in order given.
+    //! It allows to send e.g. header, payload and checksum residing in
+    //! different buffers without copying them into a staging buffer.
+    //! All effects from calls to set_buffers() will be discarded.
+    //! \details If platform bus provides set_iovec() method, the list is
+    //! handed to it directly (e.g. for chained DMA). Otherwise generic bus
+    //! starts next segment when previous one is done. In both cases user
+    //! observes single xfer: byte counters in events and in blocking xfer()
+    //! are accumulated across segments and only one TC event is delivered
+    //! to the meta channel.
+    //! \par Side effects:
+    //! \li Bus will remember the list, until unlock() or set_buffers()
+    //!     will be called.
+    //! \pre       Bus is locked.
+    //! \post      Bus is ready to execute xfer.
+    //! \param[in] iov  Segment list. Must be valid until bus is unlocked or
+    //!                 other buffers are set.
+    //! \param[in] cnt  Amount of segments in the list.
+    //! \retval    err::ok      Buffers successfully set.
+    //! \retval    err::inval   List is empty or both buffers of some
+    //!                         segment are null.
+    //! \retval    err::busy    Device is still executing async xfer.
+    static err set_buffers(const bus_iovec *iov, size_t cnt);
+
     //! Performs xfer in blocking mode using buffers set previously with optional timeout.
     //! \details If underlying bus works in half-duplex mode then first
     //! tx transaction will occur and then rx. Any deferred xfer will be
@@ -202,6 +241,27 @@ public:
     //! \post      Xfer is ongoing.
     static err trigger_xfer();
 
+    //! Queues a transaction.
+    //! \details Transactions are executed in order of submission, without
+    //! holding the bus lock. Next transaction is started by the bus right
+    //! from completion event of the previous one, thus the bus is not idle
+    //! while clients are woken up and prepare their next xfers.
+    //! Handler of the transaction receives the same events as in
+    //! xfer(const bus_handler &handler, async_type type). Transfer complete
+    //! event in the meta channel marks the end of the transaction.
+    //! If transaction can't be started, error event is delivered to the meta
+    //! channel instead.
+    //! \details Clients that use lock() are blocked until queue drains.
+    //! \warning Handler will be likely executed in ISR context. Calling
+    //! submit() from the handler is not permitted.
+    //! \pre       Bus is inited and is not locked by the caller.
+    //! \param[in] t Transaction to execute. Must be valid until transfer
+    //!              complete event is delivered.
+    //! \retval    err::ok      Transaction is queued.
+    //! \retval    err::inval   Both buffers are null.
+    //! \retval    err::busy    Queue is full.
+    static err submit(bus_transaction &t);
+
     //! Cancels xfer.
     //! \details Capable of cancelling any previously started or scheduled xfer.
     //! Keeps buffer and callback configured. Callable from ISR context.
@@ -232,6 +292,45 @@ private:
     //! Performs cleanup required after unlocking and delivering an event.
     static void cleanup();
 
+    //! Checks if platform bus is able to execute scatter-gather list itself.
+    template<class P, class = void>
+    struct native_iovec : std::false_type { };
+
+    template<class P>
+    struct native_iovec<P, decltype(void(P::set_iovec(nullptr, 0)))>
+        : std::true_type { };
+
+    //! Passes segment list to the platform bus, if it supports it.
+    template<class P = PBus>
+    static std::enable_if_t<native_iovec<P>::value> set_platform_iovec(const bus_iovec *iov, size_t cnt);
+
+    //! Sets first segment to the platform bus, rest will be chained.
+    template<class P = PBus>
+    static std::enable_if_t<!native_iovec<P>::value> set_platform_iovec(const bus_iovec *iov, size_t cnt);
+
+    //! Sets given emulated scatter-gather segment to the platform bus.
+    static void set_segment(size_t idx);
+
+    //! Starts transaction from the head of the queue.
+    //! \details Transactions that failed to start are completed with
+    //! an error right away.
+    static void start_queued();
+
+    //! Completes transaction from the head of the queue.
+    //! \return true if there are more transactions to execute.
+    static bool complete_queued();
+
+    //! Handles events of queued transactions.
+    static void queue_handler(bus_channel ch, bus_event type, size_t total);
+
+    //! Rewinds emulated scatter-gather list before new xfer.
+    static void rewind_segments();
+
+    //! Starts next emulated scatter-gather segment, if any.
+    //! \retval true  Next segment is started, TC event must be suppressed.
+    //! \retval false No segments left or failed to start next one.
+    static bool chain_segment();
+
     //! Lock proxy to protect a platform bus.
     static mutex& mut();
 
@@ -254,22 +353,52 @@ private:
     //! Xfer error status: set - error(s) occurred during transfer,
     //! reset - no error occurred.
     static constexpr uint8_t xfer_error     = 0x10;
+    //! Queue mode: set - queued transactions are executed, reset - bus is
+    //! used by lock holder.
+    static constexpr uint8_t queue_mode     = 0x20;
 
     static volatile size_t       m_received; //!< Bytes received during last blocking xfer.
     static volatile size_t       m_sent;     //!< Bytes sent during last blocking xfer.
     static volatile atomic_flag  m_cleaned;  //!< Cleanup is performed after xfer and unlock are done.
-    static volatile uint8_t      m_state;    //!< State flags.
+    static std::atomic<uint8_t>  m_state;    //!< State flags, modified from ISR too.
+
+    // Transaction queue. Producers are serialized by the bus mutex,
+    // consumer is the completion event handler.
+    static bus_transaction       *m_queue[queue_len];    //!< Queued transactions.
+    static size_t                m_q_head;               //!< Executed transaction.
+    static size_t                m_q_tail;               //!< Next free slot.
+    static std::atomic<size_t>   m_q_pending;            //!< Not yet completed.
+
+    // Emulated scatter-gather state, unused if platform bus supports it.
+    static const bus_iovec       *m_iov;     //!< Segment list.
+    static size_t                m_iov_cnt;  //!< Amount of segments.
+    static volatile size_t       m_iov_pos;  //!< Current segment.
+    static volatile size_t       m_tx_base;  //!< Bytes sent by previous segments.
+    static volatile size_t       m_rx_base;  //!< Bytes received by previous segments.
+    static volatile size_t       m_tx_seg;   //!< Bytes sent by current segment.
+    static volatile size_t       m_rx_seg;   //!< Bytes received by current segment.
 };
 
-template<class PBus> volatile size_t                   generic_bus<PBus>::m_received{};
-template<class PBus> volatile size_t                   generic_bus<PBus>::m_sent{};
-template<class PBus> volatile std::atomic_flag         generic_bus<PBus>::m_cleaned{};
-template<class PBus> volatile uint8_t                  generic_bus<PBus>::m_state{};
+template<class PBus, size_t queue_len> volatile size_t                   generic_bus<PBus, queue_len>::m_received{};
+template<class PBus, size_t queue_len> volatile size_t                   generic_bus<PBus, queue_len>::m_sent{};
+template<class PBus, size_t queue_len> volatile std::atomic_flag         generic_bus<PBus, queue_len>::m_cleaned{};
+template<class PBus, size_t queue_len> std::atomic<uint8_t>              generic_bus<PBus, queue_len>::m_state{};
+template<class PBus, size_t queue_len> bus_transaction                  *generic_bus<PBus, queue_len>::m_queue[queue_len]{};
+template<class PBus, size_t queue_len> size_t                            generic_bus<PBus, queue_len>::m_q_head{};
+template<class PBus, size_t queue_len> size_t                            generic_bus<PBus, queue_len>::m_q_tail{};
+template<class PBus, size_t queue_len> std::atomic<size_t>               generic_bus<PBus, queue_len>::m_q_pending{};
+template<class PBus, size_t queue_len> const bus_iovec                   *generic_bus<PBus, queue_len>::m_iov{};
+template<class PBus, size_t queue_len> size_t                            generic_bus<PBus, queue_len>::m_iov_cnt{};
+template<class PBus, size_t queue_len> volatile size_t                   generic_bus<PBus, queue_len>::m_iov_pos{};
+template<class PBus, size_t queue_len> volatile size_t                   generic_bus<PBus, queue_len>::m_tx_base{};
+template<class PBus, size_t queue_len> volatile size_t                   generic_bus<PBus, queue_len>::m_rx_base{};
+template<class PBus, size_t queue_len> volatile size_t                   generic_bus<PBus, queue_len>::m_tx_seg{};
+template<class PBus, size_t queue_len> volatile size_t                   generic_bus<PBus, queue_len>::m_rx_seg{};
 
 //------------------------------------------------------------------------------
 
-template<class PBus>
-err generic_bus<PBus>::init()
+template<class PBus, size_t queue_len>
+err generic_bus<PBus, queue_len>::init()
 {
     // Exists only to protect init call when multiple threads accessing it,
     // since global lock is not yet initialized.
@@ -301,8 +430,8 @@ err generic_bus<PBus>::init()
     return rc;
 }
 
-template<class PBus>
-err generic_bus<PBus>::deinit()
+template<class PBus, size_t queue_len>
+err generic_bus<PBus, queue_len>::deinit()
 {
     if (!(m_state & bus_inited)) {
         return err::perm;
@@ -311,12 +440,14 @@ err generic_bus<PBus>::deinit()
     PBus::reset_handler();
     cleanup();
     m_state = 0;
+    m_q_head = m_q_tail = 0;
+    m_q_pending = 0;
 
     return err::ok;
 }
 
-template<class PBus>
-void generic_bus<PBus>::lock()
+template<class PBus, size_t queue_len>
+void generic_bus<PBus, queue_len>::lock()
 {
     // If bus is not initialized then pre-conditions are violated.
     ecl_assert(m_state & bus_inited);
@@ -332,8 +463,8 @@ void generic_bus<PBus>::lock()
     }
 }
 
-template<class PBus>
-void generic_bus<PBus>::unlock()
+template<class PBus, size_t queue_len>
+void generic_bus<PBus, queue_len>::unlock()
 {
     // If bus is not locked then pre-conditions are violated
     // and it is clearly a sign of a bug
@@ -366,14 +497,14 @@ void generic_bus<PBus>::unlock()
     mut().unlock();
 }
 
-template<class PBus>
-ecl::err generic_bus<PBus>::set_buffers(const uint8_t *tx, uint8_t *rx, size_t size)
+template<class PBus, size_t queue_len>
+ecl::err generic_bus<PBus, queue_len>::set_buffers(const uint8_t *tx, uint8_t *rx, size_t size)
 {
     return set_buffers(tx, rx, size, size);
 }
 
-template<class PBus>
-ecl::err generic_bus<PBus>::set_buffers(const uint8_t *tx, uint8_t *rx, size_t tx_size, size_t rx_size)
+template<class PBus, size_t queue_len>
+ecl::err generic_bus<PBus, queue_len>::set_buffers(const uint8_t *tx, uint8_t *rx, size_t tx_size, size_t rx_size)
 {
     // If bus is not locked then pre-conditions are violated
     // and it is clearly a sign of a bug
@@ -387,6 +518,8 @@ ecl::err generic_bus<PBus>::set_buffers(const uint8_t *tx, uint8_t *rx, size_t t
         return err::busy;
     }
 
+    m_iov_cnt = 0;
+
     PBus::reset_buffers();
     PBus::set_tx(tx, tx_size);
     PBus::set_rx(rx, rx_size);
@@ -394,8 +527,8 @@ ecl::err generic_bus<PBus>::set_buffers(const uint8_t *tx, uint8_t *rx, size_t t
     return err::ok;
 }
 
-template<class PBus>
-ecl::err generic_bus<PBus>::set_buffers(size_t size, uint8_t fill_byte)
+template<class PBus, size_t queue_len>
+ecl::err generic_bus<PBus, queue_len>::set_buffers(size_t size, uint8_t fill_byte)
 {
     // If bus is not locked then pre-conditions are violated
     // and it is clearly a sign of a bug
@@ -405,14 +538,45 @@ ecl::err generic_bus<PBus>::set_buffers(size_t size, uint8_t fill_byte)
         return err::busy;
     }
 
+    m_iov_cnt = 0;
+
     PBus::reset_buffers();
     PBus::set_tx(size, fill_byte);
     PBus::set_rx(nullptr, 0);
     return err::ok;
 }
 
-template<class PBus>
-ecl::err generic_bus<PBus>::xfer(size_t *sent, size_t *received, std::chrono::milliseconds timeout)
+template<class PBus, size_t queue_len>
+ecl::err generic_bus<PBus, queue_len>::set_buffers(const bus_iovec *iov, size_t cnt)
+{
+    // If bus is not locked then pre-conditions are violated
+    // and it is clearly a sign of a bug
+    ecl_assert(m_state & bus_locked);
+
+    if (!iov || !cnt) {
+        return err::inval;
+    }
+
+    for (size_t i = 0; i < cnt; ++i) {
+        if (!iov[i].tx && !iov[i].rx) {
+            return err::inval;
+        }
+    }
+
+    if (bus_is_busy()) {
+        return err::busy;
+    }
+
+    m_iov_cnt = 0;
+
+    PBus::reset_buffers();
+    set_platform_iovec(iov, cnt);
+
+    return err::ok;
+}
+
+template<class PBus, size_t queue_len>
+ecl::err generic_bus<PBus, queue_len>::xfer(size_t *sent, size_t *received, std::chrono::milliseconds timeout)
 {
     // If bus is not locked then pre-conditions are violated
     // and it is clearly a sign of a bug
@@ -437,6 +601,8 @@ ecl::err generic_bus<PBus>::xfer(size_t *sent, size_t *received, std::chrono::mi
     // Reset transfer counters
     m_received = m_sent = 0;
 
+    rewind_segments();
+
     auto rc = PBus::do_xfer();
 
     if (is_ok(rc)) {
@@ -484,8 +650,8 @@ ecl::err generic_bus<PBus>::xfer(size_t *sent, size_t *received, std::chrono::mi
     return rc;
 }
 
-template<class PBus>
-ecl::err generic_bus<PBus>::xfer(const bus_handler &handler, async_type type)
+template<class PBus, size_t queue_len>
+ecl::err generic_bus<PBus, queue_len>::xfer(const bus_handler &handler, async_type type)
 {
     // If bus is not locked then pre-conditions are violated
     // and it is clearly a sign of a bug
@@ -497,6 +663,10 @@ ecl::err generic_bus<PBus>::xfer(const bus_handler &handler, async_type type)
 
     cb() = handler;
 
+    // Reset binary semaphore counter, it can be left signalled
+    // after transaction queue is drained.
+    sem().try_wait();
+
     if (type == async_type::deferred) {
         // Xfer will be executed upon user's will.
         return err::ok;
@@ -505,8 +675,8 @@ ecl::err generic_bus<PBus>::xfer(const bus_handler &handler, async_type type)
     return trigger_xfer();
 }
 
-template<class PBus>
-ecl::err generic_bus<PBus>::trigger_xfer()
+template<class PBus, size_t queue_len>
+ecl::err generic_bus<PBus, queue_len>::trigger_xfer()
 {
     ecl_assert(m_state & bus_locked);
     ecl_assert(!bus_is_busy()); // Violating of pre-conditions
@@ -516,6 +686,8 @@ ecl::err generic_bus<PBus>::trigger_xfer()
 
     m_cleaned.clear();
 
+    rewind_segments();
+
     auto rc = PBus::do_xfer();
 
     if (is_error(rc)) {
@@ -537,8 +709,54 @@ ecl::err generic_bus<PBus>::trigger_xfer()
     return rc;
 }
 
-template<class PBus>
-ecl::err generic_bus<PBus>::cancel_xfer()
+template<class PBus, size_t queue_len>
+ecl::err generic_bus<PBus, queue_len>::submit(bus_transaction &t)
+{
+    // If bus is not initialized then pre-conditions are violated.
+    ecl_assert(m_state & bus_inited);
+
+    if (!t.tx && !t.rx) {
+        return err::inval;
+    }
+
+    mut().lock();
+
+    // Async xfer of the previous lock holder can be still ongoing.
+    // Queue can use the bus only when it is done.
+    if ((m_state & async_mode) && !(m_state & queue_mode)) {
+        sem().wait();
+    }
+
+    // Pending counter can only decrease concurrently, since producers
+    // are serialized by the mutex.
+    if (m_q_pending.load() == queue_len) {
+        mut().unlock();
+        return err::busy;
+    }
+
+    m_queue[m_q_tail] = &t;
+    m_q_tail = (m_q_tail + 1) % queue_len;
+
+    if (m_q_pending.fetch_add(1) == 0) {
+        // Bus is idle, start right away. Otherwise transaction will be
+        // started after completion of the previous one.
+
+        // Drained queue leaves the semaphore signalled. Signal must not
+        // leak into the new queue, or lock() will return while the queue
+        // is still running.
+        sem().try_wait();
+
+        m_state |= (queue_mode | async_mode);
+        start_queued();
+    }
+
+    mut().unlock();
+
+    return err::ok;
+}
+
+template<class PBus, size_t queue_len>
+ecl::err generic_bus<PBus, queue_len>::cancel_xfer()
 {
     ecl_assert(m_state & bus_locked);  // Violating of pre-conditions
 
@@ -556,9 +774,14 @@ ecl::err generic_bus<PBus>::cancel_xfer()
 
 //------------------------------------------------------------------------------
 
-template<class PBus>
-void generic_bus<PBus>::platform_handler(bus_channel ch, bus_event type, size_t total)
+template<class PBus, size_t queue_len>
+void generic_bus<PBus, queue_len>::platform_handler(bus_channel ch, bus_event type, size_t total)
 {
+    if (m_state & queue_mode) {
+        queue_handler(ch, type, total);
+        return;
+    }
+
     // Transfer complete across all channels
     bool last_event = (ch == bus_channel::meta && type == bus_event::tc);
 
@@ -566,6 +789,21 @@ void generic_bus<PBus>::platform_handler(bus_channel ch, bus_event type, size_t
         m_state |= xfer_error;
     }
 
+    if (m_iov_cnt) {
+        // Emulated scatter-gather xfer. Segments are reported as single xfer.
+        if (ch == bus_channel::tx) {
+            m_tx_seg = total;
+            total += m_tx_base;
+        } else if (ch == bus_channel::rx) {
+            m_rx_seg = total;
+            total += m_rx_base;
+        }
+
+        if (last_event && chain_segment()) {
+            return;
+        }
+    }
+
     if (last_event) {
         // Spurious events are not allowed
         ecl_assert(!(m_state & xfer_served));
@@ -617,38 +855,168 @@ void generic_bus<PBus>::platform_handler(bus_channel ch, bus_event type, size_t
     }
 }
 
-template<class PBus>
-bool generic_bus<PBus>::bus_is_busy()
+template<class PBus, size_t queue_len>
+void generic_bus<PBus, queue_len>::start_queued()
+{
+    do {
+        auto t = m_queue[m_q_head];
+
+        m_state &= ~(xfer_served | xfer_error);
+        m_iov_cnt = 0;
+
+        PBus::reset_buffers();
+        PBus::set_tx(t->tx, t->tx_size);
+        PBus::set_rx(t->rx, t->rx_size);
+
+        if (is_ok(PBus::do_xfer())) {
+            return;
+        }
+
+        // Nothing will be transferred, report error and proceed with
+        // the next transaction.
+        if (t->handler) {
+            t->handler(bus_channel::meta, bus_event::err, 0);
+        }
+    } while (complete_queued());
+}
+
+template<class PBus, size_t queue_len>
+bool generic_bus<PBus, queue_len>::complete_queued()
+{
+    m_q_head = (m_q_head + 1) % queue_len;
+
+    if (m_q_pending.fetch_sub(1) > 1) {
+        return true;
+    }
+
+    // Queue drained, bus can be taken by lock holders.
+    PBus::reset_buffers();
+    m_state &= ~(queue_mode | async_mode);
+    m_state |= xfer_served;
+    sem().signal();
+
+    return false;
+}
+
+template<class PBus, size_t queue_len>
+void generic_bus<PBus, queue_len>::queue_handler(bus_channel ch, bus_event type, size_t total)
+{
+    auto t = m_queue[m_q_head];
+
+    if (t->handler) {
+        t->handler(ch, type, total);
+    }
+
+    // Transaction descriptor must not be touched after the last event
+    // is delivered, client is free to reuse it.
+    if (ch == bus_channel::meta && type == bus_event::tc) {
+        if (complete_queued()) {
+            start_queued();
+        }
+    }
+}
+
+template<class PBus, size_t queue_len>
+bool generic_bus<PBus, queue_len>::bus_is_busy()
 {
     // Asynchronous operation still in progress.
     return (m_state & async_mode) && !(m_state & xfer_served);
 }
 
-template<class PBus>
-void generic_bus<PBus>::cleanup()
+template<class PBus, size_t queue_len>
+template<class P>
+std::enable_if_t<generic_bus<PBus, queue_len>::template native_iovec<P>::value>
+generic_bus<PBus, queue_len>::set_platform_iovec(const bus_iovec *iov, size_t cnt)
+{
+    PBus::set_iovec(iov, cnt);
+}
+
+template<class PBus, size_t queue_len>
+template<class P>
+std::enable_if_t<!generic_bus<PBus, queue_len>::template native_iovec<P>::value>
+generic_bus<PBus, queue_len>::set_platform_iovec(const bus_iovec *iov, size_t cnt)
+{
+    m_iov = iov;
+    m_iov_cnt = cnt;
+    set_segment(0);
+}
+
+template<class PBus, size_t queue_len>
+void generic_bus<PBus, queue_len>::set_segment(size_t idx)
+{
+    const auto &seg = m_iov[idx];
+
+    m_iov_pos = idx;
+    m_tx_seg = m_rx_seg = 0;
+
+    PBus::set_tx(seg.tx, seg.size);
+    PBus::set_rx(seg.rx, seg.size);
+}
+
+template<class PBus, size_t queue_len>
+void generic_bus<PBus, queue_len>::rewind_segments()
+{
+    if (!m_iov_cnt) {
+        return;
+    }
+
+    m_tx_base = m_rx_base = 0;
+
+    // Platform bus still holds last segment of the previous xfer
+    if (m_iov_pos) {
+        PBus::reset_buffers();
+        set_segment(0);
+    }
+}
+
+template<class PBus, size_t queue_len>
+bool generic_bus<PBus, queue_len>::chain_segment()
+{
+    // Stop on first failed segment, rest of the chain is meaningless
+    if (m_iov_pos + 1 >= m_iov_cnt || (m_state & xfer_error)) {
+        return false;
+    }
+
+    m_tx_base = m_tx_base + m_tx_seg;
+    m_rx_base = m_rx_base + m_rx_seg;
+
+    PBus::reset_buffers();
+    set_segment(m_iov_pos + 1);
+
+    if (is_error(PBus::do_xfer())) {
+        m_state |= xfer_error;
+        return false;
+    }
+
+    return true;
+}
+
+template<class PBus, size_t queue_len>
+void generic_bus<PBus, queue_len>::cleanup()
 {
+    m_iov_cnt = 0;
     PBus::reset_buffers();
     cb() = bus_handler{};
     // When bus will be locked again, no need to wait for events.
     m_state &= ~(async_mode);
 }
 
-template<class PBus>
-mutex& generic_bus<PBus>::mut()
+template<class PBus, size_t queue_len>
+mutex& generic_bus<PBus, queue_len>::mut()
 {
     static mutex m;
     return m;
 }
 
-template<class PBus>
-binary_semaphore& generic_bus<PBus>::sem()
+template<class PBus, size_t queue_len>
+binary_semaphore& generic_bus<PBus, queue_len>::sem()
 {
     static binary_semaphore s;
     return s;
 }
 
-template<class PBus>
-bus_handler& generic_bus<PBus>::cb()
+template<class PBus, size_t queue_len>
+bus_handler& generic_bus<PBus, queue_len>::cb()
 {
     static bus_handler bh;
     return bh;
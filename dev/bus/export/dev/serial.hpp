@@ -10,18 +10,32 @@
 #include <common/bus.hpp>
 #include <ecl/thread/semaphore.hpp>
 
+#include <algorithm>
 #include <atomic>
 
 namespace ecl
 {
 
+//! Buffering modes of the serial driver.
+enum class serial_mode
+{
+    //! RX buffer is split into two halves. Reception into a half is
+    //! started only after user read all data from it.
+    chunks,
+    //! RX and TX buffers are lock-free rings. Reception continues as long as
+    //! there is free space in the ring. Watermarks control when blocked
+    //! readers and writers are woken up.
+    ring,
+};
+
 //! Serial driver interface.
 //! \details The serial allows to abstract async,
 //! interrupt-driven nature of platform-level drivers and
 //! provide synchronus, buffered data management interface.
 //! \tparam PBus Exclusively owned platform bus.
 //! \tparam buf_size Size of internal rx and tx buffers.
-template<class PBus, size_t buf_size = 128>
+//! \tparam mode     Buffering mode.
+template<class PBus, size_t buf_size = 128, serial_mode mode = serial_mode::chunks>
 class serial
 {
 public:
@@ -277,23 +291,23 @@ private:
     static uint8_t                          m_tx_buf[buf_size]; //!< TX buffer.
 };
 
-template <class PBus, size_t buf_size>
-bool serial<PBus, buf_size>::m_is_inited;
+template <class PBus, size_t buf_size, serial_mode mode>
+bool serial<PBus, buf_size, mode>::m_is_inited;
 
-template <class PBus, size_t buf_size>
-bool serial<PBus, buf_size>::m_nonblock;
+template <class PBus, size_t buf_size, serial_mode mode>
+bool serial<PBus, buf_size, mode>::m_nonblock;
 
-template <class PBus, size_t buf_size>
-safe_storage<typename serial<PBus, buf_size>::serial_chunks> serial<PBus, buf_size>::m_chunks;
+template <class PBus, size_t buf_size, serial_mode mode>
+safe_storage<typename serial<PBus, buf_size, mode>::serial_chunks> serial<PBus, buf_size, mode>::m_chunks;
 
-template <class PBus, size_t buf_size>
-safe_storage<binary_semaphore> serial<PBus, buf_size>::m_tx_rdy;
+template <class PBus, size_t buf_size, serial_mode mode>
+safe_storage<binary_semaphore> serial<PBus, buf_size, mode>::m_tx_rdy;
 
-template <class PBus, size_t buf_size>
-uint8_t serial<PBus, buf_size>::m_tx_buf[buf_size];
+template <class PBus, size_t buf_size, serial_mode mode>
+uint8_t serial<PBus, buf_size, mode>::m_tx_buf[buf_size];
 
-template <class PBus, size_t buf_size>
-err serial<PBus, buf_size>::init()
+template <class PBus, size_t buf_size, serial_mode mode>
+err serial<PBus, buf_size, mode>::init()
 {
     m_chunks.init();
     ecl_assert(!m_is_inited);
@@ -312,8 +326,8 @@ err serial<PBus, buf_size>::init()
     return result;
 }
 
-template <class PBus, size_t buf_size>
-err serial<PBus, buf_size>::deinit()
+template <class PBus, size_t buf_size, serial_mode mode>
+err serial<PBus, buf_size, mode>::deinit()
 {
     ecl_assert(m_is_inited);
     PBus::cancel_xfer();
@@ -323,8 +337,8 @@ err serial<PBus, buf_size>::deinit()
     return err::ok;
 }
 
-template <class PBus, size_t buf_size>
-void serial<PBus, buf_size>::bus_handler(bus_channel ch, bus_event type, size_t total)
+template <class PBus, size_t buf_size, serial_mode mode>
+void serial<PBus, buf_size, mode>::bus_handler(bus_channel ch, bus_event type, size_t total)
 {
     if (ch == bus_channel::rx) {
         if (type == bus_event::tc) {
@@ -364,22 +378,22 @@ void serial<PBus, buf_size>::bus_handler(bus_channel ch, bus_event type, size_t
     }
 }
 
-template <class PBus, size_t buf_size>
-err serial<PBus, buf_size>::nonblock(bool state)
+template <class PBus, size_t buf_size, serial_mode mode>
+err serial<PBus, buf_size, mode>::nonblock(bool state)
 {
     m_nonblock = state;
     return err::ok;
 }
 
-template <class PBus, size_t buf_size>
-err serial<PBus, buf_size>::recv_byte(uint8_t &byte)
+template <class PBus, size_t buf_size, serial_mode mode>
+err serial<PBus, buf_size, mode>::recv_byte(uint8_t &byte)
 {
     size_t sz = 1;
     return recv_buf(&byte, sz);
 }
 
-template <class PBus, size_t buf_size>
-err serial<PBus, buf_size>::recv_buf(uint8_t *buf, size_t &sz)
+template <class PBus, size_t buf_size, serial_mode mode>
+err serial<PBus, buf_size, mode>::recv_buf(uint8_t *buf, size_t &sz)
 {
     ecl_assert(m_is_inited);
     ecl_assert(sz);
@@ -448,15 +462,15 @@ err serial<PBus, buf_size>::recv_buf(uint8_t *buf, size_t &sz)
     return result;
 }
 
-template <class PBus, size_t buf_size>
-err serial<PBus, buf_size>::send_byte(uint8_t byte)
+template <class PBus, size_t buf_size, serial_mode mode>
+err serial<PBus, buf_size, mode>::send_byte(uint8_t byte)
 {
     size_t sz = 1;
     return send_buf(&byte, sz);
 }
 
-template <class PBus, size_t buf_size>
-err serial<PBus, buf_size>::send_buf(const uint8_t *buf, size_t &sz)
+template <class PBus, size_t buf_size, serial_mode mode>
+err serial<PBus, buf_size, mode>::send_buf(const uint8_t *buf, size_t &sz)
 {
     ecl_assert(m_is_inited);
     ecl_assert(sz);
@@ -490,6 +504,612 @@ err serial<PBus, buf_size>::send_buf(const uint8_t *buf, size_t &sz)
     return rc;
 }
 
+//------------------------------------------------------------------------------
+
+//! Serial driver with ring buffers.
+//! \details Has the same interface as the serial in chunks mode, with
+//! following differences:
+//! - Reception is continuous. Platform bus receives data into all free space
+//!   of the RX ring and stops only if the ring is full.
+//! - Blocked reader is woken up only when amount of received data reaches
+//!   RX high watermark (or amount requested, if it is smaller).
+//! - send_buf() does not wait for previous xfer to complete, data is queued
+//!   into the TX ring. Blocked writer is woken up when TX ring is drained down
+//!   to TX low watermark.
+//! - Received data can be accessed in place with recv_span() and
+//!   recv_release().
+//! - Failure to start an xfer from the bus event handler wakes up blocked
+//!   user. The error is returned by the next recv or send call, which
+//!   then restarts the xfer.
+//!
+//! Each ring has single producer and single consumer: user context and
+//! bus event handler. Ring indexes are free-running counters, so buffer size
+//! must be power of two.
+//! \tparam PBus     Exclusively owned platform bus.
+//! \tparam buf_size Size of internal rx and tx rings.
+template<class PBus, size_t buf_size>
+class serial<PBus, buf_size, serial_mode::ring>
+{
+    static_assert(buf_size && !(buf_size & (buf_size - 1)),
+                  "Ring size must be power of two");
+
+public:
+    static constexpr auto buffer_size = buf_size;
+    using platform_handle = PBus;
+
+    serial() = delete;
+    serial(const serial &other) = delete;
+    serial(serial &&other) = delete;
+    ~serial() = delete;
+
+    //! \copydoc serial::init()
+    static err init();
+
+    //! \copydoc serial::deinit()
+    static err deinit();
+
+    //! \copydoc serial::nonblock()
+    static err nonblock(bool state = true);
+
+    //! Sets watermarks.
+    //! \details Both watermarks trade latency for amount of context switches.
+    //! Setting RX high watermark bigger than 1 makes sense only for
+    //! continuous streams, since reader stays blocked until
+    //! watermark is reached.
+    //! \param[in] rx_high Amount of bytes in RX ring to wake blocked reader.
+    //!                    Default is 1.
+    //! \param[in] tx_low  Amount of bytes left in TX ring to wake blocked
+    //!                    writer. Default is half of the ring.
+    //! \retval err::ok    Watermarks are set.
+    //! \retval err::inval Watermarks are out of the ring size.
+    static err set_watermarks(size_t rx_high, size_t tx_low);
+
+    //! \copydoc serial::recv_byte()
+    static err recv_byte(uint8_t &byte);
+
+    //! \copydoc serial::recv_buf()
+    static err recv_buf(uint8_t *buf, size_t &sz);
+
+    //! Gets contiguous span of received data without copying.
+    //! \pre Driver is initialized.
+    //! \details Blocks in the same manner as recv_buf(). Data remains in the
+    //! RX ring until recv_release() is called. Span can be shorter than
+    //! data available, if data wraps around the end of the ring.
+    //! \param[out]    buf Start of the span.
+    //! \param[in,out] sz  Maximum span size. Will be updated with actual size.
+    //! \return Operation status.
+    //! \retval err::wouldblock Non-blocking mode is set and read would block
+    //!                         otherwise.
+    static err recv_span(const uint8_t *&buf, size_t &sz);
+
+    //! Releases data obtained with recv_span().
+    //! \pre Span of at least given size was obtained.
+    //! \param[in] sz Amount of bytes to release.
+    static void recv_release(size_t sz);
+
+    //! \copydoc serial::send_byte()
+    static err send_byte(uint8_t byte);
+
+    //! \copydoc serial::send_buf()
+    static err send_buf(const uint8_t *buf, size_t &sz);
+
+private:
+    //! Mask to get position in ring from free-running counter.
+    static constexpr size_t mask = buf_size - 1;
+
+    using bsem = safe_storage<binary_semaphore>;
+    using asize_t = std::atomic_size_t;
+
+    //! Bus event handler
+    static void bus_handler(bus_channel ch, bus_event type, size_t total);
+
+    //! Starts reception into free space of the RX ring.
+    //! \details Called by user or xfer. If ring is full, reception is marked
+    //! as stalled and will be resumed by user after reading some data.
+    static void rx_start();
+
+    //! Resumes stalled reception. Called by user.
+    static void rx_resume();
+
+    //! Waits until some data is available for reading.
+    //! \param[in] sz Amount of data user is asking for.
+    //! \return Error of the failed reception, if no data left in the ring.
+    static err rx_wait(size_t sz);
+
+    //! Reports reception failure to the user and restarts reception.
+    //! Called by user, when reception is stopped.
+    static err rx_error();
+
+    //! Starts transmission of the TX ring data, if it is not yet ongoing.
+    static void tx_kick();
+
+    //! Reports transmission failure to the user and retries data in the ring.
+    //! Called by user, when transmission is stopped.
+    static err tx_error();
+
+    //! Starts transmission of contiguous chunk from the TX ring.
+    //! Called when xfer is owned by the caller.
+    static void tx_start();
+
+    //! Set if serial is initialized.
+    static bool m_is_inited;
+
+    //! Set if serial is in non-blocking mode.
+    static bool m_nonblock;
+
+    // RX ring. Head is written by xfer, tail by user.
+    static uint8_t              m_rx[buf_size];  //!< RX ring.
+    static asize_t              m_rx_head;       //!< Received bytes counter.
+    static asize_t              m_rx_tail;       //!< Read bytes counter.
+    static size_t               m_rx_xfer_size;  //!< Size of ongoing reception.
+    static size_t               m_rx_xfer_done;  //!< Bytes already received by it.
+    static std::atomic_bool     m_rx_stalled;    //!< Reception stopped, ring is full.
+    static asize_t              m_rx_want;       //!< Bytes blocked reader waits for.
+    static std::atomic<err>     m_rx_err;        //!< Reception failed to start.
+    static size_t               m_rx_high_wm;    //!< RX high watermark.
+    static bsem                 m_rx_rdy;        //!< Signalled when data is ready.
+
+    // TX ring. Head is written by user, tail by xfer.
+    static uint8_t              m_tx[buf_size];  //!< TX ring.
+    static asize_t              m_tx_head;       //!< Queued bytes counter.
+    static asize_t              m_tx_tail;       //!< Sent bytes counter.
+    static std::atomic_bool     m_tx_busy;       //!< Transmission is ongoing.
+    static asize_t              m_tx_want;       //!< Free space blocked writer waits for.
+    static std::atomic<err>     m_tx_err;        //!< Transmission failed to start.
+    static size_t               m_tx_low_wm;     //!< TX low watermark.
+    static bsem                 m_tx_rdy;        //!< Signalled when space is ready.
+};
+
+template <class PBus, size_t buf_size>
+bool serial<PBus, buf_size, serial_mode::ring>::m_is_inited;
+
+template <class PBus, size_t buf_size>
+bool serial<PBus, buf_size, serial_mode::ring>::m_nonblock;
+
+template <class PBus, size_t buf_size>
+uint8_t serial<PBus, buf_size, serial_mode::ring>::m_rx[buf_size];
+
+template <class PBus, size_t buf_size>
+std::atomic_size_t serial<PBus, buf_size, serial_mode::ring>::m_rx_head;
+
+template <class PBus, size_t buf_size>
+std::atomic_size_t serial<PBus, buf_size, serial_mode::ring>::m_rx_tail;
+
+template <class PBus, size_t buf_size>
+size_t serial<PBus, buf_size, serial_mode::ring>::m_rx_xfer_size;
+
+template <class PBus, size_t buf_size>
+size_t serial<PBus, buf_size, serial_mode::ring>::m_rx_xfer_done;
+
+template <class PBus, size_t buf_size>
+std::atomic_bool serial<PBus, buf_size, serial_mode::ring>::m_rx_stalled;
+
+template <class PBus, size_t buf_size>
+std::atomic_size_t serial<PBus, buf_size, serial_mode::ring>::m_rx_want;
+
+template <class PBus, size_t buf_size>
+std::atomic<err> serial<PBus, buf_size, serial_mode::ring>::m_rx_err;
+
+template <class PBus, size_t buf_size>
+size_t serial<PBus, buf_size, serial_mode::ring>::m_rx_high_wm = 1;
+
+template <class PBus, size_t buf_size>
+safe_storage<binary_semaphore> serial<PBus, buf_size, serial_mode::ring>::m_rx_rdy;
+
+template <class PBus, size_t buf_size>
+uint8_t serial<PBus, buf_size, serial_mode::ring>::m_tx[buf_size];
+
+template <class PBus, size_t buf_size>
+std::atomic_size_t serial<PBus, buf_size, serial_mode::ring>::m_tx_head;
+
+template <class PBus, size_t buf_size>
+std::atomic_size_t serial<PBus, buf_size, serial_mode::ring>::m_tx_tail;
+
+template <class PBus, size_t buf_size>
+std::atomic_bool serial<PBus, buf_size, serial_mode::ring>::m_tx_busy;
+
+template <class PBus, size_t buf_size>
+std::atomic_size_t serial<PBus, buf_size, serial_mode::ring>::m_tx_want;
+
+template <class PBus, size_t buf_size>
+std::atomic<err> serial<PBus, buf_size, serial_mode::ring>::m_tx_err;
+
+template <class PBus, size_t buf_size>
+size_t serial<PBus, buf_size, serial_mode::ring>::m_tx_low_wm = buf_size / 2;
+
+template <class PBus, size_t buf_size>
+safe_storage<binary_semaphore> serial<PBus, buf_size, serial_mode::ring>::m_tx_rdy;
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::init()
+{
+    ecl_assert(!m_is_inited);
+
+    m_rx_rdy.init();
+    m_tx_rdy.init();
+
+    m_rx_head = m_rx_tail = 0;
+    m_rx_xfer_size = m_rx_xfer_done = 0;
+    m_rx_stalled = false;
+    m_rx_want = 0;
+    m_rx_err = err::ok;
+
+    m_tx_head = m_tx_tail = 0;
+    m_tx_busy = false;
+    m_tx_want = 0;
+    m_tx_err = err::ok;
+
+    auto result = PBus::init();
+    if (is_error(result)) {
+        return result;
+    }
+
+    PBus::set_handler(bus_handler);
+
+    rx_start();
+
+    result = m_rx_err.exchange(err::ok);
+    if (is_error(result)) {
+        return result;
+    }
+
+    m_is_inited = true;
+    return err::ok;
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::deinit()
+{
+    ecl_assert(m_is_inited);
+    PBus::cancel_xfer();
+    PBus::reset_buffers();
+    m_is_inited = false;
+    m_rx_rdy.deinit();
+    m_tx_rdy.deinit();
+    return err::ok;
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::nonblock(bool state)
+{
+    m_nonblock = state;
+    return err::ok;
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::set_watermarks(size_t rx_high, size_t tx_low)
+{
+    if (!rx_high || rx_high > buf_size || tx_low >= buf_size) {
+        return err::inval;
+    }
+
+    m_rx_high_wm = rx_high;
+    m_tx_low_wm = tx_low;
+    return err::ok;
+}
+
+template <class PBus, size_t buf_size>
+void serial<PBus, buf_size, serial_mode::ring>::bus_handler(bus_channel ch, bus_event type, size_t total)
+{
+    if (type != bus_event::tc) {
+        // Error - ignore. TC event _must_ be supplied after possible error.
+        return;
+    }
+
+    if (ch == bus_channel::rx) {
+        ecl_assert(total > m_rx_xfer_done && total <= m_rx_xfer_size);
+
+        m_rx_head += total - m_rx_xfer_done;
+        m_rx_xfer_done = total;
+
+        // Wake up reader only if it is worth it
+        auto want = m_rx_want.load();
+        if (want && m_rx_head - m_rx_tail >= want
+                && m_rx_want.compare_exchange_strong(want, 0)) {
+            m_rx_rdy.get().signal();
+        }
+
+        if (m_rx_xfer_done == m_rx_xfer_size) {
+            // Continue reception into the rest of the ring
+            rx_start();
+        }
+    } else if (ch == bus_channel::tx) {
+        m_tx_tail += total;
+
+        auto want = m_tx_want.load();
+        if (want && buf_size - (m_tx_head - m_tx_tail) >= want
+                && m_tx_want.compare_exchange_strong(want, 0)) {
+            m_tx_rdy.get().signal();
+        }
+
+        tx_start();
+    }
+}
+
+template <class PBus, size_t buf_size>
+void serial<PBus, buf_size, serial_mode::ring>::rx_start()
+{
+    size_t space = buf_size - (m_rx_head - m_rx_tail);
+
+    if (!space) {
+        m_rx_stalled = true;
+
+        // User could read some data in between. If so, nobody will resume
+        // the reception, thus it must be done here.
+        if (m_rx_head == m_rx_tail + buf_size || !m_rx_stalled.exchange(false)) {
+            return;
+        }
+
+        space = buf_size - (m_rx_head - m_rx_tail);
+    }
+
+    auto offt = m_rx_head & mask;
+    m_rx_xfer_size = std::min(space, buf_size - offt);
+    m_rx_xfer_done = 0;
+
+    PBus::set_rx(m_rx + offt, m_rx_xfer_size);
+
+    auto rc = PBus::enable_listen_mode();
+    if (is_ok(rc)) {
+        rc = PBus::do_rx();
+    }
+
+    if (is_error(rc)) {
+        PBus::set_rx(nullptr, 0);
+
+        // Reader must not wait for data that will never come
+        m_rx_err = rc;
+        m_rx_want = 0;
+        m_rx_rdy.get().signal();
+    }
+}
+
+template <class PBus, size_t buf_size>
+void serial<PBus, buf_size, serial_mode::ring>::rx_resume()
+{
+    // Only one of user or xfer can clear the flag
+    if (m_rx_stalled.exchange(false)) {
+        rx_start();
+    }
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::rx_wait(size_t sz)
+{
+    // Data received before the failure is still delivered
+    if (m_rx_head != m_rx_tail) {
+        return err::ok;
+    }
+
+    if (m_rx_err != err::ok) {
+        return rx_error();
+    }
+
+    if (m_nonblock) {
+        return err::wouldblock;
+    }
+
+    size_t want = std::min(sz, m_rx_high_wm);
+
+    // Semaphore can be left signalled by previous wakeups, thus data
+    // is checked in a loop.
+    while (m_rx_head - m_rx_tail < want) {
+        m_rx_want = want;
+
+        // Data may arrive before want was published
+        if (m_rx_head - m_rx_tail >= want || m_rx_err != err::ok) {
+            m_rx_want = 0;
+            break;
+        }
+
+        m_rx_rdy.get().wait();
+    }
+
+    if (m_rx_head == m_rx_tail) {
+        return rx_error();
+    }
+
+    return err::ok;
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::rx_error()
+{
+    auto rc = m_rx_err.exchange(err::ok);
+
+    // Reception is stopped, nothing else can restart it
+    rx_start();
+
+    return rc;
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::recv_byte(uint8_t &byte)
+{
+    size_t sz = 1;
+    return recv_buf(&byte, sz);
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::recv_buf(uint8_t *buf, size_t &sz)
+{
+    ecl_assert(m_is_inited);
+    ecl_assert(sz);
+
+    auto rc = rx_wait(sz);
+    if (is_error(rc)) {
+        sz = 0;
+        return rc;
+    }
+
+    // Copy data in up to two pieces, if it wraps around the ring
+    size_t tail = m_rx_tail;
+    size_t to_copy = std::min(sz, m_rx_head - tail);
+    size_t offt = tail & mask;
+    size_t first = std::min(to_copy, buf_size - offt);
+
+    std::copy(m_rx + offt, m_rx + offt + first, buf);
+    std::copy(m_rx, m_rx + to_copy - first, buf + first);
+
+    m_rx_tail = tail + to_copy;
+    sz = to_copy;
+
+    rx_resume();
+
+    return err::ok;
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::recv_span(const uint8_t *&buf, size_t &sz)
+{
+    ecl_assert(m_is_inited);
+    ecl_assert(sz);
+
+    auto rc = rx_wait(sz);
+    if (is_error(rc)) {
+        sz = 0;
+        return rc;
+    }
+
+    size_t tail = m_rx_tail;
+    size_t offt = tail & mask;
+
+    buf = m_rx + offt;
+    sz = std::min({sz, m_rx_head - tail, buf_size - offt});
+
+    return err::ok;
+}
+
+template <class PBus, size_t buf_size>
+void serial<PBus, buf_size, serial_mode::ring>::recv_release(size_t sz)
+{
+    ecl_assert(m_rx_head - m_rx_tail >= sz);
+
+    m_rx_tail += sz;
+    rx_resume();
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::send_byte(uint8_t byte)
+{
+    size_t sz = 1;
+    return send_buf(&byte, sz);
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::send_buf(const uint8_t *buf, size_t &sz)
+{
+    ecl_assert(m_is_inited);
+    ecl_assert(sz);
+
+    if (m_tx_err != err::ok) {
+        sz = 0;
+        return tx_error();
+    }
+
+    if (m_tx_head - m_tx_tail == buf_size) {
+        if (m_nonblock) {
+            sz = 0;
+            return err::wouldblock;
+        }
+
+        // Wait until ring is drained down to the watermark
+        size_t want = buf_size - m_tx_low_wm;
+
+        while (buf_size - (m_tx_head - m_tx_tail) < want) {
+            m_tx_want = want;
+
+            if (buf_size - (m_tx_head - m_tx_tail) >= want
+                    || m_tx_err != err::ok) {
+                m_tx_want = 0;
+                break;
+            }
+
+            m_tx_rdy.get().wait();
+        }
+
+        if (m_tx_err != err::ok) {
+            sz = 0;
+            return tx_error();
+        }
+    }
+
+    size_t head = m_tx_head;
+    size_t to_copy = std::min(sz, buf_size - (head - m_tx_tail));
+    size_t offt = head & mask;
+    size_t first = std::min(to_copy, buf_size - offt);
+
+    std::copy(buf, buf + first, m_tx + offt);
+    std::copy(buf + first, buf + to_copy, m_tx);
+
+    m_tx_head = head + to_copy;
+
+    tx_kick();
+
+    auto rc = err::ok;
+
+    // Only part of the buffer was consumed
+    if (to_copy < sz) {
+        rc = err::again;
+    }
+
+    sz = to_copy;
+
+    return rc;
+}
+
+template <class PBus, size_t buf_size>
+void serial<PBus, buf_size, serial_mode::ring>::tx_kick()
+{
+    if (!m_tx_busy.exchange(true)) {
+        tx_start();
+    }
+}
+
+template <class PBus, size_t buf_size>
+err serial<PBus, buf_size, serial_mode::ring>::tx_error()
+{
+    auto rc = m_tx_err.exchange(err::ok);
+
+    // Transmission is stopped, nothing else can restart it
+    tx_kick();
+
+    return rc;
+}
+
+template <class PBus, size_t buf_size>
+void serial<PBus, buf_size, serial_mode::ring>::tx_start()
+{
+    size_t tail = m_tx_tail;
+    size_t fill = m_tx_head - tail;
+
+    if (!fill) {
+        m_tx_busy = false;
+
+        // User could queue data before the flag was cleared
+        if (m_tx_head != m_tx_tail) {
+            tx_kick();
+        }
+
+        return;
+    }
+
+    size_t offt = tail & mask;
+
+    PBus::set_tx(m_tx + offt, std::min(fill, buf_size - offt));
+
+    auto rc = PBus::do_tx();
+
+    if (is_error(rc)) {
+        // Nothing can be done in xfer context. Writer is woken up
+        // to get the error and retry.
+        m_tx_err = rc;
+        m_tx_busy = false;
+        m_tx_want = 0;
+        m_tx_rdy.get().signal();
+    }
+}
+
 } // namespace ecl
 
 #endif // DEV_BUS_SERIAL_HPP_
@@ -5,6 +5,13 @@
 #include "dev/bus.hpp"
 #include "mocks/platform_bus.hpp"
 
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
 #include <CppUTest/TestHarness.h>
 #include <CppUTest/CommandLineTestRunner.h>
 #include <CppUTestExt/MockSupport.h>
@@ -523,6 +530,692 @@ TEST(bus_is_ready, xfer_timeout)
 
 //------------------------------------------------------------------------------
 
+// Platform bus capable of executing scatter-gather lists natively.
+struct platform_sg_mock : platform_mock
+{
+    static void set_iovec(const ecl::bus_iovec *iov, size_t cnt)
+    {
+        mock("platform_bus")
+            .actualCall("set_iovec")
+            .withConstPointerParameter("iov", iov)
+            .withParameter("cnt", cnt);
+    }
+};
+
+using sg_bus_t = ecl::generic_bus<platform_sg_mock>;
+
+// Segment as seen by the platform bus.
+struct segment
+{
+    const uint8_t   *tx;
+    uint8_t         *rx;
+    size_t          size;
+};
+
+static std::vector<segment> segments;
+
+// Records buffers xfer was started with.
+static void record_xfer()
+{
+    auto size = std::max(platform_mock::m_tx_size, platform_mock::m_rx_size);
+    segments.push_back({platform_mock::m_tx, platform_mock::m_rx, size});
+}
+
+// Delivers events for the xfer that is in progress.
+static void finish_xfer()
+{
+    auto size = std::max(platform_mock::m_tx_size, platform_mock::m_rx_size);
+
+    platform_mock::invoke(ecl::bus_channel::tx, ecl::bus_event::tc, size);
+    if (platform_mock::m_rx) {
+        platform_mock::invoke(ecl::bus_channel::rx, ecl::bus_event::tc, size);
+    }
+    platform_mock::invoke(ecl::bus_channel::meta, ecl::bus_event::tc, 0);
+}
+
+// Completes xfer right away, recording buffers it was started with.
+static void complete_xfer()
+{
+    record_xfer();
+    finish_xfer();
+}
+
+TEST_GROUP(bus_iovec)
+{
+    // Typical command frame: header, payload and checksum
+    uint8_t hdr[4];
+    uint8_t payload[64];
+    uint8_t crc[2];
+
+    ecl::bus_iovec iov[3] = {
+        { hdr,     nullptr, sizeof(hdr) },
+        { payload, payload, sizeof(payload) },
+        { nullptr, crc,     sizeof(crc) },
+    };
+
+    void setup()
+    {
+        segments.clear();
+
+        mock().disable();
+        bus_t::init();
+        bus_t::lock();
+        mock().enable();
+
+        platform_mock::m_ignore_buffer_setters = true;
+        platform_mock::m_device = complete_xfer;
+    }
+
+    void teardown()
+    {
+        platform_mock::m_device = platform_mock::device_fn{};
+        platform_mock::m_ignore_buffer_setters = false;
+
+        mock().disable();
+        bus_t::unlock();
+        bus_t::deinit();
+        mock().enable();
+
+        mock().clear();
+    }
+
+    void check_segments(size_t from)
+    {
+        CHECK_EQUAL(from + 3, segments.size());
+
+        for (size_t i = 0; i < 3; ++i) {
+            POINTERS_EQUAL(iov[i].tx, segments[from + i].tx);
+            POINTERS_EQUAL(iov[i].rx, segments[from + i].rx);
+            CHECK_EQUAL(iov[i].size, segments[from + i].size);
+        }
+    }
+};
+
+TEST(bus_iovec, invalid_list)
+{
+    CHECK_EQUAL(ecl::err::inval, bus_t::set_buffers(iov, 0));
+    CHECK_EQUAL(ecl::err::inval, bus_t::set_buffers(nullptr, 3));
+
+    iov[1].tx = nullptr;
+    iov[1].rx = nullptr;
+    CHECK_EQUAL(ecl::err::inval, bus_t::set_buffers(iov, 3));
+}
+
+TEST(bus_iovec, segments_in_order)
+{
+    mock("platform_bus").expectNCalls(3, "do_xfer");
+    mock("platform_bus").ignoreOtherCalls();
+
+    size_t sent = 0;
+    size_t received = 0;
+
+    CHECK_EQUAL(ecl::err::ok, bus_t::set_buffers(iov, 3));
+    CHECK_EQUAL(ecl::err::ok, bus_t::xfer(&sent, &received));
+
+    check_segments(0);
+
+    // Counters accumulated across segments
+    CHECK_EQUAL(sizeof(hdr) + sizeof(payload) + sizeof(crc), sent);
+    CHECK_EQUAL(sizeof(payload) + sizeof(crc), received);
+
+    mock().checkExpectations();
+
+    // Next xfer starts from the first segment again
+    mock("platform_bus").expectNCalls(3, "do_xfer");
+    mock("platform_bus").ignoreOtherCalls();
+
+    CHECK_EQUAL(ecl::err::ok, bus_t::xfer());
+    check_segments(3);
+
+    mock().checkExpectations();
+}
+
+TEST(bus_iovec, failed_segment_stops_chain)
+{
+    mock("platform_bus")
+            .expectOneCall("do_xfer")
+            .andReturnValue(static_cast<int>(ecl::err::ok));
+    mock("platform_bus")
+            .expectOneCall("do_xfer")
+            .andReturnValue(static_cast<int>(ecl::err::io));
+    mock("platform_bus").ignoreOtherCalls();
+
+    CHECK_EQUAL(ecl::err::ok, bus_t::set_buffers(iov, 3));
+    CHECK_EQUAL(ecl::err::io, bus_t::xfer());
+
+    // Second segment is not started by the platform bus
+    CHECK_EQUAL(1, segments.size());
+
+    mock().checkExpectations();
+}
+
+TEST(bus_iovec, async_single_tc)
+{
+    mock("platform_bus").expectNCalls(3, "do_xfer");
+    mock("platform_bus").ignoreOtherCalls();
+
+    size_t tx_total = 0;
+    size_t rx_total = 0;
+    int tc_cnt = 0;
+
+    auto handler = [&](ecl::bus_channel ch, ecl::bus_event e, size_t total) {
+        if (ch == ecl::bus_channel::tx) {
+            // Totals must grow monotonically, as for a contiguous buffer
+            CHECK_TRUE(total > tx_total);
+            tx_total = total;
+        } else if (ch == ecl::bus_channel::rx) {
+            CHECK_TRUE(total > rx_total);
+            rx_total = total;
+        } else if (e == ecl::bus_event::tc) {
+            tc_cnt++;
+        }
+    };
+
+    CHECK_EQUAL(ecl::err::ok, bus_t::set_buffers(iov, 3));
+    CHECK_EQUAL(ecl::err::ok, bus_t::xfer(handler));
+
+    check_segments(0);
+    CHECK_EQUAL(1, tc_cnt);
+    CHECK_EQUAL(sizeof(hdr) + sizeof(payload) + sizeof(crc), tx_total);
+    CHECK_EQUAL(sizeof(payload) + sizeof(crc), rx_total);
+
+    mock().checkExpectations();
+}
+
+TEST(bus_iovec, plain_buffers_reset_list)
+{
+    mock("platform_bus").expectOneCall("do_xfer");
+    mock("platform_bus").ignoreOtherCalls();
+
+    CHECK_EQUAL(ecl::err::ok, bus_t::set_buffers(iov, 3));
+    CHECK_EQUAL(ecl::err::ok, bus_t::set_buffers(payload, nullptr, sizeof(payload)));
+    CHECK_EQUAL(ecl::err::ok, bus_t::xfer());
+
+    CHECK_EQUAL(1, segments.size());
+    POINTERS_EQUAL(payload, segments[0].tx);
+
+    mock().checkExpectations();
+}
+
+TEST(bus_iovec, native_list)
+{
+    mock().disable();
+    sg_bus_t::init();
+    sg_bus_t::lock();
+    mock().enable();
+
+    // List is passed as is, bus does not split it
+    mock("platform_bus").expectOneCall("reset_buffers");
+    mock("platform_bus")
+            .expectOneCall("set_iovec")
+            .withConstPointerParameter("iov", iov)
+            .withParameter("cnt", 3);
+    mock("platform_bus").expectOneCall("do_xfer");
+
+    CHECK_EQUAL(ecl::err::ok, sg_bus_t::set_buffers(iov, 3));
+    CHECK_EQUAL(ecl::err::ok, sg_bus_t::xfer());
+
+    mock().checkExpectations();
+
+    mock().disable();
+    sg_bus_t::unlock();
+    sg_bus_t::deinit();
+    mock().enable();
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(bus_queue)
+{
+    static constexpr size_t queue_len = 4;
+
+    uint8_t buf[queue_len + 1][8];
+    ecl::bus_transaction t[queue_len + 1];
+
+    // Order of completed transactions
+    std::vector<int> done;
+
+    void setup()
+    {
+        segments.clear();
+
+        mock().disable();
+        bus_t::init();
+        mock().enable();
+
+        // Only xfers are checked
+        mock("mutex").ignoreOtherCalls();
+        mock("platform_bus").ignoreOtherCalls();
+
+        platform_mock::m_ignore_buffer_setters = true;
+        // Xfers are completed by the test
+        platform_mock::m_device = record_xfer;
+
+        for (size_t i = 0; i < queue_len + 1; ++i) {
+            t[i] = ecl::bus_transaction{buf[i], nullptr, sizeof(buf[i]), 0,
+                [this, i](ecl::bus_channel ch, ecl::bus_event e, size_t total) {
+                    (void)total;
+                    if (ch == ecl::bus_channel::meta) {
+                        done.push_back(e == ecl::bus_event::tc ? i : -i);
+                    }
+                }
+            };
+        }
+    }
+
+    void teardown()
+    {
+        platform_mock::m_device = platform_mock::device_fn{};
+        platform_mock::m_ignore_buffer_setters = false;
+
+        mock().disable();
+        bus_t::deinit();
+        mock().enable();
+
+        mock().clear();
+    }
+};
+
+TEST(bus_queue, executed_in_order)
+{
+    mock("platform_bus").expectNCalls(3, "do_xfer");
+
+    for (int i = 0; i < 3; ++i) {
+        CHECK_EQUAL(ecl::err::ok, bus_t::submit(t[i]));
+    }
+
+    // Only first transaction is started
+    CHECK_EQUAL(1, segments.size());
+
+    // Next transaction starts right from completion event
+    finish_xfer();
+    CHECK_EQUAL(2, segments.size());
+    POINTERS_EQUAL(buf[1], segments[1].tx);
+
+    finish_xfer();
+    finish_xfer();
+
+    CHECK_EQUAL(3, segments.size());
+    POINTERS_EQUAL(buf[2], segments[2].tx);
+
+    CHECK_EQUAL(3, done.size());
+    for (int i = 0; i < 3; ++i) {
+        CHECK_EQUAL(i, done[i]);
+    }
+
+    mock().checkExpectations();
+
+    // Queue drained, bus is available for lock holders
+    mock().disable();
+    bus_t::lock();
+    CHECK_EQUAL(ecl::err::ok, bus_t::set_buffers(buf[0], nullptr, sizeof(buf[0])));
+    bus_t::unlock();
+}
+
+TEST(bus_queue, queue_is_full)
+{
+    for (size_t i = 0; i < queue_len; ++i) {
+        CHECK_EQUAL(ecl::err::ok, bus_t::submit(t[i]));
+    }
+
+    CHECK_EQUAL(ecl::err::busy, bus_t::submit(t[queue_len]));
+
+    // Slot is freed after completion
+    finish_xfer();
+    CHECK_EQUAL(ecl::err::ok, bus_t::submit(t[queue_len]));
+
+    for (size_t i = 0; i < queue_len; ++i) {
+        finish_xfer();
+    }
+
+    CHECK_EQUAL(queue_len + 1, done.size());
+    CHECK_EQUAL(queue_len, done.back());
+}
+
+TEST(bus_queue, invalid_transaction)
+{
+    ecl::bus_transaction empty{nullptr, nullptr, 0, 0, {}};
+    CHECK_EQUAL(ecl::err::inval, bus_t::submit(empty));
+}
+
+TEST(bus_queue, failed_start)
+{
+    mock("platform_bus")
+            .expectOneCall("do_xfer")
+            .andReturnValue(static_cast<int>(ecl::err::ok));
+    mock("platform_bus")
+            .expectOneCall("do_xfer")
+            .andReturnValue(static_cast<int>(ecl::err::io));
+    mock("platform_bus")
+            .expectOneCall("do_xfer")
+            .andReturnValue(static_cast<int>(ecl::err::ok));
+
+    for (int i = 0; i < 3; ++i) {
+        CHECK_EQUAL(ecl::err::ok, bus_t::submit(t[i]));
+    }
+
+    // Second transaction fails to start, third one follows
+    finish_xfer();
+
+    CHECK_EQUAL(2, done.size());
+    CHECK_EQUAL(0, done[0]);
+    CHECK_EQUAL(-1, done[1]);
+
+    finish_xfer();
+    CHECK_EQUAL(2, done.back());
+
+    mock().checkExpectations();
+}
+
+TEST(bus_queue, lock_waits_for_restarted_queue)
+{
+    // First queue is drained, semaphore is signalled
+    CHECK_EQUAL(ecl::err::ok, bus_t::submit(t[0]));
+    finish_xfer();
+
+    // Queue is started again
+    CHECK_EQUAL(ecl::err::ok, bus_t::submit(t[1]));
+
+    std::atomic_bool locked{false};
+    std::thread holder{[&locked] {
+        bus_t::lock();
+        locked = true;
+    }};
+
+    // Lock holder must not take the bus in the middle of the queue
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    bool locked_early = locked;
+
+    finish_xfer();
+    holder.join();
+
+    CHECK_FALSE(locked_early);
+    CHECK_TRUE(locked);
+    CHECK_EQUAL(2, done.size());
+    CHECK_EQUAL(1, done.back());
+
+    mock().disable();
+    bus_t::unlock();
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(bus_bench)
+{
+    void setup()
+    {
+        mock().disable();
+        bus_t::init();
+
+        platform_mock::m_ignore_buffer_setters = true;
+        platform_mock::m_device = complete_xfer;
+    }
+
+    void teardown()
+    {
+        platform_mock::m_device = platform_mock::device_fn{};
+        platform_mock::m_ignore_buffer_setters = false;
+
+        bus_t::deinit();
+        mock().enable();
+        mock().clear();
+    }
+};
+
+TEST(bus_bench, transaction_overhead)
+{
+    constexpr int iterations = 20000;
+
+    uint8_t hdr[4] = {};
+    uint8_t payload[64] = {};
+    uint8_t crc[2] = {};
+
+    const ecl::bus_iovec iov[3] = {
+        { hdr,     nullptr, sizeof(hdr) },
+        { payload, nullptr, sizeof(payload) },
+        { crc,     nullptr, sizeof(crc) },
+    };
+
+    auto measure = [&](const std::function<void()> &fn) {
+        segments.clear();
+        segments.reserve(3 * iterations);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            fn();
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        CHECK_EQUAL(3 * iterations, segments.size());
+        return std::chrono::duration<double, std::nano>(end - start).count()
+                / iterations;
+    };
+
+    // Segment per lock/xfer/unlock round trip
+    auto separate = measure([&] {
+        for (auto &seg : iov) {
+            bus_t::lock();
+            bus_t::set_buffers(seg.tx, nullptr, seg.size);
+            bus_t::xfer();
+            bus_t::unlock();
+        }
+    });
+
+    // Whole list within single transaction
+    auto chained = measure([&] {
+        bus_t::lock();
+        bus_t::set_buffers(iov, 3);
+        bus_t::xfer();
+        bus_t::unlock();
+    });
+
+    std::cout << "\nheader+payload+crc transaction, ns: "
+              << separate << " separate xfers, "
+              << chained << " scatter-gather\n";
+}
+
+// Bus shared by several clients, simulated in virtual time.
+// Each client submits an xfer, waits for completion, then spends some time
+// processing results before the next xfer. Waking up a client takes time too.
+class shared_bus_sim
+{
+public:
+    static constexpr unsigned xfer_us    = 100;  // Duration of single xfer
+    static constexpr unsigned wakeup_us  = 20;   // Context switch latency
+    static constexpr unsigned process_us = 150;  // Client processing time
+
+    shared_bus_sim(size_t clients, bool queued)
+        :m_clients(clients)
+        ,m_queued{queued}
+    {
+        for (size_t i = 0; i < clients; ++i) {
+            auto &c = m_clients[i];
+            c.t = ecl::bus_transaction{c.buf, nullptr, sizeof(c.buf), 0,
+                [this, i](ecl::bus_channel ch, ecl::bus_event e, size_t) {
+                    if (ch == ecl::bus_channel::meta && e == ecl::bus_event::tc) {
+                        completed(i);
+                    }
+                }
+            };
+        }
+
+        platform_mock::m_device = [this] {
+            m_bus_done = m_now + xfer_us;
+            m_busy_us += xfer_us;
+        };
+    }
+
+    ~shared_bus_sim()
+    {
+        platform_mock::m_device = platform_mock::device_fn{};
+    }
+
+    void run(unsigned xfers)
+    {
+        for (auto &c : m_clients) {
+            c.wake_at = 0;
+        }
+
+        while (m_xfers < xfers) {
+            // Pick the nearest event
+            unsigned next = m_bus_done;
+            for (auto &c : m_clients) {
+                next = std::min(next, c.wake_at);
+            }
+
+            CHECK_TRUE(next != never);
+            m_now = next;
+
+            if (m_bus_done == m_now) {
+                m_bus_done = never;
+                finish_xfer();
+                continue;
+            }
+
+            for (size_t i = 0; i < m_clients.size(); ++i) {
+                if (m_clients[i].wake_at == m_now) {
+                    m_clients[i].wake_at = never;
+                    woken(i);
+                    break;
+                }
+            }
+        }
+
+        m_utilization = 100.0 * m_busy_us / m_now;
+        m_latency = static_cast<double>(m_latency_us) / m_xfers;
+
+        // Let outstanding xfers finish and release the bus
+        while (m_bus_done != never) {
+            m_now = m_bus_done;
+            m_bus_done = never;
+            finish_xfer();
+        }
+
+        if (m_owner != none) {
+            bus_t::unlock();
+        }
+    }
+
+    double utilization() const { return m_utilization; }
+    double latency() const { return m_latency; }
+
+private:
+    static constexpr unsigned never = ~0u;
+
+    enum class state { processing, waiting_bus, xfer, holding };
+
+    struct client
+    {
+        uint8_t                 buf[16];
+        ecl::bus_transaction    t;
+        state                   st = state::processing;
+        unsigned                wake_at = never;
+        unsigned                request_at = 0;
+    };
+
+    void woken(size_t i)
+    {
+        auto &c = m_clients[i];
+
+        if (c.st == state::holding) {
+            // Client got its data, releases the bus and processes results
+            bus_t::unlock();
+            m_owner = none;
+            c.st = state::processing;
+            c.wake_at = m_now + process_us;
+            grant_next();
+            return;
+        }
+
+        if (c.st == state::processing) {
+            c.request_at = m_now;
+        }
+
+        if (m_queued) {
+            CHECK_EQUAL(ecl::err::ok, bus_t::submit(c.t));
+            c.st = state::xfer;
+        } else if (m_owner == none || m_owner == i) {
+            // Bus is free, lock would not block
+            m_owner = i;
+            bus_t::lock();
+            bus_t::set_buffers(c.buf, nullptr, sizeof(c.buf));
+            bus_t::xfer(c.t.handler);
+            c.st = state::xfer;
+        } else {
+            c.st = state::waiting_bus;
+            m_waiters.push_back(i);
+        }
+    }
+
+    void completed(size_t i)
+    {
+        auto &c = m_clients[i];
+
+        m_xfers++;
+        m_latency_us += m_now + wakeup_us - c.request_at;
+
+        c.wake_at = m_now + wakeup_us;
+        c.st = m_queued ? state::processing : state::holding;
+
+        if (m_queued) {
+            c.wake_at += process_us;
+        }
+    }
+
+    void grant_next()
+    {
+        if (m_waiters.empty()) {
+            return;
+        }
+
+        // Waiter blocked on the mutex is woken up
+        auto i = m_waiters.front();
+        m_waiters.erase(m_waiters.begin());
+        m_owner = i;
+        m_clients[i].wake_at = m_now + wakeup_us;
+    }
+
+    static constexpr size_t none = ~static_cast<size_t>(0);
+
+    std::vector<client> m_clients;
+    std::vector<size_t> m_waiters       = {};
+    bool                m_queued;
+    size_t              m_owner         = none;
+    unsigned            m_now           = 0;
+    unsigned            m_bus_done      = never;
+    unsigned            m_busy_us       = 0;
+    unsigned            m_xfers         = 0;
+    unsigned            m_latency_us    = 0;
+    double              m_utilization   = 0;
+    double              m_latency       = 0;
+};
+
+TEST(bus_bench, shared_bus_utilization)
+{
+    std::cout << "\nshared bus, " << shared_bus_sim::xfer_us << " us xfers\n"
+              << "clients  locked: util %  latency us  queued: util %  latency us\n";
+
+    for (size_t clients : { 1, 2, 3, 4 }) {
+        shared_bus_sim locked{clients, false};
+        locked.run(2000);
+
+        shared_bus_sim queued{clients, true};
+        queued.run(2000);
+
+        std::cout << std::setw(7) << clients
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(17) << locked.utilization()
+                  << std::setw(12) << locked.latency()
+                  << std::setw(16) << queued.utilization()
+                  << std::setw(12) << queued.latency() << '\n';
+
+        // Queue never leaves the bus idle while clients wait for it
+        CHECK_TRUE(queued.utilization() >= locked.utilization());
+    }
+}
+
+//------------------------------------------------------------------------------
+
 int main(int argc, char *argv[])
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
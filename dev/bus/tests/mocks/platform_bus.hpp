@@ -11,6 +11,7 @@
 #include <CppUTestExt/MockSupport.h>
 
 #include <ecl/err.hpp>
+#include <functional>
 #include <iostream>
 
 #include <dev/bus.hpp>
@@ -24,6 +25,8 @@ public:
     using channel    = ecl::bus_channel;
     using event      = ecl::bus_event;
     using handler_fn = ecl::bus_handler;
+    //! Model of a device attached to the bus. Invoked on every xfer.
+    using device_fn  = std::function< void() >;
 
     static ecl::err init()
     {
@@ -95,22 +98,41 @@ public:
     static ecl::err do_xfer()
     {
         mock("platform_bus").actualCall("do_xfer");
-        return static_cast< ecl::err >
+        auto rc = static_cast< ecl::err >
                 (mock("platform_bus").returnIntValueOrDefault(0));
+
+        // Device model is responsible for delivering xfer events
+        if (ecl::is_ok(rc) && m_device) {
+            m_device();
+        }
+
+        return rc;
     }
 
     static ecl::err do_tx()
     {
         mock("platform_bus").actualCall("do_tx");
-        return static_cast< ecl::err >
+        auto rc = static_cast< ecl::err >
                 (mock("platform_bus").returnIntValueOrDefault(0));
+
+        if (ecl::is_ok(rc) && m_device) {
+            m_device();
+        }
+
+        return rc;
     }
 
     static ecl::err do_rx()
     {
         mock("platform_bus").actualCall("do_rx");
-        return static_cast< ecl::err >
+        auto rc = static_cast< ecl::err >
                 (mock("platform_bus").returnIntValueOrDefault(0));
+
+        if (ecl::is_ok(rc) && m_device) {
+            m_device();
+        }
+
+        return rc;
     }
 
     static ecl::err cancel_xfer()
@@ -171,6 +193,8 @@ public:
 
     // Mock-specific switch
     static bool m_ignore_buffer_setters;
+    // Device attached to the bus, if any
+    static device_fn m_device;
 private:
     static handler_fn m_handler;
 };
@@ -182,5 +206,6 @@ uint8_t *platform_mock::m_rx;
 size_t platform_mock::m_tx_size;
 size_t platform_mock::m_rx_size;
 bool platform_mock::m_ignore_buffer_setters;
+platform_mock::device_fn platform_mock::m_device = platform_mock::device_fn{};
 
 #endif
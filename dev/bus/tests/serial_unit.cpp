@@ -8,8 +8,11 @@
 #include "mocks/platform_bus.hpp"
 #include "ecl/thread/semaphore.hpp"
 
-#include <thread>
+#include <chrono>
+#include <iomanip>
 #include <numeric>
+#include <thread>
+#include <vector>
 
 using serial_t = ecl::serial<platform_mock>;
 
@@ -372,6 +375,440 @@ TEST(serial, send_recv_mixed)
 
 //------------------------------------------------------------------------------
 
+using ring_t = ecl::serial<platform_mock, 64, ecl::serial_mode::ring>;
+
+// Delivers received bytes in listen mode, byte by byte.
+static void feed_rx(const uint8_t *data, size_t sz, size_t &pos)
+{
+    for (size_t i = 0; i < sz; i++) {
+        CHECK(pos < platform_mock::m_rx_size);
+        platform_mock::m_rx[pos++] = data[i];
+        platform_mock::invoke(ecl::bus_channel::rx, ecl::bus_event::tc, pos);
+    }
+}
+
+TEST_GROUP(serial_ring)
+{
+    // Position inside of current RX xfer
+    size_t rx_pos = 0;
+    // Amount of xfers started
+    size_t xfers = 0;
+    // Next byte of the stream
+    uint8_t next = 0;
+
+    void setup()
+    {
+        platform_mock::m_device = [this] {
+            rx_pos = 0;
+            xfers++;
+        };
+
+        mock().disable();
+        ring_t::init();
+        mock().enable();
+
+        mock("platform_bus").ignoreOtherCalls();
+
+        // Whole ring is used for reception
+        CHECK_EQUAL(ring_t::buffer_size, platform_mock::m_rx_size);
+    }
+
+    void teardown()
+    {
+        platform_mock::m_device = platform_mock::device_fn{};
+
+        mock().disable();
+        ring_t::nonblock(false);
+        ring_t::set_watermarks(1, ring_t::buffer_size / 2);
+        ring_t::deinit();
+        mock().enable();
+        mock().clear();
+    }
+
+    void feed(size_t sz)
+    {
+        std::vector<uint8_t> data(sz);
+        std::iota(data.begin(), data.end(), next);
+        next += sz;
+        feed_rx(data.data(), sz, rx_pos);
+    }
+
+    void read_and_check(size_t sz, uint8_t from)
+    {
+        std::vector<uint8_t> buf(sz);
+        size_t read = sz;
+
+        CHECK_EQUAL(ecl::err::ok, ring_t::recv_buf(buf.data(), read));
+        CHECK_EQUAL(sz, read);
+
+        for (size_t i = 0; i < sz; i++) {
+            CHECK_EQUAL(static_cast<uint8_t>(from + i), buf[i]);
+        }
+    }
+};
+
+TEST(serial_ring, continuous_reception)
+{
+    feed(40);
+    read_and_check(30, 0);
+
+    // End of the ring is reached, reception continues right away
+    // into space freed by the reader.
+    feed(24);
+    CHECK_EQUAL(2, xfers);
+    CHECK_EQUAL(30, platform_mock::m_rx_size);
+
+    feed(10);
+
+    // Data wraps around the ring
+    read_and_check(44, 30);
+}
+
+TEST(serial_ring, stalled_when_full)
+{
+    feed(ring_t::buffer_size);
+
+    // Nothing to receive into
+    CHECK_EQUAL(1, xfers);
+
+    read_and_check(16, 0);
+
+    // Reader resumes reception
+    CHECK_EQUAL(2, xfers);
+    CHECK_EQUAL(16, platform_mock::m_rx_size);
+
+    feed(16);
+    read_and_check(ring_t::buffer_size, 16);
+}
+
+TEST(serial_ring, span_without_copy)
+{
+    feed(ring_t::buffer_size);
+    read_and_check(ring_t::buffer_size - 8, 0);
+    feed(16);
+
+    // Span ends at the end of the ring
+    const uint8_t *span;
+    size_t sz = ring_t::buffer_size;
+    CHECK_EQUAL(ecl::err::ok, ring_t::recv_span(span, sz));
+    CHECK_EQUAL(8, sz);
+    CHECK_EQUAL(ring_t::buffer_size - 8, span[0]);
+
+    ring_t::recv_release(sz);
+
+    // Next span starts from the beginning
+    const uint8_t *span2;
+    sz = ring_t::buffer_size;
+    CHECK_EQUAL(ecl::err::ok, ring_t::recv_span(span2, sz));
+    CHECK_EQUAL(16, sz);
+    CHECK_EQUAL(ring_t::buffer_size, span2[0]);
+    CHECK(span2 < span);
+
+    ring_t::recv_release(sz);
+
+    ring_t::nonblock();
+    sz = 1;
+    CHECK_EQUAL(ecl::err::wouldblock, ring_t::recv_span(span, sz));
+}
+
+TEST(serial_ring, high_watermark)
+{
+    constexpr size_t watermark = 8;
+    CHECK_EQUAL(ecl::err::inval, ring_t::set_watermarks(0, 0));
+    CHECK_EQUAL(ecl::err::ok, ring_t::set_watermarks(watermark, 0));
+
+    std::atomic_bool recv_returned{false};
+    uint8_t buf[32];
+    size_t sz = sizeof(buf);
+
+    std::thread t([&] {
+        CHECK_EQUAL(ecl::err::ok, ring_t::recv_buf(buf, sz));
+        recv_returned = true;
+    });
+
+    // Give some time for recv_buf to block waiting for the data
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    feed(watermark - 1);
+
+    // Reader is not woken up until watermark is reached
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    CHECK_FALSE(recv_returned);
+
+    feed(1);
+    t.join();
+
+    CHECK_EQUAL(watermark, sz);
+}
+
+TEST(serial_ring, send_queued)
+{
+    uint8_t buf[ring_t::buffer_size];
+    std::iota(buf, buf + sizeof(buf), 0);
+
+    mock("platform_bus").expectOneCall("do_tx");
+
+    size_t sz = 16;
+    CHECK_EQUAL(ecl::err::ok, ring_t::send_buf(buf, sz));
+    CHECK_EQUAL(16, sz);
+
+    // Transmission is ongoing, data is queued without starting new xfer
+    sz = sizeof(buf);
+    CHECK_EQUAL(ecl::err::again, ring_t::send_buf(buf + 16, sz));
+    CHECK_EQUAL(sizeof(buf) - 16, sz);
+
+    mock().checkExpectations();
+
+    // Ring is full
+    ring_t::nonblock();
+    sz = 1;
+    CHECK_EQUAL(ecl::err::wouldblock, ring_t::send_buf(buf, sz));
+
+    // Rest of the ring is sent after first xfer completes
+    mock("platform_bus").expectOneCall("do_tx");
+    platform_mock::invoke(ecl::bus_channel::tx, ecl::bus_event::tc, 16);
+    mock().checkExpectations();
+
+    CHECK_EQUAL(sizeof(buf) - 16, platform_mock::m_tx_size);
+    CHECK_EQUAL(16, platform_mock::m_tx[0]);
+
+    // Nothing left to send
+    auto started = xfers;
+    platform_mock::invoke(ecl::bus_channel::tx, ecl::bus_event::tc, sizeof(buf) - 16);
+    CHECK_EQUAL(started, xfers);
+}
+
+TEST(serial_ring, rx_failure_wakes_reader)
+{
+    CHECK_EQUAL(ecl::err::ok, ring_t::set_watermarks(8, 0));
+
+    feed(ring_t::buffer_size - 4);
+    read_and_check(ring_t::buffer_size - 4, 0);
+
+    ecl::err rc = ecl::err::generic;
+    uint8_t buf[32];
+    size_t sz = sizeof(buf);
+
+    std::thread t([&] {
+        rc = ring_t::recv_buf(buf, sz);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Reception can't be continued at the end of the ring
+    mock("platform_bus")
+            .expectOneCall("do_rx")
+            .andReturnValue(static_cast<int>(ecl::err::io));
+    feed(4);
+    t.join();
+
+    // Reader gets data received so far, below the watermark
+    CHECK_EQUAL(ecl::err::ok, rc);
+    CHECK_EQUAL(4, sz);
+
+    // Then the error, which restarts reception
+    mock("platform_bus").expectOneCall("do_rx");
+    sz = sizeof(buf);
+    CHECK_EQUAL(ecl::err::io, ring_t::recv_buf(buf, sz));
+    CHECK_EQUAL(0, sz);
+    mock().checkExpectations();
+
+    feed(8);
+    read_and_check(8, ring_t::buffer_size);
+}
+
+TEST(serial_ring, tx_failure_wakes_writer)
+{
+    uint8_t buf[ring_t::buffer_size];
+    std::iota(buf, buf + sizeof(buf), 0);
+
+    size_t sz = sizeof(buf);
+    CHECK_EQUAL(ecl::err::ok, ring_t::send_buf(buf, sz));
+
+    ecl::err rc = ecl::err::generic;
+    size_t blocked_sz = 1;
+
+    std::thread t([&] {
+        rc = ring_t::send_buf(buf, blocked_sz);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    // Rest of the ring fails to start, woken writer retries it
+    mock("platform_bus")
+            .expectOneCall("do_tx")
+            .andReturnValue(static_cast<int>(ecl::err::io));
+    mock("platform_bus").expectOneCall("do_tx");
+    platform_mock::invoke(ecl::bus_channel::tx, ecl::bus_event::tc, 16);
+    t.join();
+
+    CHECK_EQUAL(ecl::err::io, rc);
+    CHECK_EQUAL(0, blocked_sz);
+    mock().checkExpectations();
+    CHECK_EQUAL(16, platform_mock::m_tx[0]);
+
+    // Transmission is ongoing, data is just queued
+    sz = 16;
+    CHECK_EQUAL(ecl::err::ok, ring_t::send_buf(buf, sz));
+    CHECK_EQUAL(16, sz);
+}
+
+TEST(serial_ring, tx_failure_with_full_ring)
+{
+    uint8_t buf[ring_t::buffer_size];
+    std::iota(buf, buf + sizeof(buf), 0);
+
+    // Whole ring is queued, but transmission fails to start
+    mock("platform_bus")
+            .expectOneCall("do_tx")
+            .andReturnValue(static_cast<int>(ecl::err::io));
+
+    size_t sz = sizeof(buf);
+    CHECK_EQUAL(ecl::err::ok, ring_t::send_buf(buf, sz));
+    mock().checkExpectations();
+
+    // Error is reported and the ring is retried
+    mock("platform_bus").expectOneCall("do_tx");
+    sz = 1;
+    CHECK_EQUAL(ecl::err::io, ring_t::send_buf(buf, sz));
+    CHECK_EQUAL(0, sz);
+    mock().checkExpectations();
+
+    CHECK_EQUAL(ring_t::buffer_size, platform_mock::m_tx_size);
+
+    // Ring is still full, blocking writer is woken up by the completion
+    // and starts transmission of its byte
+    mock("platform_bus").expectOneCall("do_tx");
+    std::atomic_bool sent{false};
+    std::thread t([&] {
+        size_t one = 1;
+        CHECK_EQUAL(ecl::err::ok, ring_t::send_buf(buf, one));
+        sent = true;
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    bool sent_early = sent;
+
+    platform_mock::invoke(ecl::bus_channel::tx, ecl::bus_event::tc, ring_t::buffer_size);
+    t.join();
+
+    CHECK_FALSE(sent_early);
+    CHECK_TRUE(sent);
+    mock().checkExpectations();
+}
+
+//------------------------------------------------------------------------------
+
+// Stream delivered to serial at constant rate, read by periodically woken
+// reader, which drains everything received so far.
+struct stream_stats
+{
+    size_t dropped  = 0;    //!< Bytes lost, since reception was stalled.
+    size_t xfers    = 0;    //!< RX xfers started by the driver.
+    size_t reads    = 0;    //!< recv_buf() calls.
+    double latency  = 0;    //!< Average byte age when read, in byte times.
+    double ns       = 0;    //!< Driver time per byte.
+};
+
+template<class Serial>
+static stream_stats run_stream(size_t bytes, size_t period)
+{
+    stream_stats st;
+    size_t rx_pos = 0;
+    size_t arrived = 0;
+    size_t read = 0;
+    double age = 0;
+
+    // Arrival time of each received byte
+    std::vector<size_t> stamps;
+
+    platform_mock::m_device = [&] { rx_pos = 0; st.xfers++; };
+
+    mock().disable();
+    Serial::init();
+    Serial::nonblock();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t tick = 1; tick <= bytes; ++tick) {
+        if (platform_mock::m_rx && rx_pos < platform_mock::m_rx_size) {
+            platform_mock::m_rx[rx_pos++] = static_cast<uint8_t>(arrived++);
+            platform_mock::invoke(ecl::bus_channel::rx, ecl::bus_event::tc, rx_pos);
+            stamps.push_back(tick);
+        } else {
+            st.dropped++;
+        }
+
+        if (tick % period) {
+            continue;
+        }
+
+        uint8_t buf[32];
+        size_t sz = sizeof(buf);
+
+        while (ecl::is_ok(Serial::recv_buf(buf, sz))) {
+            for (size_t i = 0; i < sz; ++i) {
+                CHECK_EQUAL(static_cast<uint8_t>(read), buf[i]);
+                age += tick - stamps[read++];
+            }
+
+            st.reads++;
+            sz = sizeof(buf);
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    Serial::nonblock(false);
+    Serial::deinit();
+    mock().enable();
+
+    platform_mock::m_device = platform_mock::device_fn{};
+
+    st.latency = age / read;
+    st.ns = std::chrono::duration<double, std::nano>(end - start).count() / bytes;
+    return st;
+}
+
+TEST_GROUP(serial_bench)
+{
+    void teardown()
+    {
+        mock().clear();
+    }
+};
+
+TEST(serial_bench, chunks_vs_ring)
+{
+    using chunks_t = ecl::serial<platform_mock, 128>;
+    using ring128_t = ecl::serial<platform_mock, 128, ecl::serial_mode::ring>;
+
+    constexpr size_t bytes = 64 * 1024;
+
+    std::cout << "\n\n128-byte buffers, " << bytes << " bytes stream\n"
+              << "reader period  mode    dropped  rx xfers  reads  latency  ns/byte\n";
+
+    for (size_t period : { 16, 48, 96, 120 }) {
+        auto chunks = run_stream<chunks_t>(bytes, period);
+        auto ring = run_stream<ring128_t>(bytes, period);
+
+        for (auto p : { std::make_pair("chunks", chunks), std::make_pair("ring", ring) }) {
+            std::cout << std::setw(13) << period
+                      << std::setw(8) << p.first
+                      << std::setw(11) << p.second.dropped
+                      << std::setw(10) << p.second.xfers
+                      << std::setw(7) << p.second.reads
+                      << std::setw(9) << std::fixed << std::setprecision(1)
+                      << p.second.latency
+                      << std::setw(9) << p.second.ns << '\n';
+        }
+
+        // Ring never stalls while reader keeps up with its size
+        CHECK_EQUAL(0, ring.dropped);
+    }
+}
+
+//------------------------------------------------------------------------------
+
 int main(int argc, char *argv[])
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
@@ -198,6 +198,17 @@ public:
     //!
     static err pcm_stream_start(const uint16_t *buffer, size_t count, user_callback callback);
 
+    //! Starts stream, fed by the streamer.
+    //! \details Streamer buffer is filled before the stream is started and
+    //! then refilled on each HT and TC event, see ecl::pcm_streamer.
+    //! Streamer must outlive the stream.
+    //! \tparam Streamer Streamer type, i.e. ecl::pcm_streamer.
+    //! \param streamer Streamer which provides the buffer and handles events.
+    //! \retval Status of the operation.
+    //!
+    template< class Streamer >
+    static err pcm_stream_start(Streamer &streamer);
+
     //! Stop active stream. Must not be called if stream is not active.
     //! \details This method stops active PCM stream. It is recommended to call this method
     //! during processing of the HT or TC event. In case this method is called during
@@ -478,6 +489,17 @@ err cs43l22< I2c, I2s, Rst_gpio >::pcm_stream_start(const uint16_t *buffer, size
     return rc;
 }
 
+template < class I2c, class I2s, class Rst_gpio >
+template < class Streamer >
+err cs43l22< I2c, I2s, Rst_gpio >::pcm_stream_start(Streamer &streamer)
+{
+    streamer.prime();
+
+    return pcm_stream_start(streamer.buffer(), streamer.size(), [&streamer](ecl::bus_event type) {
+        streamer.on_event(type);
+    });
+}
+
 template < class I2c, class I2s, class Rst_gpio >
 err cs43l22< I2c, I2s, Rst_gpio >::pcm_stream_stop()
 {
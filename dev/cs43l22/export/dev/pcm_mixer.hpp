@@ -0,0 +1,210 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Fixed-point mixer of several PCM sources.
+//! \details Mixer is a PCM source itself, so it can be streamed with
+//! pcm_streamer. Samples are mixed in chunks: each source is read into
+//! a scratch chunk, scaled by the source volume and accumulated in 32 bits.
+//! Accumulated chunk is saturated to 16 bits. Both loops are branchless
+//! and operate on contiguous arrays, so compiler is able to vectorize them.
+
+#ifndef DEV_PCM_MIXER_HPP
+#define DEV_PCM_MIXER_HPP
+
+#include <ecl/assert.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace ecl
+{
+
+//! \addtogroup dev External device drivers
+//! @{
+
+//! \addtogroup pcm PCM streaming
+//! @{
+
+namespace detail
+{
+
+//! Scales samples by Q15 volume and adds them to the accumulator.
+inline void pcm_mix_add(int32_t *__restrict acc, const int16_t *__restrict src,
+                        uint16_t volume, size_t count)
+{
+    // Product fits in 32 bits for any volume up to 0xffff
+    for (size_t i = 0; i < count; ++i) {
+        acc[i] += (src[i] * static_cast<int32_t>(volume)) >> 15;
+    }
+}
+
+//! Saturates accumulated samples to 16 bits.
+inline void pcm_mix_saturate(int16_t *__restrict out, const int32_t *__restrict acc,
+                             size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = static_cast<int16_t>(std::min(std::max(acc[i], int32_t{INT16_MIN}),
+                                               int32_t{INT16_MAX}));
+    }
+}
+
+} // namespace detail
+
+//! Mixes several PCM sources with per-source volume.
+//! \details Sources must provide the same interface as pcm_queue:
+//! read() and queued() methods. Attaching and detaching sources and
+//! changing volume must not race with read().
+//! \tparam Source  Source type, i.e. pcm_queue.
+//! \tparam Sources Max amount of sources.
+//! \tparam Chunk   Amount of samples mixed at once. Scratch buffers of
+//!                 this size are allocated on the stack by read().
+template<class Source, size_t Sources, size_t Chunk = 64>
+class pcm_mixer
+{
+    static_assert(Sources > 0, "Mixer must have at least one source");
+    static_assert(Chunk > 0, "Chunk can't be empty");
+
+public:
+    //! Volume of the source, that keeps samples unchanged.
+    //! \details Volume is a Q15 fixed-point gain, so values above unity
+    //! amplify the source, up to 2x.
+    static constexpr uint16_t unity = 0x8000;
+
+    //! Constructs mixer without sources.
+    pcm_mixer();
+
+    //! Attaches source to the slot.
+    //! \param[in] slot   Slot index, less than Sources.
+    //! \param[in] src    Source of samples.
+    //! \param[in] volume Q15 gain.
+    void attach(size_t slot, Source &src, uint16_t volume = unity);
+
+    //! Detaches source from the slot.
+    void detach(size_t slot);
+
+    //! Sets volume of the source in the slot.
+    void set_volume(size_t slot, uint16_t volume);
+
+    //! Mixes samples from all sources.
+    //! \details Sources that ran out of samples are treated as silence.
+    //! \param[out] out   Destination.
+    //! \param[in]  count Amount of samples to produce.
+    //! \return Amount of produced samples: max amount read from any source.
+    size_t read(int16_t *out, size_t count);
+
+    //! Gets amount of samples ready to be mixed: max across sources.
+    size_t queued() const;
+
+private:
+    //! Source slot.
+    struct slot
+    {
+        Source      *src;       //!< Source, or nullptr if slot is empty.
+        uint16_t    volume;     //!< Q15 gain.
+    };
+
+    //! Mixes single chunk.
+    size_t mix_chunk(int16_t *out, size_t count);
+
+    slot m_slots[Sources];  //!< Sources.
+};
+
+//------------------------------------------------------------------------------
+
+template<class Source, size_t Sources, size_t Chunk>
+pcm_mixer<Source, Sources, Chunk>::pcm_mixer()
+    :m_slots{}
+{
+}
+
+template<class Source, size_t Sources, size_t Chunk>
+void pcm_mixer<Source, Sources, Chunk>::attach(size_t slot, Source &src, uint16_t volume)
+{
+    ecl_assert(slot < Sources);
+    m_slots[slot].src = &src;
+    m_slots[slot].volume = volume;
+}
+
+template<class Source, size_t Sources, size_t Chunk>
+void pcm_mixer<Source, Sources, Chunk>::detach(size_t slot)
+{
+    ecl_assert(slot < Sources);
+    m_slots[slot].src = nullptr;
+}
+
+template<class Source, size_t Sources, size_t Chunk>
+void pcm_mixer<Source, Sources, Chunk>::set_volume(size_t slot, uint16_t volume)
+{
+    ecl_assert(slot < Sources);
+    m_slots[slot].volume = volume;
+}
+
+template<class Source, size_t Sources, size_t Chunk>
+size_t pcm_mixer<Source, Sources, Chunk>::read(int16_t *out, size_t count)
+{
+    size_t done = 0;
+
+    while (done < count) {
+        auto n = std::min(count - done, Chunk);
+        auto got = mix_chunk(out + done, n);
+
+        done += got;
+
+        if (got < n) {
+            // All sources ran dry
+            break;
+        }
+    }
+
+    return done;
+}
+
+template<class Source, size_t Sources, size_t Chunk>
+size_t pcm_mixer<Source, Sources, Chunk>::queued() const
+{
+    size_t ret = 0;
+
+    for (auto &s : m_slots) {
+        if (s.src) {
+            ret = std::max(ret, s.src->queued());
+        }
+    }
+
+    return ret;
+}
+
+template<class Source, size_t Sources, size_t Chunk>
+size_t pcm_mixer<Source, Sources, Chunk>::mix_chunk(int16_t *out, size_t count)
+{
+    int32_t acc[Chunk];
+    int16_t scratch[Chunk];
+    size_t produced = 0;
+
+    std::fill(acc, acc + count, 0);
+
+    for (auto &s : m_slots) {
+        if (!s.src) {
+            continue;
+        }
+
+        auto got = s.src->read(scratch, count);
+
+        // Short source is padded with silence by the accumulator itself
+        detail::pcm_mix_add(acc, scratch, s.volume, got);
+        produced = std::max(produced, got);
+    }
+
+    detail::pcm_mix_saturate(out, acc, produced);
+    return produced;
+}
+
+//! @}
+
+//! @}
+
+} // namespace ecl
+
+#endif // DEV_PCM_MIXER_HPP
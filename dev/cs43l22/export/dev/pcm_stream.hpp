@@ -0,0 +1,280 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Queued PCM streaming over a circular DMA buffer.
+//! \details Threads queue blocks of PCM samples, DMA streams a circular
+//! buffer to the codec. On every half-transfer and transfer-complete event
+//! the half of the buffer that was just played is refilled from a source,
+//! in IRQ context. Samples are copied from the queued blocks directly into
+//! the DMA buffer, without intermediate buffers.
+//!
+//! Samples are 16 bit, signed, interleaved: LRLR...
+
+#ifndef DEV_PCM_STREAM_HPP
+#define DEV_PCM_STREAM_HPP
+
+#include <common/bus.hpp>
+#include <ecl/assert.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace ecl
+{
+
+//! \addtogroup dev External device drivers
+//! @{
+
+//! \defgroup pcm PCM streaming
+//! @{
+
+//! Single-producer, single-consumer queue of PCM blocks.
+//! \details Producer is a thread, consumer is the stream IRQ handler.
+//! Queue holds pointers to the blocks, not the samples, so block memory
+//! must stay valid until the block is consumed. See consumed().
+//! \tparam N Max amount of queued blocks, power of 2.
+template<size_t N>
+class pcm_queue
+{
+    static_assert(N && !(N & (N - 1)), "Queue length must be a power of 2");
+
+public:
+    //! Constructs empty queue.
+    pcm_queue();
+
+    //! Queues a block. Producer side.
+    //! \param[in] data  Samples. Must stay valid until the block is consumed.
+    //! \param[in] count Amount of samples, not zero. Must hold whole stereo
+    //!                  frames, otherwise channels of the following blocks
+    //!                  are swapped.
+    //! \retval true  Block is queued.
+    //! \retval false Queue is full.
+    bool push(const int16_t *data, size_t count);
+
+    //! Copies queued samples. Consumer side.
+    //! \param[out] out   Destination.
+    //! \param[in]  count Amount of samples to copy.
+    //! \return Amount of copied samples, less than requested if queue ran dry.
+    size_t read(int16_t *out, size_t count);
+
+    //! Gets amount of queued samples, not yet consumed.
+    size_t queued() const { return m_queued.load(std::memory_order_relaxed); }
+
+    //! Gets amount of free block slots.
+    size_t space() const;
+
+    //! Gets total amount of consumed blocks.
+    //! \details Blocks are consumed in order they were pushed, so the
+    //! producer may reuse memory of the first consumed() blocks it pushed.
+    size_t consumed() const { return m_tail.load(std::memory_order_acquire); }
+
+private:
+    //! Queued block.
+    struct block
+    {
+        const int16_t   *data;  //!< Samples.
+        size_t          count;  //!< Amount of samples.
+    };
+
+    block                   m_blocks[N];    //!< Ring of blocks.
+    std::atomic<size_t>     m_head;         //!< Next block to push.
+    std::atomic<size_t>     m_tail;         //!< Block being consumed.
+    std::atomic<size_t>     m_queued;       //!< Samples queued.
+    size_t                  m_offset;       //!< Consumed samples of the tail block.
+};
+
+//! PCM stream statistics.
+struct pcm_stream_stats
+{
+    uint32_t refills;       //!< Buffer halves refilled.
+    uint32_t underruns;     //!< Refills, finished with silence due to lack of data.
+    uint32_t silence;       //!< Samples of silence inserted due to underruns.
+    uint32_t errors;        //!< Bus error events.
+    uint32_t max_queued;    //!< Max samples waiting in the source at refill.
+                            //!< Worst case latency, in samples.
+};
+
+//! Streams samples from the source through a circular DMA buffer.
+//! \details Source must provide following methods, safe to be called
+//! from IRQ:
+//! - size_t read(int16_t *out, size_t count) - writes up to count samples
+//!   and returns amount written.
+//! - size_t queued() const - returns amount of samples ready to be read.
+//!
+//! Usage with CS43L22 codec:
+//! \code
+//! static ecl::pcm_queue<8> queue;
+//! static ecl::pcm_streamer<ecl::pcm_queue<8>, 512> streamer{queue};
+//! codec::pcm_stream_start(streamer);
+//! // ...
+//! queue.push(samples, count);
+//! \endcode
+//! \tparam Source Source of samples, i.e. pcm_queue or pcm_mixer.
+//! \tparam Half   Samples in each half of the DMA buffer.
+template<class Source, size_t Half>
+class pcm_streamer
+{
+    static_assert(Half && Half % 2 == 0, "Half of the buffer must hold whole stereo frames");
+    static_assert(Half * 2 <= 0xffff, "DMA transfer is limited to 0xffff samples");
+
+public:
+    //! Constructs streamer.
+    //! \param[in] src Source of samples.
+    explicit pcm_streamer(Source &src);
+
+    //! Fills the whole buffer. Must be called before the stream is started.
+    void prime();
+
+    //! Handles bus event. Must be called from the stream callback.
+    //! \param[in] type Event type.
+    void on_event(bus_event type);
+
+    //! Gets DMA buffer.
+    const uint16_t *buffer() const { return reinterpret_cast<const uint16_t *>(m_buf); }
+
+    //! Gets DMA buffer size in samples.
+    static constexpr size_t size() { return Half * 2; }
+
+    //! Gets statistics.
+    const pcm_stream_stats &stats() const { return m_stats; }
+
+    //! Resets statistics.
+    void reset_stats() { m_stats = pcm_stream_stats{}; }
+
+private:
+    //! Refills half of the buffer.
+    void refill(int16_t *half);
+
+    Source              &m_src;         //!< Source of samples.
+    int16_t             m_buf[Half * 2];//!< DMA buffer.
+    pcm_stream_stats    m_stats;        //!< Statistics.
+};
+
+//------------------------------------------------------------------------------
+
+template<size_t N>
+pcm_queue<N>::pcm_queue()
+    :m_blocks{}
+    ,m_head{0}
+    ,m_tail{0}
+    ,m_queued{0}
+    ,m_offset{0}
+{
+}
+
+template<size_t N>
+bool pcm_queue<N>::push(const int16_t *data, size_t count)
+{
+    ecl_assert(data && count);
+    ecl_assert(count % 2 == 0);
+
+    auto head = m_head.load(std::memory_order_relaxed);
+
+    if (head - m_tail.load(std::memory_order_acquire) == N) {
+        return false;
+    }
+
+    m_blocks[head & (N - 1)] = block{data, count};
+    m_queued.fetch_add(count, std::memory_order_relaxed);
+    m_head.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+template<size_t N>
+size_t pcm_queue<N>::read(int16_t *out, size_t count)
+{
+    auto tail = m_tail.load(std::memory_order_relaxed);
+    auto head = m_head.load(std::memory_order_acquire);
+    size_t done = 0;
+
+    while (done < count && tail != head) {
+        auto &b = m_blocks[tail & (N - 1)];
+        auto n = std::min(count - done, b.count - m_offset);
+
+        memcpy(out + done, b.data + m_offset, n * sizeof(*out));
+        done += n;
+        m_offset += n;
+
+        if (m_offset == b.count) {
+            // Block is consumed, producer can reuse its slot and memory
+            m_offset = 0;
+            m_tail.store(++tail, std::memory_order_release);
+        }
+    }
+
+    m_queued.fetch_sub(done, std::memory_order_relaxed);
+    return done;
+}
+
+template<size_t N>
+size_t pcm_queue<N>::space() const
+{
+    return N - (m_head.load(std::memory_order_relaxed) - m_tail.load(std::memory_order_acquire));
+}
+
+//------------------------------------------------------------------------------
+
+template<class Source, size_t Half>
+pcm_streamer<Source, Half>::pcm_streamer(Source &src)
+    :m_src(src)
+    ,m_buf{}
+    ,m_stats{}
+{
+}
+
+template<class Source, size_t Half>
+void pcm_streamer<Source, Half>::prime()
+{
+    refill(m_buf);
+    refill(m_buf + Half);
+}
+
+template<class Source, size_t Half>
+void pcm_streamer<Source, Half>::on_event(bus_event type)
+{
+    switch (type) {
+    case bus_event::ht:
+        // First half is played, DMA proceeds with the second one
+        refill(m_buf);
+        break;
+    case bus_event::tc:
+        refill(m_buf + Half);
+        break;
+    case bus_event::err:
+        m_stats.errors++;
+        break;
+    }
+}
+
+template<class Source, size_t Half>
+void pcm_streamer<Source, Half>::refill(int16_t *half)
+{
+    auto queued = m_src.queued();
+    if (queued > m_stats.max_queued) {
+        m_stats.max_queued = queued;
+    }
+
+    auto got = m_src.read(half, Half);
+
+    if (got < Half) {
+        std::fill(half + got, half + Half, 0);
+        m_stats.underruns++;
+        m_stats.silence += Half - got;
+    }
+
+    m_stats.refills++;
+}
+
+//! @}
+
+//! @}
+
+} // namespace ecl
+
+#endif // DEV_PCM_STREAM_HPP
@@ -0,0 +1,126 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Mixer throughput, in output samples per second.
+
+#include <dev/pcm_mixer.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+static constexpr size_t half = 512;
+static constexpr size_t iterations = 20000;
+
+// Endless source: decoded clip played in a loop
+struct clip
+{
+    size_t read(int16_t *out, size_t count)
+    {
+        for (size_t done = 0; done < count; ) {
+            auto n = std::min(count - done, half - pos);
+            std::copy(samples + pos, samples + pos + n, out + done);
+            done += n;
+            pos = (pos + n) % half;
+        }
+
+        return count;
+    }
+
+    size_t queued() const { return half; }
+
+    int16_t samples[half];
+    size_t  pos;
+};
+
+// Sample-by-sample float mixing, as a baseline
+template<size_t Sources>
+struct naive_mixer
+{
+    size_t read(int16_t *out, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i) {
+            float sum = 0;
+
+            for (size_t s = 0; s < Sources; ++s) {
+                int16_t v;
+                src[s]->read(&v, 1);
+                sum += v * volume[s];
+            }
+
+            sum = sum > INT16_MAX ? INT16_MAX : sum < INT16_MIN ? INT16_MIN : sum;
+            out[i] = static_cast<int16_t>(sum);
+        }
+
+        return count;
+    }
+
+    clip    *src[Sources];
+    float   volume[Sources];
+};
+
+// Returns output samples per second
+template<class Mixer>
+static double measure(Mixer &m)
+{
+    static int16_t out[half];
+    int32_t check = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < iterations; ++i) {
+        m.read(out, half);
+        check += out[i % half];
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    // Keep the result alive
+    CHECK(check != INT32_MIN);
+
+    return 1e9 * iterations * half / ns;
+}
+
+TEST_GROUP(pcm_mixer_bench)
+{
+};
+
+TEST(pcm_mixer_bench, throughput)
+{
+    constexpr size_t sources = 4;
+    static clip clips[sources];
+
+    for (size_t s = 0; s < sources; ++s) {
+        for (size_t i = 0; i < half; ++i) {
+            clips[s].samples[i] = static_cast<int16_t>(i * (s + 3) * 97);
+        }
+    }
+
+    ecl::pcm_mixer<clip, sources> fixed;
+    naive_mixer<sources> naive;
+
+    for (size_t s = 0; s < sources; ++s) {
+        fixed.attach(s, clips[s], 0x2000 * (s + 1));
+        naive.src[s] = &clips[s];
+        naive.volume[s] = (s + 1) / 4.f;
+    }
+
+    auto naive_sps = measure(naive);
+    auto fixed_sps = measure(fixed);
+
+    std::cout << "\n\nMixer throughput, " << sources << " sources, Msamples/sec\n"
+              << std::setw(16) << "per-sample: " << naive_sps / 1e6 << '\n'
+              << std::setw(16) << "fixed-point: " << fixed_sps / 1e6 << '\n';
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
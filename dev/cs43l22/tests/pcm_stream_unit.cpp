@@ -0,0 +1,350 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <dev/pcm_stream.hpp>
+#include <dev/pcm_mixer.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+//------------------------------------------------------------------------------
+
+// Simulated I2S bus in circular DMA mode.
+// Plays samples one by one and reports HT and TC events, as DMA does.
+template<class Streamer>
+struct i2s_sim
+{
+    explicit i2s_sim(Streamer &s) :streamer(s) { }
+
+    void play(size_t count)
+    {
+        const int16_t *buf = reinterpret_cast<const int16_t *>(streamer.buffer());
+        size_t size = streamer.size();
+
+        for (size_t i = 0; i < count; ++i) {
+            played.push_back(buf[pos++]);
+
+            if (pos == size / 2) {
+                streamer.on_event(ecl::bus_event::ht);
+            } else if (pos == size) {
+                pos = 0;
+                streamer.on_event(ecl::bus_event::tc);
+            }
+        }
+    }
+
+    Streamer                &streamer;
+    size_t                  pos = 0;
+    std::vector<int16_t>    played;
+};
+
+static std::vector<int16_t> ramp(int16_t from, size_t count)
+{
+    std::vector<int16_t> ret(count);
+
+    for (size_t i = 0; i < count; ++i) {
+        ret[i] = from + i;
+    }
+
+    return ret;
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(pcm_queue)
+{
+};
+
+TEST(pcm_queue, read_across_blocks)
+{
+    ecl::pcm_queue<4> q;
+    auto a = ramp(1, 10);
+    auto b = ramp(11, 6);
+
+    CHECK_TRUE(q.push(a.data(), a.size()));
+    CHECK_TRUE(q.push(b.data(), b.size()));
+    CHECK_EQUAL(16U, q.queued());
+    CHECK_EQUAL(2U, q.space());
+
+    int16_t out[12];
+    CHECK_EQUAL(12U, q.read(out, 12));
+    CHECK_EQUAL(1U, q.consumed());
+    CHECK_EQUAL(4U, q.queued());
+
+    for (int i = 0; i < 12; ++i) {
+        CHECK_EQUAL(i + 1, out[i]);
+    }
+
+    // Queue runs dry
+    CHECK_EQUAL(4U, q.read(out, 12));
+    CHECK_EQUAL(2U, q.consumed());
+    CHECK_EQUAL(0U, q.queued());
+    CHECK_EQUAL(13, out[0]);
+    CHECK_EQUAL(16, out[3]);
+
+    CHECK_EQUAL(0U, q.read(out, 12));
+}
+
+TEST(pcm_queue, full)
+{
+    ecl::pcm_queue<2> q;
+    int16_t s[4] = {};
+
+    CHECK_TRUE(q.push(s, 4));
+    CHECK_TRUE(q.push(s, 4));
+    CHECK_FALSE(q.push(s, 4));
+    CHECK_EQUAL(0U, q.space());
+
+    int16_t out[4];
+    q.read(out, 4);
+    CHECK_TRUE(q.push(s, 4));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(pcm_streamer)
+{
+};
+
+TEST(pcm_streamer, plays_queued_blocks_in_order)
+{
+    using queue_type = ecl::pcm_queue<8>;
+    queue_type q;
+    ecl::pcm_streamer<queue_type, 16> s{q};
+    i2s_sim<decltype(s)> bus{s};
+
+    auto a = ramp(1, 20);
+    auto b = ramp(21, 76);
+    q.push(a.data(), a.size());
+    q.push(b.data(), b.size());
+
+    s.prime();
+    CHECK_EQUAL(64U, q.queued());
+
+    bus.play(64);
+
+    CHECK_EQUAL(64U, bus.played.size());
+    for (int i = 0; i < 64; ++i) {
+        CHECK_EQUAL(i + 1, bus.played[i]);
+    }
+
+    CHECK_EQUAL(0U, s.stats().underruns);
+    CHECK_EQUAL(6U, s.stats().refills);
+    CHECK_EQUAL(96U, s.stats().max_queued);
+    CHECK_EQUAL(0U, q.queued());
+}
+
+TEST(pcm_streamer, underrun_inserts_silence)
+{
+    using queue_type = ecl::pcm_queue<4>;
+    queue_type q;
+    ecl::pcm_streamer<queue_type, 8> s{q};
+    i2s_sim<decltype(s)> bus{s};
+
+    auto a = ramp(1, 12);
+    q.push(a.data(), a.size());
+
+    s.prime();
+    bus.play(32);
+
+    for (int i = 0; i < 12; ++i) {
+        CHECK_EQUAL(i + 1, bus.played[i]);
+    }
+
+    for (int i = 12; i < 32; ++i) {
+        CHECK_EQUAL(0, bus.played[i]);
+    }
+
+    // Second half is short at priming, then every refill is empty
+    CHECK_EQUAL(5U, s.stats().underruns);
+    CHECK_EQUAL(4U + 4 * 8, s.stats().silence);
+
+    // Stream recovers when data arrives, after the half being played
+    // and the one refilled with silence
+    auto b = ramp(100, 8);
+    q.push(b.data(), b.size());
+    bus.play(24);
+
+    for (int i = 32; i < 48; ++i) {
+        CHECK_EQUAL(0, bus.played[i]);
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        CHECK_EQUAL(100 + i, bus.played[48 + i]);
+    }
+
+    s.on_event(ecl::bus_event::err);
+    CHECK_EQUAL(1U, s.stats().errors);
+
+    s.reset_stats();
+    CHECK_EQUAL(0U, s.stats().refills);
+}
+
+TEST(pcm_streamer, threaded_producer)
+{
+    constexpr size_t block = 96;
+    constexpr size_t pool = 8;
+    constexpr size_t blocks = 2000;
+
+    using queue_type = ecl::pcm_queue<pool>;
+    queue_type q;
+    ecl::pcm_streamer<queue_type, 128> s{q};
+    i2s_sim<decltype(s)> bus{s};
+
+    std::atomic<bool> done{false};
+
+    // Producer reuses block memory once it is consumed
+    std::thread producer([&] {
+        static int16_t mem[pool][block];
+        int16_t next = 1;
+
+        for (size_t i = 0; i < blocks; ++i) {
+            while (!q.space()) {
+                std::this_thread::yield();
+            }
+
+            auto &m = mem[i % pool];
+            for (auto &v : m) {
+                v = next;
+                next = next == INT16_MAX ? 1 : next + 1;
+            }
+
+            q.push(m, block);
+        }
+
+        done = true;
+    });
+
+    s.prime();
+
+    while (!done || q.queued()) {
+        bus.play(64);
+        std::this_thread::yield();
+    }
+
+    producer.join();
+
+    // Apart from inserted silence, samples go in the order they were produced
+    int16_t expected = 1;
+    size_t samples = 0;
+
+    for (auto v : bus.played) {
+        if (!v) {
+            continue;
+        }
+
+        CHECK_EQUAL(expected, v);
+        expected = expected == INT16_MAX ? 1 : expected + 1;
+        samples++;
+    }
+
+    // Samples still in the DMA buffer are not played yet
+    CHECK(samples + s.size() >= blocks * block);
+    CHECK(samples <= blocks * block);
+    CHECK_EQUAL(blocks, q.consumed());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(pcm_mixer)
+{
+};
+
+TEST(pcm_mixer, golden)
+{
+    using queue_type = ecl::pcm_queue<4>;
+    queue_type a, b;
+    ecl::pcm_mixer<queue_type, 3, 4> m;
+
+    int16_t sa[] = { 1000, -1000, 2000, -2000, 30000, -30000, 7, 0, 4, -4 };
+    int16_t sb[] = { 100,  200,   300,  400,   10000, -10000 };
+
+    a.push(sa, 10);
+    b.push(sb, 6);
+
+    m.attach(0, a);
+    m.attach(2, b, 0x4000);
+    CHECK_EQUAL(10U, m.queued());
+
+    int16_t out[12] = {};
+    CHECK_EQUAL(10U, m.read(out, 12));
+
+    // Second source at half volume, the sum is saturated, shorter source
+    // is silent after its end
+    int16_t expected[] = { 1050, -900, 2150, -1800, 32767, -32768, 7, 0, 4, -4 };
+    MEMCMP_EQUAL(expected, out, sizeof(expected));
+}
+
+TEST(pcm_mixer, volume)
+{
+    using queue_type = ecl::pcm_queue<4>;
+    queue_type a;
+    ecl::pcm_mixer<queue_type, 1> m;
+
+    int16_t sa[] = { 1000, -1000, 20000, -20000 };
+    a.push(sa, 4);
+    m.attach(0, a, 0xc000);
+
+    int16_t out[4];
+    CHECK_EQUAL(4U, m.read(out, 4));
+
+    int16_t expected[] = { 1500, -1500, 30000, -30000 };
+    MEMCMP_EQUAL(expected, out, sizeof(expected));
+
+    a.push(sa, 4);
+    m.set_volume(0, 0);
+    CHECK_EQUAL(4U, m.read(out, 4));
+
+    for (auto v : out) {
+        CHECK_EQUAL(0, v);
+    }
+
+    a.push(sa, 4);
+    m.detach(0);
+    CHECK_EQUAL(0U, m.read(out, 4));
+    CHECK_EQUAL(0U, m.queued());
+}
+
+TEST(pcm_mixer, streamed)
+{
+    using queue_type = ecl::pcm_queue<4>;
+    using mixer_type = ecl::pcm_mixer<queue_type, 2, 8>;
+    queue_type a, b;
+    mixer_type m;
+    ecl::pcm_streamer<mixer_type, 16> s{m};
+    i2s_sim<decltype(s)> bus{s};
+
+    auto sa = ramp(1, 40);
+    auto sb = ramp(1000, 24);
+    a.push(sa.data(), sa.size());
+    b.push(sb.data(), sb.size());
+    m.attach(0, a);
+    m.attach(1, b);
+
+    s.prime();
+    bus.play(64);
+
+    for (int i = 0; i < 24; ++i) {
+        CHECK_EQUAL(1000 + 2 * i + 1, bus.played[i]);
+    }
+
+    for (int i = 24; i < 40; ++i) {
+        CHECK_EQUAL(i + 1, bus.played[i]);
+    }
+
+    for (int i = 40; i < 64; ++i) {
+        CHECK_EQUAL(0, bus.played[i]);
+    }
+
+    CHECK_EQUAL(4U, s.stats().underruns);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
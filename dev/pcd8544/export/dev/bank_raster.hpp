@@ -0,0 +1,348 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Monochrome framebuffer with raster primitives.
+//! \details Framebuffer layout matches RAM of displays like PCD8544:
+//! each byte holds 8 vertically adjacent pixels (bank), least significant
+//! bit is the top one. Bytes of a single column are contiguous.
+//! Primitives operate on whole bytes, applying edge masks only where
+//! shape boundary does not match bank boundary.
+
+#ifndef DEV_BANK_RASTER_HPP
+#define DEV_BANK_RASTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ecl
+{
+
+//! \addtogroup dev External device drivers
+//! @{
+
+//! \defgroup raster Monochrome raster graphics
+//! @{
+
+//! Operation applied to pixels.
+enum class raster_op
+{
+    set,    //!< Set pixels.
+    clear,  //!< Clear pixels.
+    flip,   //!< Invert pixels.
+    copy,   //!< Replace pixels. Same as set, if used for shapes.
+};
+
+//! 1-bpp image, in the same bank layout as the framebuffer.
+struct bitmap
+{
+    const uint8_t   *data;      //!< Columns, (height + 7) / 8 bytes each.
+    int             width;      //!< Width in pixels.
+    int             height;     //!< Height in pixels.
+};
+
+//! Monochrome framebuffer.
+//! \details Tracks changed bytes, so display driver can send only
+//! modified parts of the framebuffer. Drawing outside of the framebuffer
+//! is clipped.
+//! \tparam W Width in pixels.
+//! \tparam H Height in pixels, up to 64.
+template<int W, int H>
+class bank_raster
+{
+    static_assert(W > 0 && H > 0, "Raster can't be empty");
+    static_assert(H <= 64, "Modified banks of a column must fit in a byte");
+
+public:
+    //! Width in pixels.
+    static constexpr int width = W;
+    //! Height in pixels.
+    static constexpr int height = H;
+    //! Amount of banks in each column.
+    static constexpr int banks = (H + 7) / 8;
+    //! Framebuffer size in bytes.
+    static constexpr size_t size = W * banks;
+
+    //! Constructs cleared framebuffer, marked as modified.
+    bank_raster();
+
+    //! Gets pixel value. Pixels outside of the framebuffer are clear.
+    bool get_point(int x, int y) const;
+
+    //! Applies an operation to a single pixel.
+    //! \return false if pixel is outside of the framebuffer.
+    bool set_point(int x, int y, raster_op op = raster_op::set);
+
+    //! Draws horizontal line from x0 to x1, inclusive.
+    void hline(int x0, int x1, int y, raster_op op = raster_op::set);
+
+    //! Draws vertical line from y0 to y1, inclusive.
+    void vline(int x, int y0, int y1, raster_op op = raster_op::set);
+
+    //! Fills a rectangle.
+    void fill_rect(int x, int y, int w, int h, raster_op op = raster_op::set);
+
+    //! Fills whole framebuffer.
+    void fill(raster_op op) { fill_rect(0, 0, W, H, op); }
+
+    //! Draws bitmap with its top left corner at given position.
+    //! \details Position is not required to be aligned to banks.
+    void blit(int x, int y, const bitmap &bmp, raster_op op = raster_op::copy);
+
+    //! Draws text with its top left corner at given position.
+    //! \details Characters not present in the font are skipped.
+    //! Characters are separated with a single column.
+    //! \tparam Font Font type, see font_5x7.
+    //! \return Position after the last character.
+    template<class Font>
+    int draw_text(int x, int y, const char *str, raster_op op = raster_op::copy);
+
+    //! Gets framebuffer bytes.
+    //! \details Column x, bank b resides at offset x * banks + b.
+    const uint8_t *data() const { return &m_data[0][0]; }
+
+    //! Checks if byte at given offset was modified.
+    bool is_dirty(size_t offt) const { return m_dirty[offt / banks] & (1 << (offt % banks)); }
+
+    //! Marks whole framebuffer as not modified.
+    void mark_clean();
+
+    //! Marks whole framebuffer as modified.
+    void mark_dirty();
+
+private:
+    //! Bits of the bank that hold pixels.
+    static constexpr uint8_t bank_mask(int b)
+    {
+        return H - b * 8 >= 8 ? 0xff : (1 << (H - b * 8)) - 1;
+    }
+
+    //! Applies operation to masked bits of a byte.
+    static void apply(uint8_t &byte, uint8_t mask, uint8_t bits, raster_op op);
+
+    //! Applies operation to a byte and marks it modified, if it is changed.
+    void apply_at(int x, int b, uint8_t mask, uint8_t bits, raster_op op);
+
+    uint8_t m_data[W][banks];   //!< Pixels.
+    uint8_t m_dirty[W];         //!< Bit per modified bank of each column.
+};
+
+//------------------------------------------------------------------------------
+
+template<int W, int H>
+bank_raster<W, H>::bank_raster()
+    :m_data{}
+    ,m_dirty{}
+{
+    mark_dirty();
+}
+
+template<int W, int H>
+bool bank_raster<W, H>::get_point(int x, int y) const
+{
+    if (x < 0 || y < 0 || x >= W || y >= H) {
+        return false;
+    }
+
+    return m_data[x][y >> 3] & (1 << (y & 7));
+}
+
+template<int W, int H>
+bool bank_raster<W, H>::set_point(int x, int y, raster_op op)
+{
+    if (x < 0 || y < 0 || x >= W || y >= H) {
+        return false;
+    }
+
+    uint8_t bit = 1 << (y & 7);
+    apply_at(x, y >> 3, bit, bit, op);
+    return true;
+}
+
+template<int W, int H>
+void bank_raster<W, H>::hline(int x0, int x1, int y, raster_op op)
+{
+    if (x0 > x1) {
+        int tmp = x0;
+        x0 = x1;
+        x1 = tmp;
+    }
+
+    fill_rect(x0, y, x1 - x0 + 1, 1, op);
+}
+
+template<int W, int H>
+void bank_raster<W, H>::vline(int x, int y0, int y1, raster_op op)
+{
+    if (y0 > y1) {
+        int tmp = y0;
+        y0 = y1;
+        y1 = tmp;
+    }
+
+    fill_rect(x, y0, 1, y1 - y0 + 1, op);
+}
+
+template<int W, int H>
+void bank_raster<W, H>::fill_rect(int x, int y, int w, int h, raster_op op)
+{
+    // Clip, x1 and y1 are exclusive
+    int x1 = x + w > W ? W : x + w;
+    int y1 = y + h > H ? H : y + h;
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+
+    int b0 = y0 >> 3;
+    int b1 = (y1 - 1) >> 3;
+
+    for (int b = b0; b <= b1; ++b) {
+        // Rows of the bank covered by the rectangle
+        uint8_t mask = bank_mask(b);
+
+        if (b == b0) {
+            mask &= 0xff << (y0 & 7);
+        }
+
+        if (b == b1) {
+            mask &= 0xff >> (7 - ((y1 - 1) & 7));
+        }
+
+        for (int i = x0; i < x1; ++i) {
+            apply_at(i, b, mask, mask, op);
+        }
+    }
+}
+
+template<int W, int H>
+void bank_raster<W, H>::blit(int x, int y, const bitmap &bmp, raster_op op)
+{
+    int src_banks = (bmp.height + 7) / 8;
+
+    // Bank and shift of the top row. Rounded down for negative positions.
+    int db = y >= 0 ? y / 8 : -((-y + 7) / 8);
+    int shift = y - db * 8;
+
+    for (int i = 0; i < bmp.width; ++i) {
+        int dx = x + i;
+
+        if (dx < 0) {
+            continue;
+        }
+
+        if (dx >= W) {
+            break;
+        }
+
+        const uint8_t *col = bmp.data + i * src_banks;
+
+        for (int sb = 0; sb < src_banks; ++sb) {
+            // Rows of the source bank that hold pixels
+            int rows = bmp.height - sb * 8;
+            uint16_t mask = rows >= 8 ? 0xff : (1 << rows) - 1;
+            uint16_t bits = col[sb] & mask;
+
+            // Source byte spans two destination banks
+            mask <<= shift;
+            bits <<= shift;
+
+            int b = db + sb;
+
+            if (b >= 0 && b < banks) {
+                apply_at(dx, b, mask, bits, op);
+            }
+
+            if (shift && b + 1 >= 0 && b + 1 < banks) {
+                apply_at(dx, b + 1, mask >> 8, bits >> 8, op);
+            }
+        }
+    }
+}
+
+template<int W, int H>
+template<class Font>
+int bank_raster<W, H>::draw_text(int x, int y, const char *str, raster_op op)
+{
+    for (; *str; ++str) {
+        auto glyph = Font::glyph(*str);
+
+        if (!glyph) {
+            continue;
+        }
+
+        blit(x, y, bitmap{glyph, Font::width, Font::height}, op);
+        x += Font::width;
+
+        // Spacing between characters
+        if (op == raster_op::copy) {
+            fill_rect(x, y, 1, Font::height, raster_op::clear);
+        }
+
+        x++;
+    }
+
+    return x;
+}
+
+template<int W, int H>
+void bank_raster<W, H>::mark_clean()
+{
+    for (auto &d : m_dirty) {
+        d = 0;
+    }
+}
+
+template<int W, int H>
+void bank_raster<W, H>::mark_dirty()
+{
+    for (auto &d : m_dirty) {
+        d = (1 << banks) - 1;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+template<int W, int H>
+void bank_raster<W, H>::apply(uint8_t &byte, uint8_t mask, uint8_t bits, raster_op op)
+{
+    switch (op) {
+    case raster_op::set:
+        byte |= bits;
+        break;
+    case raster_op::clear:
+        byte &= ~bits;
+        break;
+    case raster_op::flip:
+        byte ^= bits;
+        break;
+    case raster_op::copy:
+        byte = (byte & ~mask) | bits;
+        break;
+    }
+}
+
+template<int W, int H>
+void bank_raster<W, H>::apply_at(int x, int b, uint8_t mask, uint8_t bits, raster_op op)
+{
+    uint8_t &byte = m_data[x][b];
+    uint8_t prev = byte;
+
+    mask &= bank_mask(b);
+    apply(byte, mask, bits & mask, op);
+
+    if (byte != prev) {
+        m_dirty[x] |= 1 << b;
+    }
+}
+
+//! @}
+
+//! @}
+
+} // namespace ecl
+
+#endif // DEV_BANK_RASTER_HPP
@@ -5,6 +5,8 @@
 #ifndef DEV_PCD8544_HPP
 #define DEV_PCD8544_HPP
 
+#include <dev/bank_raster.hpp>
+
 #include <ecl/thread/semaphore.hpp>
 #include <ecl/thread/utils.hpp>
 
@@ -37,6 +39,9 @@ template< class Spi, class Cs_gpio, class Mode_gpio, class Rst_gpio >
 class pcd8544
 {
 public:
+    // Framebuffer type
+    using raster_type = bank_raster< 84, 48 >;
+
     pcd8544();
     ~pcd8544();
 
@@ -54,19 +59,23 @@ public:
     err set_point(const point& coord);
     err clear_point(const point& coord);
 
-    // Sends VRAM data to a display
+    // Framebuffer access, for batched drawing: lines, rectangles,
+    // bitmaps and text. Changes are sent on the next flush().
+    raster_type& raster() { return m_fb; }
+
+    // Sends VRAM data, modified since last flush, to a display.
+    // Modified spans are coalesced if they are close enough.
     // err::ok if succeed
     err flush();
     err clear();
 
+    // Marks whole VRAM as modified, so next flush() sends everything.
+    // Useful if display RAM content is lost, i.e. after reset.
+    void invalidate();
+
 private:
     // Rows as they are represented in a device
-    static constexpr uint8_t cols   = 84;
-    static constexpr uint8_t rows   = 6;
-
-    // Logical boundaries
-    static constexpr uint8_t max_X  = 84;
-    static constexpr uint8_t max_Y  = 48;
+    static constexpr uint8_t rows   = raster_type::banks;
 
     // D/C values
     enum class DC_state
@@ -125,6 +134,17 @@ private:
     // Bias system mask
     static constexpr uint8_t BS_mask            = 0b00000111;
 
+    // Address opcodes, H = 0:
+
+    // Set Y address (bank) of RAM prefix
+    static constexpr uint8_t Y_addr_prefix      = 0b01000000;
+    // Set X address (column) of RAM prefix
+    static constexpr uint8_t X_addr_prefix      = 0b10000000;
+
+    // Max amount of unmodified bytes sent between two modified spans, to
+    // avoid extra addressing. Setting the address takes 2 command bytes.
+    static constexpr size_t coalesce_gap        = 2;
+
     // VOP opcodes:
 
     // VOP prefix
@@ -135,20 +155,23 @@ private:
     // Blocking send
     err send(uint8_t byte, DC_state op);
 
-    // Bulk data write
+    // Bulk data write of modified spans
     err internal_flush();
 
-    uint8_t                 m_array[84][6];    // TODO: magic numbers
+    // Writes VRAM bytes in [start, end), addressed in vertical mode order
+    err write_span(size_t start, size_t end);
+
+    raster_type             m_fb;              // VRAM, tracks modified bytes
     ecl::binary_semaphore   m_sem;             // Handle bus events
 };
 
 
 template< class Spi, class Cs_gpio, class Mode_gpio, class Rst_gpio >
 pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::pcd8544()
-    :m_array{0}
+    :m_fb{}
     ,m_sem{}
 {
-
+    // Display RAM content is unknown, raster is constructed as modified
     Cs_gpio::set();
     Rst_gpio::set();
     Mode_gpio::set();
@@ -222,47 +245,19 @@ err pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::close()
 template< class Spi, class Cs_gpio, class Mode_gpio, class Rst_gpio >
 err pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::set_point(const point& coord)
 {
-    // TODO: checks
-    // TODO: common parts (see clear_point())
-    int x = coord.get_x();
-    int y = coord.get_y();
-
-    if (x < 0 || y < 0 || x > 83 || y > 47)
+    if (!m_fb.set_point(coord.get_x(), coord.get_y(), raster_op::set))
         return err::inval;
 
-    // Calculate a byte offcet
-    int y_byte = y >> 3;
-
-    // Calculate a bit offcet inside a byte
-    int y_bit = y & 0x7;
-
-    // Set appropriate bit
-    m_array[x][y_byte] |= (1 << y_bit);
-
     return err::ok;
 }
 
 template< class Spi, class Cs_gpio, class Mode_gpio, class Rst_gpio >
 err pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::clear_point(const point& coord)
 {
-    // TODO: checks
-    // TODO: common parts (see set_point())
-    int x = coord.get_x();
-    int y = coord.get_y();
-
-    if (x < 0 || y < 0 || x > 83 || y > 47)
-        return -1;
-
-    // Calculate a byte offcet
-    int y_byte = y >> 3;
-
-    // Calculate a bit offcet inside a byte
-    int y_bit = y & 0x7;
-
-    // Clear appropriate bit
-    m_array[x][y_byte] &= ~(1 << y_bit);
+    if (!m_fb.set_point(coord.get_x(), coord.get_y(), raster_op::clear))
+        return err::inval;
 
-    return 0;
+    return err::ok;
 }
 
 template< class Spi, class Cs_gpio, class Mode_gpio, class Rst_gpio >
@@ -274,17 +269,16 @@ err pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::flush()
 template< class Spi, class Cs_gpio, class Mode_gpio, class Rst_gpio >
 err pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::clear()
 {
-    // TODO: improve error check
-    // TODO: memset
-    for (unsigned i = 0; i < 84; ++i) {
-        for (unsigned j = 0; j < 6; ++j) {
-            m_array[i][j] = 0;
-        }
-    }
-
+    m_fb.fill(raster_op::clear);
     return err::ok;
 }
 
+template< class Spi, class Cs_gpio, class Mode_gpio, class Rst_gpio >
+void pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::invalidate()
+{
+    m_fb.mark_dirty();
+}
+
 //------------------------------------------------------------------------------
 // Private members
 
@@ -313,14 +307,65 @@ err pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::send(uint8_t byte, DC_state op
 template< class Spi, class Cs_gpio, class Mode_gpio, class Rst_gpio >
 err pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::internal_flush()
 {
+    constexpr size_t total = raster_type::size;
+    size_t i = 0;
+
+    while (i < total) {
+        // Skip unmodified bytes
+        while (i < total && !m_fb.is_dirty(i)) {
+            ++i;
+        }
+
+        if (i == total) {
+            break;
+        }
+
+        size_t start = i;
+        size_t end = i + 1;
+
+        // Extend the span while gaps between modified bytes are small
+        for (size_t j = end; j < total && j - end <= coalesce_gap; ++j) {
+            if (m_fb.is_dirty(j)) {
+                end = j + 1;
+            }
+        }
+
+        auto rc = write_span(start, end);
+        if (is_error(rc)) {
+            return rc;
+        }
+
+        i = end;
+    }
+
+    m_fb.mark_clean();
+    return err::ok;
+}
+
+template< class Spi, class Cs_gpio, class Mode_gpio, class Rst_gpio >
+err pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::write_span(size_t start, size_t end)
+{
+    // In vertical addressing mode, address is incremented by bank first,
+    // so the span is contiguous both in VRAM and in the display RAM.
+    uint8_t addr[] = {
+        static_cast< uint8_t >(X_addr_prefix | (start / rows)),
+        static_cast< uint8_t >(Y_addr_prefix | (start % rows)),
+    };
+
     Spi::lock();
 
-    Mode_gpio::set();
+    Mode_gpio::reset();
     Cs_gpio::reset();
 
-    auto tx = reinterpret_cast< uint8_t* > (m_array);
-    Spi::set_buffers(tx, nullptr, sizeof(m_array));
-    Spi::xfer();
+    Spi::set_buffers(addr, nullptr, sizeof(addr));
+    auto rc = Spi::xfer();
+
+    if (is_ok(rc)) {
+        Mode_gpio::set();
+
+        Spi::set_buffers(m_fb.data() + start, nullptr, end - start);
+        rc = Spi::xfer();
+    }
 
     Spi::unlock();
 
@@ -328,7 +373,7 @@ err pcd8544< Spi, Cs_gpio, Mode_gpio, Rst_gpio >::internal_flush()
     Cs_gpio::set();
     Mode_gpio::reset();
 
-    return err::ok;
+    return rc;
 }
 
 } // namespace ecl
@@ -0,0 +1,289 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <dev/pcd8544.hpp>
+
+#include <cstring>
+#include <iostream>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+//------------------------------------------------------------------------------
+// Mocks
+
+template<int id>
+struct mock_gpio
+{
+    static void set()   { state = true; }
+    static void reset() { state = false; }
+
+    static bool state;
+};
+
+template<int id>
+bool mock_gpio<id>::state;
+
+using cs_gpio   = mock_gpio<0>;
+using mode_gpio = mock_gpio<1>;
+using rst_gpio  = mock_gpio<2>;
+
+// Display controller, listening to the SPI bus
+struct mock_display
+{
+    void reset()
+    {
+        memset(ram, 0xaa, sizeof(ram));
+        x = y = 0;
+        cmd_bytes = data_bytes = 0;
+    }
+
+    void receive(const uint8_t *data, size_t size)
+    {
+        CHECK_FALSE(cs_gpio::state);
+
+        for (size_t i = 0; i < size; ++i) {
+            if (mode_gpio::state) {
+                data_bytes++;
+                ram[x][y] = data[i];
+
+                // Vertical addressing
+                if (++y == 6) {
+                    y = 0;
+                    x = (x + 1) % 84;
+                }
+            } else {
+                cmd_bytes++;
+
+                if (data[i] & 0x80) {
+                    x = data[i] & 0x7f;
+                } else if (data[i] & 0x40) {
+                    y = data[i] & 0x07;
+                }
+            }
+        }
+    }
+
+    size_t bytes() const { return cmd_bytes + data_bytes; }
+
+    uint8_t ram[84][6];
+    int     x;
+    int     y;
+    size_t  cmd_bytes;
+    size_t  data_bytes;
+};
+
+static mock_display display;
+
+struct mock_spi
+{
+    static ecl::err init() { return ecl::err::ok; }
+    static void lock() { }
+    static void unlock() { }
+
+    static ecl::err set_buffers(const uint8_t *tx, uint8_t *rx, size_t size)
+    {
+        CHECK_TRUE(tx);
+        CHECK_FALSE(rx);
+        m_tx = tx;
+        m_size = size;
+        return ecl::err::ok;
+    }
+
+    static ecl::err xfer()
+    {
+        display.receive(m_tx, m_size);
+        return ecl::err::ok;
+    }
+
+    static const uint8_t    *m_tx;
+    static size_t           m_size;
+};
+
+const uint8_t *mock_spi::m_tx;
+size_t mock_spi::m_size;
+
+using lcd_type = ecl::pcd8544<mock_spi, cs_gpio, mode_gpio, rst_gpio>;
+
+//------------------------------------------------------------------------------
+
+// Reference framebuffer, same layout as display RAM
+static uint8_t golden[84][6];
+
+static void set_point(lcd_type &lcd, int x, int y, bool on)
+{
+    if (on) {
+        CHECK_EQUAL(ecl::err::ok, lcd.set_point({x, y}));
+        golden[x][y >> 3] |= 1 << (y & 7);
+    } else {
+        CHECK_EQUAL(ecl::err::ok, lcd.clear_point({x, y}));
+        golden[x][y >> 3] &= ~(1 << (y & 7));
+    }
+}
+
+// Draws 5x8 digit made of segments, digit occupies columns [x, x + 5)
+static void draw_digit(lcd_type &lcd, int x, int y, int digit)
+{
+    // Segments a-g for each digit
+    static const uint8_t segs[] = { 0x3f, 0x06, 0x5b, 0x4f, 0x66,
+                                    0x6d, 0x7d, 0x07, 0x7f, 0x6f };
+
+    uint8_t s = segs[digit];
+
+    for (int i = 0; i < 5; ++i) {
+        set_point(lcd, x + i, y,     s & 0x01);    // a
+        set_point(lcd, x + i, y + 3, s & 0x40);    // g
+        set_point(lcd, x + i, y + 7, s & 0x08);    // d
+    }
+
+    for (int j = 0; j < 8; ++j) {
+        set_point(lcd, x + 4, y + j, (j < 4 ? s & 0x02 : s & 0x04));   // b, c
+        set_point(lcd, x,     y + j, (j < 4 ? s & 0x20 : s & 0x10));   // f, e
+    }
+}
+
+static void check_display()
+{
+    MEMCMP_EQUAL(golden, display.ram, sizeof(golden));
+}
+
+TEST_GROUP(pcd8544)
+{
+    void setup()
+    {
+        display.reset();
+        memset(golden, 0, sizeof(golden));
+    }
+};
+
+TEST(pcd8544, first_flush_sends_everything)
+{
+    lcd_type lcd;
+
+    CHECK_EQUAL(ecl::err::ok, lcd.flush());
+    CHECK_EQUAL(504, display.data_bytes);
+    check_display();
+
+    // Nothing changed
+    display.cmd_bytes = display.data_bytes = 0;
+    CHECK_EQUAL(ecl::err::ok, lcd.flush());
+    CHECK_EQUAL(0, display.bytes());
+}
+
+TEST(pcd8544, single_point)
+{
+    lcd_type lcd;
+    lcd.flush();
+    display.cmd_bytes = display.data_bytes = 0;
+
+    set_point(lcd, 40, 21, true);
+    CHECK_EQUAL(ecl::err::ok, lcd.flush());
+
+    // Address and a single byte
+    CHECK_EQUAL(2, display.cmd_bytes);
+    CHECK_EQUAL(1, display.data_bytes);
+    check_display();
+
+    // Setting already set point does not modify anything
+    display.cmd_bytes = display.data_bytes = 0;
+    set_point(lcd, 40, 21, true);
+    lcd.flush();
+    CHECK_EQUAL(0, display.bytes());
+}
+
+TEST(pcd8544, close_spans_coalesced)
+{
+    lcd_type lcd;
+    lcd.flush();
+    display.cmd_bytes = display.data_bytes = 0;
+
+    // Same bank in adjacent columns: bytes are 6 bytes apart in RAM,
+    // so they are sent separately
+    set_point(lcd, 10, 0, true);
+    set_point(lcd, 11, 0, true);
+    // Adjacent banks in a column, with one unmodified bank gap
+    set_point(lcd, 20, 0, true);
+    set_point(lcd, 20, 16, true);
+
+    lcd.flush();
+    check_display();
+    CHECK_EQUAL(6, display.cmd_bytes);
+    CHECK_EQUAL(5, display.data_bytes);
+}
+
+TEST(pcd8544, clear_and_invalidate)
+{
+    lcd_type lcd;
+    lcd.flush();
+
+    set_point(lcd, 0, 0, true);
+    set_point(lcd, 83, 47, true);
+    lcd.flush();
+
+    display.cmd_bytes = display.data_bytes = 0;
+    lcd.clear();
+    memset(golden, 0, sizeof(golden));
+    lcd.flush();
+    check_display();
+    CHECK_EQUAL(2, display.data_bytes);
+
+    // Display is reset, RAM is lost
+    display.reset();
+    lcd.invalidate();
+    lcd.flush();
+    check_display();
+    CHECK_EQUAL(504, display.data_bytes);
+}
+
+TEST(pcd8544, ui_updates)
+{
+    lcd_type lcd;
+    lcd.flush();
+
+    // Clock "12:34" and progress bar frame
+    draw_digit(lcd, 20, 16, 1);
+    draw_digit(lcd, 27, 16, 2);
+    draw_digit(lcd, 38, 16, 3);
+    draw_digit(lcd, 45, 16, 4);
+
+    for (int x = 10; x < 74; ++x) {
+        set_point(lcd, x, 36, true);
+        set_point(lcd, x, 43, true);
+    }
+
+    lcd.flush();
+    check_display();
+
+    // Minute change: 12:34 -> 12:35
+    display.cmd_bytes = display.data_bytes = 0;
+    draw_digit(lcd, 45, 16, 5);
+    lcd.flush();
+    check_display();
+
+    auto digit_bytes = display.bytes();
+
+    // Progress bar advances by 2%
+    display.cmd_bytes = display.data_bytes = 0;
+    for (int x = 30; x < 32; ++x) {
+        for (int y = 38; y < 42; ++y) {
+            set_point(lcd, x, y, true);
+        }
+    }
+    lcd.flush();
+    check_display();
+
+    auto bar_bytes = display.bytes();
+
+    std::cout << "\n\nBytes sent per flush, full vs partial:\n"
+              << "  clock digit: 504 vs " << digit_bytes << '\n'
+              << "  progress bar: 504 vs " << bar_bytes << '\n';
+
+    CHECK_TRUE(digit_bytes < 20);
+    CHECK_TRUE(bar_bytes < 10);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,117 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Cost of raster primitives: batched against per-pixel drawing.
+
+#include <dev/bank_raster.hpp>
+#include <dev/font_5x7.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+static constexpr auto iterations = 2000;
+
+using raster_type = ecl::bank_raster<84, 48>;
+
+static const char text[] = "12:34 Battery 87%";
+
+// Per-pixel drawing, as done with pcd8544::set_point()
+struct per_pixel
+{
+    static void fill_rect(raster_type &r, int x, int y, int w, int h)
+    {
+        for (int i = x; i < x + w; ++i) {
+            for (int j = y; j < y + h; ++j) {
+                r.set_point(i, j);
+            }
+        }
+    }
+
+    static void text(raster_type &r, int x, int y, const char *str)
+    {
+        for (; *str; ++str, x += 6) {
+            auto glyph = ecl::font_5x7::glyph(*str);
+
+            for (int i = 0; i < 6; ++i) {
+                for (int j = 0; j < 7; ++j) {
+                    bool on = i < 5 && (glyph[i] & (1 << j));
+                    r.set_point(x + i, y + j, on ? ecl::raster_op::set : ecl::raster_op::clear);
+                }
+            }
+        }
+    }
+};
+
+struct batched
+{
+    static void fill_rect(raster_type &r, int x, int y, int w, int h)
+    {
+        r.fill_rect(x, y, w, h);
+    }
+
+    static void text(raster_type &r, int x, int y, const char *str)
+    {
+        r.draw_text<ecl::font_5x7>(x, y, str);
+    }
+};
+
+// Draws a typical screen: frame, progress bar and two text lines
+template<class Drawer>
+static void draw_screen(raster_type &r, int i)
+{
+    Drawer::fill_rect(r, 0, 0, 84, 1);
+    Drawer::fill_rect(r, 0, 47, 84, 1);
+    Drawer::fill_rect(r, 0, 0, 1, 48);
+    Drawer::fill_rect(r, 83, 0, 1, 48);
+    Drawer::fill_rect(r, 4, 30, 10 + i % 60, 10);
+    Drawer::text(r, 3, 3 + i % 4, text);
+    Drawer::text(r, 3, 18, text);
+}
+
+// Returns nanoseconds per screen
+template<class Drawer>
+static uint64_t measure(raster_type &r)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        r.fill(ecl::raster_op::clear);
+        draw_screen<Drawer>(r, i);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()
+            / iterations;
+}
+
+TEST_GROUP(raster_bench)
+{
+};
+
+TEST(raster_bench, screen_cost)
+{
+    raster_type slow;
+    raster_type fast;
+
+    auto pixel_ns = measure<per_pixel>(slow);
+    auto batch_ns = measure<batched>(fast);
+
+    std::cout << "\n\nScreen drawing cost, ns per screen\n"
+              << std::setw(16) << "per-pixel: " << pixel_ns << '\n'
+              << std::setw(16) << "batched: " << batch_ns << '\n';
+
+    // Both paths produce the same picture
+    MEMCMP_EQUAL(slow.data(), fast.data(), raster_type::size);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,299 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <dev/bank_raster.hpp>
+#include <dev/font_5x7.hpp>
+
+#include <cstring>
+#include <string>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+//------------------------------------------------------------------------------
+
+// Per-pixel reference model of a raster
+template<int W, int H>
+struct reference
+{
+    void apply(int x, int y, bool src, ecl::raster_op op)
+    {
+        if (x < 0 || y < 0 || x >= W || y >= H) {
+            return;
+        }
+
+        bool &px = pixels[x][y];
+
+        switch (op) {
+        case ecl::raster_op::set:   px = px || src; break;
+        case ecl::raster_op::clear: px = px && !src; break;
+        case ecl::raster_op::flip:  px = px != src; break;
+        case ecl::raster_op::copy:  px = src; break;
+        }
+    }
+
+    void fill_rect(int x, int y, int w, int h, ecl::raster_op op)
+    {
+        for (int i = x; i < x + w; ++i) {
+            for (int j = y; j < y + h; ++j) {
+                apply(i, j, true, op);
+            }
+        }
+    }
+
+    void blit(int x, int y, const ecl::bitmap &bmp, ecl::raster_op op)
+    {
+        int banks = (bmp.height + 7) / 8;
+
+        for (int i = 0; i < bmp.width; ++i) {
+            for (int j = 0; j < bmp.height; ++j) {
+                bool src = bmp.data[i * banks + j / 8] & (1 << (j % 8));
+                apply(x + i, y + j, src, op);
+            }
+        }
+    }
+
+    bool pixels[W][H];
+};
+
+template<int W, int H>
+static void check_equal(const ecl::bank_raster<W, H> &r, const reference<W, H> &ref)
+{
+    for (int x = 0; x < W; ++x) {
+        for (int y = 0; y < H; ++y) {
+            if (r.get_point(x, y) != ref.pixels[x][y]) {
+                FAIL(("Pixel mismatch at " + std::to_string(x) + ", "
+                      + std::to_string(y)).c_str());
+            }
+        }
+    }
+
+    // Bits outside of the raster are never set
+    for (size_t i = 0; i < r.size; ++i) {
+        int b = i % r.banks;
+        if (H - b * 8 < 8) {
+            CHECK_EQUAL(0, r.data()[i] >> (H - b * 8));
+        }
+    }
+}
+
+// Checks that exactly changed bytes are marked as modified
+template<int W, int H>
+static void check_dirty(const ecl::bank_raster<W, H> &r, const uint8_t *before)
+{
+    for (size_t i = 0; i < r.size; ++i) {
+        CHECK_EQUAL(before[i] != r.data()[i], r.is_dirty(i));
+    }
+}
+
+// Deterministic pseudo-random numbers
+static unsigned next_rand()
+{
+    static unsigned state = 12345;
+    state = state * 1103515245 + 12345;
+    return (state >> 16) & 0x7fff;
+}
+
+static int rand_in(int lo, int hi)
+{
+    return lo + next_rand() % (hi - lo + 1);
+}
+
+static const ecl::raster_op all_ops[] = {
+    ecl::raster_op::set, ecl::raster_op::clear,
+    ecl::raster_op::flip, ecl::raster_op::copy,
+};
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(raster)
+{
+};
+
+TEST(raster, constructed_clear_and_dirty)
+{
+    ecl::bank_raster<84, 48> r;
+    CHECK_EQUAL(504, r.size);
+
+    for (size_t i = 0; i < r.size; ++i) {
+        CHECK_EQUAL(0, r.data()[i]);
+        CHECK_TRUE(r.is_dirty(i));
+    }
+
+    r.mark_clean();
+    for (size_t i = 0; i < r.size; ++i) {
+        CHECK_FALSE(r.is_dirty(i));
+    }
+}
+
+TEST(raster, points)
+{
+    ecl::bank_raster<84, 48> r;
+
+    CHECK_TRUE(r.set_point(3, 10));
+    CHECK_TRUE(r.get_point(3, 10));
+    CHECK_EQUAL(0x04, r.data()[3 * 6 + 1]);
+
+    CHECK_TRUE(r.set_point(3, 10, ecl::raster_op::flip));
+    CHECK_FALSE(r.get_point(3, 10));
+
+    CHECK_FALSE(r.set_point(84, 0));
+    CHECK_FALSE(r.set_point(0, 48));
+    CHECK_FALSE(r.set_point(-1, 0));
+    CHECK_FALSE(r.get_point(-1, -1));
+}
+
+TEST(raster, lines_golden)
+{
+    ecl::bank_raster<84, 48> r;
+
+    // Horizontal line is a single bit in consecutive columns
+    r.hline(10, 4, 9);
+    for (int x = 0; x < 84; ++x) {
+        CHECK_EQUAL(x >= 4 && x <= 10 ? 0x02 : 0, r.data()[x * 6 + 1]);
+    }
+
+    // Vertical line spanning three banks: partial, full, partial
+    r.vline(20, 5, 20);
+    const uint8_t col[] = { 0xe0, 0xff, 0x1f, 0x00, 0x00, 0x00 };
+    MEMCMP_EQUAL(col, r.data() + 20 * 6, sizeof(col));
+
+    // Filled rectangle, cleared in the middle
+    r.fill_rect(30, 0, 3, 48);
+    r.fill_rect(31, 8, 1, 32, ecl::raster_op::clear);
+    const uint8_t rect[] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+                             0xff, 0x00, 0x00, 0x00, 0x00, 0xff,
+                             0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+    MEMCMP_EQUAL(rect, r.data() + 30 * 6, sizeof(rect));
+}
+
+TEST(raster, shapes_match_reference)
+{
+    ecl::bank_raster<84, 48> r;
+    reference<84, 48> ref{};
+    uint8_t before[r.size];
+
+    for (int i = 0; i < 2000; ++i) {
+        memcpy(before, r.data(), r.size);
+        r.mark_clean();
+
+        // Shapes partially outside of the raster are included
+        int x = rand_in(-10, 90);
+        int y = rand_in(-10, 54);
+        int w = rand_in(0, 40);
+        int h = rand_in(0, 30);
+        auto op = all_ops[next_rand() % 4];
+
+        switch (next_rand() % 3) {
+        case 0:
+            r.hline(x, x + w, y, op);
+            ref.fill_rect(x, y, w + 1, 1, op);
+            break;
+        case 1:
+            r.vline(x, y + h, y, op);
+            ref.fill_rect(x, y, 1, h + 1, op);
+            break;
+        case 2:
+            r.fill_rect(x, y, w, h, op);
+            ref.fill_rect(x, y, w, h, op);
+            break;
+        }
+
+        check_equal(r, ref);
+        check_dirty(r, before);
+    }
+}
+
+TEST(raster, blits_match_reference)
+{
+    // Height is not a multiple of 8, last bank is partial
+    ecl::bank_raster<40, 21> r;
+    reference<40, 21> ref{};
+    uint8_t before[r.size];
+    uint8_t img[16 * 3];
+
+    for (int i = 0; i < 2000; ++i) {
+        memcpy(before, r.data(), r.size);
+        r.mark_clean();
+
+        ecl::bitmap bmp{img, rand_in(1, 16), rand_in(1, 24)};
+        for (auto &b : img) {
+            b = next_rand();
+        }
+
+        // Arbitrary offsets, including negative ones
+        int x = rand_in(-16, 40);
+        int y = rand_in(-24, 21);
+        auto op = all_ops[next_rand() % 4];
+
+        r.blit(x, y, bmp, op);
+        ref.blit(x, y, bmp, op);
+
+        check_equal(r, ref);
+        check_dirty(r, before);
+    }
+}
+
+TEST(raster, text_golden)
+{
+    ecl::bank_raster<84, 48> r;
+    r.fill(ecl::raster_op::set);
+
+    // Bank-aligned text replaces background, including character spacing
+    int end = r.draw_text<ecl::font_5x7>(0, 8, "Hi");
+    CHECK_EQUAL(12, end);
+
+    const uint8_t hi[] = { 0x7f, 0x08, 0x08, 0x08, 0x7f, 0x00,
+                           0x00, 0x44, 0x7d, 0x40, 0x00, 0x00 };
+    for (int x = 0; x < 12; ++x) {
+        // Only 7 rows are replaced, the bottom row keeps the background
+        CHECK_EQUAL(hi[x] | 0x80, r.data()[x * 6 + 1]);
+        CHECK_EQUAL(0xff, r.data()[x * 6]);
+        CHECK_EQUAL(0xff, r.data()[x * 6 + 2]);
+    }
+
+    // Unaligned text spans two banks
+    r.fill(ecl::raster_op::clear);
+    r.draw_text<ecl::font_5x7>(1, 4, "A", ecl::raster_op::set);
+
+    const uint8_t a[] = { 0x7e, 0x11, 0x11, 0x11, 0x7e };
+    for (int x = 0; x < 5; ++x) {
+        CHECK_EQUAL(static_cast<uint8_t>(a[x] << 4), r.data()[(x + 1) * 6]);
+        CHECK_EQUAL(a[x] >> 4, r.data()[(x + 1) * 6 + 1]);
+    }
+
+    // Characters outside of the font are skipped
+    CHECK_EQUAL(12, r.draw_text<ecl::font_5x7>(0, 0, "\x01\x7fOK"));
+}
+
+TEST(raster, text_matches_reference)
+{
+    ecl::bank_raster<84, 48> r;
+    reference<84, 48> ref{};
+    const char str[] = "0123456789 The quick brown fox!";
+
+    for (int y = -3; y < 48; y += 5) {
+        auto op = all_ops[y & 3];
+        int x = (y * 7) % 11 - 5;
+
+        r.draw_text<ecl::font_5x7>(x, y, str, op);
+
+        for (const char *c = str; *c; ++c) {
+            auto glyph = ecl::font_5x7::glyph(*c);
+            ref.blit(x, y, ecl::bitmap{glyph, 5, 7}, op);
+            x += 5;
+            if (op == ecl::raster_op::copy) {
+                ref.fill_rect(x, y, 1, 7, ecl::raster_op::clear);
+            }
+            x++;
+        }
+
+        check_equal(r, ref);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -11,9 +11,11 @@
 
 #include <algorithm>
 #include <array>
+#include <functional>
 #include <type_traits>
 #include <cstring>
 
+#include <common/bus.hpp>
 #include <ecl/iostream.hpp>
 #include <ecl/endian.hpp>
 #include <ecl/types.h>
@@ -224,6 +226,14 @@ struct sdspi_state
     uint8_t send_resp;
 };
 
+//! SDSPI block cache statistics.
+struct sdspi_cache_stats
+{
+    uint32_t  hits;       //!< Accesses served from the cache.
+    uint32_t  misses;     //!< Accesses that required reading a block from the card.
+    uint32_t  writebacks; //!< Dirty blocks written back to the card.
+};
+
 //! SDSPI card information struct.
 //! \details Used primarily for debugging.
 struct sdspi_card_info
@@ -287,14 +297,18 @@ struct sdspi_card_info
 };
 
 //! SDSPI driver class
-//! \tparam spi_dev  SPI bus driver
-//! \tparam gpio_cs  Chip-select GPIO
+//! \tparam spi_dev       SPI bus driver
+//! \tparam gpio_cs       Chip-select GPIO
+//! \tparam cache_blocks  Amount of blocks held in the write-back cache.
+//!                       Least recently used block is evicted first.
 //! \todo mention about 8 additional clocks before each command!!!
 //! \details Driver follows SDSPI specification that can be obtained here:
 //! https://www.sdcard.org/downloads/pls/
-template<class spi_dev, class gpio_cs>
+template<class spi_dev, class gpio_cs, size_t cache_blocks = 1>
 class sdspi
 {
+    static_assert(cache_blocks, "Cache must hold at least one block");
+
 public:
     //! Initializes SDSPI driver and SD card.
     //! \pre Un-initialized SDSPI driver.
@@ -324,6 +338,9 @@ public:
     //! \todo how to catch end-of-space on SD card?
     //! \details Data written may be a subject to caching. Use flush()
     //! call to make sure that all data is written to SD card.
+    //! Whole blocks spanned by the request, if there are more than one,
+    //! are written directly from the given buffer with a single multi-block
+    //! command, bypassing the cache.
     //! \param[in]      data    Data to write.
     //! \param[in,out]  count   Data size in bytes to write on entry.
     //!                         Data bytes actually written on exit.
@@ -339,6 +356,9 @@ public:
     //!       State obtainable via get_state() is populated
     //!       with relevant data.
     //! \todo how to catch end-of-space on SD card?
+    //! \details Whole blocks spanned by the request, if there are more than
+    //! one, are read directly into the given buffer with a single multi-block
+    //! command, bypassing the cache.
     //! \param[out]     data    Buffer to store data into.
     //! \param[in,out]  count   Data size in bytes to read on entry.
     //!                         Data bytes actually read on exit.
@@ -350,7 +370,8 @@ public:
 
     //! Flushes cached data.
     //! \pre  Initialized SDSPI driver.
-    //! \post Data from cache is flushed onto SD card.
+    //! \post Data from all dirty cache blocks is flushed onto SD card.
+    //!       Blocks remain cached.
     //!       Current offset is unchanged.
     //!       State obtainable via get_state() is populated
     //!       with relevant data.
@@ -406,6 +427,15 @@ public:
     //! \return Currect driver state.
     static const sdspi_state &get_state();
 
+    //! Gets block cache statistics.
+    //! \details Statistics are collected since last init() or
+    //! reset_cache_stats() call.
+    //! \return Cache statistics.
+    static const sdspi_cache_stats &get_cache_stats();
+
+    //! Resets block cache statistics.
+    static void reset_cache_stats();
+
     //! Returns a length of a block
     static constexpr size_t get_block_length();
 
@@ -490,8 +520,8 @@ private:
     //! SEND_CID                 - Read CID register.
     static err CMD10(R1 &r);
 
-    // STOP_TRANSMISSION        - Stop to read data.
-    // int CMD12(R1 &r); R1b is required here
+    //! STOP_TRANSMISSION        - Stop to read data.
+    static err CMD12(R1 &r);
 
     //! SET_BLOCKLEN             - Change R/W block size.
     static err CMD16(R1 &r);
@@ -500,7 +530,7 @@ private:
     static err CMD17(R1 &r, uint32_t address);
 
     //! READ_MULTIPLE_BLOCK      - Read multiple blocks.
-    static err CMD18(R1 &r, uint32_t address, uint8_t *buf, size_t size);
+    static err CMD18(R1 &r, uint32_t address);
 
     //! SET_BLOCK_COUNT          - For only MMC. Define number of blocks to transfer
     //!                            with next multi-block read/write command.
@@ -508,13 +538,13 @@ private:
 
     //! SET_WR_BLOCK_ERASE_COUNT - For only SDC. Define number of blocks to pre-erase
     //!                              with next multi-block write command.
-    static err ACMD23(R1 &r, uint16_t block_count);
+    static err ACMD23(R1 &r, uint32_t block_count);
 
     //! WRITE_BLOCK              - Write a block.
     static err CMD24(R1 &r, uint32_t address);
 
     //! WRITE_MULTIPLE_BLOCK     - Write multiple blocks.
-    static err CMD25(R1 &r, uint32_t address, uint8_t *buf, size_t size);
+    static err CMD25(R1 &r, uint32_t address);
 
     //! APP_CMD                  - Leading command of ACMD<n> command.
     static err CMD55(R1 &r);
@@ -526,6 +556,9 @@ private:
     template< typename R >
     static err send_CMD(R &resp, uint8_t CMD_idx, const argument &arg, uint8_t crc = 0);
 
+    //! Sends CMD frame without waiting for a response.
+    static err send_CMD_frame(uint8_t CMD_idx, const argument &arg, uint8_t crc = 0);
+
     //! Sends >= 47 empty clocks to initialize the device
     static err send_init();
     static err open_card();
@@ -535,10 +568,14 @@ private:
     static err check_OCR(sd_type &type, uint16_t &voltage_profile);
     static err obtain_card_info();
     static err set_block_length();
-    static err populate_block(size_t new_block);
-    static err flush_block();
+    static err get_block(size_t blk_num, size_t &idx);
+    static err populate_block(size_t idx, size_t new_block);
+    static err flush_block(size_t idx);
+    static err read_blocks(size_t first_block, uint8_t *buf, size_t block_count);
+    static err write_blocks(size_t first_block, const uint8_t *buf, size_t block_count);
     static err traverse_data(size_t count,
-        const std::function<void(size_t data_offt, size_t blk_offt, size_t amount)>& fn);
+        const std::function<void(size_t idx, size_t data_offt, size_t blk_offt, size_t amount)>& fn,
+        const std::function<err(size_t data_offt, size_t blk_num, size_t blk_cnt)>& stream_fn);
 
     // Useful abstractions
     static err receive_response(R1 &r);
@@ -546,10 +583,12 @@ private:
     //err receive_response(R1_read &r);
 
     static err receive_data(uint8_t *buf, size_t size);
-    static err send_data(const uint8_t *buf, size_t size);
+    static err send_data(const uint8_t *buf, size_t size, uint8_t data_token = 0xfe);
+    static err wait_busy();
 
     // Transport layer TODO: merge these three
     static err spi_send(const uint8_t *buf, size_t size);
+    static err spi_send(const bus_iovec *iov, size_t cnt);
     static err spi_receive(uint8_t *buf, size_t size);
     static err spi_send_dummy(size_t size);
 
@@ -573,27 +612,42 @@ private:
             // If card is High Capacity then block length is fixed to 512 by design.
             static constexpr size_t block_len = 512;
 
-            uint8_t buf[block_len];       //!< The block itself
-            size_t  origin;               //!< The offset from which block was obtained
-            bool    mint;                 //!< True if there were no writes in buffer
-        } block;    // Cache containing last read\write block
+            uint8_t  buf[block_len];       //!< The block itself
+            size_t   origin;               //!< The offset from which block was obtained
+            uint32_t last_used;            //!< Cache tick of the last access
+            bool     valid;                //!< True if buffer holds a block
+            bool     mint;                 //!< True if there were no writes in buffer
+        } cache[cache_blocks];  // Cache containing recently read\written blocks
+
+        uint32_t          tick;   // Cache access counter, used for LRU eviction
+        sdspi_cache_stats stats;  // Cache statistics
     } m_ctx;
 
     // Protect from future bugs
     static_assert(std::is_trivial<ctx_type>::value, "Context type must be trival");
 };
 
-template<class spi_dev, class gpio_cs>
-typename sdspi<spi_dev, gpio_cs>::ctx_type sdspi<spi_dev, gpio_cs>::m_ctx = {};
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+typename sdspi<spi_dev, gpio_cs, cache_blocks>::ctx_type
+sdspi<spi_dev, gpio_cs, cache_blocks>::m_ctx = {};
 
 //------------------------------------------------------------------------------
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::init()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::init()
 {
     err rc;
     ecl_assert(!m_ctx.inited);
-    m_ctx.block.mint = true;
+
+    // Card may be replaced since last init
+    for (auto &blk : m_ctx.cache) {
+        blk.valid = false;
+        blk.mint = true;
+    }
+
+    m_ctx.tick = 0;
+    m_ctx.stats = sdspi_cache_stats{};
+    m_ctx.offt = 0;
     m_ctx.state.clear();
 
     rc = spi_dev::init();
@@ -623,8 +677,8 @@ err sdspi<spi_dev, gpio_cs>::init()
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::deinit()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::deinit()
 {
     ecl_assert(m_ctx.inited);
 
@@ -638,48 +692,59 @@ err sdspi<spi_dev, gpio_cs>::deinit()
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::write(const uint8_t *data, size_t &count)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::write(const uint8_t *data, size_t &count)
 {
     ecl_assert(m_ctx.inited);
 
     m_ctx.state.clear();
 
-    auto fn = [data](size_t data_offt, size_t blk_offt, size_t to_copy) {
-        memcpy(m_ctx.block.buf + blk_offt, data + data_offt, to_copy);
-        m_ctx.block.mint = false;
+    auto fn = [data](size_t idx, size_t data_offt, size_t blk_offt, size_t to_copy) {
+        auto &blk = m_ctx.cache[idx];
+        memcpy(blk.buf + blk_offt, data + data_offt, to_copy);
+        blk.mint = false;
     };
 
-    return traverse_data(count, fn);
+    auto stream_fn = [data](size_t data_offt, size_t blk_num, size_t blk_cnt) {
+        return write_blocks(blk_num, data + data_offt, blk_cnt);
+    };
+
+    return traverse_data(count, fn, stream_fn);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::read(uint8_t *data, size_t &count)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::read(uint8_t *data, size_t &count)
 {
     ecl_assert(m_ctx.inited);
 
     m_ctx.state.clear();
 
-    auto fn = [data](size_t data_offt, size_t blk_offt, size_t to_copy) {
-        memcpy(data + data_offt, m_ctx.block.buf + blk_offt, to_copy);
+    auto fn = [data](size_t idx, size_t data_offt, size_t blk_offt, size_t to_copy) {
+        memcpy(data + data_offt, m_ctx.cache[idx].buf + blk_offt, to_copy);
     };
 
-    return traverse_data(count, fn);
+    auto stream_fn = [data](size_t data_offt, size_t blk_num, size_t blk_cnt) {
+        return read_blocks(blk_num, data + data_offt, blk_cnt);
+    };
+
+    return traverse_data(count, fn, stream_fn);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::flush()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::flush()
 {
     ecl_assert(m_ctx.inited);
 
     m_ctx.state.clear();
 
-    err rc;
+    err rc = err::ok;
 
     spi_dev::lock();
     gpio_cs::reset();
 
-    rc = flush_block();
+    for (size_t i = 0; i < cache_blocks && is_ok(rc); ++i) {
+        rc = flush_block(i);
+    }
 
     gpio_cs::set();
     spi_dev::unlock();
@@ -688,8 +753,8 @@ err sdspi<spi_dev, gpio_cs>::flush()
 }
 
 // TODO: change off_t to int
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::seek(off_t offset)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::seek(off_t offset)
 {
     ecl_assert(m_ctx.inited);
     m_ctx.state.clear();
@@ -697,8 +762,8 @@ err sdspi<spi_dev, gpio_cs>::seek(off_t offset)
     return err::ok;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::tell(off_t &offt)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::tell(off_t &offt)
 {
     ecl_assert(m_ctx.inited);
     m_ctx.state.clear();
@@ -706,14 +771,14 @@ err sdspi<spi_dev, gpio_cs>::tell(off_t &offt)
     return err::ok;
 }
 
-template<class spi_dev, class gpio_cs>
-constexpr size_t sdspi<spi_dev, gpio_cs>::get_block_length()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+constexpr size_t sdspi<spi_dev, gpio_cs, cache_blocks>::get_block_length()
 {
     return ctx_type::block_type::block_len;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::get_info(sdspi_card_info &info)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::get_info(sdspi_card_info &info)
 {
     R1  r1;
     err rc;
@@ -762,16 +827,28 @@ err sdspi<spi_dev, gpio_cs>::get_info(sdspi_card_info &info)
     return err::ok;
 }
 
-template<class spi_dev, class gpio_cs>
-const sdspi_state &sdspi<spi_dev, gpio_cs>::get_state()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+const sdspi_state &sdspi<spi_dev, gpio_cs, cache_blocks>::get_state()
 {
     return m_ctx.state;
 }
 
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+const sdspi_cache_stats &sdspi<spi_dev, gpio_cs, cache_blocks>::get_cache_stats()
+{
+    return m_ctx.stats;
+}
+
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+void sdspi<spi_dev, gpio_cs, cache_blocks>::reset_cache_stats()
+{
+    m_ctx.stats = sdspi_cache_stats{};
+}
+
 // Private methods -------------------------------------------------------------
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::spi_send(const uint8_t *buf, size_t size)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::spi_send(const uint8_t *buf, size_t size)
 {
     spi_dev::set_buffers(buf, nullptr, size);
     // TODO: verify that all data was transferred
@@ -785,8 +862,22 @@ err sdspi<spi_dev, gpio_cs>::spi_send(const uint8_t *buf, size_t size)
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::spi_receive(uint8_t *buf, size_t size)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::spi_send(const bus_iovec *iov, size_t cnt)
+{
+    spi_dev::set_buffers(iov, cnt);
+    auto rc = spi_dev::xfer();
+
+    // Do not propagate exact bus error code to user.
+    if (is_error(rc)) {
+        rc = err::io;
+    }
+
+    return rc;
+}
+
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::spi_receive(uint8_t *buf, size_t size)
 {
     spi_dev::set_buffers(nullptr, buf, size);
     // TODO: verify that all data was transferred
@@ -800,8 +891,8 @@ err sdspi<spi_dev, gpio_cs>::spi_receive(uint8_t *buf, size_t size)
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::spi_send_dummy(size_t size)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::spi_send_dummy(size_t size)
 {
     spi_dev::set_buffers(size);
     // TODO: verify that all data was transferred
@@ -815,20 +906,30 @@ err sdspi<spi_dev, gpio_cs>::spi_send_dummy(size_t size)
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::send_init()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::send_init()
 {
     // Initialise card with >= 74 clocks on start
     size_t dummy_bytes = 80; // TODO: bytes or clock pulses?
     return spi_send_dummy(dummy_bytes);
 }
 
-template<class spi_dev, class gpio_cs>
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
 template<typename R>
-err sdspi<spi_dev, gpio_cs>::send_CMD(R &resp, uint8_t CMD_idx, const argument &arg, uint8_t crc)
+err sdspi<spi_dev, gpio_cs, cache_blocks>::send_CMD(R &resp, uint8_t CMD_idx, const argument &arg, uint8_t crc)
 {
-    err rc;
+    err rc = send_CMD_frame(CMD_idx, arg, crc);
+    if (is_error(rc)) {
+        return rc;
+    }
+
+    // Retrieve a result
+    return receive_response(resp);
+}
 
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::send_CMD_frame(uint8_t CMD_idx, const argument &arg, uint8_t crc)
+{
     CMD_idx &= 0x3f; // First two bits are reserved TODO: comment
     CMD_idx |= 0x40;
 
@@ -842,19 +943,13 @@ err sdspi<spi_dev, gpio_cs>::send_CMD(R &resp, uint8_t CMD_idx, const argument &
         { CMD_idx, arg[0], arg[1], arg[2], arg[3], crc };
 
     // Send HCS
-    rc = spi_send(to_send, sizeof(to_send));
-    if (is_error(rc)) {
-        return rc;
-    }
-
-    // Retrieve a result
-    return receive_response(resp);
+    return spi_send(to_send, sizeof(to_send));
 }
 
 //------------------------------------------------------------------------------
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::receive_response(R1 &r)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::receive_response(R1 &r)
 {
     uint8_t tries = 8;
     err rc;
@@ -878,8 +973,8 @@ err sdspi<spi_dev, gpio_cs>::receive_response(R1 &r)
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::receive_response(R3 &r)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::receive_response(R3 &r)
 {
     err rc = receive_response(r.r1);
     if (is_error(rc)) {
@@ -889,8 +984,8 @@ err sdspi<spi_dev, gpio_cs>::receive_response(R3 &r)
     return spi_receive((uint8_t *)&r.OCR, sizeof(r.OCR));
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::receive_data(uint8_t *buf, size_t size)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::receive_data(uint8_t *buf, size_t size)
 {
     // Data token that returned in case of success
     static constexpr uint8_t data_token    = 0xfe;
@@ -927,12 +1022,9 @@ err sdspi<spi_dev, gpio_cs>::receive_data(uint8_t *buf, size_t size)
     return spi_receive((uint8_t *)&crc, sizeof(crc));
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::send_data(const uint8_t *buf, size_t size)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::send_data(const uint8_t *buf, size_t size, uint8_t data_token)
 {
-    // Data token that must be sent before data chunk
-    static constexpr uint8_t data_token    = 0xfe;
-
     // Two bits indicating data response
     static constexpr uint8_t mask          = 0x11;
     // Flags that can be found in data response
@@ -940,26 +1032,21 @@ err sdspi<spi_dev, gpio_cs>::send_data(const uint8_t *buf, size_t size)
     static constexpr uint8_t crc_err       = 0x0b;
     static constexpr uint8_t write_err     = 0x0d;
 
-    static constexpr uint8_t crc           = 0x0;
+    // CRC is ignored in SPI mode, but still must be sent
+    const uint8_t crc[2] = { 0, 0 };
 
     uint8_t  data_response = 0;
     uint8_t  tries = 32;
     err      rc;
 
-    // Token
-    rc = spi_send(&data_token, sizeof(data_token));
-    if (is_error(rc)) {
-        return rc;
-    }
-
-    // Data itself
-    rc = spi_send(buf, size);
-    if (is_error(rc)) {
-        return rc;
-    }
+    // Token, data itself and dummy CRC in a single xfer
+    const bus_iovec data_packet[] = {
+        { &data_token, nullptr, sizeof(data_token) },
+        { buf,         nullptr, size },
+        { crc,         nullptr, sizeof(crc) },
+    };
 
-    // Dummy CRC
-    rc = spi_send(&crc, sizeof(crc));
+    rc = spi_send(data_packet, sizeof(data_packet) / sizeof(data_packet[0]));
     if (is_error(rc)) {
         return rc;
     }
@@ -979,15 +1066,7 @@ err sdspi<spi_dev, gpio_cs>::send_data(const uint8_t *buf, size_t size)
 
     // No error occur, only 4 lower bits matters
     if ((data_response & 0x0f) == accepted) {
-        // Wait till card is busy
-        do {
-            rc = spi_receive(&data_response, sizeof(data_response));
-            if (is_error(rc)) {
-                return rc;
-            }
-        } while (data_response == 0x0);
-
-        return rc;
+        return wait_busy();
     }
 
     if (data_response & crc_err) {
@@ -1000,10 +1079,27 @@ err sdspi<spi_dev, gpio_cs>::send_data(const uint8_t *buf, size_t size)
     return err::generic;
 }
 
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::wait_busy()
+{
+    uint8_t resp;
+    err     rc;
+
+    // Card holds DO low while it is busy
+    do {
+        rc = spi_receive(&resp, sizeof(resp));
+        if (is_error(rc)) {
+            return rc;
+        }
+    } while (resp == 0x0);
+
+    return rc;
+}
+
 //------------------------------------------------------------------------------
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::CMD0(R1 &r)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD0(R1 &r)
 {
     // TODO: comments
     constexpr uint8_t  CMD0_idx = 0;
@@ -1012,8 +1108,8 @@ err sdspi<spi_dev, gpio_cs>::CMD0(R1 &r)
     return send_CMD(r, CMD0_idx, arg, CMD0_crc);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::CMD8(R7 &r)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD8(R7 &r)
 {
     // TODO: comments
     constexpr uint8_t   CMD8_idx = 8;
@@ -1022,8 +1118,8 @@ err sdspi<spi_dev, gpio_cs>::CMD8(R7 &r)
     return send_CMD(r, CMD8_idx, arg, CMD8_crc);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::CMD10(R1 &r)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD10(R1 &r)
 {
     // TODO: comments
     constexpr uint8_t   CMD10_idx  = 10;
@@ -1031,8 +1127,36 @@ err sdspi<spi_dev, gpio_cs>::CMD10(R1 &r)
     return send_CMD(r, CMD10_idx, arg);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::CMD16(R1 &r)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD12(R1 &r)
+{
+    constexpr uint8_t  CMD12_idx = 12;
+    constexpr argument arg       = { 0, 0, 0, 0 };
+
+    err rc = send_CMD_frame(CMD12_idx, arg);
+    if (is_error(rc)) {
+        return rc;
+    }
+
+    // Byte following CMD12 is a stuff byte and must be discarded.
+    // It can be a part of the data block that card was sending.
+    uint8_t stuff;
+    rc = spi_receive(&stuff, sizeof(stuff));
+    if (is_error(rc)) {
+        return rc;
+    }
+
+    rc = receive_response(r);
+    if (is_error(rc)) {
+        return rc;
+    }
+
+    // R1b - response is followed by busy signal
+    return wait_busy();
+}
+
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD16(R1 &r)
 {
     // TODO: comments
     constexpr uint8_t  CMD16_idx = 16;
@@ -1046,8 +1170,8 @@ err sdspi<spi_dev, gpio_cs>::CMD16(R1 &r)
     return send_CMD(r, CMD16_idx, arg);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::CMD17(R1 &r, uint32_t address)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD17(R1 &r, uint32_t address)
 {
     // TODO: comments
     constexpr uint8_t CMD17_idx = 17;
@@ -1060,8 +1184,21 @@ err sdspi<spi_dev, gpio_cs>::CMD17(R1 &r, uint32_t address)
     return send_CMD(r, CMD17_idx, arg);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::CMD24(R1 &r, uint32_t address)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD18(R1 &r, uint32_t address)
+{
+    constexpr uint8_t CMD18_idx = 18;
+    const argument arg = {
+        (uint8_t) (address >> 24),
+        (uint8_t) (address >> 16),
+        (uint8_t) (address >> 8),
+        (uint8_t) (address),
+    };
+    return send_CMD(r, CMD18_idx, arg);
+}
+
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD24(R1 &r, uint32_t address)
 {
     constexpr uint8_t CMD24_idx = 24;
     const argument arg = {
@@ -1073,8 +1210,21 @@ err sdspi<spi_dev, gpio_cs>::CMD24(R1 &r, uint32_t address)
     return send_CMD(r, CMD24_idx, arg);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::CMD55(R1 &r)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD25(R1 &r, uint32_t address)
+{
+    constexpr uint8_t CMD25_idx = 25;
+    const argument arg = {
+        (uint8_t) (address >> 24),
+        (uint8_t) (address >> 16),
+        (uint8_t) (address >> 8),
+        (uint8_t) (address),
+    };
+    return send_CMD(r, CMD25_idx, arg);
+}
+
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD55(R1 &r)
 {
     // TODO: comments
     constexpr uint8_t CMD55_idx = 55;
@@ -1082,8 +1232,8 @@ err sdspi<spi_dev, gpio_cs>::CMD55(R1 &r)
     return send_CMD(r, CMD55_idx, arg);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::CMD58(R3 &r)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::CMD58(R3 &r)
 {
     // TODO: comments
     constexpr uint8_t CMD58_idx = 58;
@@ -1091,8 +1241,8 @@ err sdspi<spi_dev, gpio_cs>::CMD58(R3 &r)
     return send_CMD(r, CMD58_idx, arg);
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::ACMD41(R1 &r, bool HCS)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::ACMD41(R1 &r, bool HCS)
 {
     const uint8_t HCS_byte = HCS ? (1 << 6) : 0;
 
@@ -1107,10 +1257,32 @@ err sdspi<spi_dev, gpio_cs>::ACMD41(R1 &r, bool HCS)
     return send_CMD(r, CMD41_idx, arg);
 }
 
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::ACMD23(R1 &r, uint32_t block_count)
+{
+    err rc = CMD55(r);
+    if (is_error(rc)) {
+        return rc;
+    }
+
+    // Only lower 23 bits are valid. Pre-erase is a hint,
+    // so clamping the count is harmless.
+    block_count = std::min< uint32_t >(block_count, 0x7fffff);
+
+    constexpr uint8_t  CMD23_idx  = 23;
+    const argument     arg        = {
+        0,
+        (uint8_t) (block_count >> 16),
+        (uint8_t) (block_count >> 8),
+        (uint8_t) (block_count),
+    };
+    return send_CMD(r, CMD23_idx, arg);
+}
+
 //------------------------------------------------------------------------------
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::open_card()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::open_card()
 {
     err rc;
     sd_type type;
@@ -1145,13 +1317,14 @@ err sdspi<spi_dev, gpio_cs>::open_card()
         return err::generic;
     }
 
-    rc = populate_block(m_ctx.offt);
+    // Probe the card by reading first block
+    rc = populate_block(0, m_ctx.offt / ctx_type::block_type::block_len);
 
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::software_reset()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::software_reset()
 {
     R1 r1;
 
@@ -1170,8 +1343,8 @@ err sdspi<spi_dev, gpio_cs>::software_reset()
     return err::generic;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::check_conditions()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::check_conditions()
 {
     R7 r7;
 
@@ -1201,8 +1374,8 @@ err sdspi<spi_dev, gpio_cs>::check_conditions()
     return err::generic;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::init_process()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::init_process()
 {
     //TODO: comments
     R1 r1;
@@ -1227,8 +1400,8 @@ err sdspi<spi_dev, gpio_cs>::init_process()
     return err::ok;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::check_OCR(sd_type &type, uint16_t &voltage_profile)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::check_OCR(sd_type &type, uint16_t &voltage_profile)
 {
     R3 r3;
     CMD58(r3);
@@ -1257,8 +1430,8 @@ err sdspi<spi_dev, gpio_cs>::check_OCR(sd_type &type, uint16_t &voltage_profile)
     return err::generic;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::set_block_length()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::set_block_length()
 {
     R1 r1;
 
@@ -1275,63 +1448,222 @@ err sdspi<spi_dev, gpio_cs>::set_block_length()
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::populate_block(size_t new_block)
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::get_block(size_t blk_num, size_t &idx)
+{
+    size_t victim = 0;
+    uint32_t victim_age = 0;
+
+    m_ctx.tick++;
+
+    for (size_t i = 0; i < cache_blocks; ++i) {
+        auto &blk = m_ctx.cache[i];
+
+        if (blk.valid && blk.origin == blk_num) {
+            blk.last_used = m_ctx.tick;
+            m_ctx.stats.hits++;
+            idx = i;
+            return err::ok;
+        }
+
+        // Free entry is preferred, otherwise least recently used is evicted.
+        // Age is calculated this way to survive tick counter overflow.
+        uint32_t age = blk.valid ? m_ctx.tick - blk.last_used : UINT32_MAX;
+        if (age > victim_age) {
+            victim = i;
+            victim_age = age;
+        }
+    }
+
+    m_ctx.stats.misses++;
+
+    spi_dev::lock();
+    gpio_cs::reset();
+    err rc = populate_block(victim, blk_num);
+    gpio_cs::set();
+    spi_dev::unlock();
+
+    if (is_error(rc)) {
+        return rc;
+    }
+
+    m_ctx.cache[victim].last_used = m_ctx.tick;
+    idx = victim;
+    return rc;
+}
+
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::populate_block(size_t idx, size_t new_block)
 {
     R1 r1;
+    auto &blk = m_ctx.cache[idx];
     off_t address = m_ctx.hc ? new_block : new_block * ctx_type::block_type::block_len;
 
-    err rc = flush_block();
+    err rc = flush_block(idx);
     if (is_error(rc)) {
         return rc;
     }
 
+    // Buffer is going to be overwritten
+    blk.valid = false;
+
     rc = CMD17(r1, address);
     if (is_error(rc)) {
         return rc;
     }
 
-    rc = receive_data(m_ctx.block.buf, ctx_type::block_type::block_len);
+    rc = receive_data(blk.buf, ctx_type::block_type::block_len);
     if (is_error(rc)) {
         return rc;
     }
 
-    m_ctx.block.origin = new_block;
+    blk.origin = new_block;
+    blk.valid = true;
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::flush_block()
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::flush_block(size_t idx)
 {
     err rc;
     R1 r1;
+    auto &blk = m_ctx.cache[idx];
 
-    if (m_ctx.block.mint) {
+    if (!blk.valid || blk.mint) {
         return err::ok;
     }
 
-    off_t address = m_ctx.hc ? m_ctx.block.origin :
-        m_ctx.block.origin * ctx_type::block_type::block_len;
+    off_t address = m_ctx.hc ? blk.origin :
+        blk.origin * ctx_type::block_type::block_len;
 
     rc = CMD24(r1, address);
     if (is_error(rc)) {
         return rc;
     }
 
-    rc = send_data(m_ctx.block.buf, ctx_type::block_type::block_len);
+    rc = send_data(blk.buf, ctx_type::block_type::block_len);
+
+    if (is_error(rc)) {
+        return rc;
+    }
+
+    m_ctx.stats.writebacks++;
+    blk.mint = true;
+    return rc;
+}
+
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::read_blocks(size_t first_block, uint8_t *buf, size_t block_count)
+{
+    constexpr auto block_len = ctx_type::block_type::block_len;
+
+    R1 r1;
+    off_t address = m_ctx.hc ? first_block : first_block * block_len;
+
+    spi_dev::lock();
+    gpio_cs::reset();
+
+    err rc = CMD18(r1, address);
+
+    if (is_ok(rc)) {
+        for (size_t i = 0; i < block_count && is_ok(rc); ++i) {
+            rc = receive_data(buf + i * block_len, block_len);
+        }
+
+        // Card keeps sending blocks until stopped, even if error occur
+        err stop_rc = CMD12(r1);
+        if (is_ok(rc)) {
+            rc = stop_rc;
+        }
+    }
+
+    gpio_cs::set();
+    spi_dev::unlock();
+
+    if (is_error(rc)) {
+        return rc;
+    }
+
+    // Cached blocks may contain data not yet written to the card
+    for (auto &blk : m_ctx.cache) {
+        if (blk.valid && !blk.mint
+                && blk.origin >= first_block && blk.origin < first_block + block_count) {
+            memcpy(buf + (blk.origin - first_block) * block_len, blk.buf, block_len);
+        }
+    }
+
+    return rc;
+}
+
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::write_blocks(size_t first_block, const uint8_t *buf,
+                                          size_t block_count)
+{
+    constexpr auto block_len = ctx_type::block_type::block_len;
+
+    // Tokens used in multi-block write
+    constexpr uint8_t data_token    = 0xfc;
+    constexpr uint8_t stop_token    = 0xfd;
+
+    R1 r1;
+    off_t address = m_ctx.hc ? first_block : first_block * block_len;
+
+    spi_dev::lock();
+    gpio_cs::reset();
+
+    // Pre-erasing speeds up following multi-block write
+    err rc = ACMD23(r1, block_count);
+
+    if (is_ok(rc)) {
+        rc = CMD25(r1, address);
+    }
+
+    if (is_ok(rc)) {
+        for (size_t i = 0; i < block_count && is_ok(rc); ++i) {
+            rc = send_data(buf + i * block_len, block_len, data_token);
+        }
+
+        // Stop transmission even if error occur
+        err stop_rc = spi_send(&stop_token, sizeof(stop_token));
+
+        if (is_ok(stop_rc)) {
+            // Card starts busy signalling after one byte
+            uint8_t stuff;
+            stop_rc = spi_receive(&stuff, sizeof(stuff));
+        }
+
+        if (is_ok(stop_rc)) {
+            stop_rc = wait_busy();
+        }
+
+        if (is_ok(rc)) {
+            rc = stop_rc;
+        }
+    }
+
+    gpio_cs::set();
+    spi_dev::unlock();
 
     if (is_error(rc)) {
         return rc;
     }
 
-    m_ctx.block.mint = true;
+    // Cached blocks are overwritten on the card, keep them in sync
+    for (auto &blk : m_ctx.cache) {
+        if (blk.valid && blk.origin >= first_block && blk.origin < first_block + block_count) {
+            memcpy(blk.buf, buf + (blk.origin - first_block) * block_len, block_len);
+            blk.mint = true;
+        }
+    }
+
     return rc;
 }
 
-template<class spi_dev, class gpio_cs>
-err sdspi<spi_dev, gpio_cs>::traverse_data(
+template<class spi_dev, class gpio_cs, size_t cache_blocks>
+err sdspi<spi_dev, gpio_cs, cache_blocks>::traverse_data(
         size_t count,
-        const std::function< void (size_t, size_t, size_t) > &fn
+        const std::function< void (size_t, size_t, size_t, size_t) > &fn,
+        const std::function< err (size_t, size_t, size_t) > &stream_fn
         )
 {
     size_t left = count;
@@ -1344,21 +1676,31 @@ err sdspi<spi_dev, gpio_cs>::traverse_data(
     size_t data_offt = 0;
 
     while (left) {
-        if (blk_num  != m_ctx.block.origin) {
-            spi_dev::lock();
-            gpio_cs::reset();
-            rc = populate_block(blk_num);
-            gpio_cs::set();
-            spi_dev::unlock();
+        size_t blk_cnt = left / ctx_type::block_type::block_len;
 
+        // Streaming multiple whole blocks at once is cheaper than
+        // passing them one by one through the cache.
+        if (!blk_offt && blk_cnt > 1) {
+            rc = stream_fn(data_offt, blk_num, blk_cnt);
             if (is_error(rc)) {
                 return rc;
             }
+
+            data_offt += blk_cnt * ctx_type::block_type::block_len;
+            left -= blk_cnt * ctx_type::block_type::block_len;
+            blk_num += blk_cnt;
+            continue;
+        }
+
+        size_t idx;
+        rc = get_block(blk_num, idx);
+        if (is_error(rc)) {
+            return rc;
         }
 
         size_t to_copy = std::min(ctx_type::block_type::block_len - blk_offt , left);
         // Copy data
-        fn(data_offt, blk_offt, to_copy);
+        fn(idx, data_offt, blk_offt, to_copy);
 
         // Advance to next free chunk
         data_offt += to_copy;
@@ -26,7 +26,7 @@ using bus_%s = generic_bus<%s>;
 '''
 
 sdspi_typedef = '''
-using %s = sdspi<bus_%s, %s>;
+using %s = sdspi<bus_%s, %s, %d>;
 '''
 
 sdspi_alias = '''
@@ -50,8 +50,9 @@ for sdspi_id in sdspi_ids:
     sdspi_name = dev.resolve_sdspi_driver(cfg, sdspi_cfg['config-spi'], sdspi_cfg['config-cs'])
     cs_gpio = common.resolve_gpio_driver(cfg, sdspi_cfg['config-cs'])
     spi_drv = common.resolve_spi_driver(cfg, sdspi_cfg['config-spi'])
+    cache_blocks = int(sdspi_cfg.get('config-cache-blocks', 1))
     cog.outl(bus_typedef % (spi_drv, spi_drv))
-    cog.outl(sdspi_typedef % (sdspi_name, spi_drv, cs_gpio))
+    cog.outl(sdspi_typedef % (sdspi_name, spi_drv, cs_gpio, cache_blocks))
     cog.outl(sdspi_alias % (sdspi_id, sdspi_name))
 
 ]]]*/
@@ -0,0 +1,298 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOCK_SD_CARD_HPP_
+#define MOCK_SD_CARD_HPP_
+
+// Simulated high capacity SD card, attached to the mocked platform bus.
+// Card is modelled byte by byte, as seen on the SPI wire.
+
+#include "platform_bus.hpp"
+
+#include <array>
+#include <deque>
+#include <vector>
+
+class sd_card
+{
+public:
+    static constexpr size_t block_len = 512;
+
+    explicit sd_card(size_t blocks)
+        :m_data(blocks * block_len)
+    {
+    }
+
+    //! Attaches card to the mocked bus.
+    void attach()
+    {
+        platform_mock::m_device = [this] { xfer(); };
+    }
+
+    //! Detaches card from the mocked bus.
+    void detach()
+    {
+        platform_mock::m_device = platform_mock::device_fn{};
+    }
+
+    //! Raw card storage.
+    std::vector< uint8_t > &data() { return m_data; }
+
+    //! How many times given command was received.
+    size_t cmd_count(uint8_t idx) const { return m_cmds[idx]; }
+
+    //! Pre-erase block count set with last ACMD23.
+    uint32_t pre_erased() const { return m_pre_erase; }
+
+    //! Bytes clocked on the bus.
+    size_t clocked() const { return m_clocked; }
+
+    //! Bus xfers served.
+    size_t xfers() const { return m_xfers; }
+
+    void reset_counters()
+    {
+        m_cmds.fill(0);
+        m_clocked = 0;
+        m_xfers = 0;
+    }
+
+private:
+    enum class state
+    {
+        idle,           // Waiting for a command
+        cmd,            // Receiving command frame
+        read_multi,     // Sending blocks until CMD12
+        write_single,   // Waiting for single block data token
+        write_multi,    // Waiting for multi block data or stop token
+        write_data,     // Receiving a block
+    };
+
+    // Serves single bus xfer.
+    void xfer()
+    {
+        size_t sz = std::max(platform_mock::m_tx_size, platform_mock::m_rx_size);
+
+        for (size_t i = 0; i < sz; ++i) {
+            uint8_t in = platform_mock::m_tx ? platform_mock::m_tx[i] : 0xff;
+            uint8_t out = clock(in);
+
+            if (platform_mock::m_rx && i < platform_mock::m_rx_size) {
+                platform_mock::m_rx[i] = out;
+            }
+        }
+
+        m_clocked += sz;
+        m_xfers++;
+
+        if (platform_mock::m_tx_size) {
+            platform_mock::invoke(ecl::bus_channel::tx, ecl::bus_event::tc, sz);
+        }
+
+        if (platform_mock::m_rx) {
+            platform_mock::invoke(ecl::bus_channel::rx, ecl::bus_event::tc, sz);
+        }
+
+        platform_mock::invoke(ecl::bus_channel::meta, ecl::bus_event::tc, 0);
+    }
+
+    // Exchanges a byte with the host.
+    uint8_t clock(uint8_t in)
+    {
+        uint8_t out = 0xff;
+
+        // Card keeps streaming blocks until stopped or end is reached
+        if (m_out.empty() && m_state == state::read_multi
+                && m_addr < m_data.size() / block_len) {
+            queue_block(m_addr++);
+        }
+
+        if (!m_out.empty()) {
+            out = m_out.front();
+            m_out.pop_front();
+        }
+
+        switch (m_state) {
+        case state::idle:
+        case state::read_multi:
+            // Host sends 0xff while it reads
+            if ((in & 0xc0) == 0x40) {
+                m_frame[0] = in;
+                m_frame_len = 1;
+                m_prev = m_state;
+                m_state = state::cmd;
+            }
+            break;
+        case state::cmd:
+            m_frame[m_frame_len++] = in;
+            if (m_frame_len == m_frame.size()) {
+                m_state = m_prev == state::read_multi ? state::read_multi : state::idle;
+                exec();
+            }
+            break;
+        case state::write_single:
+            if (in == 0xfe) {
+                m_state = state::write_data;
+                m_prev = state::idle;
+                m_block.clear();
+            }
+            break;
+        case state::write_multi:
+            if (in == 0xfc) {
+                m_state = state::write_data;
+                m_prev = state::write_multi;
+                m_block.clear();
+            } else if (in == 0xfd) {
+                // Stop token, busy starts after one byte
+                m_state = state::idle;
+                m_out.assign({ 0xff, 0x00, 0x00, 0x00 });
+            }
+            break;
+        case state::write_data:
+            m_block.push_back(in);
+            // Data followed by two CRC bytes
+            if (m_block.size() == block_len + 2) {
+                std::copy(m_block.begin(), m_block.begin() + block_len,
+                          m_data.begin() + m_addr * block_len);
+                m_addr++;
+                m_state = m_prev;
+                // Accepted, then busy
+                m_out.assign({ 0x05, 0x00, 0x00 });
+            }
+            break;
+        }
+
+        return out;
+    }
+
+    // Executes received command.
+    void exec()
+    {
+        uint8_t idx = m_frame[0] & 0x3f;
+        uint32_t arg = (static_cast< uint32_t >(m_frame[1]) << 24)
+                | (m_frame[2] << 16) | (m_frame[3] << 8) | m_frame[4];
+
+        bool app = m_app;
+        m_app = false;
+        m_cmds[idx]++;
+
+        m_out.clear();
+        // Response time
+        m_out.push_back(0xff);
+
+        bool data_cmd = idx == 17 || idx == 18 || idx == 24 || idx == 25;
+        if (data_cmd && arg >= m_data.size() / block_len) {
+            // Address error
+            m_out.push_back(0x20);
+            return;
+        }
+
+        switch (idx) {
+        case 0:
+            m_idle = true;
+            r1();
+            break;
+        case 8:
+            r1();
+            push_u32(0x000001aa);
+            break;
+        case 10:
+            r1();
+            m_out.push_back(0xff);
+            m_out.push_back(0xfe);
+            m_out.insert(m_out.end(), 16, 0x42);
+            m_out.insert(m_out.end(), 2, 0);
+            break;
+        case 12:
+            // Discard everything card was about to send. Stuff byte
+            // deliberately looks like a valid R1 response.
+            m_state = state::idle;
+            m_out.assign({ 0x3c, 0x00, 0x00, 0x00 });
+            break;
+        case 16:
+            r1();
+            break;
+        case 17:
+            r1();
+            queue_block(arg);
+            break;
+        case 18:
+            r1();
+            m_addr = arg;
+            m_state = state::read_multi;
+            break;
+        case 23:
+            if (app) {
+                m_pre_erase = arg & 0x7fffff;
+            }
+            r1();
+            break;
+        case 24:
+            r1();
+            m_addr = arg;
+            m_state = state::write_single;
+            break;
+        case 25:
+            r1();
+            m_addr = arg;
+            m_state = state::write_multi;
+            break;
+        case 41:
+            m_idle = false;
+            r1();
+            break;
+        case 55:
+            m_app = true;
+            r1();
+            break;
+        case 58:
+            r1();
+            // Powered up, high capacity, 2.7-3.6V
+            push_u32(0xc0ff8000);
+            break;
+        default:
+            // Illegal command
+            m_out.push_back(0x04 | m_idle);
+            break;
+        }
+    }
+
+    void r1()
+    {
+        m_out.push_back(m_idle ? 0x01 : 0x00);
+    }
+
+    void push_u32(uint32_t v)
+    {
+        for (int i = 3; i >= 0; --i) {
+            m_out.push_back(v >> (i * 8));
+        }
+    }
+
+    void queue_block(uint32_t blk)
+    {
+        m_out.push_back(0xff);
+        m_out.push_back(0xfe);
+        m_out.insert(m_out.end(), m_data.begin() + blk * block_len,
+                     m_data.begin() + (blk + 1) * block_len);
+        m_out.insert(m_out.end(), 2, 0);
+    }
+
+    std::vector< uint8_t >      m_data;
+    std::deque< uint8_t >       m_out       = {};
+    std::vector< uint8_t >      m_block     = {};
+    std::array< uint8_t, 6 >    m_frame     = {};
+    size_t                      m_frame_len = 0;
+    state                       m_state     = state::idle;
+    state                       m_prev      = state::idle;
+    uint32_t                    m_addr      = 0;
+    uint32_t                    m_pre_erase = 0;
+    bool                        m_idle      = true;
+    bool                        m_app       = false;
+    std::array< size_t, 64 >    m_cmds      = {};
+    size_t                      m_clocked   = 0;
+    size_t                      m_xfers     = 0;
+};
+
+#endif // MOCK_SD_CARD_HPP_
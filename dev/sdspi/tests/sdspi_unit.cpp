@@ -0,0 +1,414 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <dev/sdspi.hpp>
+#include <dev/bus.hpp>
+
+#include "platform_bus.hpp"
+#include "mocks/sd_card.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTestExt/MockSupport.h>
+
+// Chip select is not important for simulated card
+struct gpio_mock
+{
+    static void set() { }
+    static void reset() { }
+};
+
+using bus_t     = ecl::generic_bus< platform_mock >;
+using sdspi_t   = ecl::sdspi< bus_t, gpio_mock >;
+
+static constexpr auto block_len     = sdspi_t::get_block_length();
+static constexpr auto card_blocks   = 1024;
+
+static sd_card *card;
+
+// Fills buffer with pattern unique for each block.
+static void fill_pattern(uint8_t *buf, size_t size, uint8_t seed)
+{
+    for (size_t i = 0; i < size; ++i) {
+        buf[i] = static_cast< uint8_t >(seed + i / block_len * 7 + i);
+    }
+}
+
+TEST_GROUP(sdspi)
+{
+    void setup()
+    {
+        // Bus interactions are not checked here, card model does it instead
+        mock().disable();
+        platform_mock::m_ignore_buffer_setters = true;
+
+        card = new sd_card{card_blocks};
+        fill_pattern(card->data().data(), card->data().size(), 0);
+        card->attach();
+
+        bus_t::init();
+        CHECK_EQUAL(ecl::err::ok, sdspi_t::init());
+        CHECK_EQUAL(ecl::err::ok, sdspi_t::seek(0));
+
+        card->reset_counters();
+    }
+
+    void teardown()
+    {
+        sdspi_t::deinit();
+
+        card->detach();
+        delete card;
+
+        platform_mock::m_ignore_buffer_setters = false;
+        mock().enable();
+        mock().clear();
+    }
+};
+
+TEST(sdspi, single_block_goes_through_cache)
+{
+    uint8_t buf[block_len];
+    size_t sz = sizeof(buf);
+
+    sdspi_t::seek(2 * block_len);
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::read(buf, sz));
+
+    MEMCMP_EQUAL(card->data().data() + 2 * block_len, buf, sizeof(buf));
+    CHECK_EQUAL(1, card->cmd_count(17));
+    CHECK_EQUAL(0, card->cmd_count(18));
+}
+
+TEST(sdspi, multi_block_read)
+{
+    std::vector< uint8_t > buf(8 * block_len);
+    size_t sz = buf.size();
+
+    sdspi_t::seek(3 * block_len);
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::read(buf.data(), sz));
+
+    MEMCMP_EQUAL(card->data().data() + 3 * block_len, buf.data(), buf.size());
+
+    // Single command for all blocks, no cache refill
+    CHECK_EQUAL(1, card->cmd_count(18));
+    CHECK_EQUAL(1, card->cmd_count(12));
+    CHECK_EQUAL(0, card->cmd_count(17));
+
+    off_t offt;
+    sdspi_t::tell(offt);
+    CHECK_EQUAL(11 * block_len, offt);
+}
+
+TEST(sdspi, unaligned_multi_block_read)
+{
+    // Head and tail are served from cache, blocks in the middle are streamed
+    std::vector< uint8_t > buf(5 * block_len);
+    size_t sz = buf.size();
+
+    sdspi_t::seek(block_len + 100);
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::read(buf.data(), sz));
+
+    MEMCMP_EQUAL(card->data().data() + block_len + 100, buf.data(), buf.size());
+    CHECK_EQUAL(1, card->cmd_count(18));
+    CHECK_EQUAL(2, card->cmd_count(17));
+}
+
+TEST(sdspi, multi_block_write)
+{
+    std::vector< uint8_t > buf(6 * block_len);
+    size_t sz = buf.size();
+    fill_pattern(buf.data(), buf.size(), 0x5a);
+
+    sdspi_t::seek(2 * block_len);
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::write(buf.data(), sz));
+
+    // Written directly, nothing left in cache
+    MEMCMP_EQUAL(buf.data(), card->data().data() + 2 * block_len, buf.size());
+    CHECK_EQUAL(1, card->cmd_count(25));
+    CHECK_EQUAL(6, card->pre_erased());
+
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::flush());
+    CHECK_EQUAL(0, card->cmd_count(24));
+}
+
+TEST(sdspi, streaming_keeps_cache_coherent)
+{
+    const uint8_t patch[] = "not yet flushed";
+    size_t sz = sizeof(patch);
+
+    // Dirty cached block #3
+    sdspi_t::seek(3 * block_len);
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::write(patch, sz));
+
+    // Streamed read must observe cached data
+    std::vector< uint8_t > buf(4 * block_len);
+    sz = buf.size();
+    sdspi_t::seek(2 * block_len);
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::read(buf.data(), sz));
+
+    MEMCMP_EQUAL(patch, buf.data() + block_len, sizeof(patch));
+    MEMCMP_EQUAL(card->data().data() + 2 * block_len, buf.data(), block_len);
+
+    // Streamed write overrides cached block, so it must not be flushed later
+    fill_pattern(buf.data(), buf.size(), 0xa5);
+    sz = buf.size();
+    sdspi_t::seek(2 * block_len);
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::write(buf.data(), sz));
+
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::flush());
+    CHECK_EQUAL(0, card->cmd_count(24));
+    MEMCMP_EQUAL(buf.data(), card->data().data() + 2 * block_len, buf.size());
+
+    // Cache holds streamed data as well
+    uint8_t byte;
+    sz = 1;
+    sdspi_t::seek(3 * block_len);
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::read(&byte, sz));
+    CHECK_EQUAL(buf[block_len], byte);
+}
+
+//------------------------------------------------------------------------------
+
+static constexpr auto cache_blocks = 4;
+
+using cached_sdspi_t = ecl::sdspi< bus_t, gpio_mock, cache_blocks >;
+
+TEST_GROUP(sdspi_cache)
+{
+    void setup()
+    {
+        mock().disable();
+        platform_mock::m_ignore_buffer_setters = true;
+
+        card = new sd_card{card_blocks};
+        fill_pattern(card->data().data(), card->data().size(), 0);
+        card->attach();
+
+        bus_t::init();
+        CHECK_EQUAL(ecl::err::ok, cached_sdspi_t::init());
+
+        cached_sdspi_t::reset_cache_stats();
+        card->reset_counters();
+    }
+
+    void teardown()
+    {
+        cached_sdspi_t::deinit();
+
+        card->detach();
+        delete card;
+
+        platform_mock::m_ignore_buffer_setters = false;
+        mock().enable();
+        mock().clear();
+    }
+};
+
+// Reads a byte from the beginning of the given block.
+static uint8_t touch(size_t blk)
+{
+    uint8_t byte;
+    size_t sz = 1;
+
+    cached_sdspi_t::seek(blk * block_len);
+    CHECK_EQUAL(ecl::err::ok, cached_sdspi_t::read(&byte, sz));
+    CHECK_EQUAL(card->data()[blk * block_len], byte);
+
+    return byte;
+}
+
+TEST(sdspi_cache, lru_eviction)
+{
+    auto &stats = cached_sdspi_t::get_cache_stats();
+
+    for (size_t blk = 10; blk < 10 + cache_blocks; ++blk) {
+        touch(blk);
+    }
+
+    CHECK_EQUAL(cache_blocks, stats.misses);
+    CHECK_EQUAL(0, stats.hits);
+
+    // Make block 10 most recently used
+    touch(10);
+    CHECK_EQUAL(1, stats.hits);
+
+    // Evicts block 11, since it is least recently used now
+    touch(20);
+    CHECK_EQUAL(cache_blocks + 1, stats.misses);
+
+    touch(10);
+    touch(12);
+    CHECK_EQUAL(3, stats.hits);
+
+    touch(11);
+    CHECK_EQUAL(cache_blocks + 2, stats.misses);
+    CHECK_EQUAL(cache_blocks + 2, card->cmd_count(17));
+}
+
+TEST(sdspi_cache, dirty_blocks_written_back)
+{
+    auto &stats = cached_sdspi_t::get_cache_stats();
+    uint8_t byte = 0xee;
+
+    for (size_t blk = 30; blk < 30 + cache_blocks; ++blk) {
+        size_t sz = 1;
+        cached_sdspi_t::seek(blk * block_len + 1);
+        CHECK_EQUAL(ecl::err::ok, cached_sdspi_t::write(&byte, sz));
+    }
+
+    // Nothing is written until blocks are evicted or flushed
+    CHECK_EQUAL(0, card->cmd_count(24));
+
+    // Evicts and writes back block 30
+    touch(100);
+    CHECK_EQUAL(1, stats.writebacks);
+    CHECK_EQUAL(byte, card->data()[30 * block_len + 1]);
+
+    CHECK_EQUAL(ecl::err::ok, cached_sdspi_t::flush());
+    CHECK_EQUAL(cache_blocks, stats.writebacks);
+    CHECK_EQUAL(cache_blocks, card->cmd_count(24));
+
+    for (size_t blk = 30; blk < 30 + cache_blocks; ++blk) {
+        CHECK_EQUAL(byte, card->data()[blk * block_len + 1]);
+    }
+
+    // Blocks are clean now, flush does nothing
+    CHECK_EQUAL(ecl::err::ok, cached_sdspi_t::flush());
+    CHECK_EQUAL(cache_blocks, card->cmd_count(24));
+}
+
+// Mimics FAT chain walk: table entry is read, then part of the data block.
+template< typename Drv >
+static size_t walk_chain()
+{
+    constexpr size_t fat_blk     = 1;
+    constexpr size_t data_blk    = 200;
+
+    uint8_t buf[32];
+
+    card->reset_counters();
+
+    for (size_t i = 0; i < 256; ++i) {
+        size_t sz = 4;
+        Drv::seek(fat_blk * block_len + (i * 4) % block_len);
+        CHECK_EQUAL(ecl::err::ok, Drv::read(buf, sz));
+
+        sz = sizeof(buf);
+        Drv::seek((data_blk + i / 16) * block_len + (i % 16) * sizeof(buf));
+        CHECK_EQUAL(ecl::err::ok, Drv::read(buf, sz));
+    }
+
+    return card->xfers();
+}
+
+TEST(sdspi_cache, fat_access_pattern)
+{
+    // Single block cache
+    CHECK_EQUAL(ecl::err::ok, sdspi_t::init());
+    auto single = walk_chain< sdspi_t >();
+    auto single_stats = sdspi_t::get_cache_stats();
+    sdspi_t::deinit();
+
+    auto multi = walk_chain< cached_sdspi_t >();
+    auto &multi_stats = cached_sdspi_t::get_cache_stats();
+
+    std::cout << "\nFAT chain walk, bus xfers: "
+              << single << " with 1 cached block ("
+              << single_stats.hits << " hits, " << single_stats.misses << " misses), "
+              << multi << " with " << cache_blocks << " cached blocks ("
+              << multi_stats.hits << " hits, " << multi_stats.misses << " misses)";
+
+    // FAT block and data block both fit into the cache,
+    // so every block is read only once
+    CHECK_EQUAL(1 + 16, multi_stats.misses);
+    CHECK_TRUE(multi * 10 < single);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(sdspi_bench)
+{
+    void setup()
+    {
+        mock().disable();
+        platform_mock::m_ignore_buffer_setters = true;
+
+        card = new sd_card{card_blocks};
+        card->attach();
+
+        bus_t::init();
+        sdspi_t::init();
+    }
+
+    void teardown()
+    {
+        sdspi_t::deinit();
+
+        card->detach();
+        delete card;
+
+        platform_mock::m_ignore_buffer_setters = false;
+        mock().enable();
+        mock().clear();
+    }
+};
+
+// Transfers whole card either block by block, or in big chunks.
+template< typename Fn >
+static size_t run_transfer(const char *name, size_t chunk, Fn fn)
+{
+    std::vector< uint8_t > buf(chunk);
+    size_t total = card_blocks * block_len;
+
+    sdspi_t::seek(0);
+    card->reset_counters();
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t done = 0; done < total; done += chunk) {
+        size_t sz = chunk;
+        CHECK_EQUAL(ecl::err::ok, fn(buf.data(), sz));
+    }
+
+    sdspi_t::flush();
+
+    auto end = std::chrono::steady_clock::now();
+    auto sec = std::chrono::duration< double >(end - start).count();
+
+    std::cout << "\n" << name << ", " << chunk << " bytes per call: "
+              << static_cast< uint64_t >(total / sec) << " bytes/sec, "
+              << card->clocked() << " bytes clocked, "
+              << card->xfers() << " bus xfers";
+
+    return card->clocked();
+}
+
+TEST(sdspi_bench, read_throughput)
+{
+    auto single = run_transfer("read", block_len, sdspi_t::read);
+    auto multi  = run_transfer("read", 64 * block_len, sdspi_t::read);
+
+    CHECK_TRUE(multi < single);
+}
+
+TEST(sdspi_bench, write_throughput)
+{
+    auto write = [](uint8_t *buf, size_t &sz) { return sdspi_t::write(buf, sz); };
+
+    auto single = run_transfer("write", block_len, write);
+    auto multi  = run_transfer("write", 64 * block_len, write);
+
+    CHECK_TRUE(multi < single);
+}
+
+//------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
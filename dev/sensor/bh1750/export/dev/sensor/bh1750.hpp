@@ -13,6 +13,9 @@
 
 #include <ecl/err.hpp>
 #include <ecl/thread/thread.hpp>
+#include <dev/sensor/measurement.hpp>
+
+#include <chrono>
 
 namespace ecl
 {
@@ -97,10 +100,47 @@ public:
     //!
     static ecl::err get_illuminance(uint32_t &value);
 
+    //! \brief Starts one-time measurement in current resolution mode.
+    //! \details Returns as soon as the command xfer is started, the bus
+    //!  is not occupied during the conversion. See poll_result().
+    //! \retval Status of the operation.
+    //!
+    static ecl::err start_measurement();
+
+    //! \brief Advances measurement started with start_measurement().
+    //! \details First call after the conversion starts reading of the result,
+    //!  the sample is returned by one of the next calls. Sensor does not
+    //!  signal the end of the conversion, thus the first call must be made
+    //!  not earlier than conversion_time() after the start, otherwise
+    //!  the result of the previous measurement is read.
+    //! \param[out] sample Raw sample value, when err::ok is returned.
+    //! \retval err::ok    Sample is read.
+    //! \retval err::again Measurement is in progress.
+    //! \retval Any other status means that measurement failed or not started.
+    //!
+    static ecl::err poll_result(uint16_t &sample);
+
+    //! \brief Returns conversion time in current resolution mode.
+    //!
+    static std::chrono::milliseconds conversion_time();
+
+    //! \brief Returns state of the non-blocking measurement.
+    //!
+    static measurement_state state();
+
+    //! \brief Converts raw sample to a physical value.
+    //! \param[in] sample Raw sample, measured in current resolution mode.
+    //! \retval Illuminance in (1000 * (illuminance in lx)).
+    //!
+    static uint32_t to_illuminance(uint16_t sample);
+
 private:
     //! Returns I2C slave address based on class template parameter
     static constexpr uint8_t pick_i2c_slave_address();
 
+    //! Returns one-time measurement command for current resolution mode
+    static uint8_t pick_command();
+
     //! I2C slave address when ADDR pin is pulled down to GND
     static constexpr uint8_t i2s_address_low = 0x46;
     //! I2C slave address when ADDR pin is pulled up to VCC
@@ -114,6 +154,9 @@ private:
     //! Current resolution mode
     static bh1750_cfg::resolution m_resolution;
 
+    //! Non-blocking measurement: command, then 2 bytes of the result
+    static i2c_measurement<i2c_dev, 2> m_measurement;
+
     //! List of commands, supported by sensor
     enum {
         CMD_POWER_DOWN = 0x0,
@@ -131,6 +174,15 @@ private:
 template <class i2c_dev, bh1750_cfg::i2c_address address>
 bh1750_cfg::resolution bh1750<i2c_dev, address>::m_resolution = bh1750_cfg::resolution::high;
 
+template <class i2c_dev, bh1750_cfg::i2c_address address>
+i2c_measurement<i2c_dev, 2> bh1750<i2c_dev, address>::m_measurement;
+
+template <class i2c_dev, bh1750_cfg::i2c_address address>
+constexpr uint16_t bh1750<i2c_dev, address>::measurement_time_ms_low;
+
+template <class i2c_dev, bh1750_cfg::i2c_address address>
+constexpr uint16_t bh1750<i2c_dev, address>::measurement_time_ms_high;
+
 template <class i2c_dev, bh1750_cfg::i2c_address address>
 ecl::err bh1750<i2c_dev, address>::init()
 {
@@ -164,25 +216,8 @@ ecl::err bh1750<i2c_dev, address>::get_illuminance_sample(uint16_t &sample)
 {
     uint8_t i2c_addr = pick_i2c_slave_address();
 
-    uint8_t cmd = CMD_ONE_TIME_HR_MODE;
-    uint16_t delay = measurement_time_ms_high;
-
-    switch (m_resolution) {
-    case bh1750_cfg::resolution::high:
-        cmd = CMD_ONE_TIME_HR_MODE;
-        delay = measurement_time_ms_high;
-        break;
-    case bh1750_cfg::resolution::high2:
-        cmd = CMD_ONE_TIME_HR_MODE2;
-        delay = measurement_time_ms_high;
-        break;
-    case bh1750_cfg::resolution::low:
-        cmd = CMD_ONE_TIME_LR_MODE;
-        delay = measurement_time_ms_low;
-        break;
-    default:
-        break;
-    }
+    uint8_t cmd = pick_command();
+    auto delay = conversion_time();
 
     i2c_dev::lock();
     i2c_dev::platform_handle().set_slave_addr(i2c_addr);
@@ -197,7 +232,7 @@ ecl::err bh1750<i2c_dev, address>::get_illuminance_sample(uint16_t &sample)
         return rc;
     }
 
-    ecl::this_thread::sleep_for(delay);
+    ecl::this_thread::sleep_for(delay.count());
 
     uint8_t data[2] = {};
 
@@ -230,7 +265,15 @@ ecl::err bh1750<i2c_dev, address>::get_illuminance(uint32_t &value)
         return rc;
     }
 
-    value = ((1000000 * static_cast<uint64_t>(sample)) / 1200);
+    value = to_illuminance(sample);
+
+    return err::ok;
+}
+
+template <class i2c_dev, bh1750_cfg::i2c_address address>
+uint32_t bh1750<i2c_dev, address>::to_illuminance(uint16_t sample)
+{
+    uint32_t value = ((1000000 * static_cast<uint64_t>(sample)) / 1200);
 
     //! low resolution provides 4lx per count and high2 0.5lx per count
     if (m_resolution == bh1750_cfg::resolution::low) {
@@ -239,9 +282,59 @@ ecl::err bh1750<i2c_dev, address>::get_illuminance(uint32_t &value)
         value /= 2;
     }
 
+    return value;
+}
+
+template <class i2c_dev, bh1750_cfg::i2c_address address>
+uint8_t bh1750<i2c_dev, address>::pick_command()
+{
+    switch (m_resolution) {
+    case bh1750_cfg::resolution::high2:
+        return CMD_ONE_TIME_HR_MODE2;
+    case bh1750_cfg::resolution::low:
+        return CMD_ONE_TIME_LR_MODE;
+    case bh1750_cfg::resolution::high:
+    default:
+        return CMD_ONE_TIME_HR_MODE;
+    }
+}
+
+template <class i2c_dev, bh1750_cfg::i2c_address address>
+std::chrono::milliseconds bh1750<i2c_dev, address>::conversion_time()
+{
+    if (m_resolution == bh1750_cfg::resolution::low) {
+        return std::chrono::milliseconds{measurement_time_ms_low};
+    }
+
+    return std::chrono::milliseconds{measurement_time_ms_high};
+}
+
+template <class i2c_dev, bh1750_cfg::i2c_address address>
+ecl::err bh1750<i2c_dev, address>::start_measurement()
+{
+    return m_measurement.start(pick_i2c_slave_address(), pick_command());
+}
+
+template <class i2c_dev, bh1750_cfg::i2c_address address>
+ecl::err bh1750<i2c_dev, address>::poll_result(uint16_t &sample)
+{
+    err rc = m_measurement.poll(pick_i2c_slave_address());
+    if (rc != err::ok) {
+        return rc;
+    }
+
+    auto data = m_measurement.data();
+    sample = ((data[0] << 8) | data[1]);
+
     return err::ok;
 }
 
+template <class i2c_dev, bh1750_cfg::i2c_address address>
+measurement_state bh1750<i2c_dev, address>::state()
+{
+    return m_measurement.state();
+}
+
 
 } // namespace sensor
 
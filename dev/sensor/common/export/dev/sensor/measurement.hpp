@@ -0,0 +1,214 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Non-blocking measurement over I2C bus.
+//! \details Most of the I2C sensors follow the same pattern: a command starts
+//! the conversion, then the result is read once the conversion is finished.
+//! This module implements such cycle as a state machine, driven by async
+//! generic bus xfers, so the bus is free while the sensor converts.
+
+#ifndef DEV_SENSOR_MEASUREMENT_HPP_
+#define DEV_SENSOR_MEASUREMENT_HPP_
+
+#include <ecl/err.hpp>
+#include <common/bus.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace ecl
+{
+
+namespace sensor
+{
+
+//! State of the non-blocking measurement.
+enum class measurement_state : uint8_t
+{
+    idle,           //!< Measurement is not started.
+    command,        //!< Command xfer is ongoing.
+    converting,     //!< Sensor converts, bus is free.
+    reading,        //!< Result xfer is ongoing.
+    ready,          //!< Result is available.
+    failed,         //!< One of xfers failed.
+};
+
+//! Command-then-read measurement cycle of an I2C sensor.
+//! \details Transitions from the command and reading states are made
+//! by the bus event handler, thus in ISR context. The rest are made by
+//! the user calling start() and poll().
+//! \tparam i2c_dev Generic bus driver.
+//! \tparam Size    Size of the result, in bytes.
+template<class i2c_dev, size_t Size>
+class i2c_measurement
+{
+public:
+    //! Constructs measurement in idle state.
+    i2c_measurement();
+
+    //! Sends the command, that starts the conversion.
+    //! \details Returns as soon as the xfer is started.
+    //! \note If other async xfer is ongoing on the bus, the call blocks until
+    //! it finishes. Sensor scheduler never starts xfers on a busy bus.
+    //! \param[in] addr I2C slave address.
+    //! \param[in] cmd  Command to send.
+    //! \retval err::ok   Command xfer started.
+    //! \retval err::busy Xfer of the previous measurement is still ongoing.
+    //! \retval err       Any error of the bus.
+    err start(uint8_t addr, uint8_t cmd);
+
+    //! Advances the measurement.
+    //! \details When called during the conversion, starts reading of
+    //! the result. It is up to the caller to not read the result too early:
+    //! some sensors respond with the previous result instead of NACK.
+    //! \param[in] addr  I2C slave address.
+    //! \param[in] retry If set, NACK on reading means that conversion is
+    //!                  not finished yet, and reading can be repeated.
+    //! \retval err::ok    Result is available in data(). Measurement is idle.
+    //! \retval err::again Measurement is in progress, poll again later.
+    //! \retval err::perm  Measurement is not started.
+    //! \retval err::io    Measurement failed. Measurement is idle.
+    //! \retval err        Any error of the bus, if reading can't be started.
+    err poll(uint8_t addr, bool retry = false);
+
+    //! Gets current state.
+    measurement_state state() const { return m_state; }
+
+    //! Checks if xfer of the measurement is ongoing.
+    bool xfer_pending() const;
+
+    //! Gets result of the last measurement.
+    const uint8_t *data() const { return m_data; }
+
+private:
+    //! Starts async xfer and moves to the given state.
+    err issue(uint8_t addr, const uint8_t *tx, uint8_t *rx, size_t size,
+              measurement_state next);
+
+    //! Handles bus events of both xfers.
+    void handler(bus_channel ch, bus_event type);
+
+    std::atomic<measurement_state>  m_state;    //!< Current state.
+    volatile bool                   m_error;    //!< Error reported within xfer.
+    bool                            m_retry;    //!< Retry reading on NACK.
+    uint8_t                         m_cmd;      //!< Command buffer.
+    uint8_t                         m_data[Size]; //!< Result buffer.
+};
+
+//------------------------------------------------------------------------------
+
+template<class i2c_dev, size_t Size>
+i2c_measurement<i2c_dev, Size>::i2c_measurement()
+    :m_state{measurement_state::idle}
+    ,m_error{false}
+    ,m_retry{false}
+    ,m_cmd{0}
+    ,m_data{}
+{
+}
+
+template<class i2c_dev, size_t Size>
+err i2c_measurement<i2c_dev, Size>::start(uint8_t addr, uint8_t cmd)
+{
+    if (xfer_pending()) {
+        return err::busy;
+    }
+
+    m_cmd = cmd;
+    return issue(addr, &m_cmd, nullptr, 1, measurement_state::command);
+}
+
+template<class i2c_dev, size_t Size>
+err i2c_measurement<i2c_dev, Size>::poll(uint8_t addr, bool retry)
+{
+    switch (m_state.load()) {
+    case measurement_state::idle:
+        return err::perm;
+    case measurement_state::command:
+    case measurement_state::reading:
+        return err::again;
+    case measurement_state::converting: {
+        m_retry = retry;
+        auto rc = issue(addr, nullptr, m_data, Size, measurement_state::reading);
+        if (is_error(rc)) {
+            // Reading can be retried
+            m_state = measurement_state::converting;
+            return rc;
+        }
+
+        return err::again;
+    }
+    case measurement_state::ready:
+        m_state = measurement_state::idle;
+        return err::ok;
+    case measurement_state::failed:
+    default:
+        m_state = measurement_state::idle;
+        return err::io;
+    }
+}
+
+template<class i2c_dev, size_t Size>
+bool i2c_measurement<i2c_dev, Size>::xfer_pending() const
+{
+    auto s = m_state.load();
+    return s == measurement_state::command || s == measurement_state::reading;
+}
+
+template<class i2c_dev, size_t Size>
+err i2c_measurement<i2c_dev, Size>::issue(uint8_t addr, const uint8_t *tx, uint8_t *rx,
+                                          size_t size, measurement_state next)
+{
+    i2c_dev::lock();
+    i2c_dev::platform_handle::set_slave_addr(addr);
+
+    // State must be set before xfer starts, handler may be invoked right away
+    m_error = false;
+    m_state = next;
+
+    err rc = i2c_dev::set_buffers(tx, rx, size);
+    if (rc == err::ok) {
+        rc = i2c_dev::xfer([this](bus_channel ch, bus_event type, size_t) {
+            handler(ch, type);
+        });
+    }
+
+    i2c_dev::unlock();
+
+    if (rc != err::ok) {
+        m_state = measurement_state::idle;
+    }
+
+    return rc;
+}
+
+template<class i2c_dev, size_t Size>
+void i2c_measurement<i2c_dev, Size>::handler(bus_channel ch, bus_event type)
+{
+    if (type == bus_event::err) {
+        m_error = true;
+    }
+
+    if (ch != bus_channel::meta || type != bus_event::tc) {
+        return;
+    }
+
+    if (m_state == measurement_state::command) {
+        m_state = m_error ? measurement_state::failed : measurement_state::converting;
+    } else if (m_state == measurement_state::reading) {
+        if (!m_error) {
+            m_state = measurement_state::ready;
+        } else {
+            m_state = m_retry ? measurement_state::converting : measurement_state::failed;
+        }
+    }
+}
+
+} // namespace sensor
+
+} // namespace ecl
+
+#endif // DEV_SENSOR_MEASUREMENT_HPP_
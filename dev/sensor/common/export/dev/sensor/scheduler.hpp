@@ -0,0 +1,323 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Scheduler of non-blocking measurements on a shared bus.
+//! \details Conversion usually takes much longer than the xfers around it.
+//! Scheduler interleaves measurements of multiple sensors: while one sensor
+//! converts, the bus is used to start or read others. Sampling rate of each
+//! sensor approaches its own conversion rate, instead of being divided
+//! among all sensors on the bus.
+
+#ifndef DEV_SENSOR_SCHEDULER_HPP_
+#define DEV_SENSOR_SCHEDULER_HPP_
+
+#include <dev/sensor/measurement.hpp>
+#include <ecl/err.hpp>
+#include <ecl/assert.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace ecl
+{
+
+namespace sensor
+{
+
+//! Sensor scheduler statistics.
+struct scheduler_stats
+{
+    uint32_t samples;   //!< Samples delivered.
+    uint32_t errors;    //!< Failed measurements.
+    uint32_t retries;   //!< Repeated reads, when sensor was not ready yet.
+};
+
+//! Schedules measurements of sensors sharing the bus.
+//! \details Only one xfer is started at a time, thus sensors never wait
+//! for a bus lock. Conversions in progress are completed first, in order
+//! of their deadlines. Idle sensors are started in round-robin order.
+//!
+//! Each sensor must provide static non-blocking measurement API:
+//! \code
+//! static err start_measurement();
+//! static err poll_result(uint16_t &sample);
+//! static std::chrono::milliseconds conversion_time();
+//! static measurement_state state();
+//! \endcode
+//!
+//! Usage:
+//! \code
+//! using light  = ecl::sensor::bh1750<i2c, bh1750_cfg::i2c_address::low>;
+//! using temp   = ecl::sensor::htu21d<i2c>;
+//!
+//! ecl::sensor::scheduler<light, temp> sched;
+//!
+//! sched.set_handler([](size_t idx, ecl::err rc, uint16_t sample) {
+//!     // idx is position of the sensor in the scheduler parameters
+//! });
+//!
+//! for (;;) {
+//!     auto next = sched.run(now());
+//!     // Sleep until next, or until bus event
+//! }
+//! \endcode
+//! \tparam Sensors Sensor drivers.
+template<class... Sensors>
+class scheduler
+{
+    static_assert(sizeof...(Sensors) > 0, "At least one sensor is required");
+
+public:
+    //! Time units of the scheduler.
+    using duration = std::chrono::milliseconds;
+
+    //! Sample handler. Called from run().
+    //! \details Sample is valid only if status is err::ok.
+    using sample_handler = std::function<void(size_t idx, err rc, uint16_t sample)>;
+
+    //! Amount of sensors.
+    static constexpr size_t count = sizeof...(Sensors);
+
+    //! Delay before reading is repeated, if sensor was not ready.
+    static constexpr duration retry_interval{1};
+
+    //! Constructs scheduler. Sensors are sampled continuously by default.
+    scheduler();
+
+    //! Sets sample handler.
+    void set_handler(const sample_handler &h) { m_handler = h; }
+
+    //! Sets minimum interval between starts of measurements of the sensor.
+    //! \param[in] idx    Position of the sensor in the scheduler parameters.
+    //! \param[in] period Sampling period. Zero means continuous sampling.
+    void set_period(size_t idx, duration period);
+
+    //! Delivers finished measurements and starts next xfer, if any is due.
+    //! \details Never blocks, if the bus is not used by anyone else.
+    //! \param[in] now Current time.
+    //! \return Time, when run() must be called next. If it is equal to now,
+    //!         xfer is ongoing and run() must be called as soon as it is done.
+    duration run(duration now);
+
+    //! Gets statistics.
+    const scheduler_stats &stats() const { return m_stats; }
+
+    //! Resets statistics.
+    void reset_stats() { m_stats = scheduler_stats{}; }
+
+private:
+    //! Measurement API of a sensor.
+    struct ops
+    {
+        err                 (*start)();
+        err                 (*poll)(uint16_t &sample);
+        duration            (*conversion_time)();
+        measurement_state   (*state)();
+    };
+
+    //! Wrapper to get rid of default arguments of the sensor API.
+    template<class S>
+    static err start_of() { return S::start_measurement(); }
+
+    //! Gets measurement API of the sensor.
+    static const ops &sensor(size_t idx);
+
+    //! Delivers measurement result to the handler.
+    void deliver(size_t idx);
+
+    //! Starts reading the sensor with the earliest expired deadline.
+    //! \return true if reading is started.
+    bool read_due(duration now);
+
+    //! Starts next idle sensor, if its period is expired.
+    //! \return true if measurement is started.
+    bool start_due(duration now);
+
+    sample_handler  m_handler;              //!< User handler.
+    duration        m_period[count];        //!< Sampling periods.
+    duration        m_start_at[count];      //!< Time of the next start.
+    duration        m_deadline[count];      //!< End of the conversion.
+    bool            m_timed[count];         //!< Deadline is set.
+    bool            m_polled[count];        //!< Reading was started.
+    size_t          m_next;                 //!< Next sensor to start.
+    scheduler_stats m_stats;                //!< Statistics.
+};
+
+//------------------------------------------------------------------------------
+
+template<class... Sensors>
+constexpr typename scheduler<Sensors...>::duration scheduler<Sensors...>::retry_interval;
+
+template<class... Sensors>
+scheduler<Sensors...>::scheduler()
+    :m_handler{}
+    ,m_period{}
+    ,m_start_at{}
+    ,m_deadline{}
+    ,m_timed{}
+    ,m_polled{}
+    ,m_next{0}
+    ,m_stats{}
+{
+}
+
+template<class... Sensors>
+void scheduler<Sensors...>::set_period(size_t idx, duration period)
+{
+    ecl_assert(idx < count);
+    m_period[idx] = period;
+}
+
+template<class... Sensors>
+typename scheduler<Sensors...>::duration scheduler<Sensors...>::run(duration now)
+{
+    bool busy = false;
+
+    for (size_t i = 0; i < count; ++i) {
+        switch (sensor(i).state()) {
+        case measurement_state::command:
+        case measurement_state::reading:
+            busy = true;
+            break;
+        case measurement_state::converting:
+            if (!m_timed[i]) {
+                // Conversion is just started, or sensor was not ready
+                // when it was read
+                if (m_polled[i]) {
+                    m_deadline[i] = now + retry_interval;
+                    m_stats.retries++;
+                } else {
+                    m_deadline[i] = now + sensor(i).conversion_time();
+                }
+
+                m_timed[i] = true;
+            }
+            break;
+        case measurement_state::ready:
+        case measurement_state::failed:
+            deliver(i);
+            break;
+        case measurement_state::idle:
+        default:
+            break;
+        }
+    }
+
+    if (busy || read_due(now) || start_due(now)) {
+        return now;
+    }
+
+    auto next = duration::max();
+
+    for (size_t i = 0; i < count; ++i) {
+        auto s = sensor(i).state();
+
+        if (s == measurement_state::converting && m_deadline[i] < next) {
+            next = m_deadline[i];
+        } else if (s == measurement_state::idle && m_start_at[i] < next) {
+            next = m_start_at[i];
+        }
+    }
+
+    return next;
+}
+
+template<class... Sensors>
+const typename scheduler<Sensors...>::ops &scheduler<Sensors...>::sensor(size_t idx)
+{
+    static const ops table[] = {
+        { &start_of<Sensors>, &Sensors::poll_result,
+          &Sensors::conversion_time, &Sensors::state }...
+    };
+
+    return table[idx];
+}
+
+template<class... Sensors>
+void scheduler<Sensors...>::deliver(size_t idx)
+{
+    uint16_t sample = 0;
+    err rc = sensor(idx).poll(sample);
+
+    if (rc == err::ok) {
+        m_stats.samples++;
+    } else {
+        m_stats.errors++;
+    }
+
+    if (m_handler) {
+        m_handler(idx, rc, sample);
+    }
+}
+
+template<class... Sensors>
+bool scheduler<Sensors...>::read_due(duration now)
+{
+    size_t pick = count;
+
+    for (size_t i = 0; i < count; ++i) {
+        if (sensor(i).state() == measurement_state::converting && m_deadline[i] <= now
+                && (pick == count || m_deadline[i] < m_deadline[pick])) {
+            pick = i;
+        }
+    }
+
+    if (pick == count) {
+        return false;
+    }
+
+    m_timed[pick] = false;
+    m_polled[pick] = true;
+
+    uint16_t sample;
+    err rc = sensor(pick).poll(sample);
+
+    // Reading can't be started, retry it later
+    return rc == err::again;
+}
+
+template<class... Sensors>
+bool scheduler<Sensors...>::start_due(duration now)
+{
+    for (size_t k = 0; k < count; ++k) {
+        size_t i = (m_next + k) % count;
+
+        if (sensor(i).state() != measurement_state::idle || m_start_at[i] > now) {
+            continue;
+        }
+
+        m_next = (i + 1) % count;
+        m_timed[i] = false;
+        m_polled[i] = false;
+        m_start_at[i] = now + m_period[i];
+
+        err rc = sensor(i).start();
+        if (rc == err::ok) {
+            return true;
+        }
+
+        // Measurement will be retried after the period, but do not
+        // flood the bus if sensor is sampled continuously
+        if (m_period[i] < retry_interval) {
+            m_start_at[i] = now + retry_interval;
+        }
+
+        m_stats.errors++;
+
+        if (m_handler) {
+            m_handler(i, rc, 0);
+        }
+    }
+
+    return false;
+}
+
+} // namespace sensor
+
+} // namespace ecl
+
+#endif // DEV_SENSOR_SCHEDULER_HPP_
@@ -0,0 +1,27 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#ifndef MOCK_ECL_THREAD_THREAD_HPP_
+#define MOCK_ECL_THREAD_THREAD_HPP_
+
+// Blocking sensor API is not used by the tests, sleep is a stub
+
+#include <cstdint>
+
+namespace ecl
+{
+
+namespace this_thread
+{
+
+static inline void sleep_for(uint32_t ms)
+{
+    (void)ms;
+}
+
+} // namespace this_thread
+
+} // namespace ecl
+
+#endif // MOCK_ECL_THREAD_THREAD_HPP_
@@ -0,0 +1,567 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <dev/bus.hpp>
+#include <dev/sensor/bh1750.hpp>
+#include <dev/sensor/htu21d.hpp>
+#include <dev/sensor/scheduler.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+using std::chrono::microseconds;
+using std::chrono::milliseconds;
+
+//------------------------------------------------------------------------------
+// Simulated I2C bus. Xfer completes when the test advances the time.
+
+// Device attached to the simulated bus.
+struct i2c_device
+{
+    virtual ~i2c_device() = default;
+
+    // Returns false to NACK
+    virtual bool write(const uint8_t *buf, size_t size, microseconds now) = 0;
+    virtual bool read(uint8_t *buf, size_t size, microseconds now) = 0;
+};
+
+// Xfer, as seen on the bus
+struct i2c_record
+{
+    uint16_t        addr;
+    bool            read;
+    uint8_t         cmd;
+    bool            ack;
+    microseconds    start;
+};
+
+struct i2c_sim
+{
+    using channel    = ecl::bus_channel;
+    using event      = ecl::bus_event;
+    using handler_fn = ecl::bus_handler;
+
+    // 100 kHz: 9 bits per byte, address included
+    static constexpr microseconds byte_time{90};
+
+    static ecl::err init() { return ecl::err::ok; }
+
+    static void set_handler(const handler_fn &h) { m_handler = h; }
+
+    static void reset_handler() { m_handler = handler_fn{}; }
+
+    static void reset_buffers()
+    {
+        m_tx = nullptr;
+        m_rx = nullptr;
+        m_tx_size = m_rx_size = 0;
+    }
+
+    static void set_tx(const uint8_t *tx, size_t size)
+    {
+        m_tx = tx;
+        m_tx_size = tx ? size : 0;
+    }
+
+    static void set_tx(size_t, uint8_t) { FAIL("Not used by sensors"); }
+
+    static void set_rx(uint8_t *rx, size_t size)
+    {
+        m_rx = rx;
+        m_rx_size = rx ? size : 0;
+    }
+
+    static void set_slave_addr(uint16_t addr) { m_addr = addr; }
+
+    static ecl::err do_xfer()
+    {
+        // Scheduler must never start xfer on a busy bus
+        CHECK_FALSE(m_pending);
+
+        m_pending = true;
+        m_start = now;
+        m_end = now + byte_time * (1 + m_tx_size + m_rx_size);
+
+        return ecl::err::ok;
+    }
+
+    static ecl::err cancel_xfer() { return ecl::err::ok; }
+
+    // Completes ongoing xfer, advancing the time to its end
+    static void complete()
+    {
+        CHECK_TRUE(m_pending);
+
+        now = m_end;
+        m_pending = false;
+
+        auto it = devices.find(m_addr);
+        auto dev = it == devices.end() ? nullptr : it->second;
+        bool ack = true;
+
+        if (m_tx_size) {
+            ack = dev && dev->write(m_tx, m_tx_size, now);
+            log.push_back(i2c_record{m_addr, false, m_tx[0], ack, m_start});
+            m_handler(channel::tx, ack ? event::tc : event::err, ack ? m_tx_size : 0);
+        }
+
+        if (m_rx_size) {
+            ack = dev && dev->read(m_rx, m_rx_size, now);
+            log.push_back(i2c_record{m_addr, true, 0, ack, m_start});
+            m_handler(channel::rx, ack ? event::tc : event::err, ack ? m_rx_size : 0);
+        }
+
+        m_handler(channel::meta, event::tc, 0);
+    }
+
+    static bool pending() { return m_pending; }
+
+    static microseconds                     now;
+    static std::map<uint16_t, i2c_device*>  devices;
+    static std::vector<i2c_record>          log;
+
+private:
+    static handler_fn       m_handler;
+    static const uint8_t    *m_tx;
+    static uint8_t          *m_rx;
+    static size_t           m_tx_size;
+    static size_t           m_rx_size;
+    static uint16_t         m_addr;
+    static bool             m_pending;
+    static microseconds     m_start;
+    static microseconds     m_end;
+};
+
+constexpr microseconds                  i2c_sim::byte_time;
+microseconds                            i2c_sim::now;
+std::map<uint16_t, i2c_device*>         i2c_sim::devices;
+std::vector<i2c_record>                 i2c_sim::log;
+i2c_sim::handler_fn                     i2c_sim::m_handler;
+const uint8_t                           *i2c_sim::m_tx;
+uint8_t                                 *i2c_sim::m_rx;
+size_t                                  i2c_sim::m_tx_size;
+size_t                                  i2c_sim::m_rx_size;
+uint16_t                                i2c_sim::m_addr;
+bool                                    i2c_sim::m_pending;
+microseconds                            i2c_sim::m_start;
+microseconds                            i2c_sim::m_end;
+
+//------------------------------------------------------------------------------
+// Sensor models
+
+// BH1750 in one-time low resolution mode. Does not NACK during conversion,
+// but returns stale result.
+struct bh1750_model : i2c_device
+{
+    bool write(const uint8_t *buf, size_t size, microseconds now) override
+    {
+        CHECK_EQUAL(1U, size);
+        CHECK_EQUAL(0x23, buf[0]);
+
+        ready_at = now + milliseconds{16};
+        converting = true;
+        return true;
+    }
+
+    bool read(uint8_t *buf, size_t size, microseconds now) override
+    {
+        CHECK_EQUAL(2U, size);
+
+        if (converting && now < ready_at) {
+            early_reads++;
+        } else if (converting) {
+            converting = false;
+            sample++;
+        }
+
+        buf[0] = sample >> 8;
+        buf[1] = sample & 0xff;
+        return true;
+    }
+
+    microseconds    ready_at{};
+    bool            converting = false;
+    uint16_t        sample = 1000;
+    int             early_reads = 0;
+};
+
+// HTU21D in no hold master mode. NACKs reading during conversion.
+struct htu21d_model : i2c_device
+{
+    bool write(const uint8_t *buf, size_t size, microseconds now) override
+    {
+        CHECK_EQUAL(1U, size);
+        CHECK(buf[0] == 0xf3 || buf[0] == 0xf5);
+
+        ready_at = now + (buf[0] == 0xf3 ? milliseconds{44} : milliseconds{14});
+        converting = true;
+        return true;
+    }
+
+    bool read(uint8_t *buf, size_t size, microseconds now) override
+    {
+        CHECK_EQUAL(3U, size);
+
+        if (!converting || now < ready_at) {
+            nacks++;
+            return false;
+        }
+
+        converting = false;
+        sample += 4;
+
+        buf[0] = sample >> 8;
+        buf[1] = sample & 0xff;
+        buf[2] = 0; // CRC is not checked
+        return true;
+    }
+
+    microseconds    ready_at{};
+    bool            converting = false;
+    uint16_t        sample = 0x6000;
+    int             nacks = 0;
+};
+
+//------------------------------------------------------------------------------
+
+using bus_t     = ecl::generic_bus<i2c_sim>;
+using light_lo  = ecl::sensor::bh1750<bus_t, ecl::sensor::bh1750_cfg::i2c_address::low>;
+using light_hi  = ecl::sensor::bh1750<bus_t, ecl::sensor::bh1750_cfg::i2c_address::high>;
+using humid     = ecl::sensor::htu21d<bus_t>;
+using sched_t   = ecl::sensor::scheduler<light_lo, light_hi, humid>;
+
+static constexpr uint16_t light_lo_addr = 0x46;
+static constexpr uint16_t light_hi_addr = 0xB8;
+static constexpr uint16_t humid_addr    = 0x80;
+
+// Runs the scheduler on the simulated bus for the given time
+static void simulate(sched_t &s, microseconds duration)
+{
+    auto until = i2c_sim::now + duration;
+
+    while (i2c_sim::now < until) {
+        auto next = s.run(std::chrono::duration_cast<milliseconds>(i2c_sim::now));
+
+        if (i2c_sim::pending()) {
+            i2c_sim::complete();
+        } else if (next == milliseconds::max()) {
+            break;
+        } else {
+            i2c_sim::now = std::max(i2c_sim::now + microseconds{1},
+                                    microseconds{next});
+        }
+    }
+}
+
+// Blocking style measurement: bus is idle while the sensor converts
+template<class Sensor>
+static ecl::err measure_blocking(uint16_t &sample)
+{
+    auto rc = Sensor::start_measurement();
+    if (rc != ecl::err::ok) {
+        return rc;
+    }
+
+    i2c_sim::complete();
+    i2c_sim::now += Sensor::conversion_time();
+
+    while ((rc = Sensor::poll_result(sample)) == ecl::err::again) {
+        i2c_sim::complete();
+    }
+
+    return rc;
+}
+
+// Brings sensor to idle state, so the next test starts from scratch
+template<class Sensor>
+static void drain()
+{
+    uint16_t sample;
+
+    while (Sensor::state() != ecl::sensor::measurement_state::idle) {
+        if (i2c_sim::pending()) {
+            i2c_sim::complete();
+        }
+
+        i2c_sim::now += milliseconds{100};
+        Sensor::poll_result(sample);
+    }
+}
+
+// Sensors attached to the bus
+static bh1750_model lo;
+static bh1750_model hi;
+static htu21d_model rh;
+
+static void attach_all()
+{
+    i2c_sim::devices = {
+        { light_lo_addr, &lo },
+        { light_hi_addr, &hi },
+        { humid_addr, &rh },
+    };
+}
+
+static void sim_setup()
+{
+    lo = bh1750_model{};
+    hi = bh1750_model{};
+    rh = htu21d_model{};
+
+    i2c_sim::now = microseconds{0};
+    i2c_sim::log.clear();
+    attach_all();
+
+    bus_t::init();
+
+    light_lo::set_resolution(ecl::sensor::bh1750_cfg::resolution::low);
+    light_hi::set_resolution(ecl::sensor::bh1750_cfg::resolution::low);
+}
+
+static void sim_teardown()
+{
+    attach_all();
+
+    drain<light_lo>();
+    drain<light_hi>();
+    drain<humid>();
+
+    bus_t::deinit();
+}
+
+TEST_GROUP(sensor)
+{
+    void setup() { sim_setup(); }
+    void teardown() { sim_teardown(); }
+};
+
+TEST(sensor, bh1750_measurement_steps)
+{
+    using ecl::sensor::measurement_state;
+    uint16_t sample = 0;
+
+    CHECK_EQUAL(ecl::err::perm, light_lo::poll_result(sample));
+
+    CHECK_EQUAL(ecl::err::ok, light_lo::start_measurement());
+    CHECK_TRUE(light_lo::state() == measurement_state::command);
+    CHECK_EQUAL(ecl::err::again, light_lo::poll_result(sample));
+
+    // Second start is rejected while the command is sent
+    CHECK_EQUAL(ecl::err::busy, light_lo::start_measurement());
+
+    // Bus is free during conversion
+    i2c_sim::complete();
+    CHECK_TRUE(light_lo::state() == measurement_state::converting);
+    CHECK_EQUAL(25, light_lo::conversion_time().count());
+
+    i2c_sim::now += light_lo::conversion_time();
+    CHECK_EQUAL(ecl::err::again, light_lo::poll_result(sample));
+    CHECK_TRUE(light_lo::state() == measurement_state::reading);
+
+    i2c_sim::complete();
+    CHECK_TRUE(light_lo::state() == measurement_state::ready);
+    CHECK_EQUAL(ecl::err::ok, light_lo::poll_result(sample));
+    CHECK_EQUAL(1001, sample);
+    CHECK_TRUE(light_lo::state() == measurement_state::idle);
+
+    // 4 lx per count in low resolution mode
+    CHECK_EQUAL(1001U * 1000000 / 1200 * 4, light_lo::to_illuminance(sample));
+
+    CHECK_EQUAL(2U, i2c_sim::log.size());
+    CHECK_EQUAL(light_lo_addr, i2c_sim::log[0].addr);
+    CHECK_EQUAL(0x23, i2c_sim::log[0].cmd);
+    CHECK_TRUE(i2c_sim::log[1].read);
+    CHECK_EQUAL(0, lo.early_reads);
+}
+
+TEST(sensor, htu21d_reading_repeated_until_ready)
+{
+    uint16_t sample = 0;
+
+    CHECK_EQUAL(ecl::err::ok, humid::start_measurement(ecl::sensor::htu21d_quantity::humidity));
+    CHECK_EQUAL(16, humid::conversion_time().count());
+    i2c_sim::complete();
+
+    // Too early, sensor NACKs
+    CHECK_EQUAL(ecl::err::again, humid::poll_result(sample));
+    i2c_sim::complete();
+    CHECK_EQUAL(1, rh.nacks);
+    CHECK_TRUE(humid::state() == ecl::sensor::measurement_state::converting);
+
+    i2c_sim::now += humid::conversion_time();
+    CHECK_EQUAL(ecl::err::again, humid::poll_result(sample));
+    i2c_sim::complete();
+    CHECK_EQUAL(ecl::err::ok, humid::poll_result(sample));
+    CHECK_EQUAL(0x6004, sample);
+    CHECK_EQUAL(0xf5, i2c_sim::log[0].cmd);
+
+    // Same conversion as in the blocking API
+    CHECK_EQUAL(-6000 + static_cast<int>((125000LL * 0x6004) >> 16), humid::to_humidity(sample));
+
+    CHECK_EQUAL(ecl::err::ok, humid::start_measurement());
+    CHECK_EQUAL(50, humid::conversion_time().count());
+}
+
+TEST(sensor, absent_device_fails)
+{
+    uint16_t sample = 0;
+    i2c_sim::devices.erase(light_hi_addr);
+
+    CHECK_EQUAL(ecl::err::ok, light_hi::start_measurement());
+    i2c_sim::complete();
+
+    CHECK_TRUE(light_hi::state() == ecl::sensor::measurement_state::failed);
+    CHECK_EQUAL(ecl::err::io, light_hi::poll_result(sample));
+    CHECK_TRUE(light_hi::state() == ecl::sensor::measurement_state::idle);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(scheduler)
+{
+    void setup() { sim_setup(); }
+    void teardown() { sim_teardown(); }
+};
+
+TEST(scheduler, conversions_are_interleaved)
+{
+    sched_t s;
+    std::vector<std::pair<size_t, uint16_t>> samples;
+
+    s.set_handler([&samples](size_t idx, ecl::err rc, uint16_t sample) {
+        CHECK_EQUAL(ecl::err::ok, rc);
+        samples.emplace_back(idx, sample);
+    });
+
+    simulate(s, milliseconds{60});
+
+    auto &log = i2c_sim::log;
+    CHECK(log.size() >= 6);
+
+    // All sensors are started back to back, before any result is read
+    CHECK_EQUAL(light_lo_addr, log[0].addr);
+    CHECK_EQUAL(light_hi_addr, log[1].addr);
+    CHECK_EQUAL(humid_addr, log[2].addr);
+
+    for (size_t i = 0; i < 3; ++i) {
+        CHECK_FALSE(log[i].read);
+    }
+
+    CHECK_EQUAL(180, log[1].start.count());
+    CHECK_EQUAL(360, log[2].start.count());
+
+    // Light sensors are read and restarted while humidity converts
+    CHECK_EQUAL(light_lo_addr, log[3].addr);
+    CHECK_TRUE(log[3].read);
+    CHECK_EQUAL(light_hi_addr, log[4].addr);
+    CHECK_TRUE(log[4].read);
+    CHECK_EQUAL(light_lo_addr, log[5].addr);
+    CHECK_FALSE(log[5].read);
+
+    CHECK_EQUAL(0U, samples[0].first);
+    CHECK_EQUAL(1001, samples[0].second);
+    CHECK_EQUAL(1U, samples[1].first);
+    CHECK_EQUAL(1001, samples[1].second);
+
+    size_t humid_samples = std::count_if(samples.begin(), samples.end(),
+                                         [](auto &v) { return v.first == 2; });
+    CHECK_EQUAL(1U, humid_samples);
+
+    // Conversion time is respected
+    CHECK_EQUAL(0, lo.early_reads);
+    CHECK_EQUAL(0, hi.early_reads);
+    CHECK_EQUAL(0, rh.nacks);
+    CHECK_EQUAL(0U, s.stats().retries);
+    CHECK_EQUAL(samples.size(), s.stats().samples);
+}
+
+TEST(scheduler, failed_sensor_does_not_stall_others)
+{
+    sched_t s;
+    size_t ok[3] = {};
+    size_t failed[3] = {};
+
+    i2c_sim::devices.erase(light_hi_addr);
+
+    s.set_handler([&](size_t idx, ecl::err rc, uint16_t) {
+        (rc == ecl::err::ok ? ok : failed)[idx]++;
+    });
+
+    simulate(s, milliseconds{200});
+
+    CHECK(ok[0] >= 7);
+    CHECK_EQUAL(0U, ok[1]);
+    CHECK(failed[1] > 0);
+    CHECK(ok[2] >= 3);
+    CHECK_EQUAL(failed[1], s.stats().errors);
+}
+
+TEST(scheduler, sampling_period)
+{
+    sched_t s;
+    size_t got[3] = {};
+
+    s.set_period(0, milliseconds{100});
+    s.set_period(1, milliseconds{250});
+    s.set_period(2, milliseconds{500});
+
+    s.set_handler([&](size_t idx, ecl::err, uint16_t) {
+        got[idx]++;
+    });
+
+    simulate(s, milliseconds{1000});
+
+    CHECK_EQUAL(10U, got[0]);
+    CHECK_EQUAL(4U, got[1]);
+    CHECK_EQUAL(2U, got[2]);
+}
+
+TEST(scheduler, throughput)
+{
+    constexpr auto window = milliseconds{5000};
+
+    // Sequential, as with blocking API
+    size_t sequential = 0;
+    uint16_t sample;
+
+    while (i2c_sim::now < window) {
+        sequential += ecl::is_ok(measure_blocking<light_lo>(sample));
+        sequential += ecl::is_ok(measure_blocking<light_hi>(sample));
+        sequential += ecl::is_ok(measure_blocking<humid>(sample));
+    }
+
+    auto sequential_time = i2c_sim::now;
+
+    // Interleaved
+    sched_t s;
+    i2c_sim::now = microseconds{0};
+    simulate(s, window);
+
+    auto per_sec = [](size_t samples, microseconds t) {
+        return samples * 1e6 / t.count();
+    };
+
+    auto seq_sps = per_sec(sequential, sequential_time);
+    auto sched_sps = per_sec(s.stats().samples, i2c_sim::now);
+
+    std::cout << "\n\nThree sensors on one I2C bus, samples/sec\n"
+              << std::setw(16) << "sequential: " << seq_sps << '\n'
+              << std::setw(16) << "scheduled: " << sched_sps << '\n';
+
+    // Bus is no longer idle during conversions
+    CHECK(sched_sps > 2 * seq_sps);
+    CHECK_EQUAL(0U, s.stats().errors);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -13,6 +13,9 @@
 
 #include <ecl/err.hpp>
 #include <common/execution.hpp>
+#include <dev/sensor/measurement.hpp>
+
+#include <chrono>
 
 namespace ecl
 {
@@ -45,6 +48,14 @@ enum class htu21d_resolution
     rm11_t11
 };
 
+//! \brief Physical quantities measured by HTU21D sensor.
+//!
+enum class htu21d_quantity
+{
+    temperature,
+    humidity
+};
+
 //! \brief HTU21D sensor driver implementation.
 //! \tparam I2C generic bus driver
 //!
@@ -132,6 +143,46 @@ public:
     //!
     static err get_resolution_mode(htu21d_resolution &mode);
 
+    //! \brief Starts measurement in I2C no hold master mode.
+    //! \details Returns as soon as the command xfer is started, the bus
+    //!  is not occupied during the conversion. See poll_result().
+    //! \param[in] what Quantity to measure.
+    //! \retval Status of the operation.
+    //!
+    static err start_measurement(htu21d_quantity what = htu21d_quantity::temperature);
+
+    //! \brief Advances measurement started with start_measurement().
+    //! \details First call after the conversion starts reading of the result,
+    //!  the sample is returned by one of the next calls. Sensor NACKs reading
+    //!  until conversion is finished, in that case reading is repeated on
+    //!  the next call. To avoid useless xfers, the first call should be made
+    //!  after conversion_time().
+    //! \param[out] sample Raw sample value, when err::ok is returned.
+    //! \retval err::ok    Sample is read.
+    //! \retval err::again Measurement is in progress.
+    //! \retval Any other status means that measurement failed or not started.
+    //!
+    static err poll_result(uint16_t &sample);
+
+    //! \brief Returns maximum conversion time of the last started measurement.
+    //! \details Time for the highest resolution is assumed.
+    //!
+    static std::chrono::milliseconds conversion_time();
+
+    //! \brief Returns state of the non-blocking measurement.
+    //!
+    static measurement_state state();
+
+    //! \brief Converts raw temperature sample to a physical value.
+    //! \retval Temperature in (1000 * (temperature in C degree)).
+    //!
+    static int to_temperature(uint16_t sample);
+
+    //! \brief Converts raw humidity sample to a physical value.
+    //! \retval Relative humidity in (1000 * (humidity in %)).
+    //!
+    static int to_humidity(uint16_t sample);
+
     //! \brief Try set buffer for rx/tx and do_xfer several times if error occurred
     //! \retval Status of the operation
     //!
@@ -173,6 +224,18 @@ private:
     //! Used to enable rm11_t11 mode
     static constexpr uint8_t rm11_t11_mask = 0x81;
 
+    //! Maximum temperature conversion time, 14 bit resolution
+    static constexpr uint16_t temperature_time_ms = 50;
+
+    //! Maximum humidity conversion time, 12 bit resolution
+    static constexpr uint16_t humidity_time_ms = 16;
+
+    //! Non-blocking measurement: command, then MSB, LSB and CRC
+    static i2c_measurement<i2c_dev, 3> m_measurement;
+
+    //! Quantity of the last started measurement
+    static htu21d_quantity m_quantity;
+
     //! Reads sample from sensor in I2C hold master mode.
     //! In this mode sensor holds SCL until measurements is finished
     static err i2c_get_sample_hold_master(uint8_t cmd, uint16_t &sample);
@@ -188,6 +251,18 @@ private:
     static err write_user_register(uint8_t value);
 };
 
+template <class i2c_dev>
+i2c_measurement<i2c_dev, 3> htu21d<i2c_dev>::m_measurement;
+
+template <class i2c_dev>
+htu21d_quantity htu21d<i2c_dev>::m_quantity = htu21d_quantity::temperature;
+
+template <class i2c_dev>
+constexpr uint16_t htu21d<i2c_dev>::temperature_time_ms;
+
+template <class i2c_dev>
+constexpr uint16_t htu21d<i2c_dev>::humidity_time_ms;
+
 template <class i2c_dev>
 err htu21d<i2c_dev>::init()
 {
@@ -293,14 +368,20 @@ err htu21d<i2c_dev>::get_temperature(int &value)
         return rc;
     }
 
+    value = to_temperature(sample);
+
+    return rc;
+}
+
+template <class i2c_dev>
+int htu21d<i2c_dev>::to_temperature(uint16_t sample)
+{
     // clear last 2 bits according to RM,
     // since they contain status information
     sample &= ~3;
 
     // See datasheet, page 15
-    value = -46850 + ((175720 * static_cast<uint64_t>(sample)) >> 16);
-
-    return rc;
+    return -46850 + ((175720 * static_cast<uint64_t>(sample)) >> 16);
 }
 
 template <class i2c_dev>
@@ -313,14 +394,65 @@ err htu21d<i2c_dev>::get_humidity(int &value)
         return rc;
     }
 
+    value = to_humidity(sample);
+
+    return rc;
+}
+
+template <class i2c_dev>
+int htu21d<i2c_dev>::to_humidity(uint16_t sample)
+{
     // clear last 2 bits according to RM,
     // since they contain status information
     sample &= ~3;
 
     // See datasheet, page 15
-    value = -6000 + ((125000 * static_cast<uint64_t>(sample)) >> 16);
+    return -6000 + ((125000 * static_cast<uint64_t>(sample)) >> 16);
+}
 
-    return rc;
+template <class i2c_dev>
+err htu21d<i2c_dev>::start_measurement(htu21d_quantity what)
+{
+    if (m_measurement.xfer_pending()) {
+        return err::busy;
+    }
+
+    m_quantity = what;
+
+    uint8_t cmd = what == htu21d_quantity::humidity ? TRIGGER_HUMIDITY : TRIGGER_TEMPERATURE;
+
+    return m_measurement.start(i2_addr, cmd);
+}
+
+template <class i2c_dev>
+err htu21d<i2c_dev>::poll_result(uint16_t &sample)
+{
+    // Sensor NACKs reading until conversion is finished
+    err rc = m_measurement.poll(i2_addr, true);
+    if (rc != err::ok) {
+        return rc;
+    }
+
+    auto data = m_measurement.data();
+    sample = ((data[0] << 8) | data[1]);
+
+    return err::ok;
+}
+
+template <class i2c_dev>
+std::chrono::milliseconds htu21d<i2c_dev>::conversion_time()
+{
+    if (m_quantity == htu21d_quantity::humidity) {
+        return std::chrono::milliseconds{humidity_time_ms};
+    }
+
+    return std::chrono::milliseconds{temperature_time_ms};
+}
+
+template <class i2c_dev>
+measurement_state htu21d<i2c_dev>::state()
+{
+    return m_measurement.state();
 }
 
 template <class i2c_dev>
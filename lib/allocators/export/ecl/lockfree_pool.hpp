@@ -0,0 +1,238 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//!
+//! \file
+//! \brief Lock-free pool of fixed-size objects.
+//!
+#ifndef LIB_ALLOC_LOCKFREE_POOL_HPP_
+#define LIB_ALLOC_LOCKFREE_POOL_HPP_
+
+#include <ecl/pool.hpp>
+
+#include <array>
+#include <atomic>
+#include <climits>
+#include <type_traits>
+
+namespace ecl
+{
+
+//!
+//! \brief Lock-free pool of objects of the same type.
+//!
+//! Free slots are kept in a Treiber stack. Stack head is a single machine
+//! word holding both index of the top slot and a modification tag, so it
+//! can be updated with a single compare-and-swap (LDREX/STREX on Cortex-M3
+//! and above) and is not susceptible to the ABA problem, unless the tag wraps
+//! around between load and CAS of a single caller. Index takes only as many
+//! bits as the slot count requires, the rest of the word is given to the tag.
+//! E.g. on 32-bit targets pool of 100 slots has 25-bit tag, i.e. 2^25 pool
+//! operations must happen while a single caller is preempted.
+//!
+//! Allocation and deallocation never block and can be safely called
+//! concurrently from threads and interrupt handlers.
+//!
+//! Pool implements pool_base, thus can be used with pool_allocator and
+//! ecl::allocate_shared(). Only requests that fit into a single slot are
+//! served.
+//!
+//! \tparam T Type of objects placed in the pool. Size and alignment of the
+//!           slot are derived from it.
+//! \tparam N Slot count.
+//!
+template< typename T, size_t N >
+class lockfree_pool : public pool_base
+{
+    static_assert(N, "Slot count must be bigger than 0");
+    static_assert(N < 0xffff, "Slot count must fit into 16-bit index");
+
+    //! Packed stack head.
+    using head_type = uintptr_t;
+
+    //! Calculates width of the index, able to hold all slots and nil marker.
+    static constexpr unsigned index_width(size_t n)
+    {
+        unsigned w = 1;
+
+        while ((static_cast< size_t >(1) << w) <= n) {
+            ++w;
+        }
+
+        return w;
+    }
+
+public:
+    //! Width of the slot index in the stack head.
+    static constexpr unsigned index_bits = index_width(N);
+    //! Width of the ABA tag in the stack head.
+    static constexpr unsigned tag_bits = sizeof(head_type) * CHAR_BIT - index_bits;
+
+    static_assert(index_bits + tag_bits == sizeof(head_type) * CHAR_BIT
+                  && tag_bits >= 16,
+                  "Stack head must fit slot index and at least 16-bit tag");
+
+    //! \brief Constructs pool.
+    lockfree_pool();
+
+    //! \brief Destructs pool.
+    ~lockfree_pool();
+
+    //! \copydoc pool_base::real_alloc()
+    //! \details Returns nullptr if requested chunk does not fit into the slot.
+    uint8_t* real_alloc(size_t n, size_t align, size_t obj_sz) override;
+
+    //! \copydoc pool_base::real_dealloc()
+    void real_dealloc(uint8_t *p, size_t n, size_t obj_sz) override;
+
+    // Copying disabled.
+    lockfree_pool& operator=(lockfree_pool&) = delete;
+    lockfree_pool(const lockfree_pool&) = delete;
+
+private:
+    //! Slot index.
+    using index_type = uint16_t;
+    //! Slot storage.
+    using slot_type = std::aligned_storage_t< sizeof(T), alignof(T) >;
+
+    //! Mask of the index in the stack head. Tag takes the rest.
+    static constexpr head_type index_mask =
+            (static_cast< head_type >(1) << index_bits) - 1;
+
+    //! Index used as the end of the stack marker.
+    static constexpr index_type nil = index_mask;
+
+    //! Builds new head value from the previous one and new top index.
+    static head_type next_head(head_type prev, index_type idx);
+
+    //! Extracts top slot index from the head.
+    static index_type top(head_type head);
+
+    //! Pops slot from the free stack. Returns nil if there are no slots left.
+    index_type pop();
+
+    //! Pushes slot back to the free stack.
+    void push(index_type idx);
+
+    std::array< slot_type, N >                  m_slots; //!< Object storage.
+    std::array< std::atomic< index_type >, N >  m_next;  //!< Free stack links.
+    std::atomic< head_type >                    m_head;  //!< Free stack head.
+};
+
+//------------------------------------------------------------------------------
+
+template< typename T, size_t N >
+constexpr unsigned lockfree_pool< T, N >::index_bits;
+
+template< typename T, size_t N >
+constexpr unsigned lockfree_pool< T, N >::tag_bits;
+
+template< typename T, size_t N >
+lockfree_pool< T, N >::lockfree_pool()
+    :m_slots{}
+    ,m_head{}
+{
+    // Link all slots in order, so first allocation returns first slot.
+    for (size_t i = 0; i < N; ++i) {
+        m_next[i].store(i + 1 < N ? i + 1 : nil, std::memory_order_relaxed);
+    }
+
+    m_head.store(next_head(0, 0), std::memory_order_release);
+}
+
+template< typename T, size_t N >
+lockfree_pool< T, N >::~lockfree_pool()
+{
+}
+
+template< typename T, size_t N >
+uint8_t* lockfree_pool< T, N >::real_alloc(size_t n, size_t align, size_t obj_sz)
+{
+    // Not allowed to allocate zero-length buffer
+    ecl_assert(n);
+
+    if (n * obj_sz > sizeof(slot_type) || align > alignof(slot_type)) {
+        return nullptr;
+    }
+
+    auto idx = pop();
+    if (idx == nil) {
+        return nullptr;
+    }
+
+    return reinterpret_cast< uint8_t* >(&m_slots[idx]);
+}
+
+template< typename T, size_t N >
+void lockfree_pool< T, N >::real_dealloc(uint8_t *p, size_t n, size_t obj_sz)
+{
+    ecl_assert(n);
+    ecl_assert(n * obj_sz <= sizeof(slot_type));
+
+    auto start = reinterpret_cast< uint8_t* >(m_slots.begin());
+    auto end   = reinterpret_cast< uint8_t* >(m_slots.end());
+
+    ecl_assert(p >= start && p < end);
+    ecl_assert(!((p - start) % sizeof(slot_type)));
+
+    push((p - start) / sizeof(slot_type));
+}
+
+//------------------------------------------------------------------------------
+
+template< typename T, size_t N >
+typename lockfree_pool< T, N >::head_type
+lockfree_pool< T, N >::next_head(head_type prev, index_type idx)
+{
+    return ((prev + index_mask + 1) & ~index_mask) | idx;
+}
+
+template< typename T, size_t N >
+typename lockfree_pool< T, N >::index_type
+lockfree_pool< T, N >::top(head_type head)
+{
+    return head & index_mask;
+}
+
+template< typename T, size_t N >
+typename lockfree_pool< T, N >::index_type lockfree_pool< T, N >::pop()
+{
+    auto head = m_head.load(std::memory_order_acquire);
+    index_type idx;
+
+    do {
+        idx = top(head);
+        if (idx == nil) {
+            return nil;
+        }
+
+        // Link may be already stale if other context popped the slot.
+        // In that case the tag will not match and CAS will fail.
+        auto next = m_next[idx].load(std::memory_order_relaxed);
+
+        if (m_head.compare_exchange_weak(head, next_head(head, next),
+                                         std::memory_order_acquire,
+                                         std::memory_order_acquire)) {
+            break;
+        }
+    } while (true);
+
+    return idx;
+}
+
+template< typename T, size_t N >
+void lockfree_pool< T, N >::push(index_type idx)
+{
+    auto head = m_head.load(std::memory_order_relaxed);
+
+    do {
+        m_next[idx].store(top(head), std::memory_order_relaxed);
+    } while (!m_head.compare_exchange_weak(head, next_head(head, idx),
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed));
+}
+
+} // namespace ecl
+
+#endif // LIB_ALLOC_LOCKFREE_POOL_HPP_
@@ -19,6 +19,7 @@
 
 #include <memory>
 #include <array>
+#include <algorithm>
 
 namespace ecl
 {
@@ -129,14 +130,349 @@ void pool_base::deallocate(T *p, size_t n)
 
 //------------------------------------------------------------------------------
 
+//!
+//! \brief Pool block index that scans block bitmap bit by bit.
+//!
+//! Smallest and simplest index, used by default. Allocation cost grows
+//! linearly with block count and with pool fragmentation.
+//! \tparam blk_cnt Block count in the pool.
+//! \sa pool_fast_index
+//!
+template< size_t blk_cnt >
+class pool_linear_index
+{
+public:
+    //! Value returned by find() if no suitable block run is present.
+    static constexpr size_t npos = blk_cnt;
+
+    //! Constructs index with all blocks marked as free.
+    pool_linear_index();
+
+    //!
+    //! \brief Finds first run of free blocks of given length.
+    //! \param[in] n Block count in the run. Must be greater than 0.
+    //! \return Index of the first block in the run or npos if not found.
+    //!
+    size_t find(size_t n) const;
+
+    //!
+    //! \brief Marks run of blocks as used\unused.
+    //! \param[in] idx  Index of the first block in the run.
+    //! \param[in] n    Block count in the run.
+    //! \param[in] used True if blocks must be marked as used.
+    //!                 False - if as unused.
+    //!
+    void mark(size_t idx, size_t n, bool used);
+
+    //!
+    //! \brief Checks if block with given index is free or not.
+    //! \param[in] idx  Block index. Must be valid index of a block within a pool.
+    //! \return true if block is free.
+    //!
+    bool is_free(size_t idx) const;
+
+#ifdef POOL_ALLOC_TEST
+    // Special routine used for test purposes only
+    auto& get_info() { return m_info; }
+#endif
+
+private:
+    //! Gets size of info array containing bits representing data chunk state.
+    static constexpr auto info_blks_sz();
+
+    //! \todo use bitset?
+    std::array< uint8_t, info_blks_sz() >   m_info; //!< Memory info array.
+};
+
+//------------------------------------------------------------------------------
+
+template< size_t blk_cnt >
+pool_linear_index< blk_cnt >::pool_linear_index()
+    :m_info{0}
+{
+}
+
+template< size_t blk_cnt >
+size_t pool_linear_index< blk_cnt >::find(size_t n) const
+{
+    // TODO: use byte-based iteration, instead of bit-based
+
+    size_t i = 0;
+    size_t j;
+
+    // Convert count to offset
+    n--;
+
+    // Iterate over whole slab
+    for (; i + n < blk_cnt; ++i) {
+        j = i;
+
+        // Finds cache row with appropriate length
+        for (; j <= i + n; ++j) {
+            if (!is_free(j)) {
+                break;
+            }
+        }
+
+        if (j == i + n + 1) {
+            return i;
+        }
+    }
+
+    return npos;
+}
+
+template< size_t blk_cnt >
+void pool_linear_index< blk_cnt >::mark(size_t idx, size_t n, bool used)
+{
+    // TODO: use bitset?
+    ecl_assert(idx + n <= blk_cnt);
+
+    for (; n; --n, ++idx) {
+        uint byte = idx >> 3;
+        uint bit  = idx & 7;
+
+        if (used) {
+            m_info[byte] |= (1 << bit);
+        } else {
+            m_info[byte] &= ~(1 << bit);
+        }
+    }
+}
+
+template< size_t blk_cnt >
+bool pool_linear_index< blk_cnt >::is_free(size_t idx) const
+{
+    // TODO: use bitset?
+    ecl_assert(idx < blk_cnt);
+
+    uint byte = idx >> 3;
+    uint bit  = idx & 7;
+
+    return !(m_info[byte] & (1 << bit));
+}
+
+template< size_t blk_cnt >
+constexpr auto pool_linear_index< blk_cnt >::info_blks_sz()
+{
+    // Count bytes required to hold info bits. One bit per each block.
+    // TODO: use bitset?
+    return blk_cnt / 8 + 1;
+}
+
+//------------------------------------------------------------------------------
+
+//!
+//! \brief Pool block index that searches block bitmap word by word.
+//!
+//! Free block runs are located over whole bitmap words at once: runs within
+//! a word are found by shift-and folding and count-trailing-zeros, runs
+//! spanning several words are tracked with count-leading-zeros.
+//! Additional summary bitmap keeps track of words that have at least one free
+//! block, making single-block allocations (the most common case, e.g. for
+//! shared pointers) independent of the pool fill level.
+//! Costs one extra bit of RAM per 32 blocks compared to pool_linear_index.
+//! \tparam blk_cnt Block count in the pool.
+//! \sa pool_linear_index
+//!
+template< size_t blk_cnt >
+class pool_fast_index
+{
+public:
+    //! Value returned by find() if no suitable block run is present.
+    static constexpr size_t npos = blk_cnt;
+
+    //! Constructs index with all blocks marked as free.
+    pool_fast_index();
+
+    //! \copydoc pool_linear_index::find()
+    size_t find(size_t n) const;
+
+    //! \copydoc pool_linear_index::mark()
+    void mark(size_t idx, size_t n, bool used);
+
+    //! \copydoc pool_linear_index::is_free()
+    bool is_free(size_t idx) const;
+
+#ifdef POOL_ALLOC_TEST
+    // Special routine used for test purposes only
+    auto& get_info() { return m_info; }
+#endif
+
+private:
+    //! Bitmap word. 32-bit words map directly to CLZ/RBIT on Cortex-M.
+    using word_type = uint32_t;
+
+    //! Bits in a bitmap word.
+    static constexpr size_t word_bits = 32;
+    //! Words required to hold one bit per block.
+    static constexpr size_t words = (blk_cnt + word_bits - 1) / word_bits;
+    //! Words required to hold one bit per info word.
+    static constexpr size_t summary_words = (words + word_bits - 1) / word_bits;
+    //! All bits set.
+    static constexpr word_type full = ~static_cast< word_type >(0);
+
+    //! Counts trailing zeros. Argument must not be 0.
+    static size_t ctz(word_type w);
+
+    //! Counts leading zeros. Argument must not be 0.
+    static size_t clz(word_type w);
+
+    //! Refreshes summary bit of the given info word.
+    void update_summary(size_t w);
+
+    std::array< word_type, words >          m_info;    //!< Block bitmap, 1 - used.
+    std::array< word_type, summary_words >  m_summary; //!< 1 - word has free blocks.
+};
+
+//------------------------------------------------------------------------------
+
+template< size_t blk_cnt >
+pool_fast_index< blk_cnt >::pool_fast_index()
+    :m_info{}
+    ,m_summary{}
+{
+    // Tail bits of the last word do not correspond to any block.
+    // Keep them used, so search routines never return them.
+    constexpr auto tail = blk_cnt % word_bits;
+    if (tail) {
+        m_info[words - 1] = full << tail;
+    }
+
+    for (size_t w = 0; w < words; ++w) {
+        update_summary(w);
+    }
+}
+
+template< size_t blk_cnt >
+size_t pool_fast_index< blk_cnt >::find(size_t n) const
+{
+    if (n == 1) {
+        for (size_t s = 0; s < summary_words; ++s) {
+            if (m_summary[s]) {
+                auto w = s * word_bits + ctz(m_summary[s]);
+                return w * word_bits + ctz(~m_info[w]);
+            }
+        }
+
+        return npos;
+    }
+
+    // Length of the free run that ends at the top of the previous word.
+    size_t run = 0;
+
+    for (size_t w = 0; w < words; ++w) {
+        word_type free_bits = ~m_info[w];
+
+        // Run started in previous words may continue at the bottom of this one.
+        if (run) {
+            auto lead = (free_bits == full) ? word_bits : ctz(~free_bits);
+            if (run + lead >= n) {
+                return w * word_bits - run;
+            }
+        }
+
+        // Run that fits entirely into this word. After folding, bit i is set
+        // only if bits [i, i + n) are all set in the original word.
+        if (n <= word_bits) {
+            auto fold = free_bits;
+            for (size_t len = 1; len < n && fold; ) {
+                auto shift = std::min(len, n - len);
+                fold &= fold >> shift;
+                len += shift;
+            }
+
+            if (fold) {
+                return w * word_bits + ctz(fold);
+            }
+        }
+
+        if (free_bits == full) {
+            run += word_bits;
+        } else {
+            run = free_bits ? clz(~free_bits) : 0;
+        }
+    }
+
+    return npos;
+}
+
+template< size_t blk_cnt >
+void pool_fast_index< blk_cnt >::mark(size_t idx, size_t n, bool used)
+{
+    ecl_assert(idx + n <= blk_cnt);
+
+    while (n) {
+        auto w      = idx / word_bits;
+        auto bit    = idx % word_bits;
+        auto len    = std::min(n, word_bits - bit);
+        auto mask   = (len == word_bits) ? full : ((full >> (word_bits - len)) << bit);
+
+        auto summary_bit = static_cast< word_type >(1) << (w % word_bits);
+
+        if (used) {
+            m_info[w] |= mask;
+            if (m_info[w] == full) {
+                m_summary[w / word_bits] &= ~summary_bit;
+            }
+        } else {
+            m_info[w] &= ~mask;
+            m_summary[w / word_bits] |= summary_bit;
+        }
+
+        idx += len;
+        n   -= len;
+    }
+}
+
+template< size_t blk_cnt >
+bool pool_fast_index< blk_cnt >::is_free(size_t idx) const
+{
+    ecl_assert(idx < blk_cnt);
+
+    return !(m_info[idx / word_bits] & (static_cast< word_type >(1) << (idx % word_bits)));
+}
+
+template< size_t blk_cnt >
+size_t pool_fast_index< blk_cnt >::ctz(word_type w)
+{
+    return __builtin_ctz(w);
+}
+
+template< size_t blk_cnt >
+size_t pool_fast_index< blk_cnt >::clz(word_type w)
+{
+    return __builtin_clz(w);
+}
+
+template< size_t blk_cnt >
+void pool_fast_index< blk_cnt >::update_summary(size_t w)
+{
+    auto s      = w / word_bits;
+    auto bit    = static_cast< word_type >(1) << (w % word_bits);
+
+    if (m_info[w] != full) {
+        m_summary[s] |= bit;
+    } else {
+        m_summary[s] &= ~bit;
+    }
+}
+
+//------------------------------------------------------------------------------
+
 //!
 //! \brief Holds given buffer as a pool.
 //!
 //! Object of this pool can be shared by different instances of an allocator.
 //! Refer to a wiki for further info:
 //! [here](https://en.wikipedia.org/wiki/Fixed-size_blocks_allocation)
+//! \tparam blk_sz  Size of a single block. Must be power of two.
+//! \tparam blk_cnt Block count.
+//! \tparam Index   Policy used to track and search free blocks.
+//!                 Either pool_linear_index or pool_fast_index.
 //!
-template< size_t blk_sz, size_t blk_cnt >
+template< size_t blk_sz, size_t blk_cnt,
+          template< size_t > class Index = pool_linear_index >
 class pool : public pool_base
 {
     // Sanity checks
@@ -160,7 +496,7 @@ public:
 #ifdef POOL_ALLOC_TEST
     // Special routines used for test purposes only
     auto& get_data() { return m_data; }
-    auto& get_info() { return m_info; }
+    auto& get_info() { return m_index.get_info(); }
     // Debug routine
     void print_stats() const;
 #endif
@@ -169,25 +505,9 @@ public:
     pool(const pool&) = delete;
 
 private:
-    //! Gets size of info array containing bits representing data chunk state.
-    static constexpr auto info_blks_sz();
     //! Gets size of data array.
     static constexpr auto data_blks_sz();
 
-    //!
-    //! \brief Marks block with given index as used\unused.
-    //! \param[in] idx  Block index. Must be valid index of a block within a pool.
-    //! \param[in] used True if block must be marked as used. False - if as unused.
-    //!
-    void mark(size_t idx, bool used);
-
-    //!
-    //! \brief Checks if block with given index is free or not.
-    //! \param[in] idx  Block index. Must be valid index of a block within a pool.
-    //! \return true if block is free.
-    //!
-    bool is_free(size_t idx) const;
-
     //!
     //! \brief Obtains a block by given index.
     //! \param[in] idx  Block index. Must be valid index of a block within a pool.
@@ -199,69 +519,45 @@ private:
     // this will reduce complexity of calculations.
     // 64 is now maximum alignment supported TODO: clarify
     alignas((blk_sz > 64) ? 64 : blk_sz)
-    std::array< uint8_t, data_blks_sz() >   m_data; //!< Memory pool.
-    //! \todo use bitset?
-    std::array< uint8_t, info_blks_sz() >   m_info; //!< Memory info array.
+    std::array< uint8_t, data_blks_sz() >   m_data;  //!< Memory pool.
+    Index< blk_cnt >                        m_index; //!< Free blocks index.
 };
 
 //------------------------------------------------------------------------------
 
-template< size_t blk_sz, size_t blk_cnt >
-pool< blk_sz, blk_cnt >::pool()
+template< size_t blk_sz, size_t blk_cnt, template< size_t > class Index >
+pool< blk_sz, blk_cnt, Index >::pool()
     :m_data{0}
-    ,m_info{0}
+    ,m_index{}
 {
 }
 
-template< size_t blk_sz, size_t blk_cnt >
-pool< blk_sz, blk_cnt >::~pool()
+template< size_t blk_sz, size_t blk_cnt, template< size_t > class Index >
+pool< blk_sz, blk_cnt, Index >::~pool()
 {
 }
 
-template< size_t blk_sz, size_t blk_cnt >
-uint8_t* pool< blk_sz, blk_cnt >::real_alloc(size_t n, size_t align, size_t obj_sz)
+template< size_t blk_sz, size_t blk_cnt, template< size_t > class Index >
+uint8_t* pool< blk_sz, blk_cnt, Index >::real_alloc(size_t n, size_t align, size_t obj_sz)
 {
     // Consider reviewing the block size if this assertion fails.
     ecl_assert(align < blk_sz);
     // Not allowed to allocate zero-length buffer
     ecl_assert(n);
 
-    // TODO: use byte-based iteration, instead of bit-based
-
-    bool found = false;
-    size_t i = 0;
-    size_t j;
-
     // Convert a count of objects to a block count with rounding away from zero
     // to a boundary of the block size.
     n = (n * obj_sz + blk_sz - 1) / blk_sz;
 
-    // Convert count to offset
-    n--;
-
-    // Iterate over whole slab
-    for (; i + n < blk_cnt; ++i) {
-        j = i;
-
-        // Finds cache row with appropriate length
-        for (; j <= i + n; ++j) {
-            if (!is_free(j)) {
-                break;
-            }
-        }
-
-        if (j == i + n + 1) {
-            found = true;
-            break;
-        }
+    if (n > blk_cnt) {
+        return nullptr;
     }
 
-    if (found) {
-        // Mark caches as used
-        for (j = i; j <= i + n; ++j) {
-            mark(j, true);
-        }
+    auto i = m_index.find(n);
 
+    if (i != m_index.npos) {
+        // Mark caches as used
+        m_index.mark(i, n, true);
         return get_block(i);
     }
 
@@ -269,8 +565,8 @@ uint8_t* pool< blk_sz, blk_cnt >::real_alloc(size_t n, size_t align, size_t obj_
 }
 
 
-template< size_t blk_sz, size_t blk_cnt >
-void pool< blk_sz, blk_cnt >::real_dealloc(uint8_t *p, size_t n, size_t obj_sz)
+template< size_t blk_sz, size_t blk_cnt, template< size_t > class Index >
+void pool< blk_sz, blk_cnt, Index >::real_dealloc(uint8_t *p, size_t n, size_t obj_sz)
 {
     ecl_assert(n);
     ecl_assert(p); // For now
@@ -289,70 +585,35 @@ void pool< blk_sz, blk_cnt >::real_dealloc(uint8_t *p, size_t n, size_t obj_sz)
 
     ecl_assert(n <= cnt);
 
-    while (n) {
-        size_t to_free = idx + --n;
-        ecl_assert(!is_free(to_free));
-        mark(to_free, false);
+#ifndef NDEBUG
+    for (size_t i = idx; i < idx + n; ++i) {
+        ecl_assert(!m_index.is_free(i));
     }
+#endif
+
+    m_index.mark(idx, n, false);
 }
 
 
 
 //------------------------------------------------------------------------------
 
-template< size_t blk_sz, size_t blk_cnt >
-constexpr auto pool< blk_sz, blk_cnt >::info_blks_sz()
-{
-    // Count bytes required to hold info bits. One bit per each block.
-    // TODO: use bitset?
-    return blk_cnt / 8 + 1;
-}
-
-template< size_t blk_sz, size_t blk_cnt >
-constexpr auto pool<blk_sz, blk_cnt>::data_blks_sz()
+template< size_t blk_sz, size_t blk_cnt, template< size_t > class Index >
+constexpr auto pool< blk_sz, blk_cnt, Index >::data_blks_sz()
 {
     return blk_cnt * blk_sz;
 }
 
-template< size_t blk_sz, size_t blk_cnt >
-bool pool< blk_sz, blk_cnt >::is_free(size_t idx) const
-{
-    // TODO: use bitset?
-    ecl_assert(idx < blk_cnt);
-
-    uint byte = idx >> 3;
-    uint bit  = idx & 7;
-
-    return !(m_info[byte] & (1 << bit));
-}
-
-
-template< size_t blk_sz, size_t blk_cnt >
-void pool< blk_sz, blk_cnt >::mark(size_t idx, bool used)
-{
-    // TODO: use bitset?
-    ecl_assert(idx < blk_cnt);
-
-    uint byte = idx >> 3;
-    uint bit  = idx & 7;
-
-    if (used) {
-        m_info[byte] |= (1 << bit);
-    } else {
-        m_info[byte] &= ~(1 << bit);
-    }
-}
-
-template< size_t blk_sz, size_t blk_cnt >
-uint8_t *pool< blk_sz, blk_cnt >::get_block(size_t idx)
+template< size_t blk_sz, size_t blk_cnt, template< size_t > class Index >
+uint8_t *pool< blk_sz, blk_cnt, Index >::get_block(size_t idx)
 {
     ecl_assert(idx < blk_cnt);
     return m_data.begin() + idx * blk_sz;
 }
 
 #ifdef POOL_ALLOC_TEST_PRINT_STATS
-template< size_t blk_sz, size_t blk_cnt >
-void pool< blk_sz, blk_cnt >::print_stats() const
+template< size_t blk_sz, size_t blk_cnt, template< size_t > class Index >
+void pool< blk_sz, blk_cnt, Index >::print_stats() const
 {
     // Print memory stats for whole pool
     size_t i = 0;
@@ -360,7 +621,7 @@ void pool< blk_sz, blk_cnt >::print_stats() const
     size_t streak = 0;
     size_t max_streak = 0;
     for (i = 0; i < blk_cnt; ++i) {
-        if (!is_free(i)) {
+        if (!m_index.is_free(i)) {
             ecl::cout << 'x';
             used++;
             max_streak = std::min(streak, max_streak);
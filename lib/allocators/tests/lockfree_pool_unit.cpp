@@ -0,0 +1,353 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <ecl/lockfree_pool.hpp>
+#include <ecl/memory.hpp>
+#include <ecl/thread/thread.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <iostream>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+static constexpr auto slots = 64;
+
+// Slot payload. Owner tag is used to detect slots handed out twice.
+struct item
+{
+    uint32_t owner;
+    uint32_t seq;
+    double   payload;
+};
+
+using test_pool_type = ecl::lockfree_pool< item, slots >;
+
+static test_pool_type *test_pool;
+
+// Allocates everything that left in the pool and returns it back.
+static size_t drain_and_count()
+{
+    std::vector< item* > ptrs;
+
+    while (auto p = test_pool->aligned_alloc< item >(1)) {
+        ptrs.push_back(p);
+    }
+
+    // Every slot must be unique
+    std::set< item* > uniq{ptrs.begin(), ptrs.end()};
+    CHECK_EQUAL(ptrs.size(), uniq.size());
+
+    for (auto p : ptrs) {
+        test_pool->deallocate(p, 1);
+    }
+
+    return ptrs.size();
+}
+
+TEST_GROUP(lockfree_pool)
+{
+    void setup()
+    {
+        test_pool = new test_pool_type;
+    }
+
+    void teardown()
+    {
+        delete test_pool;
+    }
+};
+
+TEST(lockfree_pool, alloc_all_slots)
+{
+    std::vector< item* > ptrs;
+
+    for (int i = 0; i < slots; ++i) {
+        auto p = test_pool->aligned_alloc< item >(1);
+        CHECK_TRUE(p != nullptr);
+        CHECK_EQUAL(0, reinterpret_cast< uintptr_t >(p) & (alignof(item) - 1));
+        ptrs.push_back(p);
+    }
+
+    POINTERS_EQUAL(nullptr, test_pool->aligned_alloc< item >(1));
+
+    for (auto p : ptrs) {
+        test_pool->deallocate(p, 1);
+    }
+
+    CHECK_EQUAL(slots, drain_and_count());
+}
+
+TEST(lockfree_pool, oversized_request)
+{
+    // Two items do not fit into a single slot
+    POINTERS_EQUAL(nullptr, test_pool->aligned_alloc< item >(2));
+
+    // Smaller type fits
+    auto p = test_pool->aligned_alloc< uint16_t >(3);
+    CHECK_TRUE(p != nullptr);
+    test_pool->deallocate(p, 3);
+
+    CHECK_EQUAL(slots, drain_and_count());
+}
+
+TEST(lockfree_pool, lifo_reuse)
+{
+    auto p1 = test_pool->aligned_alloc< item >(1);
+    auto p2 = test_pool->aligned_alloc< item >(1);
+
+    test_pool->deallocate(p1, 1);
+
+    // Most recently freed slot is handed out first, it is likely still in cache
+    POINTERS_EQUAL(p1, test_pool->aligned_alloc< item >(1));
+
+    test_pool->deallocate(p1, 1);
+    test_pool->deallocate(p2, 1);
+}
+
+TEST(lockfree_pool, index_takes_only_needed_bits)
+{
+    constexpr unsigned word = sizeof(uintptr_t) * CHAR_BIT;
+
+    // Nil marker needs its own index value
+    CHECK_EQUAL(1U, (ecl::lockfree_pool< item, 1 >::index_bits));
+    CHECK_EQUAL(7U, (ecl::lockfree_pool< item, 127 >::index_bits));
+    CHECK_EQUAL(8U, (ecl::lockfree_pool< item, 128 >::index_bits));
+    CHECK_EQUAL(16U, (ecl::lockfree_pool< item, 0xfffe >::index_bits));
+
+    CHECK_EQUAL(word - 7, test_pool_type::tag_bits);
+}
+
+TEST(lockfree_pool, slot_count_at_index_boundary)
+{
+    // Last slot index is one below the nil marker
+    static ecl::lockfree_pool< item, 127 > pool;
+    std::vector< item* > ptrs;
+
+    while (auto p = pool.aligned_alloc< item >(1)) {
+        ptrs.push_back(p);
+    }
+
+    CHECK_EQUAL(127, ptrs.size());
+    CHECK_EQUAL(126, ptrs.back() - ptrs.front());
+
+    for (auto p : ptrs) {
+        pool.deallocate(p, 1);
+    }
+
+    POINTERS_EQUAL(ptrs.back(), pool.aligned_alloc< item >(1));
+}
+
+TEST(lockfree_pool, backs_shared_pointer)
+{
+    struct shared_obj
+    {
+        shared_obj(int v) :val{v} { }
+        int val;
+    };
+
+    using alloc_type = ecl::pool_allocator< shared_obj >;
+
+    // Slot must hold the object together with shared pointer bookkeeping
+    ecl::lockfree_pool< std::aligned_storage_t< 64, alignof(std::max_align_t) >, 2 > pool;
+    alloc_type alloc{&pool};
+
+    {
+        auto p1 = ecl::allocate_shared< shared_obj >(alloc, 1);
+        auto p2 = ecl::allocate_shared< shared_obj >(alloc, 2);
+        CHECK_EQUAL(1, p1->val);
+        CHECK_EQUAL(2, p2->val);
+
+        // Both slots are occupied now
+        POINTERS_EQUAL(nullptr, alloc.allocate(1));
+    }
+
+    // Slots are returned back after pointers went out of scope
+    auto p = alloc.allocate(1);
+    CHECK_TRUE(p != nullptr);
+    alloc.deallocate(p, 1);
+}
+
+//------------------------------------------------------------------------------
+
+static constexpr auto thread_cnt    = 8;
+static constexpr auto ops_per_tr    = 200000;
+static constexpr auto handoffs      = 50000;
+
+static std::atomic< bool >      corrupted;
+static std::atomic< uint64_t >  total_ops;
+
+// Shared hand-off list between producers and consumers
+static std::mutex               handoff_lock;
+static std::vector< item* >     handoff;
+
+// Allocates bursts of slots, marks them as owned and checks that
+// nobody else touched them before they are returned.
+static ecl::err churn_routine(void *arg)
+{
+    auto id = static_cast< uint32_t >(reinterpret_cast< uintptr_t >(arg));
+    item *held[4];
+    uint64_t ops = 0;
+
+    for (int i = 0; i < ops_per_tr; ++i) {
+        size_t cnt = 0;
+
+        for (; cnt < static_cast< size_t >(1 + i % 4); ++cnt) {
+            held[cnt] = test_pool->aligned_alloc< item >(1);
+            if (!held[cnt]) {
+                break;
+            }
+
+            held[cnt]->owner = id;
+            held[cnt]->seq = i;
+            ops++;
+        }
+
+        for (size_t j = 0; j < cnt; ++j) {
+            if (held[j]->owner != id || held[j]->seq != static_cast< uint32_t >(i)) {
+                corrupted = true;
+            }
+
+            test_pool->deallocate(held[j], 1);
+            ops++;
+        }
+    }
+
+    total_ops += ops;
+    return ecl::err::ok;
+}
+
+// Allocates slots and passes them to consumers.
+static ecl::err producer_routine(void *arg)
+{
+    (void)arg;
+    uint64_t ops = 0;
+
+    while (ops < handoffs) {
+        auto p = test_pool->aligned_alloc< item >(1);
+        if (!p) {
+            // Pool is depleted, let consumers catch up
+            std::this_thread::yield();
+            continue;
+        }
+
+        ops++;
+        std::lock_guard< std::mutex > lk{handoff_lock};
+        handoff.push_back(p);
+    }
+
+    total_ops += ops;
+    return ecl::err::ok;
+}
+
+// Frees slots allocated by other threads.
+static ecl::err consumer_routine(void *arg)
+{
+    auto *producers_done = reinterpret_cast< std::atomic< bool >* >(arg);
+    uint64_t ops = 0;
+
+    while (true) {
+        item *p = nullptr;
+
+        {
+            std::lock_guard< std::mutex > lk{handoff_lock};
+            if (!handoff.empty()) {
+                p = handoff.back();
+                handoff.pop_back();
+            }
+        }
+
+        if (p) {
+            test_pool->deallocate(p, 1);
+            ops++;
+        } else if (*producers_done) {
+            break;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    total_ops += ops;
+    return ecl::err::ok;
+}
+
+// Starts threads, waits for completion and reports throughput.
+static void run_threads(const char *name, ecl::native_thread::routine fns[],
+                        void *args[], size_t cnt, std::atomic< bool > *done_flag,
+                        size_t done_after)
+{
+    std::vector< ecl::native_thread > trs(cnt);
+
+    total_ops = 0;
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < cnt; ++i) {
+        CHECK_EQUAL(ecl::err::ok, trs[i].set_routine(fns[i], args[i]));
+        CHECK_EQUAL(ecl::err::ok, trs[i].start());
+    }
+
+    for (size_t i = 0; i < cnt; ++i) {
+        CHECK_EQUAL(ecl::err::ok, trs[i].join());
+        if (done_flag && i + 1 == done_after) {
+            *done_flag = true;
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto sec = std::chrono::duration< double >(end - start).count();
+
+    std::cout << "\n" << name << ": " << cnt << " threads, "
+              << static_cast< uint64_t >(total_ops / sec) << " ops/sec\n";
+}
+
+TEST(lockfree_pool, concurrent_churn)
+{
+    ecl::native_thread::routine fns[thread_cnt];
+    void *args[thread_cnt];
+
+    corrupted = false;
+
+    for (int i = 0; i < thread_cnt; ++i) {
+        fns[i] = churn_routine;
+        args[i] = reinterpret_cast< void* >(static_cast< uintptr_t >(i + 1));
+    }
+
+    run_threads("churn", fns, args, thread_cnt, nullptr, 0);
+
+    CHECK_FALSE(corrupted);
+    // No blocks lost
+    CHECK_EQUAL(slots, drain_and_count());
+}
+
+TEST(lockfree_pool, concurrent_producers_consumers)
+{
+    ecl::native_thread::routine fns[thread_cnt];
+    void *args[thread_cnt];
+    std::atomic< bool > producers_done{false};
+
+    handoff.clear();
+
+    // Producers go first, so they are joined first
+    for (int i = 0; i < thread_cnt; ++i) {
+        if (i < thread_cnt / 2) {
+            fns[i] = producer_routine;
+            args[i] = nullptr;
+        } else {
+            fns[i] = consumer_routine;
+            args[i] = &producers_done;
+        }
+    }
+
+    run_threads("producer/consumer", fns, args, thread_cnt,
+                &producers_done, thread_cnt / 2);
+
+    CHECK_TRUE(handoff.empty());
+    // No blocks lost
+    CHECK_EQUAL(slots, drain_and_count());
+}
@@ -0,0 +1,91 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Alloc/dealloc latency of pool indexes across fill levels.
+
+#include <ecl/pool.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+// Same geometry as the pool used by ecl::fat::petit
+static constexpr auto block_size    = 16;
+static constexpr auto blocks        = 256;
+static constexpr auto iterations    = 20000;
+
+struct block
+{
+    char data[block_size];
+};
+
+// Fills the pool up to given level with scattered single-block allocations,
+// then measures alloc+dealloc pair of n blocks.
+template< template< size_t > class Index >
+static double measure(unsigned fill_percent, size_t n)
+{
+    ecl::pool< block_size, blocks, Index > pool;
+    std::vector< block* > ptrs;
+    std::mt19937 gen{42};
+
+    // Occupy whole pool and free random blocks back,
+    // leaving fragmented free space behind.
+    for (int i = 0; i < blocks; ++i) {
+        ptrs.push_back(pool.template aligned_alloc< block >(1));
+    }
+
+    std::shuffle(ptrs.begin(), ptrs.end(), gen);
+
+    size_t to_free = blocks - blocks * fill_percent / 100;
+    for (size_t i = 0; i < to_free; ++i) {
+        pool.deallocate(ptrs.back(), 1);
+        ptrs.pop_back();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        auto p = pool.template aligned_alloc< block >(n);
+        if (p) {
+            pool.deallocate(p, n);
+        }
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    for (auto p : ptrs) {
+        pool.deallocate(p, 1);
+    }
+
+    return std::chrono::duration< double, std::nano >(end - start).count()
+            / iterations;
+}
+
+TEST_GROUP(pool_bench)
+{
+};
+
+TEST(pool_bench, alloc_dealloc_latency)
+{
+    std::cout << "\n\npool< " << block_size << ", " << blocks
+              << " > alloc+dealloc, ns per pair\n";
+    std::cout << "fill %  blocks    linear      fast\n";
+
+    for (auto n : { 1, 4 }) {
+        for (auto fill : { 0, 25, 50, 75, 90 }) {
+            auto linear = measure< ecl::pool_linear_index >(fill, n);
+            auto fast   = measure< ecl::pool_fast_index >(fill, n);
+
+            std::cout << std::setw(6) << fill
+                      << std::setw(8) << n
+                      << std::setw(10) << std::fixed << std::setprecision(1) << linear
+                      << std::setw(10) << fast << '\n';
+        }
+    }
+}
@@ -0,0 +1,175 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#define POOL_ALLOC_TEST
+
+#include <ecl/pool.hpp>
+
+#include <bitset>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+
+// Block count is not a multiple of a bitmap word on purpose,
+// to exercise tail handling.
+static constexpr auto block_size    = 16; // Must be power of two
+static constexpr auto blocks        = 100;
+
+using fast_pool     = ecl::pool< block_size, blocks, ecl::pool_fast_index >;
+using linear_pool   = ecl::pool< block_size, blocks, ecl::pool_linear_index >;
+
+static fast_pool    *fast;
+static linear_pool  *linear;
+
+struct exactly_block
+{
+    char data[block_size];
+} __attribute__((packed));
+
+// Counts used blocks in the fast pool.
+static size_t used_blocks()
+{
+    size_t cnt = 0;
+    for (size_t i = 0; i < fast->get_info().size(); ++i) {
+        cnt += std::bitset< 32 >{fast->get_info()[i]}.count();
+    }
+
+    // Exclude tail bits that are always set.
+    return cnt - (32 - blocks % 32) % 32;
+}
+
+// Gets block index of a pointer allocated from the fast pool.
+static size_t fast_idx(exactly_block *p)
+{
+    return (reinterpret_cast< uint8_t* >(p) - fast->get_data().begin()) / block_size;
+}
+
+// Gets block index of a pointer allocated from the linear pool.
+static size_t linear_idx(exactly_block *p)
+{
+    return (reinterpret_cast< uint8_t* >(p) - linear->get_data().begin()) / block_size;
+}
+
+TEST_GROUP(pool_fast_unit)
+{
+    void setup()
+    {
+        fast = new fast_pool;
+        linear = new linear_pool;
+    }
+
+    void teardown()
+    {
+        delete fast;
+        delete linear;
+    }
+};
+
+TEST(pool_fast_unit, multiple_alloc_dealloc)
+{
+    for (size_t i = 1; i <= blocks; ++i) {
+        auto p = fast->aligned_alloc< exactly_block >(i);
+        CHECK_TRUE(p != nullptr);
+        CHECK_EQUAL(0, fast_idx(p));
+        CHECK_EQUAL(i, used_blocks());
+
+        fast->deallocate(p, i);
+        CHECK_EQUAL(0, used_blocks());
+    }
+}
+
+TEST(pool_fast_unit, too_big_allocation)
+{
+    auto p = fast->aligned_alloc< exactly_block >(blocks + 1);
+    POINTERS_EQUAL(nullptr, p);
+    CHECK_EQUAL(0, used_blocks());
+}
+
+TEST(pool_fast_unit, depleted_pool)
+{
+    std::vector< exactly_block* > ptrs;
+
+    for (size_t i = 0; i < blocks; ++i) {
+        auto p = fast->aligned_alloc< exactly_block >(1);
+        CHECK_TRUE(p != nullptr);
+        CHECK_EQUAL(i, fast_idx(p));
+        ptrs.push_back(p);
+    }
+
+    // Tail bits must never be handed out.
+    POINTERS_EQUAL(nullptr, fast->aligned_alloc< exactly_block >(1));
+
+    for (auto p : ptrs) {
+        fast->deallocate(p, 1);
+    }
+
+    CHECK_EQUAL(0, used_blocks());
+}
+
+TEST(pool_fast_unit, run_across_word_boundary)
+{
+    // Occupy everything.
+    auto all = fast->aligned_alloc< exactly_block >(blocks);
+    CHECK_TRUE(all != nullptr);
+
+    // Free blocks [28, 40) - the run crosses first word boundary.
+    fast->deallocate(all + 28, 12);
+
+    POINTERS_EQUAL(nullptr, fast->aligned_alloc< exactly_block >(13));
+
+    auto p = fast->aligned_alloc< exactly_block >(12);
+    CHECK_EQUAL(28, fast_idx(p));
+    CHECK_EQUAL(blocks, used_blocks());
+}
+
+TEST(pool_fast_unit, same_placement_as_linear_index)
+{
+    // Both indexes implement first-fit, so any allocation sequence
+    // must produce the same block placement.
+
+    auto seed = std::time(0);
+    std::srand(seed);
+
+    // This will help reproduce a case if test fails.
+    std::cout << ">>>>>> Seed is: " << seed << " <<<<<<\n";
+
+    struct allocation
+    {
+        exactly_block   *fast;
+        exactly_block   *linear;
+        size_t          cnt;
+    };
+
+    std::vector< allocation > allocs;
+
+    for (int i = 0; i < 5000; ++i) {
+        if (allocs.empty() || std::rand() % 3) {
+            size_t cnt = (std::rand() % 4) ? 1 : std::rand() % 8 + 1;
+            auto f = fast->aligned_alloc< exactly_block >(cnt);
+            auto l = linear->aligned_alloc< exactly_block >(cnt);
+
+            CHECK_EQUAL(l == nullptr, f == nullptr);
+
+            if (f) {
+                CHECK_EQUAL(linear_idx(l), fast_idx(f));
+                allocs.push_back({f, l, cnt});
+            }
+        } else {
+            auto it = allocs.begin() + std::rand() % allocs.size();
+            fast->deallocate(it->fast, it->cnt);
+            linear->deallocate(it->linear, it->cnt);
+            allocs.erase(it);
+        }
+    }
+
+    for (auto &a : allocs) {
+        fast->deallocate(a.fast, a.cnt);
+        linear->deallocate(a.linear, a.cnt);
+    }
+
+    CHECK_EQUAL(0, used_blocks());
+}
@@ -0,0 +1,134 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//!
+//! \file
+//! \brief Integer to text conversion routines.
+//! \details Conversion is table-driven and does not depend on the C library.
+//! Decimal conversion emits two digits per division. Power-of-two bases
+//! are converted with shifts only. Values that fit into 32 bits are always
+//! converted using 32-bit arithmetic, so 64-bit division helpers are not
+//! called on 32-bit MCUs in the common case.
+//!
+#ifndef ECL_FORMAT_HPP_
+#define ECL_FORMAT_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <climits>
+#include <type_traits>
+
+namespace ecl
+{
+
+//! Size of the buffer, enough to hold any integer in any supported base,
+//! including the sign.
+static constexpr size_t format_buf_size = sizeof(unsigned long long) * CHAR_BIT + 1;
+
+namespace format_impl
+{
+
+//! Converts value to characters, placing them right before the end pointer.
+template< typename T >
+constexpr size_t digits(char *end, T value, unsigned base)
+{
+    // Pairs of decimal digits, from 00 to 99
+    constexpr const char *pairs =
+            "00010203040506070809"
+            "10111213141516171819"
+            "20212223242526272829"
+            "30313233343536373839"
+            "40414243444546474849"
+            "50515253545556575859"
+            "60616263646566676869"
+            "70717273747576777879"
+            "80818283848586878889"
+            "90919293949596979899";
+
+    constexpr const char *xdigits = "0123456789abcdef";
+
+    char *p = end;
+
+    if (base == 10) {
+        while (value >= 100) {
+            auto idx = static_cast< unsigned >(value % 100) * 2;
+            value /= 100;
+            p -= 2;
+            p[0] = pairs[idx];
+            p[1] = pairs[idx + 1];
+        }
+
+        if (value >= 10) {
+            auto idx = static_cast< unsigned >(value) * 2;
+            p -= 2;
+            p[0] = pairs[idx];
+            p[1] = pairs[idx + 1];
+        } else {
+            *--p = xdigits[value];
+        }
+    } else {
+        unsigned shift = base == 16 ? 4 : base == 8 ? 3 : 1;
+        unsigned mask = base - 1;
+
+        do {
+            *--p = xdigits[value & mask];
+            value >>= shift;
+        } while (value);
+    }
+
+    return end - p;
+}
+
+} // namespace format_impl
+
+//!
+//! \brief Converts unsigned integer to text.
+//! Characters are placed right before the end pointer, no terminating
+//! null character is written.
+//! \tparam     T       Unsigned integer type.
+//! \param[in]  end     Pointer past the last character. At least
+//!                     format_buf_size bytes must be available before it.
+//! \param[in]  value   Value to convert.
+//! \param[in]  base    Base: 2, 8, 10 or 16.
+//! \return Amount of characters written.
+//!
+template< typename T >
+constexpr size_t format_uint(char *end, T value, unsigned base = 10)
+{
+    static_assert(std::is_unsigned< T >::value, "Type must be unsigned");
+
+    // Double shift is well-defined even for 32-bit types
+    if (!(value >> 16 >> 16)) {
+        return format_impl::digits(end, static_cast< uint32_t >(value), base);
+    }
+
+    return format_impl::digits(end, value, base);
+}
+
+//!
+//! \brief Converts signed integer to text.
+//! In bases other than 10 negative values are formatted as
+//! their two's complement representation, same as std::ostream does.
+//! \copydetails format_uint()
+//!
+template< typename T >
+constexpr size_t format_int(char *end, T value, unsigned base = 10)
+{
+    static_assert(std::is_signed< T >::value, "Type must be signed");
+
+    using U = std::make_unsigned_t< T >;
+
+    if (value >= 0 || base != 10) {
+        return format_uint(end, static_cast< U >(value), base);
+    }
+
+    // Negation is done in unsigned domain to handle minimal value
+    auto n = format_uint(end, static_cast< U >(U{0} - static_cast< U >(value)), base);
+    *(end - n - 1) = '-';
+    return n + 1;
+}
+
+} // namespace ecl
+
+#endif // ECL_FORMAT_HPP_
@@ -9,6 +9,10 @@
 #include "ostream.hpp"
 #include "console_driver.hpp"
 
+#if THECORE_CONFIG_USE_CONSOLE
+#include <ecl/thread/mutex.hpp>
+#endif
+
 #include <unistd.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -72,12 +76,26 @@ static struct iostream_initializer
     ~iostream_initializer();
 } stream_initializer;
 
+#if THECORE_CONFIG_USE_CONSOLE
+// Console is shared between threads
+using console_lock = mutex;
+#else
+// Output is discarded anyway
+using console_lock = null_lock;
+#endif
+
+// Standard stream types. Error output is not buffered, so it is never
+// held back.
+using cin_type  = istream<console_driver>;
+using cout_type = ostream<console_driver, 64, console_lock>;
+using cerr_type = ostream<console_driver, 1, console_lock>;
+
 // Standard streams, defined elsewhere
 // These streams rely on specific driver, which name should be
 // the same across all targets
-extern istream<console_driver> &cin;
-extern ostream<console_driver> &cout;
-extern ostream<console_driver> &cerr;
+extern cin_type  &cin;
+extern cout_type &cout;
+extern cerr_type &cerr;
 
 //------------------------------------------------------------------------------
 
@@ -5,27 +5,101 @@
 #ifndef ECL_OSTREAM_HPP
 #define ECL_OSTREAM_HPP
 
-#include <stdio.h>
+#include <cstddef>
+#include <cstdint>
 #include <ecl/assert.h>
-#include <cmath>
+#include <ecl/format.hpp>
 
 namespace ecl
 {
 
+//! Puts end of line and flushes the stream.
 template<typename stream>
 stream& endl(stream &ios)
 {
     ios.put('\n');
     ios.put('\r');
 
-    // TODO: flush stream when appropriate functionality
-    // will be ready
-    return ios;
+    return ios.flush();
 }
 
-template<class IO_device>
+//! Writes everything buffered in the stream to the device.
+template<typename stream>
+stream& flush(stream &ios)
+{
+    return ios.flush();
+}
+
+//! Switches integer output to decimal base.
+template<typename stream>
+stream& dec(stream &ios)
+{
+    return ios.base(10);
+}
+
+//! Switches integer output to hexadecimal base.
+template<typename stream>
+stream& hex(stream &ios)
+{
+    return ios.base(16);
+}
+
+//! Switches integer output to octal base.
+template<typename stream>
+stream& oct(stream &ios)
+{
+    return ios.base(8);
+}
+
+//! Switches integer output to binary base.
+template<typename stream>
+stream& bin(stream &ios)
+{
+    return ios.base(2);
+}
+
+//! Sets minimal width of the next numeric field.
+struct setw
+{
+    constexpr explicit setw(size_t w) :width{w} { }
+    size_t width;
+};
+
+//! Sets character used to pad numeric fields.
+struct setfill
+{
+    constexpr explicit setfill(char c) :fill{c} { }
+    char fill;
+};
+
+//! Lock that does nothing, for streams used from a single thread.
+struct null_lock
+{
+    void lock() { }
+    void unlock() { }
+};
+
+//!
+//! \brief Output stream.
+//! Output is accumulated in the internal buffer and passed to the device
+//! in one write when either the buffer is full, a line is complete or
+//! the stream is flushed explicitly with ecl::flush or ecl::endl.
+//! Line completion is detected only by formatted character and string
+//! output, put() never triggers flush by itself.
+//! Integers are formatted without the C library, see ecl/format.hpp.
+//! Each insertion and flush is done under the lock, thus the stream can be
+//! shared between threads if a real lock is given. Formatting state set by
+//! manipulators is shared as well.
+//! \tparam IO_device Device driver type.
+//! \tparam buf_size  Size of the output buffer. Buffer of size 1 effectively
+//!                   makes stream unbuffered.
+//! \tparam Lock      Lock type, e.g. ecl::mutex. Not callable from ISR then.
+//!
+template<class IO_device, size_t buf_size = 64, class Lock = null_lock>
 class ostream
 {
+    static_assert(buf_size, "Buffer size must be bigger than 0");
+
 public:
     // Provides type information of the underlying device
     using device_type = IO_device;
@@ -33,136 +107,371 @@ public:
     // Initializes a stream with given device
     // NOTE: device must be initialized and opened already
     ostream(IO_device *device);
+    // Flushes remaining data
     ~ostream();
 
     ostream &operator<<(int value);
     ostream &operator<<(unsigned int value);
+    ostream &operator<<(long value);
+    ostream &operator<<(unsigned long value);
+    ostream &operator<<(long long value);
+    ostream &operator<<(unsigned long long value);
+    ostream &operator<<(bool value);
     ostream &operator<<(char character);
     ostream &operator<<(const char *string);
+    // Pointers are printed in hex, padded with zeroes to full width
+    ostream &operator<<(const void *ptr);
 
     // For I\O manipulators
-    ostream &operator<<(ostream& (*func)(ostream< IO_device >&));
-    // NOTE: this will be used later with different manipulators,
-    // such that used for hex or octal output of integers
+    ostream &operator<<(ostream& (*func)(ostream&));
+    ostream &operator<<(setw w);
+    ostream &operator<<(setfill f);
 
     // Puts a single character
     ostream &put(char c);
 
+    // Writes buffered data to the device.
+    // If device reports an error, buffered data is discarded.
+    ostream &flush();
+
+    // Sets base of integer output: 2, 8, 10 or 16.
+    ostream &base(unsigned b);
+
+    // Sets minimal width of the next numeric field.
+    // Width is reset to zero after each numeric output.
+    ostream &width(size_t w);
+
+    // Sets character used to pad numeric fields.
+    ostream &fill(char c);
+
     // Disabled for now.
     ostream &operator=(ostream &) = delete;
     ostream(const ostream &) = delete;
 
 private:
+    // Holds the stream lock in a scope
+    struct guard
+    {
+        explicit guard(Lock &l) :lock{l} { lock.lock(); }
+        ~guard() { lock.unlock(); }
+        Lock &lock;
+    };
+
+    // Writes buffered data to the device. Lock must be held.
+    void drain();
+
+    // Places a character in the buffer, flushing it if it becomes full
+    void push(char c);
+
+    // Places a sequence of characters in the buffer
+    void push(const char *str, size_t n);
+
+    // Formats and places signed integer in the buffer
+    template<typename T>
+    void put_signed(T value);
+
+    // Formats and places unsigned integer in the buffer
+    template<typename T>
+    void put_unsigned(T value);
+
+    // Places a field in the buffer, padding it according to width
+    void put_field(const char *str, size_t n);
+
     // Simply, a device driver object
     IO_device *m_device;
+    // Output buffer
+    uint8_t m_buf[buf_size];
+    // Amount of bytes in the buffer
+    size_t m_pos;
+    // Width of the next numeric field
+    size_t m_width;
+    // Base of integer output
+    uint8_t m_base;
+    // Padding character
+    char m_fill;
+    // Serializes access to the buffer and formatting state
+    Lock m_lock;
 };
 
 
 //------------------------------------------------------------------------------
 
 
-template<class IO_device>
-ostream< IO_device >::ostream(IO_device *device)
+template<class IO_device, size_t buf_size, class Lock>
+ostream< IO_device, buf_size, Lock >::ostream(IO_device *device)
     :m_device{device}
+    ,m_buf{}
+    ,m_pos{0}
+    ,m_width{0}
+    ,m_base{10}
+    ,m_fill{' '}
+    ,m_lock{}
 {
 }
 
-template<class IO_device>
-ostream< IO_device >::~ostream()
+template<class IO_device, size_t buf_size, class Lock>
+ostream< IO_device, buf_size, Lock >::~ostream()
 {
+    drain();
 }
 
-template<class IO_device>
-ostream<IO_device> &ostream< IO_device >::operator<< (int value)
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(int value)
 {
-    // Maximum numbers of characters, required to hold specific int value
-    // in base 10 can be calculated in compile time (at least in gcc/g++)
-    // using logarithm.
-    // Three additional chars are required for sign char, for compensating
-    // the result of floor when converting from double to int, for '\0' char.
-    constexpr int chars_needed = std::log10(INT_MAX) + 3;
-    char buf[chars_needed];
+    guard g{m_lock};
+
+    put_signed(value);
+    return *this;
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(unsigned int value)
+{
+    guard g{m_lock};
+
+    put_unsigned(value);
+    return *this;
+}
 
-    int n =  snprintf(buf, sizeof(buf), "%d", value);
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(long value)
+{
+    guard g{m_lock};
 
-    ecl_assert(n > 0 && n < static_cast<int>(sizeof(buf)));
+    put_signed(value);
+    return *this;
+}
 
-    m_device->write(reinterpret_cast<uint8_t*>(buf), n);
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(unsigned long value)
+{
+    guard g{m_lock};
 
+    put_unsigned(value);
     return *this;
 }
 
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(long long value)
+{
+    guard g{m_lock};
+
+    put_signed(value);
+    return *this;
+}
 
-template<class IO_device>
-ostream<IO_device> &ostream< IO_device >::operator<< (unsigned int value)
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(unsigned long long value)
 {
-    // Maximum numbers of characters, required to hold specific int value
-    // in base 10 can be calculated in compile time (at least in gcc/g++)
-    // using logarithm.
-    // Two additional chars are required for compensating the result of floor
-    // when converting from double to int and for '\0' char.
-    constexpr int chars_needed = std::log10(UINT_MAX) + 2;
-    char buf[chars_needed];
+    guard g{m_lock};
 
-    int n = snprintf(buf, sizeof(buf), "%u", value);
+    put_unsigned(value);
+    return *this;
+}
 
-    ecl_assert(n > 0 && n < static_cast<int>(sizeof(buf)));
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(bool value)
+{
+    guard g{m_lock};
 
-    m_device->write(reinterpret_cast<uint8_t*>(buf), n);
+    if (value) {
+        put_field("true", 4);
+    } else {
+        put_field("false", 5);
+    }
 
     return *this;
 }
 
 
-template<class IO_device>
-ostream<IO_device> &ostream< IO_device >::operator<<(char character)
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(char character)
 {
-    this->put(character);
+    guard g{m_lock};
+
+    push(character);
+
+    if (character == '\n') {
+        drain();
+    }
 
     return *this;
 }
 
 
-template<class IO_device>
-ostream<IO_device> &ostream< IO_device >::operator<<(const char *string)
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(const char *string)
 {
-    // TODO: improve this function in a way it can write a string
-    // to a device with chunks that are split by '\n' symbol
-    // What about somehow move it to the platform layer?
-
-    size_t i = 0;
-    while (string[i] != '\0') {
+    guard g{m_lock};
+    bool line = false;
 
+    for (size_t i = 0; string[i] != '\0'; ++i) {
         if (string[i] == '\n') {
-            uint8_t carret_ret = '\r';
-            m_device->write(&carret_ret, 1);
+            push('\r');
+            line = true;
         }
 
-        if (m_device->write((const uint8_t *) &string[i], 1) < 0) {
-            break; //FIXME: add error handling
-        }
+        push(string[i]);
+    }
 
-        i++;
+    if (line) {
+        drain();
     }
+
     return *this;
 }
 
 
-template<class IO_device>
-ostream<IO_device> &ostream< IO_device >::operator<<(
-        ostream& (*func)(ostream< IO_device >&))
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(
+        ostream& (*func)(ostream&))
 {
     return func(*this);
 }
 
-template<class IO_device>
-ostream<IO_device> &ostream< IO_device >::put(char c)
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(const void *ptr)
+{
+    guard g{m_lock};
+
+    char buf[format_buf_size];
+    auto end = buf + sizeof(buf);
+    auto n = format_uint(end, reinterpret_cast<uintptr_t>(ptr), 16);
+
+    push("0x", 2);
+    for (auto i = n; i < sizeof(ptr) * 2; ++i) {
+        push('0');
+    }
+
+    push(end - n, n);
+    m_width = 0;
+
+    return *this;
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(setw w)
+{
+    return width(w.width);
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::operator<<(setfill f)
+{
+    return fill(f.fill);
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::put(char c)
+{
+    guard g{m_lock};
+    push(c);
+
+    return *this;
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::flush()
+{
+    guard g{m_lock};
+    drain();
+
+    return *this;
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::base(unsigned b)
+{
+    ecl_assert(b == 2 || b == 8 || b == 10 || b == 16);
+
+    guard g{m_lock};
+    m_base = b;
+    return *this;
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::width(size_t w)
 {
-    m_device->write((uint8_t*)&c, 1);
+    guard g{m_lock};
+    m_width = w;
+    return *this;
+}
 
+template<class IO_device, size_t buf_size, class Lock>
+ostream<IO_device, buf_size, Lock> &ostream< IO_device, buf_size, Lock >::fill(char c)
+{
+    guard g{m_lock};
+    m_fill = c;
     return *this;
 }
 
+template<class IO_device, size_t buf_size, class Lock>
+void ostream< IO_device, buf_size, Lock >::drain()
+{
+    if (m_pos) {
+        // FIXME: add error handling. For now, data is dropped on error.
+        m_device->write(m_buf, m_pos);
+        m_pos = 0;
+    }
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+void ostream< IO_device, buf_size, Lock >::push(char c)
+{
+    // Never store past the buffer, even if it was not drained before
+    if (m_pos >= buf_size) {
+        drain();
+    }
+
+    m_buf[m_pos++] = c;
+
+    // Full buffer is written right away, so size of 1 means no buffering
+    if (m_pos >= buf_size) {
+        drain();
+    }
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+void ostream< IO_device, buf_size, Lock >::push(const char *str, size_t n)
+{
+    while (n--) {
+        push(*str++);
+    }
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+template<typename T>
+void ostream< IO_device, buf_size, Lock >::put_signed(T value)
+{
+    char buf[format_buf_size];
+    auto end = buf + sizeof(buf);
+    auto n = format_int(end, value, m_base);
+
+    put_field(end - n, n);
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+template<typename T>
+void ostream< IO_device, buf_size, Lock >::put_unsigned(T value)
+{
+    char buf[format_buf_size];
+    auto end = buf + sizeof(buf);
+    auto n = format_uint(end, value, m_base);
+
+    put_field(end - n, n);
+}
+
+template<class IO_device, size_t buf_size, class Lock>
+void ostream< IO_device, buf_size, Lock >::put_field(const char *str, size_t n)
+{
+    for (; n < m_width; --m_width) {
+        push(m_fill);
+    }
+
+    m_width = 0;
+    push(str, n);
+}
+
 } // namespace ecl
 
 #endif // ECL_OSTREAM_HPP
@@ -17,11 +17,6 @@
 
 namespace ecl {
 
-// Useful aliases
-using cin_type  = istream<console_driver>;
-using cout_type = ostream<console_driver>;
-using cerr_type = ostream<console_driver>;
-
 //! Tracks initialization and destruction.
 static int nifty_counter;
 
@@ -0,0 +1,116 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Integer formatting speed: snprintf() against ecl::format_int().
+
+#include <ecl/format.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+static constexpr auto iterations = 200000;
+
+// Prevents conversion from being optimized out
+static volatile char sink;
+
+template< typename T >
+static std::vector< T > make_values()
+{
+    std::mt19937_64 gen{42};
+    std::vector< T > values(1024);
+
+    // Mix of short and long numbers, as seen in typical log output
+    for (size_t i = 0; i < values.size(); ++i) {
+        auto v = static_cast< T >(gen());
+        values[i] = i % 2 ? v : v % 1000;
+    }
+
+    return values;
+}
+
+template< typename T, typename Fn >
+static double measure(const std::vector< T > &values, Fn fn)
+{
+    char buf[ecl::format_buf_size + 1];
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        auto n = fn(buf, values[i % values.size()]);
+        sink = buf[n - 1];
+    }
+
+    auto end = std::chrono::steady_clock::now();
+
+    return std::chrono::duration< double, std::nano >(end - start).count()
+            / iterations;
+}
+
+// Converts value and moves result to the start of the buffer,
+// same as snprintf() does.
+template< typename T >
+static size_t ecl_fmt(char *buf, T value, unsigned base)
+{
+    char *end = buf + ecl::format_buf_size;
+    size_t n;
+
+    if (std::is_signed< T >::value) {
+        n = ecl::format_int(end, static_cast< std::make_signed_t< T > >(value), base);
+    } else {
+        n = ecl::format_uint(end, static_cast< std::make_unsigned_t< T > >(value), base);
+    }
+
+    std::copy(end - n, end, buf);
+    return n;
+}
+
+static void report(const char *name, double libc, double ecl)
+{
+    std::cout << std::setw(20) << name
+              << std::setw(12) << std::fixed << std::setprecision(1) << libc
+              << std::setw(12) << ecl
+              << std::setw(10) << std::setprecision(2) << libc / ecl << "x\n";
+}
+
+TEST_GROUP(format_bench)
+{
+};
+
+TEST(format_bench, snprintf_vs_format)
+{
+    auto ints = make_values< int >();
+    auto uints = make_values< unsigned >();
+    auto llongs = make_values< long long >();
+
+    std::cout << "\n\nInteger formatting, ns per conversion\n";
+    std::cout << "                        snprintf         ecl   speedup\n";
+
+    report("int, dec",
+           measure(ints, [](char *b, int v) {
+               return snprintf(b, ecl::format_buf_size, "%d", v); }),
+           measure(ints, [](char *b, int v) { return ecl_fmt(b, v, 10); }));
+
+    report("unsigned, hex",
+           measure(uints, [](char *b, unsigned v) {
+               return snprintf(b, ecl::format_buf_size, "%x", v); }),
+           measure(uints, [](char *b, unsigned v) { return ecl_fmt(b, v, 16); }));
+
+    report("long long, dec",
+           measure(llongs, [](char *b, long long v) {
+               return snprintf(b, ecl::format_buf_size, "%lld", v); }),
+           measure(llongs, [](char *b, long long v) { return ecl_fmt(b, v, 10); }));
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
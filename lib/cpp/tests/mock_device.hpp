@@ -14,9 +14,12 @@ public:
     size_t idx = 0;
     std::string test_input_str;
     bool error_mode = false;
+    size_t writes = 0;
 
     ssize_t write(const uint8_t *buf, size_t size)
     {
+        writes++;
+
         if (error_mode) {
             return mock().actualCall("write").returnIntValue();
         }
@@ -4,6 +4,10 @@
 
 #include <limits.h>
 #include <sstream>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "ecl/ostream.hpp"
 #include "mock_device.hpp"
@@ -25,6 +29,7 @@ TEST_GROUP(ostream)
         test_device.idx = 0;
         test_device.test_input_str = "";
         test_device.error_mode = false;
+        test_device.writes = 0;
     }
 
     void teardown()
@@ -36,13 +41,13 @@ TEST_GROUP(ostream)
 
 TEST(ostream, put)
 {
-    test_ostream->put('A');
+    test_ostream->put('A').flush();
     CHECK_EQUAL("A", test_device.test_input_str);
 }
 
 TEST(ostream, write_char)
 {
-    test_ostream->operator<<('B');
+    test_ostream->operator<<('B').flush();
     CHECK_EQUAL("B", test_device.test_input_str);
 }
 
@@ -51,14 +56,14 @@ TEST(ostream, write_char_error_case)
     test_device.error_mode = true;
 
     mock().expectOneCall("write").andReturnValue(-1);
-    test_ostream->operator<<('A');
+    test_ostream->operator<<('A').flush();
     mock().checkExpectations();
     CHECK_EQUAL("", test_device.test_input_str);
 }
 
 TEST(ostream, write_string)
 {
-    test_ostream->operator<<("Hello");
+    test_ostream->operator<<("Hello").flush();
     CHECK_EQUAL("Hello", test_device.test_input_str);
 }
 
@@ -70,7 +75,7 @@ TEST(ostream, write_string_with_linefeed)
 
 TEST(ostream, write_empty_string)
 {
-    test_ostream->operator<<("");
+    test_ostream->operator<<("").flush();
     CHECK_EQUAL("", test_device.test_input_str);
 }
 
@@ -79,14 +84,14 @@ TEST(ostream, write_string_error_case)
     test_device.error_mode = true;
 
     mock().expectOneCall("write").andReturnValue(-1);
-    test_ostream->operator<<("ERROR");
+    test_ostream->operator<<("ERROR").flush();
     mock().checkExpectations();
     CHECK_EQUAL("", test_device.test_input_str);
 }
 
 TEST(ostream, write_int)
 {
-    test_ostream->operator<<(12345);
+    test_ostream->operator<<(12345).flush();
     CHECK_EQUAL("12345", test_device.test_input_str);
 }
 
@@ -95,7 +100,7 @@ TEST(ostream, write_int_error_case)
     test_device.error_mode = true;
 
     mock().expectOneCall("write").andReturnValue(-1);
-    test_ostream->operator<<(987);
+    test_ostream->operator<<(987).flush();
     mock().checkExpectations();
     CHECK_EQUAL("", test_device.test_input_str);
 }
@@ -108,7 +113,7 @@ TEST(ostream, write_int_min)
 
     ss << input_num;
     ss.get(out, sizeof(out));
-    test_ostream->operator<<(input_num);
+    test_ostream->operator<<(input_num).flush();
     CHECK_EQUAL(out, test_device.test_input_str);
 }
 
@@ -120,20 +125,20 @@ TEST(ostream, write_int_max)
 
     ss << input_num;
     ss.get(out, sizeof(out));
-    test_ostream->operator<<(input_num);
+    test_ostream->operator<<(input_num).flush();
     CHECK_EQUAL(out, test_device.test_input_str);
 }
 
 TEST(ostream, write_zero)
 {
-    test_ostream->operator<<(0);
+    test_ostream->operator<<(0).flush();
     CHECK_EQUAL("0", test_device.test_input_str);
 }
 
 TEST(ostream, write_unsigned_int)
 {
     unsigned int input_num = 11111;
-    test_ostream->operator<<(input_num);
+    test_ostream->operator<<(input_num).flush();
     CHECK_EQUAL("11111", test_device.test_input_str);
 }
 
@@ -145,14 +150,14 @@ TEST(ostream, write_unsigned_int_max)
 
     ss << input_num;
     ss.get(out, sizeof(out));
-    test_ostream->operator<<(input_num);
+    test_ostream->operator<<(input_num).flush();
     CHECK_EQUAL(out, test_device.test_input_str);
 }
 
 TEST(ostream, write_unsigned_int_zero)
 {
     unsigned int input_num = 0;
-    test_ostream->operator<<(input_num);
+    test_ostream->operator<<(input_num).flush();
     CHECK_EQUAL("0", test_device.test_input_str);
 }
 
@@ -162,11 +167,276 @@ TEST(ostream, write_unsigned_int_error_case)
     unsigned int input_num = 11111;
 
     mock().expectOneCall("write").andReturnValue(-1);
-    test_ostream->operator<<(input_num);
+    test_ostream->operator<<(input_num).flush();
     mock().checkExpectations();
     CHECK_EQUAL("", test_device.test_input_str);
 }
 
+TEST(ostream, buffered_until_flush)
+{
+    *test_ostream << "Value: " << 42 << ' ' << 7u;
+    CHECK_EQUAL("", test_device.test_input_str);
+    CHECK_EQUAL(0, test_device.writes);
+
+    *test_ostream << ecl::flush;
+    CHECK_EQUAL("Value: 42 7", test_device.test_input_str);
+    CHECK_EQUAL(1, test_device.writes);
+
+    // Nothing left to write
+    *test_ostream << ecl::flush;
+    CHECK_EQUAL(1, test_device.writes);
+}
+
+TEST(ostream, flushed_on_newline)
+{
+    *test_ostream << "First line\nSecond";
+    CHECK_EQUAL("First line\r\nSecond", test_device.test_input_str);
+
+    *test_ostream << '\n';
+    CHECK_EQUAL("First line\r\nSecond\n", test_device.test_input_str);
+}
+
+TEST(ostream, flushed_on_endl)
+{
+    *test_ostream << "Hello" << ecl::endl;
+    CHECK_EQUAL("Hello\n\r", test_device.test_input_str);
+    CHECK_EQUAL(1, test_device.writes);
+}
+
+TEST(ostream, flushed_when_full)
+{
+    ecl::ostream< mock_device, 8 > small{&test_device};
+
+    small << "0123456789";
+    CHECK_EQUAL("01234567", test_device.test_input_str);
+    CHECK_EQUAL(1, test_device.writes);
+
+    small.flush();
+    CHECK_EQUAL("0123456789", test_device.test_input_str);
+    CHECK_EQUAL(2, test_device.writes);
+}
+
+TEST(ostream, flushed_on_destruction)
+{
+    {
+        ecl::ostream< mock_device > stream{&test_device};
+        stream << "Tail";
+        CHECK_EQUAL("", test_device.test_input_str);
+    }
+
+    CHECK_EQUAL("Tail", test_device.test_input_str);
+}
+
+TEST(ostream, flush_error_drops_data)
+{
+    *test_ostream << "Lost";
+
+    test_device.error_mode = true;
+    mock().expectOneCall("write").andReturnValue(-1);
+    test_ostream->flush();
+    mock().checkExpectations();
+
+    // Buffer is empty now, nothing to write
+    test_ostream->flush();
+    CHECK_EQUAL("", test_device.test_input_str);
+}
+
+TEST(ostream, writes_per_line)
+{
+    // Typical log line with numbers, written to unbuffered and
+    // to buffered streams.
+    auto log_line = [](auto &stream) {
+        stream << "sensor " << 3 << ": temperature " << 2150u
+               << " humidity " << 47 << '\n';
+    };
+
+    ecl::ostream< mock_device, 1 > unbuffered{&test_device};
+    log_line(unbuffered);
+    auto unbuffered_writes = test_device.writes;
+    auto unbuffered_str = test_device.test_input_str;
+
+    test_device.writes = 0;
+    test_device.test_input_str = "";
+
+    log_line(*test_ostream);
+
+    // Same output, single device write
+    CHECK_EQUAL(unbuffered_str, test_device.test_input_str);
+    CHECK_EQUAL(unbuffered_str.size(), unbuffered_writes);
+    CHECK_EQUAL(1, test_device.writes);
+}
+// Checks that device is accessed only under the lock
+struct checked_lock
+{
+    void lock() { CHECK_FALSE(held); held = true; locks++; }
+    void unlock() { CHECK_TRUE(held); held = false; }
+
+    static bool held;
+    static int locks;
+};
+
+bool checked_lock::held;
+int checked_lock::locks;
+
+struct checked_device : mock_device
+{
+    ssize_t write(const uint8_t *buf, size_t size)
+    {
+        CHECK_TRUE(checked_lock::held);
+        return mock_device::write(buf, size);
+    }
+};
+
+TEST(ostream, device_is_written_under_lock)
+{
+    checked_device dev;
+    checked_lock::locks = 0;
+
+    {
+        ecl::ostream< checked_device, 4, checked_lock > stream{&dev};
+
+        stream << "Hello, " << 42 << ecl::hex << ecl::setw(4) << 255u << ecl::endl;
+        stream.put('x');
+        stream << 'y' << '\n';
+    }
+
+    CHECK_EQUAL("Hello, 42  ff\n\rxy\n", dev.test_input_str);
+    CHECK_FALSE(checked_lock::held);
+    CHECK_TRUE(checked_lock::locks > 0);
+}
+
+TEST(ostream, unbuffered_writes_immediately)
+{
+    ecl::ostream< mock_device, 1 > unbuffered{&test_device};
+
+    unbuffered << "err";
+    CHECK_EQUAL("err", test_device.test_input_str);
+    CHECK_EQUAL(3, test_device.writes);
+}
+
+TEST(ostream, concurrent_writers)
+{
+    constexpr int writers = 4;
+    constexpr int lines = 2000;
+
+    ecl::ostream< mock_device, 16, std::mutex > shared{&test_device};
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < writers; ++i) {
+        threads.emplace_back([&shared] {
+            for (int j = 0; j < lines; ++j) {
+                shared << "line\n";
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    shared.flush();
+
+    // Each insertion is written as a whole, nothing is lost
+    std::string expected;
+    for (int i = 0; i < writers * lines; ++i) {
+        expected += "line\r\n";
+    }
+
+    CHECK_EQUAL(expected, test_device.test_input_str);
+}
+
+TEST(ostream, write_long_long_limits)
+{
+    std::stringstream ss;
+    ss << LLONG_MIN << ' ' << LLONG_MAX << ' ' << ULLONG_MAX;
+
+    *test_ostream << LLONG_MIN << ' ' << LLONG_MAX << ' ' << ULLONG_MAX << ecl::flush;
+    CHECK_EQUAL(ss.str(), test_device.test_input_str);
+}
+
+TEST(ostream, write_long)
+{
+    std::stringstream ss;
+    ss << LONG_MIN << ' ' << ULONG_MAX << ' ' << sizeof(int);
+
+    *test_ostream << LONG_MIN << ' ' << ULONG_MAX << ' ' << sizeof(int) << ecl::flush;
+    CHECK_EQUAL(ss.str(), test_device.test_input_str);
+}
+
+TEST(ostream, write_all_decimal_digits)
+{
+    // Covers every entry of digit pair table, both at odd and even positions
+    for (int i = 0; i < 1000; ++i) {
+        std::stringstream ss;
+        ss << i << ' ' << -i * 1001;
+
+        test_device.test_input_str = "";
+        *test_ostream << i << ' ' << -i * 1001 << ecl::flush;
+        CHECK_EQUAL(ss.str(), test_device.test_input_str);
+    }
+}
+
+TEST(ostream, write_bool)
+{
+    *test_ostream << true << ' ' << false << ecl::flush;
+    CHECK_EQUAL("true false", test_device.test_input_str);
+}
+
+TEST(ostream, write_hex)
+{
+    std::stringstream ss;
+    ss << std::hex << 0xdeadbeefu << ' ' << -1 << ' ' << 0 << ' '
+       << 0x123456789abcdefull << std::dec << ' ' << 255;
+
+    *test_ostream << ecl::hex << 0xdeadbeefu << ' ' << -1 << ' ' << 0 << ' '
+                  << 0x123456789abcdefull << ecl::dec << ' ' << 255 << ecl::flush;
+    CHECK_EQUAL(ss.str(), test_device.test_input_str);
+}
+
+TEST(ostream, write_oct_and_bin)
+{
+    *test_ostream << ecl::oct << 8 << ' ' << 0755 << ' '
+                  << ecl::bin << 5u << ' ' << 0 << ' ' << 0x80000000u << ecl::flush;
+    CHECK_EQUAL("10 755 101 0 10000000000000000000000000000000",
+                test_device.test_input_str);
+}
+
+TEST(ostream, write_width_and_fill)
+{
+    std::stringstream ss;
+    ss << std::setw(6) << 42 << '|' << 42 << '|' << std::setfill('0')
+       << std::setw(4) << std::hex << 0xab << '|' << std::setw(2) << 12345;
+
+    *test_ostream << ecl::setw(6) << 42 << '|' << 42 << '|' << ecl::setfill('0')
+                  << ecl::setw(4) << ecl::hex << 0xab << '|' << ecl::setw(2) << 12345
+                  << ecl::flush;
+    CHECK_EQUAL(ss.str(), test_device.test_input_str);
+}
+
+TEST(ostream, write_pointer)
+{
+    auto ptr = reinterpret_cast< const void* >(static_cast< uintptr_t >(0x1234abcd));
+    std::string expected = "0x" + std::string(sizeof(void*) * 2 - 8, '0') + "1234abcd";
+
+    *test_ostream << ptr << ecl::flush;
+    CHECK_EQUAL(expected, test_device.test_input_str);
+}
+
+TEST(ostream, format_is_constexpr)
+{
+    struct check
+    {
+        static constexpr bool run()
+        {
+            char buf[ecl::format_buf_size] = {};
+            auto end = buf + sizeof(buf);
+            auto n = ecl::format_int(end, -1234, 10);
+            return n == 5 && end[-5] == '-' && end[-4] == '1' && end[-1] == '4';
+        }
+    };
+
+    static_assert(check::run(), "Formatting must be usable in constant expressions");
+}
 
 int main(int argc, char *argv[])
 {
@@ -0,0 +1,320 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Directory entry cache.
+
+#ifndef LIB_FS_DENTRY_CACHE_HPP_
+#define LIB_FS_DENTRY_CACHE_HPP_
+
+#include "ecl/fs/inode.hpp"
+
+#include <ecl/assert.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+//! Default amount of entries in the VFS directory entry cache.
+//! Can be overridden by the filesystem configuration.
+#ifndef THECORE_FS_DENTRY_CACHE_SIZE
+#define THECORE_FS_DENTRY_CACHE_SIZE 16
+#endif
+
+namespace ecl
+{
+
+namespace fs
+{
+
+//! \addtogroup lib Libraries and utilities
+//! @{
+
+//! \defgroup fs Filesystem support
+//! @{
+
+//! \defgroup fs_iface Filesystem interfaces
+//! @{
+
+//! Directory entry cache statistics.
+struct dentry_cache_stats
+{
+    uint32_t hits;      //!< Lookups served from the cache.
+    uint32_t misses;    //!< Lookups that required directory scan.
+    uint32_t evictions; //!< Entries evicted to free space for new ones.
+};
+
+//! Bounded cache of resolved directory entries.
+//! \details Maps pair of parent directory inode and a name to the child
+//! inode. Entries are kept in a fixed array, least recently used entry is
+//! evicted when the cache is full. Each entry holds references to both
+//! parent and child, so neither of them can be freed and reused while
+//! entry exists.
+//! Cache is not thread-safe.
+//! \tparam N Amount of entries.
+template<size_t N>
+class dentry_cache
+{
+    static_assert(N > 0, "Cache must have at least one entry");
+
+public:
+    //! Names of this length and longer are not cached.
+    static constexpr size_t name_max = 64;
+
+    //! Constructs empty cache.
+    dentry_cache();
+
+    //! Finds cached child inode.
+    //! \param[in] parent Parent dir inode.
+    //! \param[in] name   Name of the child, not necessarily null-terminated.
+    //! \param[in] len    Length of the name.
+    //! \return Child inode, or null pointer if not cached.
+    inode_ptr lookup(const inode_ptr &parent, const char *name, size_t len);
+
+    //! Places child inode to the cache, evicting least recently used entry.
+    //! \param[in] parent Parent dir inode.
+    //! \param[in] name   Name of the child, not necessarily null-terminated.
+    //! \param[in] len    Length of the name.
+    //! \param[in] child  Child inode.
+    void insert(const inode_ptr &parent, const char *name, size_t len,
+                const inode_ptr &child);
+
+    //! Drops entry for given name, if cached.
+    //! \details Must be called when entry is removed or renamed.
+    void invalidate(const inode_ptr &parent, const char *name, size_t len);
+
+    //! Drops all entries referring to given inode, including entries
+    //! of its descendants.
+    //! \details Must be called when inode is removed.
+    void invalidate(const inode_ptr &node);
+
+    //! Drops all entries.
+    //! \details Must be called when filesystem is (re)mounted.
+    void clear();
+
+    //! Gets cache statistics, accumulated since construction or last
+    //! reset_stats() call.
+    const dentry_cache_stats &stats() const { return m_stats; }
+
+    //! Resets cache statistics.
+    void reset_stats() { m_stats = dentry_cache_stats{}; }
+
+    //! Calculates hash of a name (FNV-1a).
+    static uint32_t hash(const char *name, size_t len);
+
+private:
+    struct entry
+    {
+        inode_ptr   parent;     //!< Parent dir. Null if entry is free.
+        inode_ptr   child;      //!< Resolved inode.
+        uint32_t    name_hash;  //!< Hash of the child name.
+        uint32_t    last_used;  //!< Cache tick of the last access.
+        size_t      len;        //!< Length of the child name.
+    };
+
+    //! Finds entry with given key. Returns N if not found.
+    size_t find(const inode_ptr &parent, const char *name, size_t len, uint32_t h) const;
+
+    //! Checks if child inode has given name.
+    static bool name_matches(const inode_ptr &child, const char *name, size_t len);
+
+    //! Frees entry.
+    void drop(entry &e);
+
+    std::array<entry, N>    m_entries;  //!< Cache entries.
+    uint32_t                m_tick;     //!< Access counter, used for LRU eviction.
+    dentry_cache_stats      m_stats;    //!< Cache statistics.
+};
+
+//------------------------------------------------------------------------------
+
+template<size_t N>
+dentry_cache<N>::dentry_cache()
+    :m_entries{}
+    ,m_tick{0}
+    ,m_stats{}
+{
+}
+
+template<size_t N>
+inode_ptr dentry_cache<N>::lookup(const inode_ptr &parent, const char *name, size_t len)
+{
+    ecl_assert(parent);
+    ecl_assert(name);
+
+    auto idx = find(parent, name, len, hash(name, len));
+
+    if (idx == N) {
+        m_stats.misses++;
+        return inode_ptr{};
+    }
+
+    m_stats.hits++;
+    m_entries[idx].last_used = ++m_tick;
+    return m_entries[idx].child;
+}
+
+template<size_t N>
+void dentry_cache<N>::insert(const inode_ptr &parent, const char *name, size_t len,
+                             const inode_ptr &child)
+{
+    ecl_assert(parent);
+    ecl_assert(name);
+    ecl_assert(child);
+
+    if (len >= name_max) {
+        return;
+    }
+
+    auto h = hash(name, len);
+    auto idx = find(parent, name, len, h);
+
+    if (idx == N) {
+        // Pick free or least recently used entry
+        idx = 0;
+        for (size_t i = 0; i < N; ++i) {
+            if (!m_entries[i].parent) {
+                idx = i;
+                break;
+            }
+
+            if (m_entries[i].last_used < m_entries[idx].last_used) {
+                idx = i;
+            }
+        }
+
+        if (m_entries[idx].parent) {
+            m_stats.evictions++;
+        }
+    }
+
+    auto &e = m_entries[idx];
+    e.parent    = parent;
+    e.child     = child;
+    e.name_hash = h;
+    e.len       = len;
+    e.last_used = ++m_tick;
+}
+
+template<size_t N>
+void dentry_cache<N>::invalidate(const inode_ptr &parent, const char *name, size_t len)
+{
+    ecl_assert(parent);
+    ecl_assert(name);
+
+    auto idx = find(parent, name, len, hash(name, len));
+    if (idx != N) {
+        invalidate(m_entries[idx].child);
+    }
+}
+
+template<size_t N>
+void dentry_cache<N>::invalidate(const inode_ptr &node)
+{
+    ecl_assert(node);
+
+    std::array<inode_ptr, N + 1> dropped;
+    size_t cnt = 0;
+
+    dropped[cnt++] = node;
+
+    // Every dropped child can be a parent of other entries.
+    // Each entry is dropped only once, so there are at most N passes.
+    for (size_t i = 0; i < cnt; ++i) {
+        for (auto &e : m_entries) {
+            if (!e.parent) {
+                continue;
+            }
+
+            if (e.parent == dropped[i] || e.child == dropped[i]) {
+                if (e.parent == dropped[i]) {
+                    dropped[cnt++] = e.child;
+                }
+
+                drop(e);
+            }
+        }
+    }
+}
+
+template<size_t N>
+void dentry_cache<N>::clear()
+{
+    for (auto &e : m_entries) {
+        drop(e);
+    }
+}
+
+template<size_t N>
+uint32_t dentry_cache<N>::hash(const char *name, size_t len)
+{
+    uint32_t h = 2166136261u;
+
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<uint8_t>(name[i]);
+        h *= 16777619u;
+    }
+
+    return h;
+}
+
+//------------------------------------------------------------------------------
+
+template<size_t N>
+size_t dentry_cache<N>::find(const inode_ptr &parent, const char *name,
+                             size_t len, uint32_t h) const
+{
+    for (size_t i = 0; i < N; ++i) {
+        auto &e = m_entries[i];
+
+        if (e.parent == parent && e.name_hash == h && e.len == len
+                && name_matches(e.child, name, len)) {
+            return i;
+        }
+    }
+
+    return N;
+}
+
+template<size_t N>
+bool dentry_cache<N>::name_matches(const inode_ptr &child, const char *name, size_t len)
+{
+    char child_name[name_max];
+    size_t child_len = sizeof(child_name);
+
+    if (len >= sizeof(child_name)) {
+        return false;
+    }
+
+    auto rc = child->get_name(child_name, child_len);
+    if (is_error(rc)) {
+        return false;
+    }
+
+    // Length reported by get_name() is not reliable across filesystems,
+    // null terminator is used instead.
+    return !strncmp(child_name, name, len) && child_name[len] == '\0';
+}
+
+template<size_t N>
+void dentry_cache<N>::drop(entry &e)
+{
+    e.parent = nullptr;
+    e.child = nullptr;
+    e.name_hash = 0;
+    e.len = 0;
+    e.last_used = 0;
+}
+
+//! @}
+
+//! @}
+
+//! @}
+
+} // namespace fs
+
+} // namespace ecl
+
+#endif // LIB_FS_DENTRY_CACHE_HPP_
@@ -11,6 +11,7 @@
 #include "ecl/fs/fs_descriptor.hpp"
 #include "ecl/fs/inode.hpp"
 #include "ecl/fs/path.hpp"
+#include "ecl/fs/dentry_cache.hpp"
 
 #include <tuple>
 #include <utility>
@@ -54,6 +55,20 @@ public:
     //! \return Pointer to the dir descriptor, or nullptr if open failed.
     static dir_ptr  open_dir(const char *path);
 
+    //! Drops all resolved entries from the directory entry cache.
+    static void invalidate_cache();
+
+    //! Drops entries of given inode and its descendants from the directory
+    //! entry cache.
+    //! \details Must be called if the inode is removed or renamed.
+    static void invalidate_cache(const inode_ptr &node);
+
+    //! Gets directory entry cache statistics.
+    static const dentry_cache_stats &get_cache_stats();
+
+    //! Resets directory entry cache statistics.
+    static void reset_cache_stats();
+
     /* TODO:
      copy(), create_dir(), rename(), remove(), move()
      */
@@ -73,8 +88,11 @@ private:
     //! Iterates over filesystems and resolves path to inode
     static auto path_to_inode(const char *path);
 
-    //! Resolves the name of item in current dir to the inode with given name length
-    static auto name_to_inode(inode_ptr cur_dir, const char *name, size_t name_len);
+    //! Cache of resolved path segments.
+    using cache_type = dentry_cache<THECORE_FS_DENTRY_CACHE_SIZE>;
+
+    //! Prevents static initialization fiasco.
+    static cache_type &cache() { static cache_type c; return c; }
 };
 
 template<class ...Fs>
@@ -82,6 +100,9 @@ ecl::err vfs<Fs...>::mount_all()
 {
     auto rc = ecl::err::ok;
 
+    // Entries of previously mounted filesystems are no longer valid
+    cache().clear();
+
     [](...){}((rc = is_ok(rc) ? Fs::mount() : rc, 0) ... );
 
     return rc;
@@ -116,6 +137,30 @@ dir_ptr vfs<Fs...>::open_dir(const char *path)
     return node->open_dir();
 }
 
+template<class ...Fs>
+void vfs<Fs...>::invalidate_cache()
+{
+    cache().clear();
+}
+
+template<class ...Fs>
+void vfs<Fs...>::invalidate_cache(const inode_ptr &node)
+{
+    cache().invalidate(node);
+}
+
+template<class ...Fs>
+const dentry_cache_stats &vfs<Fs...>::get_cache_stats()
+{
+    return cache().stats();
+}
+
+template<class ...Fs>
+void vfs<Fs...>::reset_cache_stats()
+{
+    cache().reset_stats();
+}
+
 //------------------------------------------------------------------------------
 
 template<class ...Fs>
@@ -171,18 +216,23 @@ auto vfs<Fs...>::path_to_inode(const char *path)
     }
 
     while (iter.next(seg)) {
-        // To iterate directory in name_to_inode() call, current root object
-        // must be a directory, obviously.
+        // To look up a name, current root object must be a directory, obviously.
         if (root->get_type() != inode::type::dir) {
             return inode_ptr{nullptr};
         }
 
         size_t len = seg.second - seg.first;
-        auto next = name_to_inode(root, seg.first, len);
+        auto next = cache().lookup(root, seg.first, len);
 
         if (!next) {
-            // Such name is not found
-            return inode_ptr{nullptr};
+            next = root->lookup(seg.first, len);
+
+            if (!next) {
+                // Such name is not found
+                return inode_ptr{nullptr};
+            }
+
+            cache().insert(root, seg.first, len, next);
         }
 
         // Move to the next inode in path
@@ -192,38 +242,6 @@ auto vfs<Fs...>::path_to_inode(const char *path)
     return root;
 }
 
-template<class ...Fs>
-auto vfs<Fs...>::name_to_inode(inode_ptr cur_dir, const char *name, size_t name_len)
-{
-    ecl_assert(cur_dir);
-    ecl_assert(name);
-    ecl_assert(cur_dir->get_type() == inode::type::dir);
-
-    auto dd = cur_dir->open_dir();
-    char inode_name[64]; // TODO: determine filename size from the filesystem settings
-
-    // Iterate over directory and try to find proper item
-    inode_ptr next;
-    while (next = dd->read()) {
-        size_t len = sizeof(inode_name);
-        auto rc = next->get_name(inode_name, len);
-
-        if (is_error(rc) || len >= sizeof(inode_name)) {
-            // Error occur, or name is too long
-            return inode_ptr{nullptr};
-        }
-
-        // TODO: most of FSes are case sensitive.
-        // This must be optionally be supported by checking special flags
-        if (!memcmp(inode_name, name, std::min(name_len, len))) {
-            // Item found!
-            return next;
-        }
-    }
-
-    return inode_ptr{nullptr};
-}
-
 //! @}
 
 //! @}
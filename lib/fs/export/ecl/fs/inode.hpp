@@ -59,6 +59,16 @@ public:
     //! \return Pointer to dir descriptor.
     virtual dir_ptr open_dir();
 
+    //! Finds an entry with given name in this directory.
+    //! \pre inode representing dir entity.
+    //! \details Default implementation reads the directory descriptor,
+    //! so inode is allocated for every entry checked. Filesystems should
+    //! override it to allocate only the inode of the found entry.
+    //! \param[in] name Name of the entry, not necessarily null-terminated.
+    //! \param[in] len  Length of the name.
+    //! \return Pointer to the entry inode, or nullptr if not found.
+    virtual inode_ptr lookup(const char *name, size_t len);
+
     //! Returns size of a file or number of entries in the directory.
     //! \param[out] sz Parameter to store either file size (if this inode
     //!                   represents a file) or count of etries in the directory
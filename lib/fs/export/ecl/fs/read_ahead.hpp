@@ -0,0 +1,205 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Sequential read-ahead buffer for file descriptors.
+
+#ifndef LIB_FS_READ_AHEAD_HPP_
+#define LIB_FS_READ_AHEAD_HPP_
+
+#include <ecl/err.hpp>
+#include <ecl/assert.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <sys/types.h>
+
+namespace ecl
+{
+
+namespace fs
+{
+
+//! \addtogroup lib Libraries and utilities
+//! @{
+
+//! \defgroup fs Filesystem support
+//! @{
+
+//! \defgroup fs_iface Filesystem interfaces
+//! @{
+
+//! Read-ahead statistics.
+struct read_ahead_stats
+{
+    uint32_t fills;     //!< Reads of the whole window into the buffer.
+    uint32_t direct;    //!< Reads bypassing the buffer.
+    uint32_t hits;      //!< Reads served from the buffer completely.
+};
+
+//! Read-ahead buffer.
+//! \details Detects sequential access to a file and, once detected,
+//! replaces small reads with reads of the whole window. Reads following
+//! the seek or big enough to fill the window go directly to the caller
+//! buffer. Buffer memory is provided by the file descriptor.
+//!
+//! Underlying file position is ahead of the position seen by the user
+//! by the amount of pending() bytes. File descriptor must take it into
+//! account in tell() and seek() calls and must call drop() when the
+//! file position is changed.
+class read_ahead
+{
+public:
+    //! Constructs read-ahead without buffer. All reads are direct.
+    read_ahead();
+
+    //! Assigns a buffer.
+    //! \pre No data is buffered.
+    //! \param[in] buf      Buffer, or nullptr to disable read-ahead.
+    //! \param[in] capacity Buffer size.
+    void set_buffer(uint8_t *buf, size_t capacity);
+
+    //! Gets buffer size.
+    size_t capacity() const { return m_buf ? m_capacity : 0; }
+
+    //! Gets the amount of buffered bytes, not yet consumed by reads.
+    size_t pending() const { return m_len - m_pos; }
+
+    //! Drops buffered data.
+    //! \param[in] pos  New position seen by the user.
+    //!                 Read from this position is not treated as sequential,
+    //!                 unless it is the position at which the last read ended.
+    void drop(off_t pos);
+
+    //! Reads data.
+    //! \param[out]    buf    Buffer to read into.
+    //! \param[in,out] size   On entry: amount of bytes to read.
+    //!                       On exit: amount of bytes read.
+    //! \param[in]     pos    Underlying file position.
+    //! \param[in]     window Amount of bytes to read into the buffer when it
+    //!                       is filled. Must not exceed capacity. Used to
+    //!                       align fills, i.e. to sector boundaries.
+    //! \param[in]     rd     Underlying read function with signature
+    //!                       err(uint8_t *buf, size_t &size). Reads from
+    //!                       the current file position.
+    //! \return Status of operation.
+    template<class Reader>
+    err read(uint8_t *buf, size_t &size, off_t pos, size_t window, Reader &&rd);
+
+    //! Gets statistics.
+    const read_ahead_stats &stats() const { return m_stats; }
+
+    //! Resets statistics.
+    void reset_stats() { m_stats = read_ahead_stats{}; }
+
+private:
+    uint8_t             *m_buf;     //!< Buffer.
+    size_t              m_capacity; //!< Buffer size.
+    size_t              m_pos;      //!< Next byte to read from the buffer.
+    size_t              m_len;      //!< Bytes in the buffer.
+    off_t               m_next;     //!< Position next sequential read starts at.
+    read_ahead_stats    m_stats;    //!< Statistics.
+};
+
+//------------------------------------------------------------------------------
+
+inline read_ahead::read_ahead()
+    :m_buf{nullptr}
+    ,m_capacity{0}
+    ,m_pos{0}
+    ,m_len{0}
+    ,m_next{0}
+    ,m_stats{}
+{
+}
+
+inline void read_ahead::set_buffer(uint8_t *buf, size_t capacity)
+{
+    ecl_assert(!pending());
+
+    m_buf = buf;
+    m_capacity = capacity;
+    m_pos = m_len = 0;
+}
+
+inline void read_ahead::drop(off_t pos)
+{
+    if (pos != m_next) {
+        // Not a sequential access anymore
+        m_next = -1;
+    }
+
+    m_pos = m_len = 0;
+}
+
+template<class Reader>
+err read_ahead::read(uint8_t *buf, size_t &size, off_t pos, size_t window, Reader &&rd)
+{
+    ecl_assert(buf);
+    ecl_assert(window <= capacity());
+
+    if (!size) {
+        return err::ok;
+    }
+
+    size_t done = 0;
+
+    // Buffered data first
+    if (pending()) {
+        done = std::min(size, pending());
+        std::copy(m_buf + m_pos, m_buf + m_pos + done, buf);
+        m_pos += done;
+        m_next += done;
+
+        if (done == size) {
+            m_stats.hits++;
+            return err::ok;
+        }
+    }
+
+    // Buffer is empty, underlying position is the user position
+    size_t left = size - done;
+    size_t got = 0;
+    err rc;
+
+    if (pos == m_next && left < window) {
+        m_len = window;
+        rc = rd(m_buf, m_len);
+        m_stats.fills++;
+
+        if (is_ok(rc)) {
+            got = std::min(left, m_len);
+            std::copy(m_buf, m_buf + got, buf + done);
+            m_pos = got;
+        } else {
+            m_pos = m_len = 0;
+        }
+    } else {
+        got = left;
+        rc = rd(buf + done, got);
+        m_stats.direct++;
+    }
+
+    if (is_error(rc)) {
+        m_next = -1;
+        size = done;
+        return rc;
+    }
+
+    m_next = pos + got;
+    size = done + got;
+    return err::ok;
+}
+
+//! @}
+
+//! @}
+
+//! @}
+
+} // namespace fs
+
+} // namespace ecl
+
+#endif // LIB_FS_READ_AHEAD_HPP_
@@ -7,6 +7,7 @@
 
 #include "ecl/fat/dir_inode.hpp"
 #include "ecl/fat/dir.hpp"
+#include "ecl/fat/file_inode.hpp"
 #include <ecl/iostream.hpp>
 
 using namespace ecl::fat;
@@ -62,6 +63,55 @@ ecl::fs::dir_ptr dir_inode::open_dir()
     return ptr;
 }
 
+ecl::fs::inode_ptr dir_inode::lookup(const char *name, size_t len)
+{
+    ecl_assert(name);
+
+    // Handle possible OOM condition
+    if (!m_path) {
+        return nullptr;
+    }
+
+    // Short names only, plus dot and extension
+    if (len >= sizeof(FILINFO::fname)) {
+        return nullptr;
+    }
+
+    DIR fat_dir;
+    FILINFO fno;
+
+    FRESULT res = pf_opendir(m_fs, &fat_dir, m_path->get_path());
+    if (res != FR_OK) {
+        return nullptr;
+    }
+
+    // Records are read into the stack object, nothing is allocated until
+    // matching record is found.
+    while ((res = pf_readdir(m_fs, &fat_dir, &fno)) == FR_OK && fno.fname[0]) {
+        if (strncmp(fno.fname, name, len) || fno.fname[len] != '\0') {
+            continue;
+        }
+
+        if (fno.fattrib & AM_DIR) {
+            auto ptr = ecl::allocate_shared<dir_inode, decltype(m_alloc)>
+                    (m_alloc, m_fs, m_alloc, m_path->get_path(), fno.fname);
+
+            ptr->set_weak(ptr);
+
+            return ptr;
+        } else {
+            auto ptr = ecl::allocate_shared<file_inode, decltype(m_alloc)>
+                    (m_alloc, m_fs, m_alloc, m_path->get_path(), fno.fname);
+
+            ptr->set_weak(ptr);
+
+            return ptr;
+        }
+    }
+
+    return nullptr;
+}
+
 ecl::err dir_inode::size(size_t &sz) const
 {
     (void)sz;
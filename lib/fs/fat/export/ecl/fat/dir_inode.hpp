@@ -58,6 +58,11 @@ public:
     //! \copydoc fs::inode::open_dir()
     fs::dir_ptr open_dir() override;
 
+    //! \copydoc fs::inode::lookup()
+    //! \details Directory records are scanned without allocating inodes,
+    //! only inode of the matching record is allocated.
+    fs::inode_ptr lookup(const char *name, size_t len) override;
+
     //! \copydoc fs::inode::size()
     err size(size_t &sz) const override;
 
@@ -11,8 +11,15 @@
 
 #include <ecl/fs/file_descriptor.hpp>
 #include <ecl/fs/inode.hpp>
+#include <ecl/fs/read_ahead.hpp>
 
 #include "src/pff.h"
+#include "ecl/fat/types.hpp"
+
+#ifndef THECORE_FATFS_READ_AHEAD
+//! Read-ahead window in sectors, 0 or 1. Zero disables read-ahead.
+#define THECORE_FATFS_READ_AHEAD 0
+#endif
 
 namespace ecl
 {
@@ -30,13 +37,28 @@ namespace fat
 //! @{
 
 //! FATFS file descriptor.
+//! \details If read-ahead is enabled, sequential reads smaller than
+//! the read-ahead window are served from the buffer, allocated from
+//! the filesystem pool. Buffer is filled by whole sectors, thus a block
+//! device is accessed once per sector instead of once per read call.
+//! Read-ahead requires seek support, since the position of underlying
+//! FAT object must be restored before a write.
 class file : public fs::file_descriptor
 {
 public:
+    //! Read-ahead window size in bytes.
+    static constexpr size_t read_ahead_size = THECORE_FATFS_READ_AHEAD * 512;
+
+    // Petite FAT passes every sector to disk_readp() separately, larger
+    // window only costs pool memory.
+    static_assert(THECORE_FATFS_READ_AHEAD <= 1,
+                  "Read-ahead window is limited to a single sector");
+
     //! Constructs the FATFS file descriptor.
     //! \param[in] node Weak smart pointer to the respective file inode.
     //! \param[in] fs Petite FATFS object.
-    file(const fs::inode_weak &node, FATFS *fs);
+    //! \param[in] alloc Allocator for the read-ahead buffer.
+    file(const fs::inode_weak &node, FATFS *fs, const allocator &alloc);
 
     //! \copydoc ecl::fs::file_descriptor::~file_descriptor()
     ~file();
@@ -52,12 +74,24 @@ public:
     //! \copydoc ecl::fs::file_descriptor::close()
     err close() override;
 
+    //! Gets read-ahead statistics.
+    const fs::read_ahead_stats &get_read_ahead_stats() const { return m_ra.stats(); }
+
     file &operator=(file&) = delete;
     file(const file&) = delete;
 
 private:
-    FATFS *m_fs;    //! Pointer to petite FATFS object
-    bool  m_opened; //! Set to true if opened. \todo: remove it and use FATFS::flag instead
+    //! Gets amount of bytes to read into read-ahead buffer from current position.
+    size_t read_ahead_window() const;
+
+    //! Drops read-ahead data and moves FAT position to the user position.
+    err read_ahead_drop();
+
+    FATFS           *m_fs;      //! Pointer to petite FATFS object
+    bool            m_opened;   //! Set to true if opened. \todo: remove it and use FATFS::flag instead
+    allocator       m_alloc;    //! Allocator of the read-ahead buffer
+    uint8_t         *m_ra_buf;  //! Read-ahead buffer
+    fs::read_ahead  m_ra;       //! Read-ahead state
 };
 
 //! @}
@@ -8,6 +8,7 @@
 #include "ecl/fat/types.hpp"
 #include "ecl/fat/file_inode.hpp"
 #include "ecl/fat/dir_inode.hpp"
+#include "ecl/fat/file.hpp"
 #include "src/pff.h"
 
 #include <ecl/pool.hpp>
@@ -42,6 +43,9 @@ private:
     //! Gets an estimated single allocation size for inodes.
     static constexpr size_t get_alloc_blk_size();
 
+    //! Gets amount of pool blocks.
+    static constexpr size_t get_alloc_blk_count();
+
     // Block device bindings
     static DSTATUS disk_initialize(void* disk_obj);
     static DRESULT disk_writep(void* disk_obj, const BYTE* buff, DWORD sc);
@@ -53,7 +57,7 @@ private:
         ctx_type() :pool{}, alloc{&pool}, fat{} { }
         // TODO: make it configurable, i.e. by moving it to the template arguments
         // Memory pool where fat objects will reside
-        ecl::pool<get_alloc_blk_size(), 256> pool;
+        ecl::pool<get_alloc_blk_size(), get_alloc_blk_count(), ecl::pool_fast_index> pool;
         // Will be rebound to a proper object type each time allocation will occur
         allocator   alloc;
         // Petite FAT object
@@ -110,6 +114,13 @@ constexpr size_t petit<Block>::get_alloc_blk_size()
     return alignof(std::max_align_t);
 }
 
+template<class Block>
+constexpr size_t petit<Block>::get_alloc_blk_count()
+{
+    // Inodes, descriptors and paths, plus read-ahead buffer of a single file
+    return 256 + file::read_ahead_size / get_alloc_blk_size();
+}
+
 template<class Block>
 DSTATUS petit<Block>::disk_initialize(void* disk_obj)
 {
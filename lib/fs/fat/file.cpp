@@ -10,15 +10,26 @@
 
 using namespace ecl::fat;
 
-file::file(const fs::inode_weak &node, FATFS *fs)
+file::file(const fs::inode_weak &node, FATFS *fs, const allocator &alloc)
     :fs::file_descriptor{node}
     ,m_fs{fs}
     ,m_opened{true} // When constructed it is already opened
+    ,m_alloc{alloc}
+    ,m_ra_buf{nullptr}
+    ,m_ra{}
 {
+#if _USE_LSEEK && THECORE_FATFS_READ_AHEAD
+    // Read-ahead is silently disabled if pool is exhausted
+    m_ra_buf = m_alloc.allocate(read_ahead_size);
+    m_ra.set_buffer(m_ra_buf, read_ahead_size);
+#endif
 }
 
 file::~file()
 {
+    if (m_ra_buf) {
+        m_alloc.deallocate(m_ra_buf, read_ahead_size);
+    }
 }
 
 ecl::err file::read(uint8_t *buf, size_t &size)
@@ -30,16 +41,20 @@ ecl::err file::read(uint8_t *buf, size_t &size)
         return err::ok;
     }
 
-    unsigned read;
+    auto fat_read = [this](uint8_t *dst, size_t &count) {
+        unsigned read;
 
-    FRESULT res = pf_read(m_fs, reinterpret_cast<void*>(buf), size, &read);
+        FRESULT res = pf_read(m_fs, reinterpret_cast<void*>(dst), count, &read);
 
-    if (res == FR_OK) {
-        size = read;
-        return err::ok;
-    }
+        if (res == FR_OK) {
+            count = read;
+            return err::ok;
+        }
+
+        return err::io;
+    };
 
-    return err::io;
+    return m_ra.read(buf, size, m_fs->fptr, read_ahead_window(), fat_read);
 }
 
 ecl::err file::write(const uint8_t *buf, size_t &size)
@@ -52,6 +67,13 @@ ecl::err file::write(const uint8_t *buf, size_t &size)
         return err::ok;
     }
 
+    if (m_ra.pending()) {
+        auto rc = read_ahead_drop();
+        if (is_error(rc)) {
+            return rc;
+        }
+    }
+
     UINT written;
 
     FRESULT res = pf_write(m_fs, reinterpret_cast<const void*>(buf), size, &written);
@@ -77,12 +99,15 @@ ecl::err file::seek(off_t offt, fs::seekdir whence)
 
     off_t top_offt;
 
+    // FAT position is ahead of the user position if data is read ahead
+    off_t cur_offt = m_fs->fptr - m_ra.pending();
+
     switch (whence) {
     case fs::seekdir::beg:
         top_offt = offt;
         break;
     case fs::seekdir::cur:
-        top_offt = m_fs->fptr + offt;
+        top_offt = cur_offt + offt;
         break;
     case fs::seekdir::end:
         top_offt = m_fs->fsize + offt;
@@ -92,6 +117,8 @@ ecl::err file::seek(off_t offt, fs::seekdir whence)
         break;
     }
 
+    m_ra.drop(top_offt);
+
     res = pf_lseek(m_fs, top_offt);
     if (res == FR_OK) {
         return ecl::err::ok;
@@ -110,7 +137,7 @@ ecl::err file::tell(off_t &offt)
     ecl_assert(m_opened);
 
 #if _USE_LSEEK
-    offt = m_fs->fptr;
+    offt = m_fs->fptr - m_ra.pending();
     return ecl::err::ok;
 #else
     (void)offt;
@@ -130,3 +157,29 @@ ecl::err file::close()
     m_opened = false;
     return err::ok;
 }
+
+//------------------------------------------------------------------------------
+
+size_t file::read_ahead_window() const
+{
+    if (!m_ra.capacity()) {
+        return 0;
+    }
+
+    // Fills are aligned to sector boundaries
+    return read_ahead_size - m_fs->fptr % 512;
+}
+
+ecl::err file::read_ahead_drop()
+{
+#if _USE_LSEEK
+    off_t offt = m_fs->fptr - m_ra.pending();
+    m_ra.drop(offt);
+
+    if (pf_lseek(m_fs, offt) != FR_OK) {
+        return err::io;
+    }
+#endif
+
+    return err::ok;
+}
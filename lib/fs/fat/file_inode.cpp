@@ -41,7 +41,7 @@ ecl::fs::file_ptr file_inode::open()
     // in every file descriptor.
     FRESULT res = pf_open(&m_fs, m_path->get_path());
     if (res == FR_OK) {
-        auto ptr = ecl::allocate_shared<file, allocator>(m_alloc, my_ptr, &m_fs);
+        auto ptr = ecl::allocate_shared<file, allocator>(m_alloc, my_ptr, &m_fs, m_alloc);
         return ptr;
     }
 
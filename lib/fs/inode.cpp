@@ -5,6 +5,8 @@
 #include <ecl/fs/inode.hpp>
 #include <ecl/fs/dir_descriptor.hpp>
 
+#include <cstring>
+
 using namespace ecl::fs;
 
 inode::inode()
@@ -30,6 +32,46 @@ dir_ptr inode::open_dir()
     return dir_ptr{};
 }
 
+inode_ptr inode::lookup(const char *name, size_t len)
+{
+    ecl_assert(name);
+    ecl_assert(get_type() == inode::type::dir);
+
+    char inode_name[64]; // TODO: determine filename size from the filesystem settings
+
+    if (len >= sizeof(inode_name)) {
+        // Such name can't be found
+        return inode_ptr{};
+    }
+
+    auto dd = open_dir();
+    if (!dd) {
+        return inode_ptr{};
+    }
+
+    // Iterate over directory and try to find proper item
+    inode_ptr next;
+    while ((next = dd->read())) {
+        size_t sz = sizeof(inode_name);
+        auto rc = next->get_name(inode_name, sz);
+
+        if (is_error(rc)) {
+            return inode_ptr{};
+        }
+
+        // TODO: most of FSes are case sensitive.
+        // This must be optionally be supported by checking special flags
+        // Length reported by get_name() is not reliable across filesystems,
+        // so whole name is compared including null terminator.
+        if (!strncmp(inode_name, name, len) && inode_name[len] == '\0') {
+            // Item found!
+            return next;
+        }
+    }
+
+    return inode_ptr{};
+}
+
 void inode::set_weak(const fs::inode_ptr &ptr)
 {
     ecl_assert(my_ptr.expired());
@@ -8,11 +8,12 @@
 #ifndef LIB_FS_CFG_HPP_
 #define LIB_FS_CFG_HPP_
 
+// Definitions must precede VFS headers, they may override VFS defaults
+#include <fs/fs_defines.h>
+
 #include <ecl/fs/fs_descriptor.hpp>
 #include <ecl/fs/fs.hpp>
 
-#include <fs/fs_defines.h>
-
 // SDSPI is only block device supported in theCore right now
 // So, to make things easier just include it right away
 #include <dev/sdspi.hpp>
@@ -20,7 +20,8 @@ initial_config = {
     'fat': {
         'config-readonly':      False,
         'config-enable_seek':   True,
-        'config-lowercase':     False
+        'config-lowercase':     False,
+        'config-read_ahead':    0
     }
 }
 
@@ -28,7 +29,8 @@ defines_map = {
     'fat': {
         'config-readonly':      'THECORE_FATFS_READONLY',
         'config-enable_seek':   'THECORE_FATFS_USE_SEEK',
-        'config-lowercase':     'THECORE_FATFS_USE_LCC'
+        'config-lowercase':     'THECORE_FATFS_USE_LCC',
+        'config-read_ahead':    'THECORE_FATFS_READ_AHEAD'
     }
 }
 
@@ -42,6 +44,12 @@ def fat_generator(fat_cfg):
 
 cfg = json.load(open(JSON_CFG))
 
+try:
+    dentry_cache = cfg['menu-lib']['menu-filesystem']['config-dentry-cache']
+    cog.outl('#define THECORE_FS_DENTRY_CACHE_SIZE ' + str(int(dentry_cache)))
+except:
+    pass
+
 fatfs_cfg = None
 
 try:
@@ -0,0 +1,281 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <ecl/fs/read_ahead.hpp>
+#include <platform/image_block.hpp>
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+using ecl::fs::read_ahead;
+
+//------------------------------------------------------------------------------
+// In-memory file
+
+struct mem_file
+{
+    mem_file() :data(4096), pos{0}, reads{0}
+    {
+        for (size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<uint8_t>(i * 13 + (i >> 8));
+        }
+    }
+
+    ecl::err operator()(uint8_t *buf, size_t &size)
+    {
+        reads++;
+        size = std::min(size, data.size() - pos);
+        std::copy(data.begin() + pos, data.begin() + pos + size, buf);
+        pos += size;
+        return ecl::err::ok;
+    }
+
+    std::vector<uint8_t>    data;
+    size_t                  pos;
+    size_t                  reads;
+};
+
+static constexpr size_t window = 512;
+
+TEST_GROUP(read_ahead)
+{
+    void setup()
+    {
+        ra.set_buffer(buf, sizeof(buf));
+    }
+
+    // Reads and checks data at the position seen by user
+    void read_and_check(size_t size, size_t expected)
+    {
+        uint8_t out[1024];
+        off_t user_pos = file.pos - ra.pending();
+
+        CHECK_EQUAL(ecl::err::ok, ra.read(out, size, file.pos, window, file));
+        CHECK_EQUAL(expected, size);
+
+        for (size_t i = 0; i < size; ++i) {
+            CHECK_EQUAL(file.data[user_pos + i], out[i]);
+        }
+    }
+
+    uint8_t     buf[window];
+    read_ahead  ra;
+    mem_file    file;
+};
+
+TEST(read_ahead, no_buffer)
+{
+    read_ahead direct;
+    uint8_t out[16];
+    size_t size = sizeof(out);
+
+    CHECK_EQUAL(ecl::err::ok, direct.read(out, size, file.pos, 0, file));
+    size = sizeof(out);
+    CHECK_EQUAL(ecl::err::ok, direct.read(out, size, file.pos, 0, file));
+
+    CHECK_EQUAL(2, file.reads);
+    CHECK_EQUAL(2, direct.stats().direct);
+    CHECK_EQUAL(0, direct.pending());
+}
+
+TEST(read_ahead, small_sequential_reads)
+{
+    // Whole window is read at once
+    for (int i = 0; i < 16; ++i) {
+        read_and_check(32, 32);
+    }
+
+    CHECK_EQUAL(1, file.reads);
+    CHECK_EQUAL(1, ra.stats().fills);
+    CHECK_EQUAL(15, ra.stats().hits);
+    CHECK_EQUAL(0, ra.pending());
+
+    // Read spanning buffered data and the next window
+    read_and_check(20, 20);
+    CHECK_EQUAL(window - 20, ra.pending());
+    read_and_check(window, window);
+
+    // Rest of the buffer is used, then the next window is filled
+    CHECK_EQUAL(3, file.reads);
+    CHECK_EQUAL(window - 20, ra.pending());
+}
+
+TEST(read_ahead, big_reads_are_direct)
+{
+    read_and_check(window, window);
+    read_and_check(1000, 1000);
+
+    CHECK_EQUAL(2, file.reads);
+    CHECK_EQUAL(2, ra.stats().direct);
+    CHECK_EQUAL(0, ra.pending());
+}
+
+TEST(read_ahead, random_access_is_direct)
+{
+    // Seek to other position
+    file.pos = 1000;
+    ra.drop(1000);
+
+    read_and_check(10, 10);
+    CHECK_EQUAL(1, ra.stats().direct);
+
+    // Second contiguous read, sequential access detected
+    read_and_check(10, 10);
+    CHECK_EQUAL(1, ra.stats().fills);
+    CHECK_EQUAL(window - 10, ra.pending());
+
+    // Seek back, buffered data is dropped
+    file.pos = 0;
+    ra.drop(0);
+    CHECK_EQUAL(0, ra.pending());
+
+    read_and_check(10, 10);
+    CHECK_EQUAL(2, ra.stats().direct);
+
+    // Seek to current position is not considered as random access
+    file.pos = 10;
+    ra.drop(10);
+
+    read_and_check(10, 10);
+    CHECK_EQUAL(2, ra.stats().fills);
+}
+
+TEST(read_ahead, end_of_file)
+{
+    file.data.resize(100);
+
+    read_and_check(60, 60);
+    read_and_check(60, 40);
+    read_and_check(60, 0);
+}
+
+TEST(read_ahead, error)
+{
+    uint8_t out[16];
+    size_t size = sizeof(out);
+
+    auto failing = [](uint8_t *, size_t &) { return ecl::err::io; };
+
+    CHECK_EQUAL(ecl::err::io, ra.read(out, size, 0, window, failing));
+    CHECK_EQUAL(0, size);
+    CHECK_EQUAL(0, ra.pending());
+
+    // Next read is not considered sequential
+    size = sizeof(out);
+    CHECK_EQUAL(ecl::err::ok, ra.read(out, size, 0, window, file));
+    CHECK_EQUAL(1, ra.stats().direct);
+}
+
+//------------------------------------------------------------------------------
+// Small reads from the file on SD card image. File is read same way
+// as Petite FAT does: each read request is split to sector fragments and
+// each fragment is read by a separate command.
+
+static char image_path[] = "/tmp/read_ahead_bench_XXXXXX";
+
+struct bench_image
+{
+    static const char *path() { return image_path; }
+};
+
+// Same delays as SD card over SPI, but only accounted
+struct bench_profile : ecl::image_profile_sdspi
+{
+    static constexpr bool realtime = false;
+};
+
+using sd_image = ecl::image_block<bench_image, ecl::image_access::mmap, bench_profile>;
+
+struct image_file
+{
+    static constexpr size_t sector = 512;
+
+    ecl::err operator()(uint8_t *buf, size_t &size)
+    {
+        size_t done = 0;
+
+        while (done < size) {
+            size_t frag = std::min(size - done, sector - pos % sector);
+
+            sd_image::seek(pos);
+            auto rc = sd_image::read(buf + done, frag);
+            if (is_error(rc)) {
+                return rc;
+            }
+
+            done += frag;
+            pos += frag;
+        }
+
+        return ecl::err::ok;
+    }
+
+    size_t pos;
+};
+
+TEST_GROUP(read_ahead_bench)
+{
+    void setup()
+    {
+        int fd = mkstemp(image_path);
+        CHECK_TRUE(fd >= 0);
+        CHECK_EQUAL(0, ftruncate(fd, file_size));
+        close(fd);
+
+        CHECK_EQUAL(ecl::err::ok, sd_image::init());
+    }
+
+    void teardown()
+    {
+        sd_image::deinit();
+        unlink(image_path);
+        strcpy(image_path + strlen(image_path) - 6, "XXXXXX");
+    }
+
+    static constexpr size_t file_size = 64 * 1024;
+};
+
+TEST(read_ahead_bench, small_reads)
+{
+    static uint8_t buf[512];
+    constexpr size_t chunk = 32;
+
+    std::cout << "\n\nReading " << file_size / 1024 << " KB in "
+              << chunk << " byte chunks, SD card over SPI\n";
+
+    for (size_t sectors : { 0, 1 }) {
+        read_ahead ra;
+        image_file file{0};
+        size_t window = sectors * 512;
+
+        ra.set_buffer(sectors ? buf : nullptr, window);
+        sd_image::reset_stats();
+
+        uint8_t out[chunk];
+        size_t total = 0;
+
+        while (total < file_size) {
+            size_t size = sizeof(out);
+            CHECK_EQUAL(ecl::err::ok, ra.read(out, size, file.pos, window, file));
+            CHECK_EQUAL(sizeof(out), size);
+            total += size;
+        }
+
+        auto &stats = sd_image::get_stats();
+
+        std::cout << "  read-ahead " << sectors << " sectors: "
+                  << stats.reads << " commands, "
+                  << stats.busy_us / 1000 << " ms, "
+                  << file_size * 1000 / stats.busy_us << " KB/s\n";
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
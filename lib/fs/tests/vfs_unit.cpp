@@ -0,0 +1,552 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <ecl/fs/fs.hpp>
+#include <ecl/fs/dentry_cache.hpp>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+using namespace ecl::fs;
+
+//------------------------------------------------------------------------------
+// In-memory filesystem. Same as real filesystems, it allocates
+// new inode for every directory entry read.
+
+static size_t allocations;
+static size_t entries_read;
+static bool generic_lookup;
+
+template<typename T>
+struct counting_allocator
+{
+    T* allocate(size_t n)
+    {
+        allocations++;
+        return static_cast<T*>(std::malloc(n * sizeof(T)));
+    }
+
+    void deallocate(T *p, size_t n)
+    {
+        (void)n;
+        std::free(p);
+    }
+
+    template<typename U>
+    counting_allocator<U> rebind() const { return {}; }
+};
+
+struct mem_entry
+{
+    std::string                 name;
+    bool                        is_dir;
+    std::vector<mem_entry>      children;
+};
+
+class mem_inode : public inode
+{
+public:
+    mem_inode(const mem_entry *e) :m_entry{e} { }
+
+    type get_type() const override
+    {
+        return m_entry->is_dir ? type::dir : type::file;
+    }
+
+    file_ptr open() override;
+    dir_ptr open_dir() override;
+    inode_ptr lookup(const char *name, size_t len) override;
+
+    ecl::err size(size_t &sz) const override
+    {
+        sz = m_entry->children.size();
+        return ecl::err::ok;
+    }
+
+    ecl::err get_name(char *buf, size_t &buf_sz) const override
+    {
+        auto len = m_entry->name.copy(buf, buf_sz - 1);
+        buf[len] = 0;
+        buf_sz = m_entry->name.size();
+        return ecl::err::ok;
+    }
+
+    const mem_entry *m_entry;
+};
+
+class mem_dir : public dir_descriptor
+{
+public:
+    mem_dir(const inode_weak &node, const mem_entry *e)
+        :dir_descriptor{node}, m_entry{e}, m_idx{0} { }
+
+    inode_ptr read() override
+    {
+        if (m_idx == m_entry->children.size()) {
+            return inode_ptr{};
+        }
+
+        entries_read++;
+
+        auto ptr = ecl::allocate_shared<mem_inode>(counting_allocator<uint8_t>{},
+                                                   &m_entry->children[m_idx++]);
+        ptr->set_weak(ptr);
+        return ptr;
+    }
+
+    ecl::err rewind() override { m_idx = 0; return ecl::err::ok; }
+    ecl::err close() override { return ecl::err::ok; }
+
+    const inode_ptr &node() const { return m_inode; }
+
+private:
+    const mem_entry *m_entry;
+    size_t          m_idx;
+};
+
+class mem_file : public file_descriptor
+{
+public:
+    mem_file(const inode_weak &node) :file_descriptor{node} { }
+
+    ecl::err read(uint8_t *, size_t &) override { return ecl::err::notsup; }
+    ecl::err write(const uint8_t *, size_t &) override { return ecl::err::notsup; }
+    ecl::err seek(off_t, seekdir) override { return ecl::err::notsup; }
+    ecl::err tell(off_t &) override { return ecl::err::notsup; }
+    ecl::err close() override { return ecl::err::ok; }
+};
+
+file_ptr mem_inode::open()
+{
+    auto ptr = ecl::allocate_shared<mem_file>(counting_allocator<uint8_t>{}, my_ptr);
+    return ptr;
+}
+
+dir_ptr mem_inode::open_dir()
+{
+    auto ptr = ecl::allocate_shared<mem_dir>(counting_allocator<uint8_t>{}, my_ptr, m_entry);
+    return ptr;
+}
+
+// Same as real filesystems, scans entries without allocation
+inode_ptr mem_inode::lookup(const char *name, size_t len)
+{
+    if (generic_lookup) {
+        return inode::lookup(name, len);
+    }
+
+    for (auto &e : m_entry->children) {
+        entries_read++;
+
+        if (!e.name.compare(0, std::string::npos, name, len)) {
+            auto ptr = ecl::allocate_shared<mem_inode>(counting_allocator<uint8_t>{}, &e);
+            ptr->set_weak(ptr);
+            return ptr;
+        }
+    }
+
+    return inode_ptr{};
+}
+
+// Directory with given amount of dummy files before the entry of interest
+static mem_entry make_dir(const char *name, mem_entry next, size_t siblings)
+{
+    mem_entry dir{name, true, {}};
+
+    for (size_t i = 0; i < siblings; ++i) {
+        dir.children.push_back({"file" + std::to_string(i) + ".txt", false, {}});
+    }
+
+    dir.children.push_back(next);
+    return dir;
+}
+
+static const mem_entry &mem_tree()
+{
+    static const mem_entry root = make_dir("", make_dir("logs",
+                                                make_dir("2026",
+                                                    make_dir("10",
+                                                        {"data.bin", false, {}},
+                                                    30), 12), 20), 5);
+    return root;
+}
+
+struct mem_fs
+{
+    static inode_ptr mount()
+    {
+        auto ptr = ecl::allocate_shared<mem_inode>(counting_allocator<uint8_t>{}, &mem_tree());
+        ptr->set_weak(ptr);
+        return ptr;
+    }
+};
+
+ECL_FS_MOUNT_POINT(mem_mount, "mem");
+
+using test_vfs = vfs<fs_descriptor<mem_mount, mem_fs>>;
+
+static constexpr auto deep_path = "/mem/logs/2026/10/data.bin";
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(vfs)
+{
+    void setup()
+    {
+        CHECK_EQUAL(ecl::err::ok, test_vfs::mount_all());
+        test_vfs::reset_cache_stats();
+        allocations = 0;
+        entries_read = 0;
+    }
+
+    void teardown()
+    {
+        test_vfs::invalidate_cache();
+    }
+};
+
+TEST(vfs, deep_path_is_cached)
+{
+    CHECK_TRUE(test_vfs::open_file(deep_path));
+
+    auto &stats = test_vfs::get_cache_stats();
+    CHECK_EQUAL(0, stats.hits);
+    CHECK_EQUAL(4, stats.misses);
+
+    allocations = 0;
+    entries_read = 0;
+
+    CHECK_TRUE(test_vfs::open_file(deep_path));
+    CHECK_EQUAL(4, stats.hits);
+    CHECK_EQUAL(4, stats.misses);
+
+    // Only the file descriptor is allocated, no directories are scanned
+    CHECK_EQUAL(1, allocations);
+    CHECK_EQUAL(0, entries_read);
+}
+
+TEST(vfs, shared_prefix_is_cached)
+{
+    CHECK_TRUE(test_vfs::open_dir("/mem/logs/2026"));
+    CHECK_TRUE(test_vfs::open_file(deep_path));
+
+    auto &stats = test_vfs::get_cache_stats();
+    CHECK_EQUAL(2, stats.hits);
+    CHECK_EQUAL(4, stats.misses);
+}
+
+TEST(vfs, exact_names_only)
+{
+    CHECK_FALSE(test_vfs::open_dir("/mem/logs/20"));
+    CHECK_FALSE(test_vfs::open_dir("/mem/logs/2026x"));
+    CHECK_FALSE(test_vfs::open_file("/mem/logs/2026/10/data"));
+
+    // Resolved name still found after failed lookups of its prefixes
+    CHECK_TRUE(test_vfs::open_dir("/mem/logs/2026"));
+}
+
+TEST(vfs, missing_entry_is_not_cached)
+{
+    CHECK_FALSE(test_vfs::open_file("/mem/logs/none.txt"));
+    CHECK_FALSE(test_vfs::open_file("/mem/logs/none.txt"));
+
+    // Both lookups of missing entry scanned the dir
+    auto &stats = test_vfs::get_cache_stats();
+    CHECK_EQUAL(1, stats.hits);
+    CHECK_EQUAL(3, stats.misses);
+}
+
+TEST(vfs, invalidated_subtree)
+{
+    CHECK_TRUE(test_vfs::open_file(deep_path));
+
+    auto dir = test_vfs::open_dir("/mem/logs/2026");
+    CHECK_TRUE(dir);
+
+    // Unrelated inode, nothing is dropped
+    test_vfs::invalidate_cache(mem_fs::mount());
+
+    test_vfs::reset_cache_stats();
+    CHECK_TRUE(test_vfs::open_file(deep_path));
+    CHECK_EQUAL(4, test_vfs::get_cache_stats().hits);
+
+    // Entries of the dir itself and its descendants are dropped
+    test_vfs::invalidate_cache(static_cast<mem_dir&>(*dir).node());
+
+    test_vfs::reset_cache_stats();
+    CHECK_TRUE(test_vfs::open_file(deep_path));
+    CHECK_EQUAL(1, test_vfs::get_cache_stats().hits);
+    CHECK_EQUAL(3, test_vfs::get_cache_stats().misses);
+}
+
+TEST(vfs, remount_drops_cache)
+{
+    CHECK_TRUE(test_vfs::open_file(deep_path));
+    CHECK_EQUAL(ecl::err::ok, test_vfs::mount_all());
+
+    test_vfs::reset_cache_stats();
+    CHECK_TRUE(test_vfs::open_file(deep_path));
+    CHECK_EQUAL(0, test_vfs::get_cache_stats().hits);
+}
+
+//------------------------------------------------------------------------------
+
+// Named inode for direct cache tests
+class named_inode : public inode
+{
+public:
+    named_inode(const char *name) :m_name{name} { }
+
+    type get_type() const override { return type::dir; }
+    ecl::err size(size_t &) const override { return ecl::err::notsup; }
+
+    ecl::err get_name(char *buf, size_t &buf_sz) const override
+    {
+        auto len = strlen(m_name);
+        strncpy(buf, m_name, buf_sz);
+        buf[buf_sz - 1] = 0;
+        buf_sz = len;
+        return ecl::err::ok;
+    }
+
+private:
+    const char *m_name;
+};
+
+static inode_ptr make_node(const char *name)
+{
+    auto ptr = ecl::allocate_shared<named_inode>(counting_allocator<uint8_t>{}, name);
+    ptr->set_weak(ptr);
+    return ptr;
+}
+
+TEST_GROUP(dentry_cache)
+{
+};
+
+TEST(dentry_cache, lru_eviction)
+{
+    dentry_cache<2> cache;
+    auto root = make_node("");
+    auto a = make_node("a");
+    auto b = make_node("b");
+    auto c = make_node("c");
+
+    cache.insert(root, "a", 1, a);
+    cache.insert(root, "b", 1, b);
+
+    // 'a' becomes most recently used
+    CHECK_TRUE(cache.lookup(root, "a", 1) == a);
+
+    cache.insert(root, "c", 1, c);
+    CHECK_EQUAL(1, cache.stats().evictions);
+
+    CHECK_TRUE(cache.lookup(root, "a", 1) == a);
+    CHECK_TRUE(cache.lookup(root, "c", 1) == c);
+    CHECK_FALSE(cache.lookup(root, "b", 1));
+}
+
+TEST(dentry_cache, entries_of_different_parents)
+{
+    dentry_cache<4> cache;
+    auto d1 = make_node("d1");
+    auto d2 = make_node("d2");
+    auto x1 = make_node("x");
+    auto x2 = make_node("x");
+
+    cache.insert(d1, "x", 1, x1);
+    cache.insert(d2, "x", 1, x2);
+
+    CHECK_TRUE(cache.lookup(d1, "x", 1) == x1);
+    CHECK_TRUE(cache.lookup(d2, "x", 1) == x2);
+}
+
+TEST(dentry_cache, invalidate_descendants)
+{
+    dentry_cache<8> cache;
+    auto root = make_node("");
+    auto a = make_node("a");
+    auto b = make_node("b");
+    auto c = make_node("c");
+    auto other = make_node("other");
+
+    // root/a/b/c and root/other
+    cache.insert(root, "a", 1, a);
+    cache.insert(a, "b", 1, b);
+    cache.insert(b, "c", 1, c);
+    cache.insert(root, "other", 5, other);
+
+    cache.invalidate(root, "a", 1);
+
+    CHECK_FALSE(cache.lookup(root, "a", 1));
+    CHECK_FALSE(cache.lookup(a, "b", 1));
+    CHECK_FALSE(cache.lookup(b, "c", 1));
+    CHECK_TRUE(cache.lookup(root, "other", 5) == other);
+}
+
+TEST(dentry_cache, name_is_verified)
+{
+    dentry_cache<2> cache;
+    auto root = make_node("");
+    auto a = make_node("abc");
+
+    cache.insert(root, "abc", 3, a);
+
+    CHECK_FALSE(cache.lookup(root, "abd", 3));
+    CHECK_FALSE(cache.lookup(root, "ab", 2));
+    CHECK_TRUE(cache.lookup(root, "abc", 3) == a);
+}
+
+//------------------------------------------------------------------------------
+
+static inode_ptr large_dir()
+{
+    static const mem_entry dir = make_dir("large", {"last.bin", false, {}}, 500);
+
+    auto ptr = ecl::allocate_shared<mem_inode>(counting_allocator<uint8_t>{}, &dir);
+    ptr->set_weak(ptr);
+    return ptr;
+}
+
+TEST_GROUP(lookup)
+{
+    void setup()
+    {
+        allocations = 0;
+        entries_read = 0;
+    }
+
+    void teardown()
+    {
+        generic_lookup = false;
+    }
+};
+
+TEST(lookup, generic)
+{
+    generic_lookup = true;
+    auto dir = large_dir();
+
+    allocations = 0;
+    auto node = dir->lookup("file250.txt", 11);
+    CHECK_TRUE(node);
+    CHECK_TRUE(static_cast<mem_inode&>(*node).m_entry->name == "file250.txt");
+
+    // Dir descriptor and every inode read
+    CHECK_EQUAL(252, allocations);
+
+    CHECK_FALSE(dir->lookup("file250", 7));
+    CHECK_FALSE(dir->lookup("file250.txt.bak", 15));
+}
+
+TEST(lookup, fs_specific)
+{
+    auto dir = large_dir();
+
+    allocations = 0;
+    auto node = dir->lookup("file250.txt", 11);
+    CHECK_TRUE(node);
+    CHECK_TRUE(static_cast<mem_inode&>(*node).m_entry->name == "file250.txt");
+
+    // Only the found inode
+    CHECK_EQUAL(1, allocations);
+
+    allocations = 0;
+    CHECK_FALSE(dir->lookup("file250", 7));
+    CHECK_FALSE(dir->lookup("file250.txt.bak", 15));
+    CHECK_EQUAL(0, allocations);
+}
+
+TEST(lookup, name_not_terminated)
+{
+    auto dir = large_dir();
+    const char path[] = "last.bin/other";
+
+    auto node = dir->lookup(path, 8);
+    CHECK_TRUE(node);
+    CHECK_TRUE(static_cast<mem_inode&>(*node).m_entry->name == "last.bin");
+
+    generic_lookup = true;
+    CHECK_TRUE(dir->lookup(path, 8));
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(vfs_bench)
+{
+};
+
+TEST(vfs_bench, open_deep_path)
+{
+    constexpr int iterations = 2000;
+
+    CHECK_EQUAL(ecl::err::ok, test_vfs::mount_all());
+
+    auto run = [](bool cached) {
+        allocations = 0;
+        entries_read = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            if (!cached) {
+                test_vfs::invalidate_cache();
+            }
+
+            CHECK_TRUE(test_vfs::open_file(deep_path));
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << (cached ? "   cached: " : " uncached: ")
+                  << allocations / iterations << " allocations, "
+                  << entries_read / iterations << " entries read, "
+                  << std::chrono::duration<double, std::micro>(end - start).count() / iterations
+                  << " us per open\n";
+    };
+
+    std::cout << "\n\nOpening " << deep_path << '\n';
+    run(false);
+    run(true);
+
+    test_vfs::invalidate_cache();
+}
+
+TEST(vfs_bench, lookup_in_large_dir)
+{
+    constexpr int iterations = 500;
+
+    auto dir = large_dir();
+
+    auto run = [&dir](bool generic) {
+        generic_lookup = generic;
+        allocations = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            CHECK_TRUE(dir->lookup("last.bin", 8));
+        }
+        auto end = std::chrono::steady_clock::now();
+
+        std::cout << (generic ? "      generic: " : " fs-specific: ")
+                  << allocations / iterations << " allocations, "
+                  << std::chrono::duration<double, std::micro>(end - start).count() / iterations
+                  << " us per lookup\n";
+    };
+
+    std::cout << "\n\nLooking up last of 501 entries\n";
+    run(true);
+    run(false);
+
+    generic_lookup = false;
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
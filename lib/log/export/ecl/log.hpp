@@ -0,0 +1,525 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//!
+//! \file
+//! \brief Deferred binary logging.
+//! \details Call site records only the address of a format string and raw
+//! argument values into a lock-free ring. Formatting is done later,
+//! when the ring is drained from a low-priority context, e.g. idle thread.
+//! Alternatively, records can be drained in binary form and decoded on
+//! the host with scripts/log_decode.py.
+//!
+#ifndef LIB_LOG_LOG_HPP_
+#define LIB_LOG_LOG_HPP_
+
+#include <ecl/ostream.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace ecl
+{
+
+//! Type of the recorded log argument.
+enum class log_arg : uint8_t
+{
+    none    = 0,    //!< No argument.
+    i32     = 1,    //!< Signed 32-bit integer.
+    u32     = 2,    //!< Unsigned 32-bit integer.
+    i64     = 3,    //!< Signed 64-bit integer.
+    u64     = 4,    //!< Unsigned 64-bit integer.
+    chr     = 5,    //!< Character.
+    boolean = 6,    //!< Boolean value.
+    str     = 7,    //!< Pointer to string with static storage duration.
+    ptr     = 8,    //!< Pointer.
+};
+
+//! Kind of the record in the log ring. Placed in the upper byte of a header.
+enum class log_record : uint8_t
+{
+    empty   = 0,    //!< Record is not yet committed.
+    msg     = 1,    //!< Log message.
+    pad     = 2,    //!< Padding till the end of the ring.
+    dropped = 3,    //!< Amount of messages dropped due to lack of space.
+};
+
+namespace log_impl
+{
+
+//! Words required to hold a pointer.
+static constexpr size_t ptr_words = sizeof(uintptr_t) / sizeof(uint32_t);
+
+//! Maps argument type to its tag.
+template< typename T, typename = void >
+struct arg_traits;
+
+template< typename T >
+struct arg_traits< T, std::enable_if_t< std::is_integral< T >::value
+                                        && std::is_signed< T >::value
+                                        && !std::is_same< T, char >::value > >
+{
+    static constexpr log_arg tag = sizeof(T) > 4 ? log_arg::i64 : log_arg::i32;
+};
+
+template< typename T >
+struct arg_traits< T, std::enable_if_t< std::is_integral< T >::value
+                                        && std::is_unsigned< T >::value
+                                        && !std::is_same< T, char >::value
+                                        && !std::is_same< T, bool >::value > >
+{
+    static constexpr log_arg tag = sizeof(T) > 4 ? log_arg::u64 : log_arg::u32;
+};
+
+template<>
+struct arg_traits< char >
+{
+    static constexpr log_arg tag = log_arg::chr;
+};
+
+template<>
+struct arg_traits< bool >
+{
+    static constexpr log_arg tag = log_arg::boolean;
+};
+
+template<>
+struct arg_traits< const char* >
+{
+    static constexpr log_arg tag = log_arg::str;
+};
+
+template<>
+struct arg_traits< char* >
+{
+    static constexpr log_arg tag = log_arg::str;
+};
+
+template< typename T >
+struct arg_traits< T*, std::enable_if_t< !std::is_same< std::remove_cv_t< T >, char >::value > >
+{
+    static constexpr log_arg tag = log_arg::ptr;
+};
+
+//! Words occupied by the argument of given type.
+constexpr size_t arg_words(log_arg tag)
+{
+    return tag == log_arg::i64 || tag == log_arg::u64 ? 2
+            : tag == log_arg::str || tag == log_arg::ptr ? ptr_words
+            : 1;
+}
+
+//! Total words occupied by arguments.
+template< typename... Args >
+constexpr size_t args_words()
+{
+    size_t sum = 0;
+    for (auto tag : { log_arg::none, arg_traits< Args >::tag... }) {
+        sum += tag == log_arg::none ? 0 : arg_words(tag);
+    }
+
+    return sum;
+}
+
+//! Packs argument tags, 4 bits per argument.
+template< typename... Args >
+constexpr uint32_t pack_tags()
+{
+    uint32_t tags = 0;
+    unsigned shift = 0;
+    for (auto tag : { log_arg::none, arg_traits< Args >::tag... }) {
+        if (tag != log_arg::none) {
+            tags |= static_cast< uint32_t >(tag) << shift;
+            shift += 4;
+        }
+    }
+
+    return tags;
+}
+
+//! Converts integral argument to its raw value.
+template< typename T >
+constexpr uint64_t raw(T value)
+{
+    return static_cast< uint64_t >(value);
+}
+
+//! Converts pointer argument to its raw value.
+template< typename T >
+inline uint64_t raw(T *value)
+{
+    return reinterpret_cast< uintptr_t >(value);
+}
+
+} // namespace log_impl
+
+//!
+//! \brief Ring of deferred log records.
+//!
+//! Records can be placed from any context, including interrupt handlers,
+//! concurrently. Placing a record does not block and costs a reservation
+//! (single compare-and-swap in the common case) and a copy of the argument
+//! words. If there is no space left, record is dropped and accounted.
+//!
+//! Ring must be drained from a single context at a time.
+//!
+//! Format string uses {} placeholders, {x} prints integer argument in hex,
+//! {{ prints single brace. Format string and string arguments are recorded
+//! as pointers, so they must have static storage duration,
+//! e.g. be string literals.
+//!
+//! Binary layout of a record, in 32-bit words:
+//! - header: length in words in bits 0-15, argument count in bits 16-23,
+//!   kind of the record (ecl::log_record) in bits 24-31;
+//! - argument tags (ecl::log_arg), 4 bits per argument, first argument
+//!   in the lowest bits;
+//! - address of the format string;
+//! - arguments. 64-bit values and pointers occupy two words on 64-bit
+//!   platforms, lower word first.
+//!
+//! Record of dropped kind has no format string and holds amount of dropped
+//! messages in place of tags.
+//!
+//! \tparam size Size of the ring in bytes. Must be a power of two.
+//!
+template< size_t size >
+class log_ring
+{
+    static_assert(size && !(size & (size - 1)), "Size must be a power of two");
+    static_assert(size >= 64, "Ring is too small");
+    static_assert(size <= 0x10000 * sizeof(uint32_t), "Ring is too big");
+
+public:
+    //! Maximum number of arguments in a single record.
+    static constexpr size_t max_args = 8;
+
+    //! Constructs empty ring.
+    log_ring();
+
+    //!
+    //! \brief Places a record in the ring.
+    //! \param[in] fmt  Format string. Must have static storage duration.
+    //! \param[in] args Arguments: integers, characters, booleans, pointers and
+    //!                 strings with static storage duration.
+    //! \retval true    Record is placed.
+    //! \retval false   No space left, record is dropped.
+    //!
+    template< typename... Args >
+    bool record(const char *fmt, Args... args);
+
+    //!
+    //! \brief Formats pending records to the stream.
+    //! Each record is terminated with ecl::endl.
+    //! \param[in] out  Stream, compatible with ecl::ostream.
+    //! \param[in] max  Maximum amount of records to process.
+    //! \return Amount of records processed.
+    //!
+    template< class Stream >
+    size_t drain(Stream &out, size_t max = SIZE_MAX);
+
+    //!
+    //! \brief Writes pending records to the device in binary form.
+    //! Words are written in native byte order.
+    //! \param[in] dev  Device with write(const uint8_t*, size_t) method.
+    //! \param[in] max  Maximum amount of records to process.
+    //! \return Amount of records processed.
+    //!
+    template< class Device >
+    size_t drain_raw(Device &dev, size_t max = SIZE_MAX);
+
+    //! Gets amount of records dropped and not yet reported by drain.
+    size_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    // Copying disabled.
+    log_ring(const log_ring&) = delete;
+    log_ring& operator=(const log_ring&) = delete;
+
+private:
+    //! Ring size in words.
+    static constexpr size_t words = size / sizeof(uint32_t);
+
+    //! Builds record header.
+    static constexpr uint32_t header(log_record kind, size_t argc, size_t len)
+    {
+        return static_cast< uint32_t >(kind) << 24 | argc << 16 | len;
+    }
+
+    //! Reserves given amount of contiguous words. Returns position of them.
+    bool reserve(size_t len, size_t &pos);
+
+    //! Stores a value in the reserved space.
+    void store(size_t &pos, uint64_t value, size_t cnt);
+
+    //! Visits pending records in order, releasing space after each one.
+    template< typename Fn >
+    size_t consume(size_t max, Fn fn);
+
+    //! Formats single message.
+    template< class Stream >
+    void format(Stream &out, const uint32_t *rec);
+
+    //! Record space. Atomic words make concurrent access well-defined.
+    std::array< std::atomic< uint32_t >, words > m_ring;
+    std::atomic< size_t >   m_head;     //!< Reservation position.
+    std::atomic< size_t >   m_tail;     //!< Consumer position.
+    std::atomic< size_t >   m_dropped;  //!< Dropped records counter.
+};
+
+//------------------------------------------------------------------------------
+
+template< size_t size >
+log_ring< size >::log_ring()
+    :m_head{0}
+    ,m_tail{0}
+    ,m_dropped{0}
+{
+    for (auto &w : m_ring) {
+        w.store(0, std::memory_order_relaxed);
+    }
+}
+
+template< size_t size >
+template< typename... Args >
+bool log_ring< size >::record(const char *fmt, Args... args)
+{
+    static_assert(sizeof...(Args) <= max_args, "Too many arguments");
+
+    constexpr size_t len = 2 + log_impl::ptr_words + log_impl::args_words< Args... >();
+    constexpr uint32_t tags = log_impl::pack_tags< Args... >();
+
+    size_t pos;
+    if (!reserve(len, pos)) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto start = pos++;
+
+    store(pos, tags, 1);
+    store(pos, log_impl::raw(fmt), log_impl::ptr_words);
+
+    // Expansion is done in order of arguments
+    using expand = int[];
+    (void)expand{ 0, (store(pos, log_impl::raw(args),
+                            log_impl::arg_words(log_impl::arg_traits< Args >::tag)), 0)... };
+
+    // Record becomes visible to the consumer only after header is set
+    m_ring[start].store(header(log_record::msg, sizeof...(Args), len),
+                        std::memory_order_release);
+    return true;
+}
+
+template< size_t size >
+template< class Stream >
+size_t log_ring< size >::drain(Stream &out, size_t max)
+{
+    return consume(max, [this, &out](const uint32_t *rec) {
+        if (static_cast< log_record >(rec[0] >> 24) == log_record::dropped) {
+            out << "<" << rec[1] << " messages dropped>" << ecl::endl;
+        } else {
+            format(out, rec);
+        }
+    });
+}
+
+template< size_t size >
+template< class Device >
+size_t log_ring< size >::drain_raw(Device &dev, size_t max)
+{
+    return consume(max, [&dev](const uint32_t *rec) {
+        dev.write(reinterpret_cast< const uint8_t* >(rec),
+                  (rec[0] & 0xffff) * sizeof(uint32_t));
+    });
+}
+
+//------------------------------------------------------------------------------
+
+template< size_t size >
+bool log_ring< size >::reserve(size_t len, size_t &pos)
+{
+    auto head = m_head.load(std::memory_order_relaxed);
+    size_t need;
+
+    do {
+        pos = head % words;
+        need = len;
+
+        // Record is never split, rest of the ring is skipped instead
+        if (pos + len > words) {
+            need += words - pos;
+        }
+
+        // Acquire pairs with the consumer, which clears the space
+        // before releasing it.
+        if (head + need - m_tail.load(std::memory_order_acquire) > words) {
+            return false;
+        }
+    } while (!m_head.compare_exchange_weak(head, head + need,
+                                           std::memory_order_relaxed,
+                                           std::memory_order_relaxed));
+
+    if (need != len) {
+        m_ring[pos].store(header(log_record::pad, 0, words - pos),
+                          std::memory_order_release);
+        pos = 0;
+    }
+
+    return true;
+}
+
+template< size_t size >
+void log_ring< size >::store(size_t &pos, uint64_t value, size_t cnt)
+{
+    for (size_t i = 0; i < cnt; ++i) {
+        m_ring[pos++].store(static_cast< uint32_t >(value), std::memory_order_relaxed);
+        value >>= 16;
+        value >>= 16;
+    }
+}
+
+template< size_t size >
+template< typename Fn >
+size_t log_ring< size >::consume(size_t max, Fn fn)
+{
+    // Longest possible record
+    uint32_t rec[2 + log_impl::ptr_words + max_args * 2];
+    size_t cnt = 0;
+
+    if (!max) {
+        return 0;
+    }
+
+    // Drop notification is the first thing consumer sees,
+    // so it is placed right before the records that survived.
+    auto dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped) {
+        rec[0] = header(log_record::dropped, 0, 2);
+        rec[1] = dropped;
+        fn(rec);
+        cnt++;
+    }
+
+    auto tail = m_tail.load(std::memory_order_relaxed);
+
+    while (cnt < max) {
+        auto pos = tail % words;
+        auto hdr = m_ring[pos].load(std::memory_order_acquire);
+
+        if (!hdr) {
+            break;
+        }
+
+        size_t len = hdr & 0xffff;
+        auto kind = static_cast< log_record >(hdr >> 24);
+
+        if (kind == log_record::msg) {
+            for (size_t i = 0; i < len; ++i) {
+                rec[i] = m_ring[pos + i].load(std::memory_order_relaxed);
+            }
+
+            fn(rec);
+            cnt++;
+        }
+
+        // Slot must be cleared, otherwise stale words can be
+        // interpreted as headers of new records.
+        for (size_t i = 0; i < len; ++i) {
+            m_ring[pos + i].store(0, std::memory_order_relaxed);
+        }
+
+        tail += len;
+        m_tail.store(tail, std::memory_order_release);
+    }
+
+    return cnt;
+}
+
+template< size_t size >
+template< class Stream >
+void log_ring< size >::format(Stream &out, const uint32_t *rec)
+{
+    using namespace log_impl;
+
+    auto tags = rec[1];
+    auto word = &rec[2];
+
+    // Reads value occupying given amount of words
+    auto read = [&word](size_t cnt) {
+        uint64_t v = 0;
+        for (size_t i = 0; i < cnt; ++i) {
+            v |= static_cast< uint64_t >(*word++) << (i * 32);
+        }
+        return v;
+    };
+
+    auto fmt = reinterpret_cast< const char* >(static_cast< uintptr_t >(read(ptr_words)));
+
+    while (*fmt) {
+        if (fmt[0] == '{' && fmt[1] == '{') {
+            out << '{';
+            fmt += 2;
+            continue;
+        }
+
+        bool hex = fmt[0] == '{' && fmt[1] == 'x' && fmt[2] == '}';
+
+        if (!(fmt[0] == '{' && fmt[1] == '}') && !hex) {
+            out << *fmt++;
+            continue;
+        }
+
+        fmt += hex ? 3 : 2;
+
+        auto tag = static_cast< log_arg >(tags & 0xf);
+        tags >>= 4;
+
+        if (hex) {
+            out << ecl::hex;
+        }
+
+        switch (tag) {
+        case log_arg::i32:
+            out << static_cast< int32_t >(read(1));
+            break;
+        case log_arg::u32:
+            out << static_cast< uint32_t >(read(1));
+            break;
+        case log_arg::i64:
+            out << static_cast< long long >(read(2));
+            break;
+        case log_arg::u64:
+            out << static_cast< unsigned long long >(read(2));
+            break;
+        case log_arg::chr:
+            out << static_cast< char >(read(1));
+            break;
+        case log_arg::boolean:
+            out << static_cast< bool >(read(1));
+            break;
+        case log_arg::str:
+            out << reinterpret_cast< const char* >(static_cast< uintptr_t >(read(ptr_words)));
+            break;
+        case log_arg::ptr:
+            out << reinterpret_cast< const void* >(static_cast< uintptr_t >(read(ptr_words)));
+            break;
+        case log_arg::none:
+            // More placeholders than arguments
+            out << "{?}";
+            break;
+        }
+
+        if (hex) {
+            out << ecl::dec;
+        }
+    }
+
+    out << ecl::endl;
+}
+
+} // namespace ecl
+
+#endif // LIB_LOG_LOG_HPP_
@@ -0,0 +1,92 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Cost of a log call: deferred record against direct stream output.
+
+#include <ecl/log.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+static constexpr auto iterations = 100000;
+
+// Discards everything, so only formatting cost is measured.
+// Real console device will be much slower.
+struct null_device
+{
+    ssize_t write(const uint8_t *buf, size_t size)
+    {
+        (void)buf;
+        return size;
+    }
+};
+
+// Timestamp in CPU cycles, if available, nanoseconds otherwise
+static uint64_t now()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast< std::chrono::nanoseconds >(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+TEST_GROUP(log_bench)
+{
+};
+
+TEST(log_bench, call_cost)
+{
+    ecl::log_ring< 4096 > ring;
+    null_device dev;
+    ecl::ostream< null_device > out{&dev};
+
+    uint64_t deferred = 0;
+    uint64_t direct = 0;
+    uint64_t drain = 0;
+
+    for (int i = 0; i < iterations; ++i) {
+        auto start = now();
+        ring.record("block {} read, status {x}, retries {}", i, 0x5u, 2);
+        deferred += now() - start;
+
+        start = now();
+        out << "block " << i << " read, status " << ecl::hex << 0x5u
+            << ecl::dec << ", retries " << 2 << ecl::endl;
+        direct += now() - start;
+
+        // Drain is done out of the caller's context, measured separately
+        start = now();
+        ring.drain(out);
+        drain += now() - start;
+    }
+
+#if defined(__x86_64__) || defined(__i386__)
+    const char *unit = "cycles";
+#else
+    const char *unit = "ns";
+#endif
+
+    std::cout << "\n\nLog call cost, " << unit << " per call\n"
+              << std::setw(28) << "deferred record: " << deferred / iterations << '\n'
+              << std::setw(28) << "direct ecl::ostream: " << direct / iterations << '\n'
+              << std::setw(28) << "drain (deferred format): " << drain / iterations << '\n';
+
+    CHECK_EQUAL(0, ring.dropped());
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
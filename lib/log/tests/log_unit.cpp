@@ -0,0 +1,252 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <ecl/log.hpp>
+
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+// Collects everything written to it
+struct string_device
+{
+    std::string str;
+    size_t writes = 0;
+
+    ssize_t write(const uint8_t *buf, size_t size)
+    {
+        str.append(reinterpret_cast< const char* >(buf), size);
+        writes++;
+        return size;
+    }
+
+    std::vector< uint32_t > words() const
+    {
+        std::vector< uint32_t > w(str.size() / sizeof(uint32_t));
+        std::memcpy(w.data(), str.data(), w.size() * sizeof(uint32_t));
+        return w;
+    }
+};
+
+using test_ring = ecl::log_ring< 256 >;
+using test_stream = ecl::ostream< string_device >;
+
+TEST_GROUP(log)
+{
+    test_ring       *ring;
+    string_device   dev;
+    test_stream     *out;
+
+    void setup()
+    {
+        ring = new test_ring;
+        out = new test_stream{&dev};
+    }
+
+    void teardown()
+    {
+        delete out;
+        delete ring;
+    }
+};
+
+TEST(log, nothing_to_drain)
+{
+    CHECK_EQUAL(0, ring->drain(*out));
+    CHECK_EQUAL("", dev.str);
+}
+
+TEST(log, format_arguments)
+{
+    CHECK_TRUE(ring->record("Value {} and {x}", 42, 0xbeefu));
+    CHECK_EQUAL("", dev.str);
+
+    CHECK_EQUAL(1, ring->drain(*out));
+    CHECK_EQUAL("Value 42 and beef\n\r", dev.str);
+}
+
+TEST(log, all_argument_types)
+{
+    static const char name[] = "sdspi";
+    auto ptr = reinterpret_cast< const void* >(static_cast< uintptr_t >(0x2000));
+
+    ring->record("{} {} {} {} {}", -1, 4000000000u, LLONG_MIN, ULLONG_MAX, 'c');
+    ring->record("{} {} {} {x}", true, false, name, -1);
+    ring->record("{}", ptr);
+
+    std::stringstream ss;
+    ss << "-1 4000000000 " << LLONG_MIN << ' ' << ULLONG_MAX << " c\n\r"
+       << "true false sdspi ffffffff\n\r"
+       << "0x" << std::string(sizeof(void*) * 2 - 4, '0') << "2000\n\r";
+
+    CHECK_EQUAL(3, ring->drain(*out));
+    CHECK_EQUAL(ss.str(), dev.str);
+}
+
+TEST(log, placeholders)
+{
+    ring->record("{{}} {} {}", 1);
+
+    ring->drain(*out);
+    CHECK_EQUAL("{}} 1 {?}\n\r", dev.str);
+}
+
+TEST(log, drain_limit)
+{
+    for (int i = 0; i < 3; ++i) {
+        ring->record("record {}", i);
+    }
+
+    CHECK_EQUAL(2, ring->drain(*out, 2));
+    CHECK_EQUAL("record 0\n\rrecord 1\n\r", dev.str);
+
+    CHECK_EQUAL(1, ring->drain(*out));
+    CHECK_EQUAL("record 0\n\rrecord 1\n\rrecord 2\n\r", dev.str);
+}
+
+TEST(log, overflow_is_reported)
+{
+    size_t placed = 0;
+
+    while (ring->record("record {}", static_cast< int >(placed))) {
+        placed++;
+    }
+
+    CHECK_TRUE(placed > 0);
+    CHECK_FALSE(ring->record("lost {}", 0));
+    CHECK_EQUAL(2, ring->dropped());
+
+    // Drop notification goes first
+    CHECK_EQUAL(placed + 1, ring->drain(*out));
+    CHECK_EQUAL(0, ring->dropped());
+    CHECK_EQUAL(0, dev.str.find("<2 messages dropped>\n\rrecord 0\n\r"));
+
+    // Space is available again
+    CHECK_TRUE(ring->record("record"));
+}
+
+TEST(log, wrap_around)
+{
+    // Different record sizes move records across the end of the ring
+    for (int i = 0; i < 500; ++i) {
+        dev.str.clear();
+
+        ring->record("{}", i);
+        if (i % 3) {
+            ring->record("{} {} {}", i, static_cast< long long >(i) << 32, "str");
+        }
+
+        ring->drain(*out);
+
+        std::stringstream ss;
+        ss << i << "\n\r";
+        if (i % 3) {
+            ss << i << ' ' << (static_cast< long long >(i) << 32) << " str\n\r";
+        }
+
+        CHECK_EQUAL(ss.str(), dev.str);
+    }
+
+    CHECK_EQUAL(0, ring->dropped());
+}
+
+TEST(log, raw_layout)
+{
+    static const char fmt[] = "{} {}";
+
+    ring->record(fmt, 7, 'a');
+    CHECK_EQUAL(1, ring->drain_raw(dev));
+
+    auto w = dev.words();
+    auto ptr_words = sizeof(uintptr_t) / sizeof(uint32_t);
+
+    CHECK_EQUAL(4 + ptr_words, w.size());
+    // Message of two arguments, length in words
+    CHECK_EQUAL(0x01020000u | w.size(), w[0]);
+    // Tags: i32, chr
+    CHECK_EQUAL(0x51u, w[1]);
+
+    uint64_t addr = w[2];
+    if (ptr_words > 1) {
+        addr |= static_cast< uint64_t >(w[3]) << 32;
+    }
+
+    CHECK_EQUAL(reinterpret_cast< uintptr_t >(fmt), addr);
+    CHECK_EQUAL(7u, w[2 + ptr_words]);
+    CHECK_EQUAL('a', w[3 + ptr_words]);
+}
+
+//------------------------------------------------------------------------------
+
+static constexpr int producers = 4;
+static constexpr int records_per_producer = 20000;
+
+TEST(log, concurrent_producers)
+{
+    ecl::log_ring< 1024 > shared;
+    std::atomic< int > done{0};
+    std::vector< std::thread > trs;
+
+    for (int id = 0; id < producers; ++id) {
+        trs.emplace_back([&shared, &done, id] {
+            for (int seq = 0; seq < records_per_producer; ++seq) {
+                shared.record("{} {}", id, seq);
+            }
+            done++;
+        });
+    }
+
+    string_device raw;
+    while (done != producers) {
+        shared.drain_raw(raw);
+    }
+
+    shared.drain_raw(raw);
+
+    for (auto &t : trs) {
+        t.join();
+    }
+
+    // Check that no record is torn and order of each producer is preserved
+    auto w = raw.words();
+    auto ptr_words = sizeof(uintptr_t) / sizeof(uint32_t);
+    int last[producers] = { -1, -1, -1, -1 };
+    size_t received = 0;
+    size_t dropped = 0;
+
+    for (size_t i = 0; i < w.size(); i += w[i] & 0xffff) {
+        auto kind = static_cast< ecl::log_record >(w[i] >> 24);
+
+        if (kind == ecl::log_record::dropped) {
+            dropped += w[i + 1];
+            continue;
+        }
+
+        CHECK_TRUE(kind == ecl::log_record::msg);
+        CHECK_EQUAL(0x11u, w[i + 1]);
+
+        auto id = w[i + 2 + ptr_words];
+        auto seq = static_cast< int >(w[i + 3 + ptr_words]);
+
+        CHECK_TRUE(id < producers);
+        CHECK_TRUE(seq > last[id]);
+        last[id] = seq;
+        received++;
+    }
+
+    CHECK_EQUAL(producers * records_per_producer, received + dropped);
+    CHECK_TRUE(received > 0);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
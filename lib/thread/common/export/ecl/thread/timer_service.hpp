@@ -0,0 +1,363 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Software timers, based on hierarchical timing wheel.
+//! \details Service is driven by periodic ticks, e.g. from the system timer
+//! handler. Timer callbacks are executed by the consumer of the work queue,
+//! thus never in ISR context.
+
+#ifndef LIB_THREAD_TIMER_SERVICE_HPP_
+#define LIB_THREAD_TIMER_SERVICE_HPP_
+
+#include <ecl/thread/work_queue.hpp>
+#include <ecl/thread/mutex.hpp>
+#include <ecl/list.hpp>
+#include <ecl/err.hpp>
+#include <ecl/assert.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace ecl
+{
+
+class timer_service;
+
+//! Software timer.
+//! \details Timer is owned by the user and must be stopped before
+//! it is destroyed.
+class timer
+{
+public:
+    //! Timer callback. Called in context of the work queue consumer.
+    using callback = work_item::routine;
+
+    //! Constructs inactive timer.
+    //! \param[in] fn  Timer callback.
+    //! \param[in] arg Callback argument.
+    timer(callback fn, void *arg = nullptr);
+
+    //! Checks if timer is started and not yet expired.
+    //! \details Periodic timer is active until it is stopped.
+    bool active() const { return m_node.linked(); }
+
+    timer(const timer&)             = delete;
+    timer& operator=(const timer&)  = delete;
+
+private:
+    friend class timer_service;
+
+    list_node   m_node;     //!< Link in the wheel slot.
+    work_item   m_work;     //!< Posted when timer expires.
+    uint32_t    m_expires;  //!< Tick, at which timer expires.
+    uint32_t    m_period;   //!< Period in ticks. Zero for one-shot timer.
+};
+
+//! Hierarchical timing wheel.
+//! \details Timers are placed into slots of the wheel according to their
+//! expiration tick. Each level of the wheel covers range of the previous one
+//! in each of its slots. Both start and stop take constant time. On a tick,
+//! only one slot is inspected, except when lower level wraps: then timers
+//! of the next level slot are moved closer to the ground.
+//!
+//! Wheel of 4 levels, 64 slots each, covers 2^24 ticks. Longer delays are
+//! supported as well, such timers are rescheduled upon reaching last slot.
+//!
+//! Callback is executed by posting work item of the timer to the queue.
+//! Callback of the stopped timer still can be executed once, if timer has
+//! expired right before it was stopped.
+//!
+//! Usage with system timer:
+//! \code
+//! static ecl::work_queue wq;
+//! static ecl::work_thread worker{wq};
+//! static ecl::timer_service timers{wq,
+//!         std::chrono::milliseconds(1000 / THECORE_CONFIG_SYSTMR_FREQ)};
+//!
+//! extern "C" void systmr_handler()
+//! {
+//!     timers.tick();
+//! }
+//!
+//! static ecl::timer blink{[](void *) { ... }};
+//!
+//! worker.start();
+//! ecl::systmr::enable();
+//! timers.start(blink, std::chrono::milliseconds(500),
+//!              std::chrono::milliseconds(500));
+//! \endcode
+//!
+//! On host, service can be driven by std::chrono clock with advance_to().
+class timer_service
+{
+public:
+    //! Time units of the service.
+    using duration = std::chrono::microseconds;
+
+    //! Slot index width, in bits.
+    static constexpr unsigned slot_bits = 6;
+
+    //! Amount of wheel levels.
+    static constexpr unsigned levels = 4;
+
+    //! Ticks covered by the wheel.
+    static constexpr uint32_t range = 1u << (slot_bits * levels);
+
+    //! Constructs timer service.
+    //! \param[in] q    Queue to execute callbacks.
+    //! \param[in] tick Tick period. Must be positive.
+    timer_service(work_queue &q, duration tick);
+
+    //! Starts or restarts the timer.
+    //! \details Not callable from ISR. Callable from timer callbacks.
+    //! Delays are rounded up to the whole ticks.
+    //! \param[in] t      Timer to start.
+    //! \param[in] delay  Time before the first expiration. Timer expires not
+    //!                   earlier than on the first tick after the call.
+    //! \param[in] period Period of the timer. Zero means one-shot timer.
+    //! \retval err::ok Timer is started.
+    err start(timer &t, duration delay, duration period = duration::zero());
+
+    //! Stops the timer.
+    //! \details Not callable from ISR. Callable from timer callbacks.
+    //! \retval err::ok   Timer is stopped.
+    //! \retval err::srch Timer is not active.
+    err stop(timer &t);
+
+    //! Advances time of the service.
+    //! \details Callable from ISR. Ticks are processed by the queue consumer.
+    //! \param[in] n Amount of ticks passed.
+    void tick(uint32_t n = 1);
+
+    //! Advances time of the service up to given point.
+    //! \details Useful to drive the service by std::chrono clock.
+    //! Must be called by single driver only, not along with tick().
+    //! \param[in] elapsed Time elapsed since the service start.
+    void advance_to(duration elapsed);
+
+    //! Gets tick period.
+    duration tick_period() const { return m_tick; }
+
+    //! Gets amount of expirations, which callback was not executed,
+    //! because callback of the previous one was still pending.
+    uint32_t overruns() const { return m_overruns.load(std::memory_order_relaxed); }
+
+    timer_service(const timer_service&)             = delete;
+    timer_service& operator=(const timer_service&)  = delete;
+
+private:
+    //! Slot of the wheel.
+    using slot = list<timer, &timer::m_node>;
+
+    //! Amount of slots in the level.
+    static constexpr uint32_t slots = 1u << slot_bits;
+
+    //! Slot index mask.
+    static constexpr uint32_t slot_mask = slots - 1;
+
+    //! Converts duration to ticks, rounding up.
+    uint32_t to_ticks(duration d) const;
+
+    //! Places timer into the wheel, according to its expiration tick.
+    void insert(timer &t);
+
+    //! Moves all timers from the slot to lower levels.
+    void cascade(slot &s);
+
+    //! Processes pending ticks. Work routine of the service.
+    static void process(void *arg);
+
+    work_queue              &m_queue;               //!< Queue to post callbacks.
+    const duration          m_tick;                 //!< Tick period.
+    mutex                   m_lock;                 //!< Protects the wheel.
+    work_item               m_work;                 //!< Posted on tick.
+    std::atomic<uint32_t>   m_pending;              //!< Ticks to process.
+    std::atomic<uint32_t>   m_overruns;             //!< Callbacks not executed.
+    uint32_t                m_now;                  //!< Next tick to process.
+    uint32_t                m_driven;               //!< Ticks issued by advance_to().
+    uint32_t                m_active;               //!< Timers in the wheel.
+    slot                    m_wheel[levels][slots]; //!< Timer slots.
+};
+
+//------------------------------------------------------------------------------
+
+inline timer::timer(callback fn, void *arg)
+    :m_node{}
+    ,m_work{fn, arg}
+    ,m_expires{0}
+    ,m_period{0}
+{
+}
+
+//------------------------------------------------------------------------------
+
+inline timer_service::timer_service(work_queue &q, duration tick)
+    :m_queue{q}
+    ,m_tick{tick}
+    ,m_lock{}
+    ,m_work{process, this}
+    ,m_pending{0}
+    ,m_overruns{0}
+    ,m_now{0}
+    ,m_driven{0}
+    ,m_active{0}
+    ,m_wheel{}
+{
+    ecl_assert(tick > duration::zero());
+}
+
+inline err timer_service::start(timer &t, duration delay, duration period)
+{
+    ecl_assert(delay >= duration::zero() && period >= duration::zero());
+
+    auto ticks = to_ticks(delay);
+
+    m_lock.lock();
+
+    if (t.active()) {
+        t.m_node.unlink();
+    } else {
+        m_active++;
+    }
+
+    // Count from the latest tick, even if it is not yet processed
+    t.m_expires = m_now + m_pending.load() + ticks - 1;
+    t.m_period = period > duration::zero() ? to_ticks(period) : 0;
+    insert(t);
+
+    m_lock.unlock();
+    return err::ok;
+}
+
+inline err timer_service::stop(timer &t)
+{
+    err rc = err::srch;
+
+    m_lock.lock();
+
+    if (t.active()) {
+        t.m_node.unlink();
+        m_active--;
+        rc = err::ok;
+    }
+
+    m_lock.unlock();
+    return rc;
+}
+
+inline void timer_service::tick(uint32_t n)
+{
+    if (n) {
+        m_pending.fetch_add(n);
+        m_queue.post(m_work);
+    }
+}
+
+inline void timer_service::advance_to(duration elapsed)
+{
+    auto target = static_cast<uint32_t>(elapsed.count() / m_tick.count());
+
+    tick(target - m_driven);
+    m_driven = target;
+}
+
+inline uint32_t timer_service::to_ticks(duration d) const
+{
+    auto ticks = (d.count() + m_tick.count() - 1) / m_tick.count();
+
+    if (ticks < 1) {
+        return 1;
+    } else if (ticks > INT32_MAX) {
+        return INT32_MAX;
+    }
+
+    return ticks;
+}
+
+inline void timer_service::insert(timer &t)
+{
+    uint32_t delta = t.m_expires - m_now;
+    uint32_t at = t.m_expires;
+
+    // Too long delay: timer is parked in the last slot and rescheduled
+    // when it is cascaded
+    if (delta >= range) {
+        delta = range - 1;
+        at = m_now + delta;
+    }
+
+    unsigned level = 0;
+    while (level < levels - 1 && (delta >> ((level + 1) * slot_bits))) {
+        level++;
+    }
+
+    m_wheel[level][(at >> (level * slot_bits)) & slot_mask].push_back(t);
+}
+
+inline void timer_service::cascade(slot &s)
+{
+    while (!s.empty()) {
+        auto &t = *s.begin();
+        t.m_node.unlink();
+        insert(t);
+    }
+}
+
+inline void timer_service::process(void *arg)
+{
+    auto self = static_cast<timer_service *>(arg);
+
+    // Drain pending ticks under the lock, so start() always finds them
+    // either in m_pending or in m_now
+    self->m_lock.lock();
+
+    auto n = self->m_pending.exchange(0);
+
+    while (n--) {
+        auto &now = self->m_now;
+
+        // Nothing to expire, skip the rest at once
+        if (!self->m_active) {
+            now += n + 1;
+            break;
+        }
+
+        // Upper level slot is cascaded when the lower level wraps
+        uint32_t idx = now & slot_mask;
+        for (unsigned level = 1; !idx && level < levels; ++level) {
+            idx = (now >> (level * slot_bits)) & slot_mask;
+            self->cascade(self->m_wheel[level][idx]);
+        }
+
+        auto &expired = self->m_wheel[0][now & slot_mask];
+
+        while (!expired.empty()) {
+            auto &t = *expired.begin();
+            ecl_assert(t.m_expires == now);
+
+            t.m_node.unlink();
+
+            if (t.m_period) {
+                t.m_expires += t.m_period;
+                self->insert(t);
+            } else {
+                self->m_active--;
+            }
+
+            if (!self->m_queue.post(t.m_work)) {
+                self->m_overruns.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        now++;
+    }
+
+    self->m_lock.unlock();
+}
+
+} // namespace ecl
+
+#endif // LIB_THREAD_TIMER_SERVICE_HPP_
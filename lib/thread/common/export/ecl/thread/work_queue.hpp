@@ -0,0 +1,194 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Deferred work queue.
+//! \details Allows to move work out of ISR: handler posts preallocated work
+//! item and returns, the work is executed later in thread context.
+//!
+//! Queue is built on top of the semaphore of the selected thread backend,
+//! so it is available with FreeRTOS, host (POSIX) and without OS at all.
+//! In the latter case queue is drained by the main loop with run_pending().
+//! With OS, ecl::work_thread can be used as a worker.
+
+#ifndef LIB_THREAD_WORK_QUEUE_HPP_
+#define LIB_THREAD_WORK_QUEUE_HPP_
+
+#include <ecl/thread/semaphore.hpp>
+#include <ecl/assert.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+namespace ecl
+{
+
+class work_queue;
+
+//! Deferred work item.
+//! \details Item is owned by the user and usually embedded into the object,
+//! that produces the work. Item must outlive any queue it is posted to.
+class work_item
+{
+public:
+    //! Work routine. Called in context of the queue consumer.
+    using routine = void (*)(void *arg);
+
+    //! Constructs work item.
+    //! \param[in] fn  Work routine.
+    //! \param[in] arg Routine argument.
+    work_item(routine fn, void *arg = nullptr);
+
+    //! Checks if item is queued and not yet started.
+    bool queued() const { return m_queued.load(std::memory_order_relaxed); }
+
+    work_item(const work_item&)             = delete;
+    work_item& operator=(const work_item&)  = delete;
+
+private:
+    friend class work_queue;
+
+    routine             m_fn;       //!< Work routine.
+    void                *m_arg;     //!< Routine argument.
+    work_item           *m_next;    //!< Next item in the queue.
+    std::atomic_bool    m_queued;   //!< Item is in the queue.
+};
+
+//! Multiple producer, single consumer queue of deferred work.
+//! \details Posting is lock-free and does not allocate, thus can be done
+//! from ISR. Items posted from the same context are executed in order.
+//!
+//! Queue is a singly linked list of items, pushed with compare-and-swap.
+//! Consumer detaches the whole list at once, so producers and consumer never
+//! contend for the same item and there is no ABA problem.
+//!
+//! Usage without OS:
+//! \code
+//! static ecl::work_queue wq;
+//! static ecl::work_item rx_done{[](void *) { ... }};
+//!
+//! void bus_handler(...)       // ISR context
+//! {
+//!     wq.post(rx_done);
+//! }
+//!
+//! for (;;) {                  // Main loop
+//!     wq.run_pending();
+//! }
+//! \endcode
+class work_queue
+{
+public:
+    //! Constructs empty queue.
+    work_queue();
+
+    //! Posts work item.
+    //! \details Callable from ISR. Item that is already queued is not queued
+    //! twice: its routine will be executed once. Item can be posted again
+    //! as soon as its routine is started, including from the routine itself.
+    //! \param[in] item Item to post.
+    //! \retval true  Item is queued.
+    //! \retval false Item is already queued.
+    bool post(work_item &item);
+
+    //! Executes all pending items in the caller context.
+    //! \details Must be called by single consumer only.
+    //! Items posted during execution are left for the next call.
+    //! \return Amount of executed items.
+    size_t run_pending();
+
+    //! Waits until work is posted.
+    //! \details Might return spuriously with no work pending.
+    void wait() { m_sem.wait(); }
+
+    //! Waits until work is posted, with timeout.
+    //! \param[in] ms Milliseconds to wait.
+    //! \retval true  Work might be pending.
+    //! \retval false Timeout hit.
+    bool wait(std::chrono::milliseconds ms) { return m_sem.try_wait(ms); }
+
+    //! Checks if any item is pending.
+    bool empty() const { return !m_head.load(std::memory_order_relaxed); }
+
+    work_queue(const work_queue&)             = delete;
+    work_queue& operator=(const work_queue&)  = delete;
+
+private:
+    std::atomic<work_item *>    m_head;     //!< Most recently posted item.
+    binary_semaphore            m_sem;      //!< Signalled when queue is filled.
+};
+
+//------------------------------------------------------------------------------
+
+inline work_item::work_item(routine fn, void *arg)
+    :m_fn{fn}
+    ,m_arg{arg}
+    ,m_next{nullptr}
+    ,m_queued{false}
+{
+    ecl_assert(fn);
+}
+
+inline work_queue::work_queue()
+    :m_head{nullptr}
+    ,m_sem{}
+{
+}
+
+inline bool work_queue::post(work_item &item)
+{
+    if (item.m_queued.exchange(true, std::memory_order_acquire)) {
+        return false;
+    }
+
+    auto head = m_head.load(std::memory_order_relaxed);
+
+    do {
+        item.m_next = head;
+    } while (!m_head.compare_exchange_weak(head, &item,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed));
+
+    // Consumer is woken up only when queue becomes non-empty. It will
+    // pick up the rest of the items along with the first one.
+    if (!head) {
+        m_sem.signal();
+    }
+
+    return true;
+}
+
+inline size_t work_queue::run_pending()
+{
+    auto list = m_head.exchange(nullptr, std::memory_order_acquire);
+
+    // List is in reverse order of posting
+    work_item *fifo = nullptr;
+
+    while (list) {
+        auto next = list->m_next;
+        list->m_next = fifo;
+        fifo = list;
+        list = next;
+    }
+
+    size_t done = 0;
+
+    while (fifo) {
+        auto item = fifo;
+        fifo = item->m_next;
+
+        // Since now item can be posted again and its link is overwritten
+        item->m_queued.store(false, std::memory_order_release);
+        item->m_fn(item->m_arg);
+        done++;
+    }
+
+    return done;
+}
+
+} // namespace ecl
+
+#endif // LIB_THREAD_WORK_QUEUE_HPP_
@@ -0,0 +1,134 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Worker thread of the deferred work queue.
+//! \details Requires thread backend with native_thread support:
+//! FreeRTOS or host (POSIX).
+
+#ifndef LIB_THREAD_WORK_THREAD_HPP_
+#define LIB_THREAD_WORK_THREAD_HPP_
+
+#include <ecl/thread/work_queue.hpp>
+#include <ecl/thread/thread.hpp>
+#include <ecl/err.hpp>
+
+#include <atomic>
+
+namespace ecl
+{
+
+//! Thread that executes work posted to the queue.
+//! \details Usage:
+//! \code
+//! static ecl::work_queue wq;
+//! static ecl::work_thread worker{wq};
+//!
+//! worker.thread().set_name("work");
+//! worker.start();
+//!
+//! // In ISR
+//! wq.post(item);
+//! \endcode
+class work_thread
+{
+public:
+    //! Constructs worker for the queue.
+    //! \param[in] q Queue to drain. Worker must be the only consumer.
+    explicit work_thread(work_queue &q);
+
+    //! Stops the worker, if it is running.
+    ~work_thread();
+
+    //! Starts the worker.
+    //! \retval err::busy Worker is already running.
+    //! \retval err       Any error of the thread start.
+    err start();
+
+    //! Stops the worker.
+    //! \details Work posted before this call is executed first.
+    //! Not callable from the work routine.
+    //! \retval err::srch Worker is not running.
+    err stop();
+
+    //! Gets the underlying thread, e.g. to set its name and stack size
+    //! before the start.
+    native_thread &thread() { return m_thread; }
+
+    work_thread(const work_thread&)             = delete;
+    work_thread& operator=(const work_thread&)  = delete;
+
+private:
+    //! Thread routine.
+    static err run(void *arg);
+
+    work_queue          &m_queue;   //!< Queue to drain.
+    native_thread       m_thread;   //!< Worker thread.
+    work_item           m_stop;     //!< Posted to stop the worker.
+    std::atomic_bool    m_running;  //!< Thread routine is looping.
+};
+
+//------------------------------------------------------------------------------
+
+inline work_thread::work_thread(work_queue &q)
+    :m_queue{q}
+    ,m_thread{}
+    ,m_stop{[](void *arg) { static_cast<work_thread *>(arg)->m_running = false; }, this}
+    ,m_running{false}
+{
+}
+
+inline work_thread::~work_thread()
+{
+    if (m_running) {
+        stop();
+    }
+}
+
+inline err work_thread::start()
+{
+    if (m_running) {
+        return err::busy;
+    }
+
+    m_running = true;
+
+    auto rc = m_thread.set_routine(run, this);
+    if (is_ok(rc)) {
+        rc = m_thread.start();
+    }
+
+    if (is_error(rc)) {
+        m_running = false;
+    }
+
+    return rc;
+}
+
+inline err work_thread::stop()
+{
+    if (!m_running) {
+        return err::srch;
+    }
+
+    m_queue.post(m_stop);
+    return m_thread.join();
+}
+
+inline err work_thread::run(void *arg)
+{
+    auto self = static_cast<work_thread *>(arg);
+
+    while (self->m_running) {
+        self->m_queue.wait();
+
+        while (self->m_running && self->m_queue.run_pending()) { }
+    }
+
+    return err::ok;
+}
+
+} // namespace ecl
+
+#endif // LIB_THREAD_WORK_THREAD_HPP_
@@ -0,0 +1,311 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Stackless cooperative tasks for projects without OS support.
+//! \details Without OS, blocking wait for a semaphore or a bus stalls the
+//! whole application. Cooperative task is a resumable function instead:
+//! it returns to the scheduler when it has to wait and continues from the
+//! same point on the next call. All tasks share the single stack, the only
+//! RAM needed per task is its control block.
+//!
+//! Since the stack is not preserved between calls, local variables of the
+//! task routine lose their values at every suspension point. State, that
+//! must survive, is kept in the object which embeds the task.
+//!
+//! Example:
+//! \code
+//! struct blinker
+//! {
+//!     static ecl::coop_state routine(ecl::coop_task &self)
+//!     {
+//!         auto b = static_cast<blinker *>(self.arg());
+//!
+//!         ECL_CO_BEGIN(self);
+//!
+//!         for (b->i = 0; b->i < 10; ++b->i) {
+//!             led::toggle();
+//!             ECL_CO_SLEEP(self, 500);
+//!         }
+//!
+//!         // Wait for the bus completion, signalled from bus handler
+//!         ECL_CO_AWAIT_SEM(self, b->xfer_done);
+//!
+//!         ECL_CO_END(self);
+//!     }
+//!
+//!     int                     i;
+//!     ecl::binary_semaphore   xfer_done;
+//!     ecl::coop_task          task{routine, this};
+//! };
+//! \endcode
+
+#ifndef LIB_THREAD_NO_OS_COOP_HPP_
+#define LIB_THREAD_NO_OS_COOP_HPP_
+
+#include <ecl/assert.h>
+
+#include <chrono>
+#include <cstdint>
+
+namespace ecl
+{
+
+//! Result of the cooperative task step.
+enum class coop_state : uint8_t
+{
+    ready,      //!< Task can continue immediately.
+    blocked,    //!< Task waits for condition, polled on every run.
+    sleeping,   //!< Task waits for its delay to pass.
+    done,       //!< Task is finished.
+};
+
+//! Control block of the stackless cooperative task.
+class coop_task
+{
+public:
+    //! Task routine. Must be written with ECL_CO_* macros.
+    using routine = coop_state (*)(coop_task &self);
+
+    //! Constructs task.
+    //! \param[in] fn  Task routine.
+    //! \param[in] arg Routine argument.
+    coop_task(routine fn, void *arg = nullptr);
+
+    //! Gets routine argument.
+    void *arg() const { return m_arg; }
+
+    //! Gets state after the last step.
+    coop_state state() const { return m_state; }
+
+    //! Gets point, from which routine is resumed. Used by ECL_CO_* macros.
+    uint16_t resume_point() const { return m_point; }
+
+    //! Sets point, from which routine is resumed. Used by ECL_CO_* macros.
+    void set_resume_point(uint16_t point) { m_point = point; }
+
+    //! Sets sleep duration. Used by ECL_CO_SLEEP().
+    void set_delay(std::chrono::milliseconds delay);
+
+    coop_task(const coop_task&)             = delete;
+    coop_task& operator=(const coop_task&)  = delete;
+
+private:
+    friend class coop_scheduler;
+
+    routine     m_fn;       //!< Task routine.
+    void        *m_arg;     //!< Routine argument.
+    coop_task   *m_next;    //!< Next task in the scheduler.
+    uint32_t    m_wake;     //!< Delay, then wake-up time, in milliseconds.
+    uint16_t    m_point;    //!< Resume point.
+    coop_state  m_state;    //!< Last step result.
+};
+
+//! Round-robin scheduler of cooperative tasks.
+//! \details Usage:
+//! \code
+//! ecl::coop_scheduler sched;
+//!
+//! sched.add(a.task);
+//! sched.add(b.task);
+//!
+//! while (!sched.idle()) {
+//!     auto now = current_time();
+//!     auto next = sched.run(now);
+//!
+//!     if (next > now) {
+//!         // Sleep until next, or until interrupt arrives
+//!         ecl::wfe();
+//!     }
+//! }
+//! \endcode
+class coop_scheduler
+{
+public:
+    //! Time units of the scheduler.
+    using duration = std::chrono::milliseconds;
+
+    //! Constructs empty scheduler.
+    coop_scheduler();
+
+    //! Adds task to the end of the run queue.
+    //! \details Finished task can be added again, it will start over.
+    //! \pre Task is not in any scheduler.
+    void add(coop_task &t);
+
+    //! Steps every task, that can make progress, once.
+    //! \details Finished tasks are removed from the scheduler.
+    //! \param[in] now Current time. Time can wrap around, but delays must
+    //!                be shorter than 2^31 ms.
+    //! \return Time, when run() must be called next, unless interrupt has
+    //!         unblocked any task before. If it is equal to now, some task
+    //!         is ready. If no task is ready or sleeping, duration::max().
+    duration run(duration now);
+
+    //! Checks if all tasks are finished.
+    bool idle() const { return !m_head; }
+
+    coop_scheduler(const coop_scheduler&)             = delete;
+    coop_scheduler& operator=(const coop_scheduler&)  = delete;
+
+private:
+    coop_task   *m_head;    //!< First task in the run queue.
+    coop_task   *m_tail;    //!< Last task in the run queue.
+};
+
+//------------------------------------------------------------------------------
+
+inline coop_task::coop_task(routine fn, void *arg)
+    :m_fn{fn}
+    ,m_arg{arg}
+    ,m_next{nullptr}
+    ,m_wake{0}
+    ,m_point{0}
+    ,m_state{coop_state::ready}
+{
+    ecl_assert(fn);
+}
+
+inline void coop_task::set_delay(std::chrono::milliseconds delay)
+{
+    m_wake = delay.count();
+}
+
+//------------------------------------------------------------------------------
+
+inline coop_scheduler::coop_scheduler()
+    :m_head{nullptr}
+    ,m_tail{nullptr}
+{
+}
+
+inline void coop_scheduler::add(coop_task &t)
+{
+    ecl_assert(!t.m_next && &t != m_tail);
+
+    t.m_state = coop_state::ready;
+
+    if (m_tail) {
+        m_tail->m_next = &t;
+    } else {
+        m_head = &t;
+    }
+
+    m_tail = &t;
+}
+
+inline coop_scheduler::duration coop_scheduler::run(duration now)
+{
+    auto ms = static_cast<uint32_t>(now.count());
+    auto next = duration::max();
+
+    coop_task *prev = nullptr;
+    auto t = m_head;
+
+    while (t) {
+        auto following = t->m_next;
+
+        // Signed difference handles wraparound of the clock
+        int32_t left = t->m_wake - ms;
+
+        if (t->m_state == coop_state::sleeping && left > 0) {
+            if (now + duration{left} < next) {
+                next = now + duration{left};
+            }
+
+            prev = t;
+            t = following;
+            continue;
+        }
+
+        t->m_state = t->m_fn(*t);
+
+        switch (t->m_state) {
+        case coop_state::done:
+            if (prev) {
+                prev->m_next = following;
+            } else {
+                m_head = following;
+            }
+
+            if (m_tail == t) {
+                m_tail = prev;
+            }
+
+            t->m_next = nullptr;
+            t = following;
+            continue;
+        case coop_state::sleeping: {
+            // Delay is converted to the wake-up time
+            auto delay = duration{t->m_wake};
+            t->m_wake += ms;
+
+            if (now + delay < next) {
+                next = now + delay;
+            }
+            break;
+        }
+        case coop_state::ready:
+            next = now;
+            break;
+        case coop_state::blocked:
+        default:
+            break;
+        }
+
+        prev = t;
+        t = following;
+    }
+
+    return next;
+}
+
+} // namespace ecl
+
+//------------------------------------------------------------------------------
+
+//! Starts the body of the task routine.
+//! \details Routine body is a switch statement, thus suspension points
+//! must not be placed inside other switch statements, and only one
+//! suspension point is allowed per line.
+#define ECL_CO_BEGIN(task) \
+    switch ((task).resume_point()) { case 0:
+
+//! Ends the body of the task routine.
+#define ECL_CO_END(task) \
+    } (task).set_resume_point(0); return ::ecl::coop_state::done
+
+//! Returns control to the scheduler, continues on the next run.
+#define ECL_CO_YIELD(task) \
+    do { \
+        (task).set_resume_point(__LINE__); \
+        return ::ecl::coop_state::ready; \
+        case __LINE__:; \
+    } while (0)
+
+//! Suspends the task until condition becomes true.
+//! \details Condition is checked immediately and then on every run.
+#define ECL_CO_AWAIT(task, cond) \
+    do { \
+        while (!(cond)) { \
+            (task).set_resume_point(__LINE__); \
+            return ::ecl::coop_state::blocked; \
+            case __LINE__:; \
+        } \
+    } while (0)
+
+//! Suspends the task until semaphore is signalled, e.g. from ISR.
+#define ECL_CO_AWAIT_SEM(task, sem) \
+    ECL_CO_AWAIT(task, (sem).try_wait())
+
+//! Suspends the task for given amount of milliseconds.
+#define ECL_CO_SLEEP(task, ms) \
+    do { \
+        (task).set_delay(std::chrono::milliseconds(ms)); \
+        (task).set_resume_point(__LINE__); \
+        return ::ecl::coop_state::sleeping; \
+        case __LINE__:; \
+    } while (0)
+
+#endif // LIB_THREAD_NO_OS_COOP_HPP_
@@ -0,0 +1,117 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Switch cost and RAM per task: cooperative tasks against threads.
+//! \details FreeRTOS can't be run on host, so preemptive switch is measured
+//! with host threads. On MCU it is cheaper, but still involves saving
+//! of the whole register set and a separate stack per task.
+
+#include <ecl/thread/coop.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+using clock_type = std::chrono::steady_clock;
+
+static constexpr auto switches = 1000000;
+
+// Default stack of ecl::native_thread on FreeRTOS, see freertos/thread.cpp.
+// Kernel task control block comes on top of it.
+static constexpr auto freertos_stack = 512;
+
+// Two tasks pass the turn to each other
+struct ping_pong
+{
+    static ecl::coop_state routine(ecl::coop_task &self)
+    {
+        auto p = static_cast<ping_pong *>(self.arg());
+
+        ECL_CO_BEGIN(self);
+
+        for (p->i = 0; p->i < switches / 2; ++p->i) {
+            ECL_CO_AWAIT(self, *p->turn == p->id);
+            *p->turn = !p->id;
+        }
+
+        ECL_CO_END(self);
+    }
+
+    ping_pong(int *t, int n) :turn{t}, id{n} { }
+
+    int             *turn;
+    int             id;
+    int             i = 0;
+    ecl::coop_task  task{routine, this};
+};
+
+TEST_GROUP(coop_bench)
+{
+};
+
+TEST(coop_bench, switch_cost_and_ram)
+{
+    // Cooperative tasks
+    int turn = 0;
+    ping_pong a{&turn, 0}, b{&turn, 1};
+    ecl::coop_scheduler sched;
+
+    sched.add(a.task);
+    sched.add(b.task);
+
+    auto start = clock_type::now();
+
+    while (!sched.idle()) {
+        sched.run(std::chrono::milliseconds{0});
+    }
+
+    auto coop_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock_type::now() - start).count();
+
+    // Host threads
+    std::mutex lock;
+    std::condition_variable cv;
+    int thread_turn = 0;
+
+    auto player = [&](int id) {
+        for (int i = 0; i < switches / 20; ++i) {
+            std::unique_lock<std::mutex> l{lock};
+            cv.wait(l, [&] { return thread_turn == id; });
+            thread_turn = !id;
+            cv.notify_one();
+        }
+    };
+
+    start = clock_type::now();
+
+    std::thread t1{player, 0};
+    std::thread t2{player, 1};
+    t1.join();
+    t2.join();
+
+    auto thread_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock_type::now() - start).count();
+
+    std::cout << "\n\nTask switch, ns\n"
+              << std::setw(32) << "cooperative task: " << coop_ns / switches << '\n'
+              << std::setw(32) << "host thread: " << thread_ns / (switches / 10) << '\n'
+              << "RAM per task, bytes\n"
+              << std::setw(32) << "cooperative task: " << sizeof(ecl::coop_task) << '\n'
+              << std::setw(32) << "FreeRTOS task stack: " << freertos_stack << " + TCB\n";
+
+    CHECK_EQUAL(switches / 2, a.i);
+    CHECK_EQUAL(switches / 2, b.i);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
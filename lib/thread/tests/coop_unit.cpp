@@ -0,0 +1,289 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <ecl/thread/coop.hpp>
+#include <ecl/thread/semaphore.hpp>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+#include <string>
+
+using std::chrono::milliseconds;
+
+//------------------------------------------------------------------------------
+
+// Appends its name to the log, yielding in between
+struct yielder
+{
+    static ecl::coop_state routine(ecl::coop_task &self)
+    {
+        auto y = static_cast<yielder *>(self.arg());
+
+        ECL_CO_BEGIN(self);
+
+        for (y->i = 0; y->i < 3; ++y->i) {
+            *y->log += y->name;
+            ECL_CO_YIELD(self);
+        }
+
+        ECL_CO_END(self);
+    }
+
+    yielder(std::string &l, char n) :log{&l}, name{n} { }
+
+    std::string     *log;
+    char            name;
+    int             i = 0;
+    ecl::coop_task  task{routine, this};
+};
+
+// Emulation of the bus with fixed xfer time. Completion is signalled from
+// the "interrupt", raised by the simulated clock.
+struct sim_bus
+{
+    void start(milliseconds now, ecl::binary_semaphore &done)
+    {
+        ecl_assert(!busy);
+        busy = true;
+        done_at = now + xfer_time;
+        sem = &done;
+    }
+
+    void irq(milliseconds now)
+    {
+        if (busy && now >= done_at) {
+            busy = false;
+            sem->signal();
+        }
+    }
+
+    const milliseconds      xfer_time{2};
+    bool                    busy = false;
+    milliseconds            done_at{0};
+    ecl::binary_semaphore   *sem = nullptr;
+};
+
+static milliseconds clock_now;
+static sim_bus bus;
+
+// Driver, that starts xfer, waits for its completion, then waits
+// for the conversion
+struct driver
+{
+    static ecl::coop_state routine(ecl::coop_task &self)
+    {
+        auto d = static_cast<driver *>(self.arg());
+
+        ECL_CO_BEGIN(self);
+
+        for (d->samples = 0; d->samples < 5; ++d->samples) {
+            ECL_CO_AWAIT(self, !bus.busy);
+            bus.start(clock_now, d->done);
+            ECL_CO_AWAIT_SEM(self, d->done);
+
+            ECL_CO_SLEEP(self, d->conversion);
+        }
+
+        d->finished_at = clock_now;
+        ECL_CO_END(self);
+    }
+
+    explicit driver(int conv) :conversion{conv} { }
+
+    int                     conversion;
+    int                     samples = 0;
+    milliseconds            finished_at{0};
+    ecl::binary_semaphore   done;
+    ecl::coop_task          task{routine, this};
+};
+
+// Deterministic main loop: time moves straight to the next event
+static void run_all(ecl::coop_scheduler &sched)
+{
+    while (!sched.idle()) {
+        bus.irq(clock_now);
+
+        auto next = sched.run(clock_now);
+
+        if (!sched.idle() && next > clock_now) {
+            auto irq_at = bus.busy ? bus.done_at : milliseconds::max();
+            clock_now = std::min(next, irq_at);
+            ecl_assert(clock_now != milliseconds::max());
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(coop)
+{
+    void setup()
+    {
+        clock_now = milliseconds{0};
+        bus.busy = false;
+    }
+};
+
+TEST(coop, yield_interleaves_tasks)
+{
+    std::string log;
+    yielder a{log, 'a'}, b{log, 'b'};
+    ecl::coop_scheduler sched;
+
+    CHECK_TRUE(sched.idle());
+
+    sched.add(a.task);
+    sched.add(b.task);
+
+    CHECK_TRUE(sched.run(milliseconds{0}) == milliseconds{0});
+    STRCMP_EQUAL("ab", log.c_str());
+
+    sched.run(milliseconds{0});
+    sched.run(milliseconds{0});
+    STRCMP_EQUAL("ababab", log.c_str());
+    CHECK_FALSE(sched.idle());
+
+    // Tasks are finished after the last yield
+    CHECK_TRUE(sched.run(milliseconds{0}) == milliseconds::max());
+    CHECK_TRUE(sched.idle());
+    CHECK_TRUE(a.task.state() == ecl::coop_state::done);
+
+    // Finished task starts over
+    sched.add(a.task);
+    sched.run(milliseconds{0});
+    STRCMP_EQUAL("abababa", log.c_str());
+}
+
+TEST(coop, sleep)
+{
+    struct sleeper
+    {
+        static ecl::coop_state routine(ecl::coop_task &self)
+        {
+            auto s = static_cast<sleeper *>(self.arg());
+
+            ECL_CO_BEGIN(self);
+            s->steps++;
+            ECL_CO_SLEEP(self, 10);
+            s->steps++;
+            ECL_CO_SLEEP(self, 0);
+            s->steps++;
+            ECL_CO_END(self);
+        }
+
+        int             steps = 0;
+        ecl::coop_task  task{routine, this};
+    } s;
+
+    ecl::coop_scheduler sched;
+    sched.add(s.task);
+
+    CHECK_TRUE(sched.run(milliseconds{100}) == milliseconds{110});
+    CHECK_EQUAL(1, s.steps);
+    CHECK_TRUE(s.task.state() == ecl::coop_state::sleeping);
+
+    CHECK_TRUE(sched.run(milliseconds{109}) == milliseconds{110});
+    CHECK_EQUAL(1, s.steps);
+
+    // Zero sleep behaves like yield
+    CHECK_TRUE(sched.run(milliseconds{110}) == milliseconds{110});
+    CHECK_EQUAL(2, s.steps);
+
+    sched.run(milliseconds{110});
+    CHECK_EQUAL(3, s.steps);
+    CHECK_TRUE(sched.idle());
+}
+
+TEST(coop, sleep_across_clock_wraparound)
+{
+    struct sleeper
+    {
+        static ecl::coop_state routine(ecl::coop_task &self)
+        {
+            ECL_CO_BEGIN(self);
+            ECL_CO_SLEEP(self, 20);
+            ECL_CO_END(self);
+        }
+
+        ecl::coop_task  task{routine, this};
+    } s;
+
+    ecl::coop_scheduler sched;
+    sched.add(s.task);
+
+    const milliseconds start{UINT32_MAX - 9};
+
+    sched.run(start);
+    sched.run(milliseconds{5});
+    CHECK_FALSE(sched.idle());
+
+    sched.run(milliseconds{10});
+    CHECK_TRUE(sched.idle());
+}
+
+TEST(coop, await_semaphore_signalled_from_isr)
+{
+    struct waiter
+    {
+        static ecl::coop_state routine(ecl::coop_task &self)
+        {
+            auto w = static_cast<waiter *>(self.arg());
+
+            ECL_CO_BEGIN(self);
+            ECL_CO_AWAIT_SEM(self, w->sem);
+            w->woken = true;
+            ECL_CO_END(self);
+        }
+
+        bool                    woken = false;
+        ecl::binary_semaphore   sem;
+        ecl::coop_task          task{routine, this};
+    } w;
+
+    ecl::coop_scheduler sched;
+    sched.add(w.task);
+
+    // Blocked task does not set any deadline
+    CHECK_TRUE(sched.run(milliseconds{0}) == milliseconds::max());
+    CHECK_TRUE(w.task.state() == ecl::coop_state::blocked);
+    CHECK_FALSE(w.woken);
+
+    sched.run(milliseconds{1});
+    CHECK_FALSE(w.woken);
+
+    w.sem.signal();
+    sched.run(milliseconds{2});
+    CHECK_TRUE(w.woken);
+    CHECK_TRUE(sched.idle());
+}
+
+TEST(coop, drivers_share_bus_and_single_stack)
+{
+    driver fast{3}, slow{10};
+    ecl::coop_scheduler sched;
+
+    sched.add(fast.task);
+    sched.add(slow.task);
+
+    run_all(sched);
+
+    CHECK_EQUAL(5, fast.samples);
+    CHECK_EQUAL(5, slow.samples);
+
+    // Conversions overlap with xfers of the other driver: slow one
+    // is not delayed by the fast one at all, except the very first xfer.
+    CHECK_TRUE(slow.finished_at == milliseconds{2 + 2 + 5 * (2 + 10) - 2});
+    CHECK_TRUE(fast.finished_at < slow.finished_at);
+}
+
+TEST(coop, task_control_block_is_small)
+{
+    CHECK_TRUE(sizeof(ecl::coop_task) <= 3 * sizeof(void *) + 8);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,191 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Tick processing cost and firing jitter of the timer service.
+
+#include <ecl/thread/timer_service.hpp>
+#include <ecl/thread/work_thread.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+using clock_type = std::chrono::steady_clock;
+using std::chrono::milliseconds;
+using std::chrono::microseconds;
+
+static constexpr auto timers = 50000;
+
+// Deterministic pseudo-random delays
+static uint32_t next_random()
+{
+    static uint32_t state = 2463534242u;
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static uint64_t elapsed_ns(clock_type::time_point since)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            clock_type::now() - since).count();
+}
+
+static uint64_t percentile(const std::vector<uint64_t> &sorted, unsigned p)
+{
+    return sorted[(sorted.size() - 1) * p / 100];
+}
+
+struct bench_timer
+{
+    static void routine(void *arg)
+    {
+        auto self = static_cast<bench_timer *>(arg);
+        self->fired++;
+
+        if (self->lateness) {
+            auto late = clock_type::now() - self->deadline;
+            self->lateness->push_back(
+                    std::chrono::duration_cast<microseconds>(late).count());
+        }
+    }
+
+    ecl::timer                  t{routine, this};
+    int                         fired = 0;
+    clock_type::time_point      deadline;
+    std::vector<uint64_t>       *lateness = nullptr;
+};
+
+TEST_GROUP(timer_service_bench)
+{
+};
+
+// Service is ticked manually, as fast as possible
+TEST(timer_service_bench, tick_cost)
+{
+    constexpr uint32_t max_delay = 100000;
+    constexpr uint32_t ticks = max_delay + 1;
+
+    static bench_timer items[timers];
+
+    ecl::work_queue q;
+    ecl::timer_service svc{q, milliseconds(1)};
+
+    auto start = clock_type::now();
+
+    for (auto &it : items) {
+        svc.start(it.t, milliseconds(1 + next_random() % max_delay));
+    }
+
+    auto start_ns = elapsed_ns(start);
+
+    std::vector<uint64_t> cost;
+    cost.reserve(ticks);
+
+    for (uint32_t i = 0; i < ticks; ++i) {
+        svc.tick();
+
+        // Only the wheel is measured, expired callbacks are executed after
+        start = clock_type::now();
+        q.run_pending();
+        cost.push_back(elapsed_ns(start));
+
+        q.run_pending();
+    }
+
+    int fired = 0;
+    for (auto &it : items) {
+        fired += it.fired;
+    }
+
+    CHECK_EQUAL(timers, fired);
+
+    uint64_t total = 0;
+    for (auto c : cost) {
+        total += c;
+    }
+
+    std::sort(cost.begin(), cost.end());
+
+    std::cout << "\n\nTimer wheel, " << timers << " timers over "
+              << ticks << " ticks\n"
+              << std::setw(24) << "start, ns per timer: " << start_ns / timers << '\n'
+              << std::setw(24) << "tick, ns average: " << total / ticks << '\n'
+              << std::setw(24) << "tick, ns p99: " << percentile(cost, 99) << '\n'
+              << std::setw(24) << "tick, ns max: " << cost.back() << '\n';
+}
+
+// Service is driven by the clock, callbacks are executed by the worker
+TEST(timer_service_bench, firing_jitter)
+{
+    constexpr auto tick = milliseconds(1);
+    constexpr uint32_t max_delay = 500;
+
+    static bench_timer items[timers];
+
+    // Accessed only by the worker
+    std::vector<uint64_t> lateness;
+    lateness.reserve(timers);
+
+    ecl::work_queue q;
+    ecl::work_thread w{q};
+    ecl::timer_service svc{q, tick};
+
+    CHECK_EQUAL(ecl::err::ok, w.start());
+
+    auto epoch = clock_type::now();
+
+    for (auto &it : items) {
+        auto delay = milliseconds(1 + next_random() % max_delay);
+
+        it.lateness = &lateness;
+        it.deadline = epoch + delay;
+        svc.start(it.t, delay);
+    }
+
+    std::atomic_bool done{false};
+
+    std::thread ticker{[&] {
+        auto next = epoch;
+
+        while (!done) {
+            next += tick;
+            std::this_thread::sleep_until(next);
+            svc.advance_to(std::chrono::duration_cast<microseconds>(
+                    clock_type::now() - epoch));
+        }
+    }};
+
+    std::this_thread::sleep_for(milliseconds(max_delay + 50));
+    done = true;
+    ticker.join();
+
+    CHECK_EQUAL(ecl::err::ok, w.stop());
+    q.run_pending();
+
+    CHECK_EQUAL(static_cast<size_t>(timers), lateness.size());
+    std::sort(lateness.begin(), lateness.end());
+
+    std::cout << "\n\nTimer firing lateness, " << timers << " timers, tick "
+              << tick.count() << " ms\n"
+              << std::setw(24) << "p50, us: " << percentile(lateness, 50) << '\n'
+              << std::setw(24) << "p90, us: " << percentile(lateness, 90) << '\n'
+              << std::setw(24) << "p99, us: " << percentile(lateness, 99) << '\n'
+              << std::setw(24) << "max, us: " << lateness.back() << '\n';
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,312 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <ecl/thread/timer_service.hpp>
+#include <ecl/thread/work_thread.hpp>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+#include <atomic>
+#include <thread>
+
+using std::chrono::milliseconds;
+using std::chrono::microseconds;
+
+//------------------------------------------------------------------------------
+
+static ecl::work_queue *queue;
+static ecl::timer_service *service;
+
+static void counter(void *arg)
+{
+    ++*static_cast<int *>(arg);
+}
+
+// Ticks the service and executes expired callbacks
+static void advance(uint32_t n = 1)
+{
+    service->tick(n);
+
+    // First pass processes the ticks, second executes callbacks
+    queue->run_pending();
+    queue->run_pending();
+}
+
+TEST_GROUP(timer_service)
+{
+    void setup()
+    {
+        queue = new ecl::work_queue;
+        service = new ecl::timer_service{*queue, milliseconds(1)};
+    }
+
+    void teardown()
+    {
+        delete service;
+        delete queue;
+    }
+};
+
+TEST(timer_service, one_shot)
+{
+    int fired = 0;
+    ecl::timer t{counter, &fired};
+
+    CHECK_FALSE(t.active());
+    CHECK_EQUAL(ecl::err::ok, service->start(t, milliseconds(5)));
+    CHECK_TRUE(t.active());
+
+    advance(4);
+    CHECK_EQUAL(0, fired);
+
+    advance();
+    CHECK_EQUAL(1, fired);
+    CHECK_FALSE(t.active());
+
+    advance(100);
+    CHECK_EQUAL(1, fired);
+}
+
+TEST(timer_service, start_with_pending_ticks)
+{
+    int fired = 0;
+    ecl::timer t{counter, &fired};
+
+    // Ticks are counted but not yet processed
+    service->tick(3);
+    CHECK_EQUAL(ecl::err::ok, service->start(t, milliseconds(5)));
+
+    queue->run_pending();
+    queue->run_pending();
+    CHECK_EQUAL(0, fired);
+
+    advance(4);
+    CHECK_EQUAL(0, fired);
+
+    advance();
+    CHECK_EQUAL(1, fired);
+}
+
+TEST(timer_service, delay_is_rounded_up_to_ticks)
+{
+    int fired = 0;
+    ecl::timer a{counter, &fired};
+    ecl::timer b{counter, &fired};
+
+    service->start(a, microseconds(1500));
+    service->start(b, milliseconds(0));
+
+    // Zero delay expires on the next tick
+    advance();
+    CHECK_EQUAL(1, fired);
+
+    advance();
+    CHECK_EQUAL(2, fired);
+}
+
+TEST(timer_service, periodic)
+{
+    int fired = 0;
+    ecl::timer t{counter, &fired};
+
+    service->start(t, milliseconds(2), milliseconds(3));
+
+    advance(2);
+    CHECK_EQUAL(1, fired);
+
+    advance(2);
+    CHECK_EQUAL(1, fired);
+
+    advance(1);
+    CHECK_EQUAL(2, fired);
+
+    for (int i = 0; i < 300; ++i) {
+        advance();
+    }
+
+    CHECK_EQUAL(102, fired);
+    CHECK_TRUE(t.active());
+
+    CHECK_EQUAL(ecl::err::ok, service->stop(t));
+    advance(10);
+    CHECK_EQUAL(102, fired);
+}
+
+TEST(timer_service, stop_and_restart)
+{
+    int fired = 0;
+    ecl::timer t{counter, &fired};
+
+    CHECK_EQUAL(ecl::err::srch, service->stop(t));
+
+    service->start(t, milliseconds(3));
+    advance(2);
+    CHECK_EQUAL(ecl::err::ok, service->stop(t));
+    CHECK_EQUAL(ecl::err::srch, service->stop(t));
+
+    advance(10);
+    CHECK_EQUAL(0, fired);
+
+    // Restart of the active timer replaces its deadline
+    service->start(t, milliseconds(3));
+    advance(2);
+    service->start(t, milliseconds(3));
+    advance(2);
+    CHECK_EQUAL(0, fired);
+    advance();
+    CHECK_EQUAL(1, fired);
+}
+
+TEST(timer_service, expires_exactly_at_all_levels)
+{
+    const uint32_t range = ecl::timer_service::range;
+    const uint32_t delays[] = {
+        1, 63, 64, 65, 4095, 4096, 4097, 262143, 262144, 262145,
+        range - 1, range, range + 1, 2 * range + 7,
+    };
+
+    // Not aligned to any level, and close to the wraparound
+    const uint32_t offsets[] = { 0, 12345, UINT32_MAX - 100 };
+
+    for (auto offset : offsets) {
+        for (auto d : delays) {
+            // Delays beyond the wheel take long to tick through, check once
+            if (d >= range - 1 && offset != 12345) {
+                continue;
+            }
+
+            teardown();
+            setup();
+
+            // Wheel is empty, time just moves forward
+            advance(offset);
+
+            int fired = 0;
+            ecl::timer t{counter, &fired};
+            service->start(t, milliseconds(d));
+
+            advance(d - 1);
+            CHECK_EQUAL(0, fired);
+
+            advance();
+            CHECK_EQUAL(1, fired);
+            CHECK_FALSE(t.active());
+        }
+    }
+}
+
+TEST(timer_service, timers_with_same_deadline)
+{
+    int fired = 0;
+    ecl::timer t[8] = {
+        {counter, &fired}, {counter, &fired}, {counter, &fired}, {counter, &fired},
+        {counter, &fired}, {counter, &fired}, {counter, &fired}, {counter, &fired},
+    };
+
+    for (auto &it : t) {
+        service->start(it, milliseconds(100));
+    }
+
+    service->stop(t[3]);
+
+    advance(99);
+    CHECK_EQUAL(0, fired);
+    advance();
+    CHECK_EQUAL(7, fired);
+}
+
+TEST(timer_service, restart_from_callback)
+{
+    struct self_restart
+    {
+        static void routine(void *arg)
+        {
+            auto self = static_cast<self_restart *>(arg);
+            if (++self->fired < 3) {
+                service->start(self->t, milliseconds(10));
+            }
+        }
+
+        ecl::timer  t{routine, this};
+        int         fired = 0;
+    } s;
+
+    service->start(s.t, milliseconds(10));
+
+    for (int i = 0; i < 50; ++i) {
+        advance();
+    }
+
+    CHECK_EQUAL(3, s.fired);
+    CHECK_FALSE(s.t.active());
+}
+
+TEST(timer_service, overrun_when_callback_is_pending)
+{
+    int fired = 0;
+    ecl::timer t{counter, &fired};
+
+    service->start(t, milliseconds(1), milliseconds(1));
+
+    // All three ticks are processed before callback is executed
+    advance(3);
+    CHECK_EQUAL(1, fired);
+    CHECK_EQUAL(2U, service->overruns());
+
+    service->stop(t);
+}
+
+TEST(timer_service, driven_by_clock)
+{
+    int fired = 0;
+    ecl::timer t{counter, &fired};
+
+    service->start(t, milliseconds(10));
+
+    service->advance_to(microseconds(9999));
+    queue->run_pending();
+    queue->run_pending();
+    CHECK_EQUAL(0, fired);
+
+    service->advance_to(milliseconds(10));
+    queue->run_pending();
+    queue->run_pending();
+    CHECK_EQUAL(1, fired);
+}
+
+TEST(timer_service, callbacks_in_worker_thread)
+{
+    std::atomic_int fired{0};
+    ecl::timer t{[](void *arg) {
+        static_cast<std::atomic_int *>(arg)->fetch_add(1);
+    }, &fired};
+
+    ecl::work_thread w{*queue};
+    CHECK_EQUAL(ecl::err::ok, w.start());
+
+    service->start(t, milliseconds(1), milliseconds(1));
+
+    // Ticks from another context, as if from the timer ISR
+    std::thread isr{[] {
+        for (int i = 0; i < 1000; ++i) {
+            service->tick();
+            std::this_thread::yield();
+        }
+    }};
+
+    isr.join();
+    CHECK_EQUAL(ecl::err::ok, w.stop());
+
+    // Callbacks posted by the last tick, if any
+    queue->run_pending();
+    service->stop(t);
+
+    CHECK_EQUAL(1000, fired.load() + static_cast<int>(service->overruns()));
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
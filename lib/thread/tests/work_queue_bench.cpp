@@ -0,0 +1,109 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Post-to-run latency and throughput of the deferred work queue.
+
+#include <ecl/thread/work_queue.hpp>
+#include <ecl/thread/work_thread.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+using clock_type = std::chrono::steady_clock;
+
+static constexpr auto producers = 4;
+static constexpr auto pool = 64;
+static constexpr auto posts = 50000;
+
+struct timed_work
+{
+    static void routine(void *arg)
+    {
+        auto self = static_cast<timed_work *>(arg);
+        auto delay = clock_type::now() - self->posted;
+
+        self->latency->push_back(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(delay).count());
+    }
+
+    ecl::work_item          item{routine, this};
+    clock_type::time_point  posted;
+    std::vector<uint64_t>   *latency;
+};
+
+static uint64_t percentile(const std::vector<uint64_t> &sorted, unsigned p)
+{
+    return sorted[(sorted.size() - 1) * p / 100];
+}
+
+TEST_GROUP(work_queue_bench)
+{
+};
+
+TEST(work_queue_bench, latency_and_throughput)
+{
+    static timed_work items[producers][pool];
+
+    // Accessed only by the worker
+    std::vector<uint64_t> latency;
+    latency.reserve(producers * posts);
+
+    ecl::work_queue q;
+    ecl::work_thread w{q};
+    CHECK_EQUAL(ecl::err::ok, w.start());
+
+    std::vector<std::thread> threads;
+    auto start = clock_type::now();
+
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < posts; ++i) {
+                auto &it = items[p][i % pool];
+
+                while (it.item.queued()) {
+                    std::this_thread::yield();
+                }
+
+                it.latency = &latency;
+                it.posted = clock_type::now();
+                q.post(it.item);
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    CHECK_EQUAL(ecl::err::ok, w.stop());
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            clock_type::now() - start).count();
+
+    CHECK_EQUAL(static_cast<size_t>(producers * posts), latency.size());
+    std::sort(latency.begin(), latency.end());
+
+    std::cout << "\n\nWork queue, " << producers << " producers, "
+              << posts << " posts each\n"
+              << std::setw(24) << "throughput, items/s: "
+              << latency.size() * 1000000 / std::max<int64_t>(elapsed, 1) << '\n'
+              << std::setw(24) << "post-to-run p50, ns: " << percentile(latency, 50) << '\n'
+              << std::setw(24) << "post-to-run p90, ns: " << percentile(latency, 90) << '\n'
+              << std::setw(24) << "post-to-run p99, ns: " << percentile(latency, 99) << '\n'
+              << std::setw(24) << "post-to-run max, ns: " << latency.back() << '\n';
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,227 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <ecl/thread/work_queue.hpp>
+#include <ecl/thread/work_thread.hpp>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+//------------------------------------------------------------------------------
+
+// Work that records its execution
+struct recorder
+{
+    explicit recorder(std::vector<int> &l, int i)
+        :log(l), id(i), item{routine, this} { }
+
+    static void routine(void *arg)
+    {
+        auto self = static_cast<recorder *>(arg);
+        self->log.push_back(self->id);
+    }
+
+    std::vector<int>    &log;
+    int                 id;
+    ecl::work_item      item;
+};
+
+TEST_GROUP(work_queue)
+{
+};
+
+TEST(work_queue, executed_in_order_of_posting)
+{
+    ecl::work_queue q;
+    std::vector<int> log;
+    recorder a{log, 1}, b{log, 2}, c{log, 3};
+
+    CHECK_TRUE(q.empty());
+    CHECK_EQUAL(0U, q.run_pending());
+
+    CHECK_TRUE(q.post(b.item));
+    CHECK_TRUE(q.post(a.item));
+    CHECK_TRUE(q.post(c.item));
+    CHECK_FALSE(q.empty());
+    CHECK_TRUE(a.item.queued());
+
+    CHECK_EQUAL(3U, q.run_pending());
+    CHECK_TRUE(q.empty());
+    CHECK_FALSE(a.item.queued());
+
+    CHECK_EQUAL(3U, log.size());
+    CHECK_EQUAL(2, log[0]);
+    CHECK_EQUAL(1, log[1]);
+    CHECK_EQUAL(3, log[2]);
+}
+
+TEST(work_queue, queued_item_is_not_posted_twice)
+{
+    ecl::work_queue q;
+    std::vector<int> log;
+    recorder a{log, 1};
+
+    CHECK_TRUE(q.post(a.item));
+    CHECK_FALSE(q.post(a.item));
+
+    CHECK_EQUAL(1U, q.run_pending());
+    CHECK_EQUAL(1U, log.size());
+
+    // Can be posted again once started
+    CHECK_TRUE(q.post(a.item));
+    CHECK_EQUAL(1U, q.run_pending());
+    CHECK_EQUAL(2U, log.size());
+}
+
+TEST(work_queue, repost_from_routine)
+{
+    static ecl::work_queue q;
+    static int runs;
+    runs = 0;
+
+    static ecl::work_item self{[](void *) {
+        if (++runs < 3) {
+            q.post(self);
+        }
+    }};
+
+    q.post(self);
+
+    // Reposted item is left for the next call
+    CHECK_EQUAL(1U, q.run_pending());
+    CHECK_EQUAL(1U, q.run_pending());
+    CHECK_EQUAL(1U, q.run_pending());
+    CHECK_EQUAL(0U, q.run_pending());
+    CHECK_EQUAL(3, runs);
+}
+
+TEST(work_queue, wait_is_signalled_by_post)
+{
+    ecl::work_queue q;
+    std::vector<int> log;
+    recorder a{log, 1};
+
+    CHECK_FALSE(q.wait(std::chrono::milliseconds(1)));
+
+    q.post(a.item);
+    CHECK_TRUE(q.wait(std::chrono::milliseconds(0)));
+    CHECK_EQUAL(1U, q.run_pending());
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(work_thread)
+{
+};
+
+TEST(work_thread, executes_and_stops)
+{
+    ecl::work_queue q;
+    ecl::work_thread w{q};
+    std::atomic_int runs{0};
+
+    ecl::work_item item{[](void *arg) {
+        static_cast<std::atomic_int *>(arg)->fetch_add(1);
+    }, &runs};
+
+    CHECK_EQUAL(ecl::err::srch, w.stop());
+    CHECK_EQUAL(ecl::err::ok, w.start());
+    CHECK_EQUAL(ecl::err::busy, w.start());
+
+    q.post(item);
+
+    while (runs.load() != 1) {
+        std::this_thread::yield();
+    }
+
+    // Work posted before stop is not lost
+    q.post(item);
+    CHECK_EQUAL(ecl::err::ok, w.stop());
+    CHECK_EQUAL(2, runs.load());
+
+    // Worker can be restarted
+    CHECK_EQUAL(ecl::err::ok, w.start());
+    q.post(item);
+    CHECK_EQUAL(ecl::err::ok, w.stop());
+    CHECK_EQUAL(3, runs.load());
+}
+
+// Producers emulate interrupt handlers, each reusing its own pool of items
+TEST(work_thread, concurrent_producers)
+{
+    constexpr int producers = 4;
+    constexpr int pool = 16;
+    constexpr int posts = 20000;
+
+    struct work
+    {
+        static void routine(void *arg)
+        {
+            auto self = static_cast<work *>(arg);
+            auto &last = (*self->last)[self->producer];
+
+            // Items of the same producer are executed in order of posting
+            CHECK(self->seq > last);
+            last = self->seq;
+        }
+
+        ecl::work_item          item{routine, this};
+        int                     producer;
+        int                     seq;
+        std::vector<int>        *last;
+    };
+
+    static work items[producers][pool];
+    std::vector<int> last(producers, -1);
+
+    ecl::work_queue q;
+    ecl::work_thread w{q};
+    CHECK_EQUAL(ecl::err::ok, w.start());
+
+    std::vector<std::thread> threads;
+    std::atomic_int coalesced{0};
+
+    for (int p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (int i = 0; i < posts; ++i) {
+                auto &it = items[p][i % pool];
+
+                // Wait until item is started
+                while (it.item.queued()) {
+                    std::this_thread::yield();
+                }
+
+                it.producer = p;
+                it.seq = i;
+                it.last = &last;
+
+                if (!q.post(it.item)) {
+                    coalesced++;
+                }
+            }
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    CHECK_EQUAL(ecl::err::ok, w.stop());
+
+    CHECK_EQUAL(0, coalesced.load());
+    CHECK_TRUE(q.empty());
+
+    for (int p = 0; p < producers; ++p) {
+        CHECK_EQUAL(posts - 1, last[p]);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,346 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Continuous ADC acquisition through a circular DMA buffer.
+//! \details DMA writes samples into a circular buffer. Each time half of
+//! the buffer is filled (ADC half conversion and end of conversion events),
+//! samples of that half are passed through a decimation filter and the
+//! resulting block is delivered to the user, while DMA fills the other half.
+//!
+//! This part is platform-independent, the ADC driver provides DMA setup and
+//! routes its events to adc_stream::on_event().
+#ifndef PLATFORM_COMMON_ADC_STREAM_
+#define PLATFORM_COMMON_ADC_STREAM_
+
+#include <common/adc.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+namespace ecl
+{
+
+//! Filter without decimation: blocks are delivered straight from the DMA buffer.
+//! \tparam Channels Amount of interleaved channels in the buffer.
+template<size_t Channels = 1>
+struct adc_passthrough
+{
+    static_assert(Channels > 0, "At least one channel is required");
+
+    //! Type of the filter output.
+    using output_type = uint16_t;
+
+    //! Input frames per output frame.
+    static constexpr size_t ratio = 1;
+
+    //! Amount of interleaved channels.
+    static constexpr size_t channels = Channels;
+
+    //! Filter output is its input. Stream skips the process() call.
+    static constexpr bool passthrough = true;
+
+    //! Resets filter state.
+    void reset() { }
+};
+
+//! Cascaded integrator-comb decimation filter.
+//! \details Filter of the first order is a moving average, decimated by its
+//! length. Higher orders give better attenuation of the aliased frequencies,
+//! at the cost of wider passband droop.
+//!
+//! Integrators wrap around, that is expected: outputs are correct as long as
+//! they fit into 32 bits, which is checked at compile time. Output is
+//! normalized by the filter gain, so it has the same scale as the input.
+//! \tparam Order    Amount of integrator and comb stages.
+//! \tparam Ratio    Decimation ratio.
+//! \tparam Channels Amount of interleaved channels in the input.
+template<size_t Order, size_t Ratio, size_t Channels = 1>
+class adc_cic
+{
+    static_assert(Order > 0 && Ratio > 0 && Channels > 0, "Invalid filter parameters");
+
+    //! Computes filter gain: Ratio ^ Order.
+    static constexpr uint64_t compute_gain()
+    {
+        uint64_t g = 1;
+        for (size_t i = 0; i < Order; ++i) {
+            g *= Ratio;
+        }
+
+        return g;
+    }
+
+    //! Checks if the number is a power of 2.
+    static constexpr bool is_pow2(uint64_t v)
+    {
+        return !(v & (v - 1));
+    }
+
+    //! Computes log2 of the gain, if gain is a power of 2.
+    static constexpr unsigned compute_shift()
+    {
+        unsigned s = 0;
+        while ((uint64_t{1} << s) < compute_gain()) {
+            ++s;
+        }
+
+        return s;
+    }
+
+public:
+    static_assert(compute_gain() * 0xffff <= UINT32_MAX,
+                  "Filter output does not fit into 32 bits, decrease order or ratio");
+
+    //! Type of the filter output.
+    using output_type = uint16_t;
+
+    //! Input frames per output frame.
+    static constexpr size_t ratio = Ratio;
+
+    //! Amount of interleaved channels.
+    static constexpr size_t channels = Channels;
+
+    //! Filter produces own output.
+    static constexpr bool passthrough = false;
+
+    //! DC gain of the filter, before normalization.
+    static constexpr uint32_t gain = compute_gain();
+
+    //! Constructs filter with zero state.
+    adc_cic();
+
+    //! Resets filter state.
+    void reset();
+
+    //! Filters and decimates interleaved samples.
+    //! \param[in]  in    Input samples. Amount must be multiple of channels.
+    //! \param[in]  count Amount of input samples.
+    //! \param[out] out   Output samples. Must fit count / ratio samples,
+    //!                   rounded up to whole frames.
+    //! \return Amount of output samples.
+    size_t process(const uint16_t *in, size_t count, output_type *out);
+
+private:
+    uint32_t    m_integ[Channels][Order];   //!< Integrator stages.
+    uint32_t    m_comb[Channels][Order];    //!< Comb delay elements.
+    size_t      m_phase;                    //!< Input frames since last output.
+};
+
+//! ADC acquisition statistics.
+struct adc_stream_stats
+{
+    uint32_t blocks;        //!< Blocks delivered to the user.
+    uint32_t missed;        //!< Halves reached by DMA before handling was done.
+    uint32_t overruns;      //!< ADC overrun events.
+};
+
+//! Continuous ADC acquisition stream.
+//! \details Usage with STM32 ADC in DMA mode:
+//! \code
+//! // 4 channels, decimated by 16 with 3rd order CIC filter
+//! using filter = ecl::adc_cic<3, 16, 4>;
+//! static ecl::adc_stream<1024, filter> stream;
+//!
+//! stream.set_handler([](const uint16_t *block, size_t count) {
+//!     // Called in IRQ context, count is 1024 / 16.
+//! });
+//!
+//! ecl::adc<ecl::adc_dev::dev1>::start_stream<channels>(stream);
+//! \endcode
+//! \tparam Half   Amount of samples in each half of the DMA buffer,
+//!                multiple of filter channels and ratio.
+//! \tparam Filter Filter applied to each half, see adc_cic.
+template<size_t Half, class Filter = adc_passthrough<>>
+class adc_stream
+{
+    static_assert(Half % (Filter::ratio * Filter::channels) == 0,
+                  "Half of the buffer must hold whole decimation periods of all channels");
+
+public:
+    //! Type of the raw ADC sample.
+    using sample_type = uint16_t;
+
+    //! Type of the delivered sample.
+    using output_type = typename Filter::output_type;
+
+    //! Amount of samples in each delivered block.
+    static constexpr size_t block_size = Half / Filter::ratio;
+
+    //! Block handler. Called in IRQ context.
+    //! \details Block memory is valid only during the call.
+    using block_handler = std::function<void(const output_type *block, size_t count)>;
+
+    //! Constructs stream without handler.
+    adc_stream();
+
+    //! Sets block handler. Must not be called while stream is running.
+    void set_handler(const block_handler &h) { m_handler = h; }
+
+    //! Resets filter. Must be called before DMA is started.
+    void reset();
+
+    //! Handles ADC event. Must be called by the driver from IRQ.
+    //! \details DMA position is checked after the half is handled. If DMA
+    //! is not in the other half, handled data was overwritten, either
+    //! because the event was served late or because handling took too long.
+    //! \param[in] ev   Half conversion for the first half, end of conversion
+    //!                 for the second one, or overrun.
+    //! \param[in] left Callable, returning amount of samples DMA has yet
+    //!                 to write until the end of the buffer (i.e. NDTR).
+    template<class Left>
+    void on_event(adc_event ev, Left &&left);
+
+    //! Gets DMA buffer.
+    sample_type *buffer() { return m_buf; }
+
+    //! Gets DMA buffer size in samples.
+    static constexpr size_t size() { return Half * 2; }
+
+    //! Gets the filter.
+    Filter &filter() { return m_filter; }
+
+    //! Gets statistics.
+    const adc_stream_stats &stats() const { return m_stats; }
+
+    //! Resets statistics.
+    void reset_stats() { m_stats = adc_stream_stats{}; }
+
+private:
+    //! Delivers block without filtering.
+    template<class F = Filter>
+    std::enable_if_t<F::passthrough> process(const sample_type *half);
+
+    //! Filters block and delivers result.
+    template<class F = Filter>
+    std::enable_if_t<!F::passthrough> process(const sample_type *half);
+
+    //! Filtered block. Not used in passthrough mode.
+    output_type         m_out[Filter::passthrough ? 1 : block_size];
+    sample_type         m_buf[Half * 2];    //!< DMA buffer.
+    Filter              m_filter;           //!< Decimation filter.
+    block_handler       m_handler;          //!< User handler.
+    adc_stream_stats    m_stats;            //!< Statistics.
+};
+
+//------------------------------------------------------------------------------
+
+template<size_t Order, size_t Ratio, size_t Channels>
+adc_cic<Order, Ratio, Channels>::adc_cic()
+    :m_integ{}
+    ,m_comb{}
+    ,m_phase{0}
+{
+}
+
+template<size_t Order, size_t Ratio, size_t Channels>
+void adc_cic<Order, Ratio, Channels>::reset()
+{
+    *this = adc_cic{};
+}
+
+template<size_t Order, size_t Ratio, size_t Channels>
+size_t adc_cic<Order, Ratio, Channels>::process(const uint16_t *in, size_t count,
+                                                 output_type *out)
+{
+    size_t produced = 0;
+
+    for (size_t i = 0; i < count; i += Channels) {
+        // Integrators run at the input rate
+        for (size_t ch = 0; ch < Channels; ++ch) {
+            uint32_t v = in[i + ch];
+
+            for (size_t s = 0; s < Order; ++s) {
+                v = m_integ[ch][s] += v;
+            }
+        }
+
+        if (++m_phase < Ratio) {
+            continue;
+        }
+
+        m_phase = 0;
+
+        // Combs run at the output rate
+        for (size_t ch = 0; ch < Channels; ++ch) {
+            uint32_t v = m_integ[ch][Order - 1];
+
+            for (size_t s = 0; s < Order; ++s) {
+                uint32_t prev = m_comb[ch][s];
+                m_comb[ch][s] = v;
+                v -= prev;
+            }
+
+            out[produced++] = is_pow2(gain) ? v >> compute_shift() : v / gain;
+        }
+    }
+
+    return produced;
+}
+
+//------------------------------------------------------------------------------
+
+template<size_t Half, class Filter>
+adc_stream<Half, Filter>::adc_stream()
+    :m_out{}
+    ,m_buf{}
+    ,m_filter{}
+    ,m_handler{}
+    ,m_stats{}
+{
+}
+
+template<size_t Half, class Filter>
+void adc_stream<Half, Filter>::reset()
+{
+    m_filter.reset();
+}
+
+template<size_t Half, class Filter>
+template<class Left>
+void adc_stream<Half, Filter>::on_event(adc_event ev, Left &&left)
+{
+    if (ev == adc_event::ovr) {
+        m_stats.overruns++;
+        return;
+    }
+
+    bool first = ev == adc_event::hc;
+
+    process(first ? m_buf : m_buf + Half);
+    m_stats.blocks++;
+
+    // Counter is reloaded when DMA wraps around
+    size_t pos = size() - left();
+
+    if ((pos < Half) == first) {
+        m_stats.missed++;
+    }
+}
+
+template<size_t Half, class Filter>
+template<class F>
+std::enable_if_t<F::passthrough> adc_stream<Half, Filter>::process(const sample_type *half)
+{
+    if (m_handler) {
+        m_handler(half, Half);
+    }
+}
+
+template<size_t Half, class Filter>
+template<class F>
+std::enable_if_t<!F::passthrough> adc_stream<Half, Filter>::process(const sample_type *half)
+{
+    auto n = m_filter.process(half, Half, m_out);
+
+    if (m_handler) {
+        m_handler(m_out, n);
+    }
+}
+
+} // namespace ecl
+
+#endif // PLATFORM_COMMON_ADC_STREAM_
@@ -48,6 +48,19 @@ enum class async_type
 //!
 using bus_handler = std::function<void(bus_channel ch, bus_event type, size_t total)>;
 
+//! Segment of a scatter-gather xfer.
+//! \details Segments are transferred one after another, as if single
+//! contiguous buffer was used. In full-duplex mode both buffers of the segment
+//! are transferred simultaneously. If only one direction is required,
+//! the other buffer must be null.
+//! \sa generic_bus::set_buffers(const bus_iovec *iov, size_t cnt)
+struct bus_iovec
+{
+    const uint8_t   *tx;    //!< Data to transmit. Optional.
+    uint8_t         *rx;    //!< Buffer to receive data. Optional.
+    size_t          size;   //!< Size of the segment.
+};
+
 } // namespace ecl
 
 
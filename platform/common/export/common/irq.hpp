@@ -13,6 +13,13 @@
 
 #include <functional>
 #include <type_traits>
+#include <new>
+
+//! Selects IRQ dispatch through the table of plain function pointers,
+//! instead of std::function objects. Set by the platform configuration.
+#ifndef THECORE_IRQ_DISPATCH_TABLE
+#define THECORE_IRQ_DISPATCH_TABLE 0
+#endif
 
 namespace ecl
 {
@@ -22,17 +29,84 @@ namespace irq
 
 #if !defined THECORE_NO_IRQ_MANAGER || THECORE_NO_IRQ_MANAGER == 0
 
-using handler_type = std::function<void()>;
-
 //! Initializes storage for callbacks and setups default handler for every IRQ.
 void init_storage();
 
+#if THECORE_IRQ_DISPATCH_TABLE
+
+//! Plain IRQ handler, called with the context given during subscription.
+using handler_fn = void (*)(void *ctx);
+
+//! Callable object handler is stored in the dispatch table directly.
+//! This is its maximum size.
+static constexpr size_t handler_obj_size = 2 * sizeof(void *);
+
+//! Entry of the dispatch table.
+struct handler_slot
+{
+    handler_fn  fn;     //!< Handler.
+    void        *ctx;   //!< Handler argument.
+    //! Callable object storage. Context points to it, if object is stored.
+    std::aligned_storage_t<handler_obj_size, alignof(void *)> obj;
+};
+
+//! Subscribes plain function to the given IRQ.
+//! \param[in] irqn     Valid IRQ number.
+//! \param[in] fn       Handler.
+//! \param[in] ctx      Argument passed to the handler.
+//!
+void subscribe(irq_num irqn, handler_fn fn, void *ctx);
+
+//! Subscribes to the given IRQ.
+//! \details Handler is copied into the dispatch table, thus no heap is used.
+//! Typical handlers, like lambdas capturing this pointer or function pointers,
+//! fit. Keep bigger state elsewhere and capture a pointer to it.
+//! \param[in] irqn     Valid IRQ number.
+//! \param[in] handler  Callable object with signature void().
+//!
+template<class Handler>
+void subscribe(irq_num irqn, Handler handler);
+
+namespace detail
+{
+
+//! Gets dispatch table entry. Must be modified with interrupts disabled.
+handler_slot &get_slot(irq_num irqn);
+
+} // namespace detail
+
+template<class Handler>
+void subscribe(irq_num irqn, Handler handler)
+{
+    static_assert(sizeof(Handler) <= handler_obj_size,
+                  "Handler is too big to be stored in the dispatch table");
+    static_assert(alignof(Handler) <= alignof(void *),
+                  "Handler alignment is not supported by the dispatch table");
+    static_assert(std::is_trivially_copyable<Handler>::value
+                  && std::is_trivially_destructible<Handler>::value,
+                  "Handler in the dispatch table is never destroyed");
+
+    auto &slot = detail::get_slot(irqn);
+
+    irq::disable();
+    new (&slot.obj) Handler(handler);
+    slot.ctx = &slot.obj;
+    slot.fn = [](void *obj) { (*static_cast<Handler *>(obj))(); };
+    irq::enable();
+}
+
+#else
+
+using handler_type = std::function<void()>;
+
 //! Subscribes to the given IRQ.
 //! \param[in] irqn     Valid IRQ number.
 //! \param[in] handler  New IRQ handler for given IRQ.
 //!
 void subscribe(irq_num irqn, const irq::handler_type &handler);
 
+#endif // THECORE_IRQ_DISPATCH_TABLE
+
 //! Unsubscribes from the given IRQ.
 //! \details Default handler will be used for given IRQ if this call succeed.
 //! \param[in] irqn Valid IRQ number.
@@ -10,7 +10,13 @@
 #ifndef PLATFORM_COMMON_MMIO_
 #define PLATFORM_COMMON_MMIO_
 
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
 #include <limits>
+#include <type_traits>
+#include <tuple>
+#include <utility>
 
 namespace ecl
 {
@@ -74,6 +80,15 @@ struct rw_mut : ro_mut
     }
 };
 
+//! Value of a register field, to be written with other fields.
+//! \tparam Field Register field, see reg.
+//! \sa modify
+template<typename Field>
+struct field_value
+{
+    uint32_t value; //!< Value, not shifted.
+};
+
 //! Memory-mapped I/O register.
 //! \tparam Mut     Mutability trait.
 //! \tparam addr    Address of a memory map register.
@@ -86,6 +101,18 @@ struct reg
     static_assert(width != 0, "zero width");
     static_assert(width + offset <= std::numeric_limits<uint32_t>::digits, "width overflow");
 
+    //! Mutability trait.
+    using mutability = Mut;
+
+    //! Address of a register.
+    static constexpr std::uintptr_t address = addr;
+
+    //! Offset of the data inside register.
+    static constexpr uint32_t shift = offset;
+
+    //! Mask of the data inside register.
+    static constexpr uint32_t mask = generate_mask(width, offset);
+
     //! Reads data from a register.
     static uint32_t read()
     {
@@ -98,8 +125,221 @@ struct reg
     {
         Mut::write(reinterpret_cast<volatile uint32_t*>(addr), offset, generate_mask(width, offset), val);
     }
+
+    //! Makes value of this field, for writing along with other fields.
+    //! \param[in] val Value to write.
+    //! \sa modify
+    static constexpr field_value<reg> val(uint32_t val)
+    {
+        return field_value<reg>{val};
+    }
 };
 
+template<typename Mut, std::uintptr_t addr, uint32_t offset, uint32_t width>
+constexpr std::uintptr_t reg<Mut, addr, offset, width>::address;
+
+template<typename Mut, std::uintptr_t addr, uint32_t offset, uint32_t width>
+constexpr uint32_t reg<Mut, addr, offset, width>::shift;
+
+template<typename Mut, std::uintptr_t addr, uint32_t offset, uint32_t width>
+constexpr uint32_t reg<Mut, addr, offset, width>::mask;
+
+//------------------------------------------------------------------------------
+
+namespace detail
+{
+
+//! Gets type at the given position of the pack.
+template<size_t I, typename... Ts>
+using nth_type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+//! Checks if the field at given position is the first field of its register.
+template<size_t I, typename... Fields>
+constexpr bool is_first_of_reg()
+{
+    constexpr std::uintptr_t addrs[] = { Fields::address... };
+
+    for (size_t j = 0; j < I; ++j) {
+        if (addrs[j] == addrs[I]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//! Merges masks of fields, placed in the same register as the field at
+//! given position.
+template<size_t I, typename... Fields>
+constexpr uint32_t reg_mask()
+{
+    constexpr std::uintptr_t addrs[] = { Fields::address... };
+    constexpr uint32_t masks[] = { Fields::mask... };
+    uint32_t mask = 0;
+
+    for (size_t j = 0; j < sizeof...(Fields); ++j) {
+        if (addrs[j] == addrs[I]) {
+            mask |= masks[j];
+        }
+    }
+
+    return mask;
+}
+
+//! Checks that fields of the same register do not overlap.
+template<typename... Fields>
+constexpr bool fields_disjoint()
+{
+    constexpr std::uintptr_t addrs[] = { Fields::address... };
+    constexpr uint32_t masks[] = { Fields::mask... };
+
+    for (size_t i = 0; i < sizeof...(Fields); ++i) {
+        for (size_t j = i + 1; j < sizeof...(Fields); ++j) {
+            if (addrs[i] == addrs[j] && (masks[i] & masks[j])) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+//! Checks that fields placed in the same register as the field at given
+//! position have the same mutability.
+template<size_t I, typename... Fields>
+constexpr bool same_mutability()
+{
+    using field = nth_type<I, Fields...>;
+    constexpr std::uintptr_t addrs[] = { Fields::address... };
+    constexpr bool same[] = { std::is_same<typename Fields::mutability,
+                                           typename field::mutability>::value... };
+
+    for (size_t j = 0; j < sizeof...(Fields); ++j) {
+        if (addrs[j] == addrs[I] && !same[j]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//! Checks that all fields are placed in the same register.
+template<typename... Fields>
+constexpr bool same_reg()
+{
+    constexpr std::uintptr_t addrs[] = { Fields::address... };
+
+    for (auto a : addrs) {
+        if (a != addrs[0]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//! Writes all fields of the register, which holds the field at given position.
+//! \details Does nothing if the field is not the first field of its register.
+//! Register is written once, with merged mask and value.
+template<size_t I, typename... Fields, size_t... J>
+void write_reg(std::index_sequence<J...>, const uint32_t *values)
+{
+    using field = nth_type<I, Fields...>;
+
+    static_assert(same_mutability<I, Fields...>(),
+                  "fields of the same register have different mutability");
+
+    if (!is_first_of_reg<I, Fields...>()) {
+        return;
+    }
+
+    uint32_t value = 0;
+
+    // Addresses are constants, so only ORs of values of this register remain.
+    (void)std::initializer_list<int>{
+        (value |= Fields::address == field::address ? values[J] : 0, 0)... };
+
+    field::mutability::write(reinterpret_cast<volatile uint32_t*>(field::address),
+                             0, reg_mask<I, Fields...>(), value);
+}
+
+//! Writes all registers, in order of their first appearance.
+template<typename... Fields, size_t... I>
+void write_regs(std::index_sequence<I...> seq, const uint32_t *values)
+{
+    (void)std::initializer_list<int>{ (write_reg<I, Fields...>(seq, values), 0)... };
+}
+
+} // namespace detail
+
+//! Writes several fields, possibly from different registers.
+//! \details Masks and values of the fields placed in the same register are
+//! merged, so each register is written once: a single read and a single
+//! write for read-write registers, a single write for write-only ones.
+//! Intermediate states of a register, when only part of fields are updated,
+//! are never visible to the peripheral. Registers are written in order of
+//! their first appearance in the argument list.
+//! \code
+//! using cr_en   = reg<rw_mut, 0x40000000, 0, 1>;
+//! using cr_mode = reg<rw_mut, 0x40000000, 1, 2>;
+//! using psc     = reg<rw_mut, 0x40000004, 0, 16>;
+//!
+//! // Prescaler is written first, then control register
+//! modify(psc::val(99), cr_mode::val(2), cr_en::val(1));
+//! \endcode
+//! \param[in] vals Values of fields. Fields of the same register must not
+//!                 overlap and must have the same mutability.
+template<typename... Fields>
+void modify(field_value<Fields>... vals)
+{
+    static_assert(sizeof...(Fields) > 0, "no fields to write");
+    static_assert(detail::fields_disjoint<Fields...>(), "fields of the same register overlap");
+
+    const uint32_t values[] = { ((vals.value << Fields::shift) & Fields::mask)... };
+    detail::write_regs<Fields...>(std::index_sequence_for<Fields...>{}, values);
+}
+
+//! Set of fields, placed in the same register.
+//! \details Fields are read and written at once, with a single register access.
+//! \tparam Fields Fields of the register, see reg.
+template<typename... Fields>
+struct reg_set
+{
+    static_assert(sizeof...(Fields) > 0, "empty set");
+    static_assert(detail::same_reg<Fields...>(), "fields must be placed in the same register");
+
+    //! First field, defines register address and mutability.
+    using first = detail::nth_type<0, Fields...>;
+
+    //! Merged mask of the fields.
+    static constexpr uint32_t mask = detail::reg_mask<0, Fields...>();
+
+    //! Reads all fields with a single register read.
+    //! \param[out] out Field values, in the same order as fields in the set.
+    template<typename... Vals>
+    static void read(Vals &... out)
+    {
+        static_assert(sizeof...(Vals) == sizeof...(Fields), "value for each field is required");
+
+        uint32_t raw = first::mutability::read(
+                    reinterpret_cast<volatile const uint32_t*>(first::address), 0, mask);
+
+        (void)std::initializer_list<int>{ (out = (raw & Fields::mask) >> Fields::shift, 0)... };
+    }
+
+    //! Writes all fields with a single register write.
+    //! \param[in] vals Field values, in the same order as fields in the set.
+    template<typename... Vals>
+    static void write(Vals... vals)
+    {
+        static_assert(sizeof...(Vals) == sizeof...(Fields), "value for each field is required");
+        modify(Fields::val(vals)...);
+    }
+};
+
+template<typename... Fields>
+constexpr uint32_t reg_set<Fields...>::mask;
+
 } // namespace mmio
 
 } // namespace ecl
@@ -19,6 +19,83 @@
 namespace ecl
 {
 
+//! Unhandled interrupt must cause the abort
+static void default_handler()
+{
+    ecl::abort();
+}
+
+#if THECORE_IRQ_DISPATCH_TABLE
+
+//! Dispatch table
+static irq::handler_slot table[IRQ_COUNT];
+
+//! Unhandled interrupt, table entry version
+static void default_table_handler(void *ctx)
+{
+    (void)ctx;
+    default_handler();
+}
+
+//------------------------------------------------------------------------------
+
+//! Handles IRQ and visible to the startup code
+extern "C" __attribute__ ((used))
+void core_isr()
+{
+    int irqn = irq::get_current_irqn();
+
+    // Drivers expect IRQ to be masked while it is handled
+    irq::mask(static_cast< irq_num >(irqn));
+
+    auto &slot = table[irqn];
+    slot.fn(slot.ctx);
+}
+
+//------------------------------------------------------------------------------
+
+namespace irq
+{
+
+void init_storage()
+{
+    for (auto &slot : table) {
+        slot.fn = default_table_handler;
+        slot.ctx = nullptr;
+    }
+
+    irq::enable();
+}
+
+void subscribe(irq_num irqn, handler_fn fn, void *ctx)
+{
+    ecl_assert(fn);
+
+    auto &slot = detail::get_slot(irqn);
+
+    irq::disable();
+    slot.fn = fn;
+    slot.ctx = ctx;
+    irq::enable();
+}
+
+void unsubscribe(irq_num irqn)
+{
+    subscribe(irqn, default_table_handler, nullptr);
+}
+
+handler_slot &detail::get_slot(irq_num irqn)
+{
+    ecl_assert(static_cast<int>(irqn) >= 0);
+    ecl_assert(static_cast<int>(irqn) < IRQ_COUNT);
+
+    return table[irqn];
+}
+
+} // namespace irq
+
+#else
+
 //! Storage type for the IRQ handlers
 using handler_storage =
 std::aligned_storage_t<sizeof(irq::handler_type), alignof(irq::handler_type)>;
@@ -26,12 +103,6 @@ std::aligned_storage_t<sizeof(irq::handler_type), alignof(irq::handler_type)>;
 //! IRQ storage itself
 static handler_storage storage[IRQ_COUNT];
 
-//! Unhandled interrupt must cause the abort
-static void default_handler()
-{
-    ecl::abort();
-}
-
 //! Effectively casts IRQ storage
 static auto extract_handlers()
 {
@@ -92,6 +163,8 @@ void unsubscribe(irq_num irqn)
 
 } // namespace irq
 
+#endif // THECORE_IRQ_DISPATCH_TABLE
+
 } // namespace ecl
 
 #endif // !defined THECORE_NO_IRQ_MANAGER || THECORE_NO_IRQ_MANAGER == 0
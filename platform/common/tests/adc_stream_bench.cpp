@@ -0,0 +1,81 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief ADC stream throughput, in input samples per second.
+
+#include <common/adc_stream.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+static constexpr size_t half = 1024;
+static constexpr size_t blocks = 20000;
+
+// Returns input samples per second
+template<class Filter>
+static double measure()
+{
+    static ecl::adc_stream<half, Filter> s;
+    uint32_t check = 0;
+
+    s.set_handler([&check](const uint16_t *block, size_t count) {
+        check += block[count - 1];
+    });
+
+    for (size_t i = 0; i < s.size(); ++i) {
+        s.buffer()[i] = static_cast<uint16_t>((i * 2654435761u) >> 20);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    // DMA is always in the other half
+    auto in_second = [] { return half; };
+    auto in_first = [] { return 2 * half; };
+
+    for (size_t i = 0; i < blocks; i += 2) {
+        s.on_event(ecl::adc_event::hc, in_second);
+        s.on_event(ecl::adc_event::eoc, in_first);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+    // Keep the result alive
+    CHECK(check != 1);
+    CHECK_EQUAL(blocks, s.stats().blocks);
+
+    return 1e9 * blocks * half / ns;
+}
+
+template<class Filter>
+static void report(const std::string &name)
+{
+    std::cout << std::setw(24) << name << measure<Filter>() / 1e6 << '\n';
+}
+
+TEST_GROUP(adc_stream_bench)
+{
+};
+
+TEST(adc_stream_bench, throughput)
+{
+    std::cout << "\n\nADC stream throughput, Msamples/sec\n";
+
+    report<ecl::adc_passthrough<1>>("passthrough: ");
+    report<ecl::adc_cic<1, 16, 1>>("average /16: ");
+    report<ecl::adc_cic<3, 16, 1>>("CIC3 /16: ");
+    report<ecl::adc_cic<3, 16, 4>>("CIC3 /16, 4 ch: ");
+    report<ecl::adc_cic<4, 8, 2>>("CIC4 /8, 2 ch: ");
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,281 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <common/adc_stream.hpp>
+
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+//------------------------------------------------------------------------------
+
+// Synthetic ADC signal: 12-bit noise around a per-channel level
+static std::vector<uint16_t> make_signal(size_t frames, size_t channels, unsigned seed)
+{
+    std::vector<uint16_t> ret(frames * channels);
+    srand(seed);
+
+    for (size_t i = 0; i < ret.size(); ++i) {
+        size_t ch = i % channels;
+        ret[i] = static_cast<uint16_t>((500 + ch * 1000 + rand() % 2048) & 0xfff);
+    }
+
+    return ret;
+}
+
+// Direct form of the CIC filter: input convolved with boxcar of length
+// Ratio, Order times, taken at each Ratio-th sample
+static std::vector<uint16_t> reference_cic(const std::vector<uint16_t> &in, size_t order,
+                                           size_t ratio, size_t channels)
+{
+    std::vector<uint64_t> h{1};
+
+    for (size_t s = 0; s < order; ++s) {
+        std::vector<uint64_t> next(h.size() + ratio - 1, 0);
+
+        for (size_t i = 0; i < h.size(); ++i) {
+            for (size_t j = 0; j < ratio; ++j) {
+                next[i + j] += h[i];
+            }
+        }
+
+        h = next;
+    }
+
+    uint64_t gain = 1;
+    for (size_t s = 0; s < order; ++s) {
+        gain *= ratio;
+    }
+
+    std::vector<uint16_t> out;
+    size_t frames = in.size() / channels;
+
+    for (size_t n = ratio - 1; n < frames; n += ratio) {
+        for (size_t ch = 0; ch < channels; ++ch) {
+            uint64_t acc = 0;
+
+            for (size_t k = 0; k < h.size() && k <= n; ++k) {
+                acc += h[k] * in[(n - k) * channels + ch];
+            }
+
+            out.push_back(static_cast<uint16_t>(acc / gain));
+        }
+    }
+
+    return out;
+}
+
+// Simulated circular DMA: writes signal into the stream buffer and
+// reports half conversion and end of conversion events.
+template<class Stream>
+static void dma_feed(Stream &s, const std::vector<uint16_t> &signal)
+{
+    auto buf = s.buffer();
+    size_t pos = 0;
+    auto left = [&s, &pos] { return s.size() - pos; };
+
+    for (auto v : signal) {
+        buf[pos++] = v;
+
+        if (pos == s.size() / 2) {
+            s.on_event(ecl::adc_event::hc, left);
+        } else if (pos == s.size()) {
+            pos = 0;
+            s.on_event(ecl::adc_event::eoc, left);
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(adc_cic)
+{
+};
+
+TEST(adc_cic, moving_average)
+{
+    ecl::adc_cic<1, 4> f;
+    uint16_t in[] = { 1, 2, 3, 4, 100, 100, 100, 104, 0, 0, 0, 3 };
+    uint16_t out[3];
+
+    CHECK_EQUAL(3U, f.process(in, 12, out));
+    CHECK_EQUAL(2, out[0]);
+    CHECK_EQUAL(101, out[1]);
+    CHECK_EQUAL(0, out[2]);
+}
+
+TEST(adc_cic, dc_is_preserved)
+{
+    ecl::adc_cic<3, 10, 2> f;
+    uint16_t in[2 * 100];
+    uint16_t out[2 * 10];
+
+    for (size_t i = 0; i < 100; ++i) {
+        in[2 * i] = 0xfff;
+        in[2 * i + 1] = 1234;
+    }
+
+    CHECK_EQUAL(20U, f.process(in, 200, out));
+
+    // Filter settles after Order - 1 outputs
+    for (size_t i = 2; i < 10; ++i) {
+        CHECK_EQUAL(0xfff, out[2 * i]);
+        CHECK_EQUAL(1234, out[2 * i + 1]);
+    }
+}
+
+TEST(adc_cic, matches_reference)
+{
+    auto signal = make_signal(4096, 3, 42);
+
+    ecl::adc_cic<3, 16, 3> f;
+    std::vector<uint16_t> out(signal.size() / 16);
+
+    // Odd chunks, so decimation phase does not match chunk boundaries
+    size_t done = 0;
+    size_t produced = 0;
+    size_t chunk = 3 * 7;
+
+    while (done < signal.size()) {
+        auto n = std::min(chunk, signal.size() - done);
+        produced += f.process(signal.data() + done, n, out.data() + produced);
+        done += n;
+        chunk = chunk == 3 * 7 ? 3 * 40 : 3 * 7;
+    }
+
+    auto ref = reference_cic(signal, 3, 16, 3);
+
+    CHECK_EQUAL(ref.size(), produced);
+    for (size_t i = 0; i < ref.size(); ++i) {
+        CHECK_EQUAL(ref[i], out[i]);
+    }
+
+    // Starts from scratch after reset
+    f.reset();
+    CHECK_EQUAL(9U, f.process(signal.data(), 3 * 48, out.data()));
+    for (size_t i = 0; i < 9; ++i) {
+        CHECK_EQUAL(ref[i], out[i]);
+    }
+}
+
+TEST(adc_cic, non_power_of_2_gain)
+{
+    auto signal = make_signal(3000, 1, 7);
+
+    ecl::adc_cic<2, 5> f;
+    std::vector<uint16_t> out(signal.size() / 5);
+
+    CHECK_EQUAL(out.size(), f.process(signal.data(), signal.size(), out.data()));
+
+    auto ref = reference_cic(signal, 2, 5, 1);
+    CHECK_TRUE(ref == out);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(adc_stream)
+{
+};
+
+TEST(adc_stream, passthrough_delivers_dma_halves)
+{
+    using stream_type = ecl::adc_stream<64, ecl::adc_passthrough<2>>;
+    static stream_type s;
+
+    std::vector<const uint16_t *> blocks;
+    std::vector<uint16_t> got;
+
+    s.set_handler([&](const uint16_t *block, size_t count) {
+        blocks.push_back(block);
+        got.insert(got.end(), block, block + count);
+    });
+
+    auto signal = make_signal(64 * 3, 2, 1);
+    dma_feed(s, signal);
+
+    CHECK_EQUAL(6U, blocks.size());
+    CHECK_EQUAL(6U, s.stats().blocks);
+    CHECK_EQUAL(0U, s.stats().missed);
+    CHECK_TRUE(signal == got);
+
+    // Blocks are not copied
+    POINTERS_EQUAL(s.buffer(), blocks[0]);
+    POINTERS_EQUAL(s.buffer() + 64, blocks[1]);
+}
+
+TEST(adc_stream, decimated_blocks)
+{
+    using filter_type = ecl::adc_cic<3, 8, 4>;
+    using stream_type = ecl::adc_stream<256, filter_type>;
+    static stream_type s;
+
+    CHECK_EQUAL(32U, stream_type::block_size);
+
+    std::vector<uint16_t> got;
+    size_t calls = 0;
+
+    s.set_handler([&](const uint16_t *block, size_t count) {
+        CHECK_EQUAL(stream_type::block_size, count);
+        got.insert(got.end(), block, block + count);
+        calls++;
+    });
+
+    auto signal = make_signal(64 * 10, 4, 3);
+    dma_feed(s, signal);
+
+    // State is kept across blocks, so the result matches filtering of
+    // the whole signal at once
+    CHECK_EQUAL(10U, calls);
+    CHECK_TRUE(reference_cic(signal, 3, 8, 4) == got);
+}
+
+TEST(adc_stream, missed_events_and_overruns)
+{
+    ecl::adc_stream<16, ecl::adc_cic<1, 2>> s;
+    size_t calls = 0;
+
+    s.set_handler([&](const uint16_t *, size_t count) {
+        CHECK_EQUAL(8U, count);
+        calls++;
+    });
+
+    // Samples DMA has left until the end of the 32-sample buffer
+    size_t left = 0;
+    auto dma = [&left] { return left; };
+
+    // DMA is in the other half
+    left = 16;
+    s.on_event(ecl::adc_event::hc, dma);
+    left = 32;
+    s.on_event(ecl::adc_event::eoc, dma);
+    left = 1;
+    s.on_event(ecl::adc_event::hc, dma);
+    CHECK_EQUAL(0U, s.stats().missed);
+
+    // DMA wrapped around and overwrites the first half
+    left = 30;
+    s.on_event(ecl::adc_event::hc, dma);
+    CHECK_EQUAL(1U, s.stats().missed);
+
+    // DMA already reached the second half
+    left = 16;
+    s.on_event(ecl::adc_event::eoc, dma);
+    CHECK_EQUAL(2U, s.stats().missed);
+
+    s.on_event(ecl::adc_event::ovr, dma);
+    CHECK_EQUAL(1U, s.stats().overruns);
+    CHECK_EQUAL(5U, s.stats().blocks);
+    CHECK_EQUAL(5U, calls);
+
+    s.reset_stats();
+    CHECK_EQUAL(0U, s.stats().missed);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
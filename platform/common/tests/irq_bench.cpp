@@ -0,0 +1,69 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Cost of IRQ dispatch, in the configured dispatch mode.
+
+#include <common/irq.hpp>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+extern "C" void core_isr();
+
+static constexpr auto iterations = 10000000;
+
+// Typical driver, handling IRQ in a member function
+struct driver
+{
+    void irq_handler() { events++; }
+
+    volatile int events = 0;
+};
+
+TEST_GROUP(irq_bench)
+{
+};
+
+TEST(irq_bench, dispatch_cost)
+{
+    driver drv;
+    auto irqn = static_cast<ecl::irq_num>(2);
+
+    ecl::irq::disable();
+    ecl::irq::init_storage();
+    ecl::irq::subscribe(irqn, [&drv] { drv.irq_handler(); });
+
+    ecl::irq::current_irqn() = irqn;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        core_isr();
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+
+#if THECORE_IRQ_DISPATCH_TABLE
+    const char *mode = "table";
+#else
+    const char *mode = "std::function";
+#endif
+
+    std::cout << "\n\nIRQ dispatch cost, " << mode << ": "
+              << std::setprecision(3) << static_cast<double>(ns) / iterations
+              << " ns per IRQ\n";
+
+    CHECK_EQUAL(iterations, drv.events);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
@@ -0,0 +1,174 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <common/irq.hpp>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+extern "C" void core_isr();
+
+// Emulates IRQ, raised in the calling thread
+static void raise(int irqn)
+{
+    ecl::irq::current_irqn() = irqn;
+    ecl::irq::disable();
+    core_isr();
+    ecl::irq::enable();
+}
+
+static int called;
+
+// Handlers that observed state of the other handler
+static std::atomic<int> torn;
+
+static void plain_handler()
+{
+    called++;
+}
+
+TEST_GROUP(irq)
+{
+    void setup()
+    {
+        called = 0;
+
+        // Interrupts are disabled after reset
+        ecl::irq::disable();
+        ecl::irq::init_storage();
+
+        for (int i = 0; i < IRQ_COUNT; ++i) {
+            ecl::irq::mask_calls()[i] = 0;
+        }
+    }
+};
+
+TEST(irq, dispatch_masks_irq)
+{
+    int calls = 0;
+    ecl::irq::subscribe(static_cast<ecl::irq_num>(3), [&calls] { calls++; });
+
+    raise(3);
+    raise(3);
+
+    CHECK_EQUAL(2, calls);
+    CHECK_EQUAL(2, ecl::irq::mask_calls()[3]);
+    CHECK_EQUAL(0, ecl::irq::mask_calls()[2]);
+}
+
+TEST(irq, handler_replacement)
+{
+    int first = 0;
+    int second = 0;
+    auto irqn = static_cast<ecl::irq_num>(5);
+
+    ecl::irq::subscribe(irqn, [&first] { first++; });
+    raise(5);
+
+    ecl::irq::subscribe(irqn, [&second] { second++; });
+    raise(5);
+
+    // Function is accepted as well
+    ecl::irq::subscribe(irqn, plain_handler);
+    raise(5);
+
+    CHECK_EQUAL(1, first);
+    CHECK_EQUAL(1, second);
+    CHECK_EQUAL(1, called);
+
+    ecl::irq::unsubscribe(irqn);
+}
+
+#if THECORE_IRQ_DISPATCH_TABLE
+
+static void ctx_handler(void *ctx)
+{
+    (*static_cast<int *>(ctx))++;
+}
+
+TEST(irq, plain_function_with_context)
+{
+    int calls = 0;
+    auto irqn = static_cast<ecl::irq_num>(7);
+
+    ecl::irq::subscribe(irqn, ctx_handler, &calls);
+    raise(7);
+    raise(7);
+
+    CHECK_EQUAL(2, calls);
+}
+
+#endif // THECORE_IRQ_DISPATCH_TABLE
+
+TEST(irq, concurrent_subscribe)
+{
+    // Each subscriber installs a handler that checks it observes its own
+    // state. Torn handler would see the state of the other subscriber.
+    struct owner
+    {
+        int                 id;
+        std::atomic<int>    calls;
+    };
+
+    constexpr int subscribers = 4;
+    constexpr int rounds = 20000;
+
+    owner owners[subscribers];
+    std::atomic<int> done{0};
+    int raised = 0;
+
+    for (int i = 0; i < subscribers; ++i) {
+        owners[i].id = i;
+        owners[i].calls = 0;
+    }
+
+    auto irqn = static_cast<ecl::irq_num>(1);
+    ecl::irq::subscribe(irqn, [&owners] { owners[0].calls++; });
+
+    std::vector<std::thread> threads;
+
+    for (int i = 0; i < subscribers; ++i) {
+        threads.emplace_back([&, i] {
+            owner *o = &owners[i];
+
+            for (int j = 0; j < rounds; ++j) {
+                ecl::irq::subscribe(irqn, [o, i] {
+                    if (o->id != i) {
+                        torn++;
+                    }
+                    o->calls++;
+                });
+            }
+
+            done++;
+        });
+    }
+
+    while (done != subscribers) {
+        raise(1);
+        raised++;
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    int total = 0;
+    for (auto &o : owners) {
+        total += o.calls;
+    }
+
+    CHECK_EQUAL(0, torn);
+    CHECK_EQUAL(raised, total);
+    CHECK_EQUAL(raised, ecl::irq::mask_calls()[1]);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
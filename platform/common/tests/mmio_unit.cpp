@@ -11,6 +11,9 @@
 
 #include "common/mmio.hpp"
 
+#include <map>
+#include <vector>
+
 using namespace ecl::mmio;
 
 //------------------------------------------------------------------------------
@@ -203,6 +206,168 @@ TEST(mmio_reg, at_middle)
     mock().checkExpectations();
 }
 
+//------------------------------------------------------------------------------
+
+// Simulated registers, counting bus accesses
+struct sim_bus
+{
+    static uint32_t &at(volatile const uint32_t *device)
+    {
+        return regs[reinterpret_cast<std::uintptr_t>(device)];
+    }
+
+    static void reset()
+    {
+        regs.clear();
+        reads = writes = 0;
+        written.clear();
+    }
+
+    static std::map<std::uintptr_t, uint32_t>   regs;
+    static int                                  reads;
+    static int                                  writes;
+    static std::vector<std::uintptr_t>          written;    // Addresses, in order of writes
+};
+
+std::map<std::uintptr_t, uint32_t> sim_bus::regs;
+int sim_bus::reads;
+int sim_bus::writes;
+std::vector<std::uintptr_t> sim_bus::written;
+
+struct sim_rw_mut
+{
+    static uint32_t read(volatile const uint32_t *device, uint32_t offset, uint32_t mask)
+    {
+        sim_bus::reads++;
+        return (sim_bus::at(device) & mask) >> offset;
+    }
+
+    static void write(volatile uint32_t *device, uint32_t offset, uint32_t mask, uint32_t value)
+    {
+        // Read-modify-write
+        uint32_t old = read(device, 0, 0xffffffff);
+
+        sim_bus::writes++;
+        sim_bus::written.push_back(reinterpret_cast<std::uintptr_t>(device));
+        sim_bus::at(device) = (old & ~mask) | ((value << offset) & mask);
+    }
+};
+
+struct sim_wo_mut
+{
+    static void write(volatile uint32_t *device, uint32_t offset, uint32_t mask, uint32_t value)
+    {
+        sim_bus::writes++;
+        sim_bus::written.push_back(reinterpret_cast<std::uintptr_t>(device));
+        sim_bus::at(device) = (value << offset) & mask;
+    }
+};
+
+// Peripheral with control, prescaler and write-only command registers
+static constexpr std::uintptr_t cr_addr  = 0x1000;
+static constexpr std::uintptr_t psc_addr = 0x1004;
+static constexpr std::uintptr_t cmd_addr = 0x1008;
+
+using cr_en     = reg<sim_rw_mut, cr_addr, 0, 1>;
+using cr_mode   = reg<sim_rw_mut, cr_addr, 1, 2>;
+using cr_div    = reg<sim_rw_mut, cr_addr, 4, 4>;
+using cr_irq    = reg<sim_rw_mut, cr_addr, 8, 3>;
+using cr_dma    = reg<sim_rw_mut, cr_addr, 12, 1>;
+using psc_val   = reg<sim_rw_mut, psc_addr, 0, 16>;
+using cmd_op    = reg<sim_wo_mut, cmd_addr, 0, 4>;
+using cmd_arg   = reg<sim_wo_mut, cmd_addr, 8, 8>;
+
+TEST_GROUP(mmio_modify)
+{
+    void setup()
+    {
+        sim_bus::reset();
+
+        // Bits, not covered by fields, must stay untouched
+        sim_bus::regs[cr_addr] = 0xf0000000;
+        sim_bus::regs[psc_addr] = 0xffff0000;
+    }
+};
+
+TEST(mmio_modify, per_field_writes)
+{
+    // Baseline: read-modify-write for each field
+    cr_en::write(1);
+    cr_mode::write(2);
+    cr_div::write(0xa);
+    cr_irq::write(5);
+    cr_dma::write(1);
+
+    CHECK_EQUAL(5, sim_bus::reads);
+    CHECK_EQUAL(5, sim_bus::writes);
+    CHECK_EQUAL(0xf00015a5, sim_bus::regs[cr_addr]);
+}
+
+TEST(mmio_modify, fields_of_single_register)
+{
+    modify(cr_en::val(1), cr_mode::val(2), cr_div::val(0xa), cr_irq::val(5), cr_dma::val(1));
+
+    CHECK_EQUAL(1, sim_bus::reads);
+    CHECK_EQUAL(1, sim_bus::writes);
+    CHECK_EQUAL(0xf00015a5, sim_bus::regs[cr_addr]);
+
+    // Order of fields does not matter, other fields are kept
+    modify(cr_div::val(3), cr_en::val(0));
+
+    CHECK_EQUAL(2, sim_bus::reads);
+    CHECK_EQUAL(2, sim_bus::writes);
+    CHECK_EQUAL(0xf0001534, sim_bus::regs[cr_addr]);
+}
+
+TEST(mmio_modify, values_are_masked)
+{
+    modify(cr_mode::val(0xff), cr_en::val(0));
+
+    CHECK_EQUAL(0xf0000006, sim_bus::regs[cr_addr]);
+}
+
+TEST(mmio_modify, several_registers_in_order)
+{
+    modify(psc_val::val(999), cr_en::val(1), cmd_op::val(3), cr_mode::val(1),
+           cmd_arg::val(0x42));
+
+    // Each register accessed once, in order of first appearance
+    CHECK_EQUAL(3, sim_bus::writes);
+    CHECK_EQUAL(3U, sim_bus::written.size());
+    CHECK_EQUAL(psc_addr, sim_bus::written[0]);
+    CHECK_EQUAL(cr_addr, sim_bus::written[1]);
+    CHECK_EQUAL(cmd_addr, sim_bus::written[2]);
+
+    // Write-only register is not read
+    CHECK_EQUAL(2, sim_bus::reads);
+
+    CHECK_EQUAL(0xffff0000 | 999, sim_bus::regs[psc_addr]);
+    CHECK_EQUAL(0xf0000003, sim_bus::regs[cr_addr]);
+    CHECK_EQUAL(0x4203, sim_bus::regs[cmd_addr]);
+}
+
+TEST(mmio_modify, reg_set)
+{
+    using cr_cfg = reg_set<cr_en, cr_mode, cr_irq>;
+
+    CHECK_EQUAL(0x707, cr_cfg::mask);
+
+    cr_cfg::write(1, 3, 6);
+
+    CHECK_EQUAL(1, sim_bus::reads);
+    CHECK_EQUAL(1, sim_bus::writes);
+    CHECK_EQUAL(0xf0000607, sim_bus::regs[cr_addr]);
+
+    uint32_t en = 0, mode = 0;
+    uint8_t irq = 0;
+    cr_cfg::read(en, mode, irq);
+
+    CHECK_EQUAL(2, sim_bus::reads);
+    CHECK_EQUAL(1, en);
+    CHECK_EQUAL(3, mode);
+    CHECK_EQUAL(6, irq);
+}
+
 int main(int argc, char *argv[])
 {
     return CommandLineTestRunner::RunAllTests(argc, argv);
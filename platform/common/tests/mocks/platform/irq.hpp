@@ -0,0 +1,80 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief IRQ interface mock, for testing IRQ manager on the host.
+//! \details Interrupts are emulated with threads. Code that disables
+//! interrupts and emulated ISR are mutually exclusive.
+
+#ifndef PLATFORM_IRQ_MOCK_HPP_
+#define PLATFORM_IRQ_MOCK_HPP_
+
+#include <mutex>
+
+namespace ecl
+{
+
+enum irq_num : int
+{
+};
+
+namespace irq
+{
+
+//! Per IRQ counters of mask calls. Only emulated ISR modifies them.
+inline int *mask_calls()
+{
+    static int calls[IRQ_COUNT];
+    return calls;
+}
+
+//! Lock held while interrupts are disabled or ISR is executed.
+inline std::mutex &global_lock()
+{
+    static std::mutex lock;
+    return lock;
+}
+
+//! IRQ, emulated by the calling thread.
+inline int &current_irqn()
+{
+    static thread_local int irqn;
+    return irqn;
+}
+
+inline void mask(irq_num irqn)
+{
+    mask_calls()[irqn]++;
+}
+
+inline void unmask(irq_num irqn)
+{
+    (void)irqn;
+}
+
+inline irq_num get_current_irqn()
+{
+    return static_cast<irq_num>(current_irqn());
+}
+
+inline bool in_isr()
+{
+    return false;
+}
+
+inline void disable()
+{
+    global_lock().lock();
+}
+
+inline void enable()
+{
+    global_lock().unlock();
+}
+
+} // namespace irq
+
+} // namespace ecl
+
+#endif // PLATFORM_IRQ_MOCK_HPP_
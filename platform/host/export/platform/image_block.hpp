@@ -0,0 +1,398 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief Block device backed by a disk image file on the host.
+//! \details Provides the same static interface as block device drivers,
+//! like ecl::sdspi, so filesystems can be exercised and benchmarked
+//! against a disk image on a host machine.
+#ifndef THE_CORE_HOST_PLATFORM_IMAGE_BLOCK_HPP_
+#define THE_CORE_HOST_PLATFORM_IMAGE_BLOCK_HPP_
+
+#include <ecl/err.hpp>
+#include <ecl/assert.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+namespace ecl
+{
+
+//! \addtogroup platform Platform defintions and drivers
+//! @{
+
+//! \addtogroup host Host platform
+//! @{
+
+//! \defgroup host_image_block Disk image block device
+//! @{
+
+//! Access method to the disk image.
+enum class image_access
+{
+    file, //!< Image is accessed with pread()/pwrite().
+    mmap, //!< Image is mapped into memory. Allows zero-copy reads.
+};
+
+//! Image access profile without any delays.
+struct image_profile_none
+{
+    //! Delay of every read command, in microseconds.
+    static constexpr uint32_t read_latency_us = 0;
+    //! Delay of every write and flush command, in microseconds.
+    static constexpr uint32_t write_latency_us = 0;
+    //! Transfer speed in bytes per millisecond. Zero means unlimited.
+    static constexpr uint32_t bytes_per_ms = 0;
+    //! If true, delays are spent in real time. Otherwise, delays are
+    //! only accounted in the statistics.
+    static constexpr bool realtime = false;
+};
+
+//! Image access profile, similar to the SD card connected over SPI.
+//! \details Single-block command latencies of a typical class 4-10 card,
+//! SPI bus clocked at 25 MHz.
+struct image_profile_sdspi
+{
+    //! \copydoc image_profile_none::read_latency_us
+    static constexpr uint32_t read_latency_us = 300;
+    //! \copydoc image_profile_none::write_latency_us
+    static constexpr uint32_t write_latency_us = 1000;
+    //! \copydoc image_profile_none::bytes_per_ms
+    static constexpr uint32_t bytes_per_ms = 3000;
+    //! \copydoc image_profile_none::realtime
+    static constexpr bool realtime = true;
+};
+
+//! Image block device statistics.
+struct image_block_stats
+{
+    uint32_t    reads;          //!< Read commands issued.
+    uint32_t    writes;         //!< Write commands issued.
+    uint32_t    flushes;        //!< Flush commands issued.
+    uint64_t    bytes_read;     //!< Bytes read, including zero-copy reads.
+    uint64_t    bytes_written;  //!< Bytes written.
+    uint64_t    busy_us;        //!< Delay time accumulated, according to profile.
+};
+
+//! Block device backed by a disk image file.
+//! \tparam Image   Image description. Must provide static function
+//!                 path() that returns a path to the existing image.
+//!                 Image size is fixed, it is not extended by writes.
+//! \tparam access  Image access method.
+//! \tparam Profile Delay profile, see image_profile_none for the
+//!                 required members.
+template<class Image, image_access access = image_access::file,
+         class Profile = image_profile_none>
+class image_block
+{
+public:
+    //! Opens the image.
+    //! \pre Un-initialized device.
+    //! \post Initialized device. Offset is set to 0.
+    //! \retval err::noent      Image not found.
+    //! \retval err::io         Image can't be opened or mapped.
+    //! \retval err::ok         Operation succeed.
+    static err init();
+
+    //! Closes the image.
+    //! \pre Initialized device.
+    //! \post Uninitialized device.
+    //! \retval err::ok         Operation succeed.
+    static err deinit();
+
+    //! Writes given data to the image from current offset.
+    //! \pre  Initialized device.
+    //! \post Current offset is increased by the amount of data written.
+    //! \param[in]      data    Data to write.
+    //! \param[in,out]  count   Data size in bytes to write on entry.
+    //!                         Data bytes actually written on exit.
+    //!                         Less than requested at the end of the image.
+    //! \retval err::io         I/O error.
+    //! \retval err::ok         Operation succeed.
+    static err write(const uint8_t *data, size_t &count);
+
+    //! Reads data from the image from current offset to given buffer.
+    //! \pre  Initialized device.
+    //! \post Current offset is increased by the amount of data read.
+    //! \param[out]     data    Buffer to store data into.
+    //! \param[in,out]  count   Data size in bytes to read on entry.
+    //!                         Data bytes actually read on exit.
+    //!                         Less than requested at the end of the image.
+    //! \retval err::io         I/O error.
+    //! \retval err::ok         Operation succeed.
+    static err read(uint8_t *data, size_t &count);
+
+    //! Provides direct access to the image data from current offset.
+    //! \pre  Initialized device, mapped into memory.
+    //! \post Current offset is increased by the amount of data provided.
+    //! \details Same as read(), but without copying. Data remains valid
+    //! until deinit() is called.
+    //! \param[out]     data    Pointer to the data.
+    //! \param[in,out]  count   Data size in bytes to read on entry.
+    //!                         Data bytes actually available on exit.
+    //! \retval err::ok         Operation succeed.
+    static err map(const uint8_t *&data, size_t &count);
+
+    //! Flushes written data to the image file.
+    //! \pre  Initialized device.
+    //! \retval err::io         I/O error.
+    //! \retval err::ok         Operation succeed.
+    static err flush();
+
+    //! Seeks to the given position, in bytes.
+    //! \pre  Initialized device.
+    //! \param[in] offt         New offset in bytes.
+    //! \retval err::inval      Offset is outside of the image.
+    //! \retval err::ok         Operation succeed.
+    static err seek(off_t offt);
+
+    //! Tells current position.
+    //! \pre  Initialized device.
+    //! \param[out] offt        Current offset.
+    //! \retval err::ok         Operation succeed.
+    static err tell(off_t &offt);
+
+    //! Gets size of the image in bytes.
+    //! \pre  Initialized device.
+    static size_t size();
+
+    //! Gets device statistics.
+    //! \details Statistics are collected since last init() or
+    //! reset_stats() call.
+    static const image_block_stats &get_stats();
+
+    //! Resets device statistics.
+    static void reset_stats();
+
+private:
+    //! Accounts and, if required by the profile, spends delay
+    //! of the command transferring given amount of bytes.
+    static void delay(uint32_t latency_us, size_t bytes);
+
+    struct ctx
+    {
+        int                 fd;     //!< Image file descriptor.
+        uint8_t             *mem;   //!< Image mapping, if used.
+        size_t              size;   //!< Image size.
+        off_t               offt;   //!< Current offset.
+        image_block_stats   stats;  //!< Statistics.
+    };
+
+    static ctx m_ctx;
+};
+
+template<class Image, image_access access, class Profile>
+typename image_block<Image, access, Profile>::ctx
+image_block<Image, access, Profile>::m_ctx = { -1, nullptr, 0, 0, {} };
+
+//------------------------------------------------------------------------------
+
+template<class Image, image_access access, class Profile>
+err image_block<Image, access, Profile>::init()
+{
+    ecl_assert(m_ctx.fd < 0);
+
+    int fd = ::open(Image::path(), O_RDWR);
+    if (fd < 0) {
+        return errno == ENOENT ? err::noent : err::io;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        ::close(fd);
+        return err::io;
+    }
+
+    m_ctx.size = st.st_size;
+
+    if (access == image_access::mmap && m_ctx.size) {
+        void *mem = mmap(nullptr, m_ctx.size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mem == MAP_FAILED) {
+            ::close(fd);
+            return err::io;
+        }
+
+        m_ctx.mem = static_cast<uint8_t*>(mem);
+    }
+
+    m_ctx.fd = fd;
+    m_ctx.offt = 0;
+    m_ctx.stats = image_block_stats{};
+
+    return err::ok;
+}
+
+template<class Image, image_access access, class Profile>
+err image_block<Image, access, Profile>::deinit()
+{
+    ecl_assert(m_ctx.fd >= 0);
+
+    if (m_ctx.mem) {
+        munmap(m_ctx.mem, m_ctx.size);
+        m_ctx.mem = nullptr;
+    }
+
+    ::close(m_ctx.fd);
+    m_ctx.fd = -1;
+
+    return err::ok;
+}
+
+template<class Image, image_access access, class Profile>
+err image_block<Image, access, Profile>::write(const uint8_t *data, size_t &count)
+{
+    ecl_assert(m_ctx.fd >= 0);
+    ecl_assert(data);
+
+    count = std::min(count, m_ctx.size - static_cast<size_t>(m_ctx.offt));
+
+    if (access == image_access::mmap) {
+        std::copy(data, data + count, m_ctx.mem + m_ctx.offt);
+    } else if (pwrite(m_ctx.fd, data, count, m_ctx.offt) != static_cast<ssize_t>(count)) {
+        count = 0;
+        return err::io;
+    }
+
+    m_ctx.offt += count;
+    m_ctx.stats.writes++;
+    m_ctx.stats.bytes_written += count;
+    delay(Profile::write_latency_us, count);
+
+    return err::ok;
+}
+
+template<class Image, image_access access, class Profile>
+err image_block<Image, access, Profile>::read(uint8_t *data, size_t &count)
+{
+    ecl_assert(m_ctx.fd >= 0);
+    ecl_assert(data);
+
+    count = std::min(count, m_ctx.size - static_cast<size_t>(m_ctx.offt));
+
+    if (access == image_access::mmap) {
+        std::copy(m_ctx.mem + m_ctx.offt, m_ctx.mem + m_ctx.offt + count, data);
+    } else if (pread(m_ctx.fd, data, count, m_ctx.offt) != static_cast<ssize_t>(count)) {
+        count = 0;
+        return err::io;
+    }
+
+    m_ctx.offt += count;
+    m_ctx.stats.reads++;
+    m_ctx.stats.bytes_read += count;
+    delay(Profile::read_latency_us, count);
+
+    return err::ok;
+}
+
+template<class Image, image_access access, class Profile>
+err image_block<Image, access, Profile>::map(const uint8_t *&data, size_t &count)
+{
+    static_assert(access == image_access::mmap, "Image must be mapped into memory");
+    ecl_assert(m_ctx.fd >= 0);
+
+    count = std::min(count, m_ctx.size - static_cast<size_t>(m_ctx.offt));
+    data = m_ctx.mem + m_ctx.offt;
+
+    m_ctx.offt += count;
+    m_ctx.stats.reads++;
+    m_ctx.stats.bytes_read += count;
+    delay(Profile::read_latency_us, count);
+
+    return err::ok;
+}
+
+template<class Image, image_access access, class Profile>
+err image_block<Image, access, Profile>::flush()
+{
+    ecl_assert(m_ctx.fd >= 0);
+
+    int rc = access == image_access::mmap && m_ctx.mem
+            ? msync(m_ctx.mem, m_ctx.size, MS_SYNC)
+            : fdatasync(m_ctx.fd);
+
+    m_ctx.stats.flushes++;
+    delay(Profile::write_latency_us, 0);
+
+    return rc < 0 ? err::io : err::ok;
+}
+
+template<class Image, image_access access, class Profile>
+err image_block<Image, access, Profile>::seek(off_t offt)
+{
+    ecl_assert(m_ctx.fd >= 0);
+
+    if (offt < 0 || static_cast<size_t>(offt) > m_ctx.size) {
+        return err::inval;
+    }
+
+    m_ctx.offt = offt;
+    return err::ok;
+}
+
+template<class Image, image_access access, class Profile>
+err image_block<Image, access, Profile>::tell(off_t &offt)
+{
+    ecl_assert(m_ctx.fd >= 0);
+
+    offt = m_ctx.offt;
+    return err::ok;
+}
+
+template<class Image, image_access access, class Profile>
+size_t image_block<Image, access, Profile>::size()
+{
+    ecl_assert(m_ctx.fd >= 0);
+    return m_ctx.size;
+}
+
+template<class Image, image_access access, class Profile>
+const image_block_stats &image_block<Image, access, Profile>::get_stats()
+{
+    return m_ctx.stats;
+}
+
+template<class Image, image_access access, class Profile>
+void image_block<Image, access, Profile>::reset_stats()
+{
+    m_ctx.stats = image_block_stats{};
+}
+
+//------------------------------------------------------------------------------
+
+template<class Image, image_access access, class Profile>
+void image_block<Image, access, Profile>::delay(uint32_t latency_us, size_t bytes)
+{
+    uint64_t us = latency_us;
+
+    if (Profile::bytes_per_ms) {
+        us += bytes * 1000 / Profile::bytes_per_ms;
+    }
+
+    m_ctx.stats.busy_us += us;
+
+    if (Profile::realtime && us) {
+        // Sleeping is too coarse for delays this short
+        auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(us);
+        while (std::chrono::steady_clock::now() < until) { }
+    }
+}
+
+//! @}
+
+//! @}
+
+//! @}
+
+} // namespace ecl
+
+#endif // THE_CORE_HOST_PLATFORM_IMAGE_BLOCK_HPP_
@@ -0,0 +1,236 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+#include <platform/image_block.hpp>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+static char image_path[] = "/tmp/image_block_unit_XXXXXX";
+
+struct test_image
+{
+    static const char *path() { return image_path; }
+};
+
+struct missing_image
+{
+    static const char *path() { return "/tmp/image_block_unit_missing"; }
+};
+
+// Profile with short delays, spent in real time
+struct test_profile
+{
+    static constexpr uint32_t read_latency_us = 100;
+    static constexpr uint32_t write_latency_us = 200;
+    static constexpr uint32_t bytes_per_ms = 1000;
+    static constexpr bool realtime = true;
+};
+
+using file_block = ecl::image_block<test_image, ecl::image_access::file>;
+using mmap_block = ecl::image_block<test_image, ecl::image_access::mmap>;
+using slow_block = ecl::image_block<test_image, ecl::image_access::file, test_profile>;
+
+static constexpr size_t image_size = 4096;
+
+static uint8_t pattern(size_t offt)
+{
+    return static_cast<uint8_t>(offt * 7 + (offt >> 8));
+}
+
+static std::vector<uint8_t> read_image()
+{
+    std::vector<uint8_t> data(image_size);
+    auto f = fopen(image_path, "rb");
+    CHECK_TRUE(f);
+    CHECK_EQUAL(image_size, fread(data.data(), 1, data.size(), f));
+    fclose(f);
+    return data;
+}
+
+//------------------------------------------------------------------------------
+
+template<class Block>
+static void check_read()
+{
+    uint8_t buf[600];
+    size_t count = sizeof(buf);
+
+    CHECK_EQUAL(ecl::err::ok, Block::seek(1000));
+    CHECK_EQUAL(ecl::err::ok, Block::read(buf, count));
+    CHECK_EQUAL(sizeof(buf), count);
+
+    for (size_t i = 0; i < count; ++i) {
+        CHECK_EQUAL(pattern(1000 + i), buf[i]);
+    }
+
+    off_t offt;
+    CHECK_EQUAL(ecl::err::ok, Block::tell(offt));
+    CHECK_EQUAL(1600, offt);
+
+    // Read is truncated at the end of the image
+    CHECK_EQUAL(ecl::err::ok, Block::seek(image_size - 100));
+    count = sizeof(buf);
+    CHECK_EQUAL(ecl::err::ok, Block::read(buf, count));
+    CHECK_EQUAL(100, count);
+
+    count = sizeof(buf);
+    CHECK_EQUAL(ecl::err::ok, Block::read(buf, count));
+    CHECK_EQUAL(0, count);
+
+    CHECK_EQUAL(ecl::err::inval, Block::seek(image_size + 1));
+    CHECK_EQUAL(ecl::err::inval, Block::seek(-1));
+}
+
+template<class Block>
+static void check_write()
+{
+    uint8_t buf[512];
+    std::fill(buf, buf + sizeof(buf), 0xa5);
+    size_t count = sizeof(buf);
+
+    CHECK_EQUAL(ecl::err::ok, Block::seek(512));
+    CHECK_EQUAL(ecl::err::ok, Block::write(buf, count));
+    CHECK_EQUAL(sizeof(buf), count);
+
+    // Image is not extended
+    CHECK_EQUAL(ecl::err::ok, Block::seek(image_size - 10));
+    count = sizeof(buf);
+    CHECK_EQUAL(ecl::err::ok, Block::write(buf, count));
+    CHECK_EQUAL(10, count);
+
+    CHECK_EQUAL(ecl::err::ok, Block::flush());
+
+    auto data = read_image();
+    for (size_t i = 0; i < image_size; ++i) {
+        bool written = (i >= 512 && i < 1024) || i >= image_size - 10;
+        CHECK_EQUAL(written ? 0xa5 : pattern(i), data[i]);
+    }
+
+    auto &stats = Block::get_stats();
+    CHECK_EQUAL(2, stats.writes);
+    CHECK_EQUAL(1, stats.flushes);
+    CHECK_EQUAL(522, stats.bytes_written);
+}
+
+//------------------------------------------------------------------------------
+
+TEST_GROUP(image_block)
+{
+    void setup()
+    {
+        int fd = mkstemp(image_path);
+        CHECK_TRUE(fd >= 0);
+
+        std::vector<uint8_t> data(image_size);
+        for (size_t i = 0; i < image_size; ++i) {
+            data[i] = pattern(i);
+        }
+
+        CHECK_EQUAL(image_size, write(fd, data.data(), data.size()));
+        close(fd);
+    }
+
+    void teardown()
+    {
+        unlink(image_path);
+        strcpy(image_path + strlen(image_path) - 6, "XXXXXX");
+    }
+};
+
+TEST(image_block, missing_image)
+{
+    CHECK_EQUAL(ecl::err::noent, (ecl::image_block<missing_image>::init()));
+}
+
+TEST(image_block, file_read)
+{
+    CHECK_EQUAL(ecl::err::ok, file_block::init());
+    CHECK_EQUAL(image_size, file_block::size());
+    check_read<file_block>();
+    file_block::deinit();
+}
+
+TEST(image_block, mmap_read)
+{
+    CHECK_EQUAL(ecl::err::ok, mmap_block::init());
+    CHECK_EQUAL(image_size, mmap_block::size());
+    check_read<mmap_block>();
+    mmap_block::deinit();
+}
+
+TEST(image_block, file_write)
+{
+    CHECK_EQUAL(ecl::err::ok, file_block::init());
+    check_write<file_block>();
+    file_block::deinit();
+}
+
+TEST(image_block, mmap_write)
+{
+    CHECK_EQUAL(ecl::err::ok, mmap_block::init());
+    check_write<mmap_block>();
+    mmap_block::deinit();
+}
+
+TEST(image_block, zero_copy_read)
+{
+    CHECK_EQUAL(ecl::err::ok, mmap_block::init());
+    CHECK_EQUAL(ecl::err::ok, mmap_block::seek(2000));
+
+    const uint8_t *data = nullptr;
+    size_t count = 100;
+    CHECK_EQUAL(ecl::err::ok, mmap_block::map(data, count));
+    CHECK_EQUAL(100, count);
+
+    for (size_t i = 0; i < count; ++i) {
+        CHECK_EQUAL(pattern(2000 + i), data[i]);
+    }
+
+    // Next chunk follows the previous one
+    const uint8_t *next = nullptr;
+    count = image_size;
+    CHECK_EQUAL(ecl::err::ok, mmap_block::map(next, count));
+    CHECK_EQUAL(image_size - 2100, count);
+    POINTERS_EQUAL(data + 100, next);
+
+    CHECK_EQUAL(2, mmap_block::get_stats().reads);
+    CHECK_EQUAL(image_size - 2000, mmap_block::get_stats().bytes_read);
+
+    mmap_block::deinit();
+}
+
+TEST(image_block, profile_delays)
+{
+    CHECK_EQUAL(ecl::err::ok, slow_block::init());
+
+    uint8_t buf[1000];
+    size_t count = sizeof(buf);
+
+    auto start = std::chrono::steady_clock::now();
+    CHECK_EQUAL(ecl::err::ok, slow_block::read(buf, count));
+    count = 500;
+    CHECK_EQUAL(ecl::err::ok, slow_block::write(buf, count));
+    auto end = std::chrono::steady_clock::now();
+
+    // 100 us latency plus 1000 us transfer,
+    // then 200 us latency plus 500 us transfer
+    CHECK_EQUAL(1800, slow_block::get_stats().busy_us);
+    CHECK_TRUE(end - start >= std::chrono::microseconds(1800));
+
+    slow_block::reset_stats();
+    CHECK_EQUAL(0, slow_block::get_stats().busy_us);
+
+    slow_block::deinit();
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
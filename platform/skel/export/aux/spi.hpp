@@ -137,6 +137,16 @@ public:
     //! \param[in] size Buffer size.
     static void set_tx(const uint8_t *tx, size_t size);
 
+    //! Sets scatter-gather list of buffers. Optional.
+    //! \details Platform bus may implement this method if it is able to
+    //! execute the whole list as a single xfer, e.g. using chained DMA
+    //! descriptors. Events must be reported as for contiguous buffers.
+    //! If method is not present, generic bus emulates it by transferring
+    //! segments one by one.
+    //! \param[in] iov Segment list. Must remain valid until reset_buffers().
+    //! \param[in] cnt Amount of segments.
+    static void set_iovec(const bus_iovec *iov, size_t cnt);
+
     //! Sets event handler.
     //! \details Handler will be used by the bus, until reset_handler() will be called.
     //! \param[in] handler Handler itself.
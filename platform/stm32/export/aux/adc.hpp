@@ -487,17 +487,36 @@ public:
 
     //! Performs DMA configuration for single-mode async conversion.
     static void single(const adc_evh &evh);
+
+    //! Performs DMA configuration for continuous conversion into
+    //! the circular buffer.
+    //! \details Half conversion event is reported when the first half of
+    //! the buffer is filled, end of conversion - when the second one is.
+    //! \param[in] buf   Circular buffer.
+    //! \param[in] count Buffer size in samples, even.
+    //! \param[in] evh   Event handler.
+    static void continuous(typename adc<dev>::sample_type *buf, size_t count,
+                           const adc_evh &evh);
+
+    //! Stops continuous conversion.
+    static void stop();
 private:
     //! Handles DMA IRQ.
     static void irq_handler();
 
     //! User handler of ADC events.
     static safe_storage<adc_evh> m_user_evh;
+
+    //! DMA runs in circular mode, conversion must not be stopped on TC.
+    static bool m_circular;
 };
 
 template<adc_dev dev>
 safe_storage<adc_evh> mgmt_configurator<dev, adc_mgmt_mode::dma>::m_user_evh;
 
+template<adc_dev dev>
+bool mgmt_configurator<dev, adc_mgmt_mode::dma>::m_circular;
+
 //------------------------------------------------------------------------------
 
 template<adc_dev dev>
@@ -552,6 +571,57 @@ void mgmt_configurator<dev, adc_mgmt_mode::dma>::single(const adc_evh &evh)
     ADC_DMACmd(spl_adc, ENABLE);
 }
 
+template<adc_dev dev>
+void mgmt_configurator<dev, adc_mgmt_mode::dma>::continuous(
+        typename adc<dev>::sample_type *buf, size_t count, const adc_evh &evh)
+{
+    // TODO: Use adc::pick_spl_adc() somehow
+    auto spl_adc = reinterpret_cast<ADC_TypeDef*>(dev);
+
+    m_user_evh.get() = evh;
+    m_circular = true;
+
+    adc_cfg<dev>::dma::template periph_to_mem<dma_data_sz::hword, dma_mode::circular>(
+                reinterpret_cast<volatile uint16_t*>(&spl_adc->DR),
+                reinterpret_cast<uint8_t*>(buf),
+                count * sizeof(*buf));
+
+    // Each half of the buffer is reported.
+    adc_cfg<dev>::dma::template enable_events_irq<true, true, false>();
+    adc_cfg<dev>::dma::enable();
+
+    // Keep issuing DMA requests after the last transfer, so DMA wraps around.
+    ADC_DMARequestAfterLastTransferCmd(spl_adc, ENABLE);
+    ADC_DMACmd(spl_adc, ENABLE);
+}
+
+template<adc_dev dev>
+void mgmt_configurator<dev, adc_mgmt_mode::dma>::stop()
+{
+    // TODO: Use adc::pick_spl_adc() somehow
+    auto spl_adc = reinterpret_cast<ADC_TypeDef*>(dev);
+
+    constexpr auto dma_irqn = adc_cfg<dev>::dma::get_irqn();
+
+    // Avoid race with DMA IRQ.
+    irq::mask(dma_irqn);
+
+    ADC_Cmd(spl_adc, DISABLE);
+    ADC_DMARequestAfterLastTransferCmd(spl_adc, DISABLE);
+    ADC_DMACmd(spl_adc, DISABLE);
+
+    adc_cfg<dev>::dma::disable();
+    adc_cfg<dev>::dma::clear_ht();
+    adc_cfg<dev>::dma::clear_tc();
+
+    // Restore configuration used by single conversions.
+    adc_cfg<dev>::dma::template disable_events_irq<false, true, false>();
+    m_circular = false;
+
+    irq::clear(dma_irqn);
+    irq::unmask(dma_irqn);
+}
+
 //------------------------------------------------------------------------------
 
 template<adc_dev dev>
@@ -570,7 +640,11 @@ void mgmt_configurator<dev, adc_mgmt_mode::dma>::irq_handler()
         adc_cfg<dev>::dma::clear_ht();
     }
 
-    if (adc_cfg<dev>::dma::tc()) {
+    if (adc_cfg<dev>::dma::tc() && m_circular) {
+        // DMA continues from the start of the buffer
+        m_user_evh.get()(adc_event::eoc);
+        adc_cfg<dev>::dma::clear_tc();
+    } else if (adc_cfg<dev>::dma::tc()) {
         m_user_evh.get()(adc_event::eoc);
 
         // Stop ADC
@@ -643,7 +717,34 @@ public:
     //! \todo Implement support for external triggers.
     static err single(const adc_evh &evh);
 
+    //! Starts continuous conversion of given channels into the stream.
+    //! \details DMA fills the stream buffer in circular mode. Stream is
+    //! notified each time half of the buffer is filled, in IRQ context.
+    //! Conversions are back-to-back, unless external trigger is selected
+    //! for the group. Channel samples are interleaved in the buffer,
+    //! in the order channels are listed in the group.
+    //! \pre ADC is configured in DMA mode.
+    //! \tparam Group  Group of channels to convert.
+    //! \tparam Stream Stream type, i.e. ecl::adc_stream. Must provide
+    //!                buffer(), size(), reset() and on_event(adc_event, left),
+    //!                where left() returns samples DMA has yet to write.
+    //! \param[in] stream Stream, must be valid until stop_stream() is called.
+    //! \return Result of operation.
+    //! \retval ecl::err::ok Conversion is started.
+    template<typename Group, class Stream>
+    static err start_stream(Stream &stream);
+
+    //! Stops continuous conversion, started with start_stream().
+    //! \details Single conversions require channels to be enabled again.
+    //! \return Result of operation.
+    static err stop_stream();
+
 private:
+    //! Configures ADC for given channels.
+    //! \param[in] continuous Continue to convert channels after each round.
+    template<typename Group>
+    static void configure(bool continuous);
+
     //! Picks peripheral clock asociated with given ADC.
     static constexpr auto pick_periph();
 
@@ -702,6 +803,63 @@ void adc<dev>::enable_channels(sample_array<Group> &out_samples)
 {
     // TODO: assert if inited
 
+    configure<Group>(false);
+    mgmt_configurator<dev>::template enable_channels<Group>(out_samples);
+}
+
+template<adc_dev dev>
+template<typename Group, class Stream>
+err adc<dev>::start_stream(Stream &stream)
+{
+    // TODO: assert if inited
+
+    static_assert(adc_cfg<dev>::mgtm_mode == adc_mgmt_mode::dma,
+                  "Continuous conversion requires DMA mode.");
+
+    static_assert(Stream::size() % (2 * Group::template extractor<extractor>::conv_num()) == 0,
+                  "Each half of the stream buffer must hold whole conversion rounds.");
+
+    auto spl_adc = pick_spl_adc();
+
+    configure<Group>(true);
+
+    stream.reset();
+    auto left = [] {
+        return adc_cfg<dev>::dma::bytes_left() / sizeof(sample_type);
+    };
+
+    mgmt_configurator<dev>::continuous(stream.buffer(), stream.size(),
+                                       [&stream, left](adc_event ev) { stream.on_event(ev, left); });
+
+    ADC_Cmd(spl_adc, ENABLE);
+
+    // TODO: do it in cross-family fashion
+    if (!(spl_adc->CR2 & 0x30000000)) {
+        ADC_SoftwareStartConv(spl_adc);
+    }
+
+    return err::ok;
+}
+
+template<adc_dev dev>
+err adc<dev>::stop_stream()
+{
+    // TODO: assert if inited
+
+    mgmt_configurator<dev>::stop();
+
+    m_conv_mode = conversion_mode::single;
+    ADC_ContinuousModeCmd(pick_spl_adc(), DISABLE);
+
+    return err::ok;
+}
+
+//------------------------------------------------------------------------------
+
+template<adc_dev dev>
+template<typename Group>
+void adc<dev>::configure(bool continuous)
+{
     auto spl_adc = pick_spl_adc();
 
     ADC_InitTypeDef         init_struct;
@@ -709,7 +867,7 @@ void adc<dev>::enable_channels(sample_array<Group> &out_samples)
     // Parameters that are not dependent on channels.
 
     init_struct.ADC_Resolution              = ADC_Resolution_10b;
-    init_struct.ADC_ContinuousConvMode      = DISABLE;
+    init_struct.ADC_ContinuousConvMode      = continuous ? ENABLE : DISABLE;
     init_struct.ADC_ExternalTrigConvEdge    = extract_value(Group::trigger_edge);
     init_struct.ADC_ExternalTrigConv        = extract_value(Group::trigger);
     init_struct.ADC_DataAlign               = ADC_DataAlign_Right;
@@ -726,10 +884,7 @@ void adc<dev>::enable_channels(sample_array<Group> &out_samples)
     // Init channels one by one.
     Group::template extractor<extractor>::init_channels(spl_adc);
 
-    m_conv_mode = conversion_mode::single;
-    ADC_ContinuousModeCmd(spl_adc, DISABLE);
-
-    mgmt_configurator<dev>::template enable_channels<Group>(out_samples);
+    m_conv_mode = continuous ? conversion_mode::continuous : conversion_mode::single;
 }
 
 template<adc_dev dev>
@@ -9,7 +9,6 @@
 #ifndef STM32_EXTI_MANAGER_HPP_
 #define STM32_EXTI_MANAGER_HPP_
 
-#include <ecl/list.hpp>
 #include <common/irq.hpp>
 #include <stm32_device.hpp>
 
@@ -37,16 +36,14 @@ public:
     using callback = void (*)(void *);
 
     //! External interrupt handler.
-    //! \details An object of this class is linked into the intrusive list of
-    //! EXTI handlers. Client must retain the object and make sure that it
+    //! \details A pointer to this object is stored in the table of EXTI
+    //! handlers. Client must retain the object and make sure that it
     //! will not be destroyed without deregistering.
     class handler
     {
         friend class exti_manager;
 
     public:
-        ecl::list_node m_node = {};       //!< List node of the EXTI handlers list.
-
         //! Constructs empty handler
         handler() = default;
 
@@ -121,9 +118,6 @@ public:
     static void unmask(handler &h);
 
 private:
-    //! Type of a grouped EXTI handlers container.
-    using handlers = list<handler, &handler::m_node>;
-
     //! Maps interrupts to EXTI lines.
     struct mapping
     {
@@ -155,8 +149,14 @@ private:
 
 // Not all platforms have grouped EXTI lines.
 #if CONFIG_ECL_EXTI_GROUPED_COUNT > 0
-        //! Grouped IRQ lines.
-        handlers grouped[grouped_cnt];
+        //! Amount of EXTI lines connected to GPIO.
+        static constexpr auto lines_cnt = 16;
+
+        //! Grouped EXTI handlers, indexed by EXTI line number.
+        handler  *grouped[lines_cnt]  = {};
+
+        //! Subscribed lines of each group, in the EXTI register format.
+        uint32_t group_lines[grouped_cnt] = {};
 #endif
     };
 
@@ -164,6 +164,10 @@ private:
     template<class Gpio>
     static constexpr auto extract_exti();
 
+    //! Gets EXTI line number associated with GPIO.
+    template<class Gpio>
+    static constexpr auto extract_line();
+
     //! SFINAE helper for determining EXTI type of the given GPIO
     template<typename Gpio>
     using is_direct_exti = std::enable_if_t<direct_exti<exti_manager::extract_exti<Gpio>()>(), bool>;
@@ -178,10 +182,17 @@ private:
     static void direct_isr(size_t idx, irq_num irqn);
 
     //! Handles IRQs from grouped EXTI.
-    //! \param idx Index inside grouped handlers array.
+    //! \details Pending register is read once, handlers of pending lines
+    //! are found by the line number. Cost doesn't depend on amount of
+    //! subscribed handlers.
+    //! \param idx Index of the group.
     //! \param[in] irqn IRQ number.
     static void group_isr(size_t idx, irq_num irqn);
 
+    //! Removes handler from handler tables.
+    //! \param[in] h Handler.
+    static void drop_handler(handler &h);
+
     //! Checks if direct EXTI line is already used or not.
     //! \tparam Gpio   GPIO for which EXTI line will be configured.
     //! \return true if line is already used, false otherwise.
@@ -236,10 +247,11 @@ void exti_manager::subscribe(handler &h, trigger t)
     }
 
     save_handler<Gpio>(h);
+    configure_line<Gpio>(t);
 
     // Do not let EXTI fire unless user explicitly ask for it.
+    // Line configuration unmasks the line, so it is masked afterwards.
     mask(h);
-    configure_line<Gpio>(t);
 
     __enable_irq();
 }
@@ -259,6 +271,12 @@ constexpr auto exti_manager::extract_exti()
     return spl_exti;
 }
 
+template<class Gpio>
+constexpr auto exti_manager::extract_line()
+{
+    return static_cast<typename std::underlying_type<gpio_num>::type>(Gpio::pin);
+}
+
 template<typename Gpio>
 exti_manager::is_direct_exti<Gpio> exti_manager::exti_used()
 {
@@ -274,19 +292,9 @@ exti_manager::is_direct_exti<Gpio> exti_manager::exti_used()
 template<typename Gpio>
 exti_manager::is_grouped_exti<Gpio> exti_manager::exti_used()
 {
-    // In grouped EXTIs a handler with the same exti line reside somewhere
-    // in the list.
-
-    constexpr auto exti = extract_exti<Gpio>();
-    constexpr auto idx  = get_exti_idx<exti>();
-
-    for (auto &h : map()->grouped[idx]) {
-        if (h.m_exti_line == exti) {
-            return true;
-        }
-    }
+    // Grouped EXTI handlers are indexed by the line number.
 
-    return false;
+    return map()->grouped[extract_line<Gpio>()] != nullptr;
 }
 
 template<typename Gpio>
@@ -343,7 +351,8 @@ exti_manager::is_grouped_exti<Gpio> exti_manager::save_handler(handler &h)
     constexpr auto idx  = get_exti_idx<exti>();
 
     h.m_exti_line = exti;
-    map()->grouped[idx].push_back(h);
+    map()->grouped[extract_line<Gpio>()] = &h;
+    map()->group_lines[idx] |= exti;
 
     // Dummy return value. See is_direct_exti for explanation.
     return true;
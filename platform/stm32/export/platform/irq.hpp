@@ -10,6 +10,7 @@
 #define PLATFORM_IRQ_HPP_
 
 #include <stm32_device.hpp>
+#include <aux/platform_defines.hpp>
 #include <ecl/err.hpp>
 
 #include <functional>
@@ -55,15 +55,7 @@ void exti_manager::unsubscribe(handler &h)
 {
     __disable_irq();
 
-    // Will not appear in the exti list anymore (if was present)
-    h.m_node.unlink();
-
-    // A bit slow method to remove handler from the array of direct handler.
-    for (auto &saved : map()->direct) {
-        if (saved == &h) {
-            saved = nullptr;
-        }
-    }
+    drop_handler(h);
 
     // De-configure line
 
@@ -120,13 +112,24 @@ void exti_manager::direct_isr(size_t idx, irq_num irqn)
 
 void exti_manager::group_isr(size_t idx, irq_num irqn)
 {
-    auto &handlers = map()->grouped[idx];
-    for (auto &h : handlers) {
-        auto exti = h.m_exti_line;
-        if ((EXTI->IMR | exti) && EXTI_GetITStatus(exti) == SET) {
-            mask(h);
-            EXTI_ClearFlag(h.m_exti_line);
-            h();
+    // Pending and unmasked lines of this group
+    uint32_t pending = EXTI->PR & EXTI->IMR & map()->group_lines[idx];
+
+    // Mask and acknowledge all lines at once.
+    // Handlers unmask lines when they are ready for next events.
+    __disable_irq();
+    EXTI->IMR &= ~pending;
+    __enable_irq();
+    EXTI->PR = pending;
+
+    while (pending) {
+        auto line = __builtin_ctz(pending);
+        pending &= pending - 1;
+
+        // Previous handler may have unsubscribed this one
+        auto h = map()->grouped[line];
+        if (h) {
+            (*h)();
         }
     }
 
@@ -134,6 +137,25 @@ void exti_manager::group_isr(size_t idx, irq_num irqn)
     irq::unmask(irqn);
 }
 
+void exti_manager::drop_handler(handler &h)
+{
+    for (auto &saved : map()->direct) {
+        if (saved == &h) {
+            saved = nullptr;
+        }
+    }
+
+    for (auto &saved : map()->grouped) {
+        if (saved == &h) {
+            saved = nullptr;
+
+            for (auto &lines : map()->group_lines) {
+                lines &= ~h.m_exti_line;
+            }
+        }
+    }
+}
+
 exti_manager::mapping* exti_manager::map()
 {
     return reinterpret_cast<mapping *>(&m_storage);
@@ -142,8 +164,7 @@ exti_manager::mapping* exti_manager::map()
 //------------------------------------------------------------------------------
 
 exti_manager::handler::handler(exti_manager::callback cb, void *ctx)
-    :m_node{}
-    ,m_ctx{ctx}
+    :m_ctx{ctx}
     ,m_cb{cb}
     ,m_exti_line{0}
 {
@@ -152,9 +173,8 @@ exti_manager::handler::handler(exti_manager::callback cb, void *ctx)
 
 exti_manager::handler::~handler()
 {
-    // TODO
     irq::disable();
-    m_node.unlink();
+    drop_handler(*this);
     irq::enable();
 }
 
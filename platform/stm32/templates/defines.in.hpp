@@ -36,6 +36,9 @@ cfg = cfg['menu-platform']['menu-stm32']
 if 'config-console' in cfg:
     cog.outl('#define THECORE_CONFIG_USE_CONSOLE 1')
 
+if cfg.get('config-irq-dispatch') == 'table':
+    cog.outl('#define THECORE_IRQ_DISPATCH_TABLE 1')
+
 ]]]*/
 //[[[end]]]
 
@@ -0,0 +1,231 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief EXTI manager unit test, with mocked registers.
+
+#include <platform/exti_manager.hpp>
+
+#include <map>
+#include <vector>
+
+#include <CppUTest/TestHarness.h>
+#include <CppUTest/CommandLineTestRunner.h>
+
+//------------------------------------------------------------------------------
+// Register and SPL mocks
+
+EXTI_TypeDef exti_regs;
+GPIO_TypeDef gpio_ports[8];
+
+void RCC_APB2PeriphClockCmd(uint32_t, FunctionalState) { }
+void SYSCFG_EXTILineConfig(uint8_t, uint8_t) { }
+
+void EXTI_Init(EXTI_InitTypeDef *init)
+{
+    if (init->EXTI_LineCmd == ENABLE) {
+        EXTI->IMR |= init->EXTI_Line;
+    } else {
+        EXTI->IMR &= ~init->EXTI_Line;
+    }
+}
+
+// Pending register is "write 1 to clear". Written value is kept,
+// so the test can check which lines were acknowledged.
+void EXTI_ClearFlag(uint32_t line)
+{
+    EXTI->PR = line;
+}
+
+// IRQ handlers, subscribed by the EXTI manager
+static std::map<int, ecl::irq::handler_type> irq_handlers;
+static int irq_unmasks;
+
+namespace ecl
+{
+
+namespace irq
+{
+
+void subscribe(irq_num irqn, const handler_type &handler)
+{
+    irq_handlers[irqn] = handler;
+}
+
+void mask(irq_num) { }
+void unmask(irq_num) { irq_unmasks++; }
+void clear(irq_num) { }
+
+} // namespace irq
+
+} // namespace ecl
+
+//------------------------------------------------------------------------------
+
+template<ecl::gpio_num pin>
+using gpio = ecl::gpio<ecl::gpio_port::a, pin>;
+
+using ecl::gpio_num;
+using trigger = ecl::exti_manager::trigger;
+
+// Lines of called handlers, in order of calls
+static std::vector<int> calls;
+
+static void handler_cb(void *ctx)
+{
+    calls.push_back(reinterpret_cast<intptr_t>(ctx));
+}
+
+static void raise(IRQn irqn)
+{
+    irq_handlers.at(irqn)();
+}
+
+static uint32_t line(int n)
+{
+    return 1 << n;
+}
+
+TEST_GROUP(exti)
+{
+    void setup()
+    {
+        memset(&exti_regs, 0, sizeof(exti_regs));
+        irq_handlers.clear();
+        calls.clear();
+
+        ecl::exti_manager::init();
+        irq_unmasks = 0;
+    }
+};
+
+TEST(exti, grouped_pending_lines_dispatched)
+{
+    ecl::exti_manager::handler h10{handler_cb, reinterpret_cast<void *>(10)};
+    ecl::exti_manager::handler h12{handler_cb, reinterpret_cast<void *>(12)};
+    ecl::exti_manager::handler h15{handler_cb, reinterpret_cast<void *>(15)};
+
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin10>>(h10, trigger::rising);
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin12>>(h12, trigger::falling);
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin15>>(h15, trigger::both);
+
+    // Lines are masked until user unmasks them
+    CHECK_EQUAL(0, EXTI->IMR);
+
+    ecl::exti_manager::unmask(h10);
+    ecl::exti_manager::unmask(h12);
+    ecl::exti_manager::unmask(h15);
+    CHECK_EQUAL(line(10) | line(12) | line(15), EXTI->IMR);
+
+    // Line 11 has no handler, line 3 belongs to other IRQ
+    EXTI->PR = line(3) | line(11) | line(12) | line(15);
+    raise(EXTI15_10_IRQn);
+
+    CHECK_EQUAL(2, calls.size());
+    CHECK_EQUAL(12, calls[0]);
+    CHECK_EQUAL(15, calls[1]);
+
+    // Dispatched lines are acknowledged and masked
+    CHECK_EQUAL(line(12) | line(15), EXTI->PR);
+    CHECK_EQUAL(line(10), EXTI->IMR);
+    CHECK_EQUAL(1, irq_unmasks);
+}
+
+TEST(exti, masked_line_not_dispatched)
+{
+    ecl::exti_manager::handler h5{handler_cb, reinterpret_cast<void *>(5)};
+    ecl::exti_manager::handler h7{handler_cb, reinterpret_cast<void *>(7)};
+
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin5>>(h5, trigger::rising);
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin7>>(h7, trigger::rising);
+
+    ecl::exti_manager::unmask(h5);
+
+    EXTI->PR = line(5) | line(7);
+    raise(EXTI9_5_IRQn);
+
+    CHECK_EQUAL(1, calls.size());
+    CHECK_EQUAL(5, calls[0]);
+
+    // Masked line stays pending
+    CHECK_EQUAL(line(5), EXTI->PR);
+}
+
+TEST(exti, groups_are_isolated)
+{
+    ecl::exti_manager::handler h6{handler_cb, reinterpret_cast<void *>(6)};
+    ecl::exti_manager::handler h14{handler_cb, reinterpret_cast<void *>(14)};
+
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin6>>(h6, trigger::rising);
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin14>>(h14, trigger::rising);
+    ecl::exti_manager::unmask(h6);
+    ecl::exti_manager::unmask(h14);
+
+    EXTI->PR = line(6) | line(14);
+    raise(EXTI15_10_IRQn);
+
+    CHECK_EQUAL(1, calls.size());
+    CHECK_EQUAL(14, calls[0]);
+
+    EXTI->PR = line(6);
+    raise(EXTI9_5_IRQn);
+
+    CHECK_EQUAL(2, calls.size());
+    CHECK_EQUAL(6, calls[1]);
+}
+
+TEST(exti, unsubscribed_handlers_removed)
+{
+    ecl::exti_manager::handler h8{handler_cb, reinterpret_cast<void *>(8)};
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin8>>(h8, trigger::rising);
+    ecl::exti_manager::unmask(h8);
+
+    {
+        ecl::exti_manager::handler h9{handler_cb, reinterpret_cast<void *>(9)};
+        ecl::exti_manager::subscribe<gpio<gpio_num::pin9>>(h9, trigger::rising);
+        ecl::exti_manager::unmask(h9);
+    }
+
+    // Handler for line 9 is destroyed, stale line state is ignored
+    EXTI->PR = line(8) | line(9);
+    raise(EXTI9_5_IRQn);
+
+    CHECK_EQUAL(1, calls.size());
+    CHECK_EQUAL(8, calls[0]);
+
+    ecl::exti_manager::unsubscribe(h8);
+
+    EXTI->IMR = line(8);
+    EXTI->PR = line(8);
+    raise(EXTI9_5_IRQn);
+
+    CHECK_EQUAL(1, calls.size());
+
+    // Line can be used again
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin8>>(h8, trigger::falling);
+    ecl::exti_manager::unmask(h8);
+    EXTI->PR = line(8);
+    raise(EXTI9_5_IRQn);
+
+    CHECK_EQUAL(2, calls.size());
+}
+
+TEST(exti, direct_line)
+{
+    ecl::exti_manager::handler h2{handler_cb, reinterpret_cast<void *>(2)};
+    ecl::exti_manager::subscribe<gpio<gpio_num::pin2>>(h2, trigger::rising);
+    ecl::exti_manager::unmask(h2);
+
+    EXTI->PR = line(2);
+    raise(EXTI2_IRQn);
+
+    CHECK_EQUAL(1, calls.size());
+    CHECK_EQUAL(2, calls[0]);
+    CHECK_EQUAL(0, EXTI->IMR);
+}
+
+int main(int argc, char *argv[])
+{
+    return CommandLineTestRunner::RunAllTests(argc, argv);
+}
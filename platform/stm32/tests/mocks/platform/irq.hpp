@@ -0,0 +1,33 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief STM32 IRQ interface mock.
+//! \details Functions are defined by the test.
+
+#ifndef PLATFORM_IRQ_MOCK_HPP_
+#define PLATFORM_IRQ_MOCK_HPP_
+
+#include <stm32_device.hpp>
+
+namespace ecl
+{
+
+using irq_num = IRQn_Type;
+
+namespace irq
+{
+
+void mask(irq_num irqn);
+void unmask(irq_num irqn);
+void clear(irq_num irqn);
+
+inline void disable() { }
+inline void enable() { }
+
+} // namespace irq
+
+} // namespace ecl
+
+#endif // PLATFORM_IRQ_MOCK_HPP_
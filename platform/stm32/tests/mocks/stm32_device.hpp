@@ -0,0 +1,144 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/. */
+
+//! \file
+//! \brief STM32 device mock, for testing platform code on the host.
+//! \details Registers are plain variables, defined by the test.
+//! SPL functions are declared here and defined by the test, if used.
+
+#ifndef STM32_DEVICE_MOCK_HPP_
+#define STM32_DEVICE_MOCK_HPP_
+
+#include <cstdint>
+#include <utility>
+
+#define CONFIG_ECL_EXTI_DIRECT_COUNT 5
+#define CONFIG_ECL_EXTI_GROUPED_COUNT 2
+
+typedef enum
+{
+    EXTI0_IRQn      = 6,
+    EXTI1_IRQn      = 7,
+    EXTI2_IRQn      = 8,
+    EXTI3_IRQn      = 9,
+    EXTI4_IRQn      = 10,
+    EXTI9_5_IRQn    = 23,
+    EXTI15_10_IRQn  = 40,
+} IRQn;
+
+typedef IRQn IRQn_Type;
+
+typedef enum { RESET = 0, SET = !RESET } FlagStatus, ITStatus;
+typedef enum { DISABLE = 0, ENABLE = !DISABLE } FunctionalState;
+
+inline void __disable_irq() { }
+inline void __enable_irq() { }
+
+//------------------------------------------------------------------------------
+// RCC, SYSCFG
+
+#define RCC_APB2Periph_SYSCFG ((uint32_t)0x00004000)
+
+void RCC_APB2PeriphClockCmd(uint32_t periph, FunctionalState state);
+void SYSCFG_EXTILineConfig(uint8_t port, uint8_t pin);
+
+//------------------------------------------------------------------------------
+// GPIO
+
+struct GPIO_TypeDef { };
+
+extern GPIO_TypeDef gpio_ports[8];
+
+#define GPIOA (&gpio_ports[0])
+#define GPIOB (&gpio_ports[1])
+#define GPIOC (&gpio_ports[2])
+#define GPIOD (&gpio_ports[3])
+#define GPIOE (&gpio_ports[4])
+#define GPIOF (&gpio_ports[5])
+#define GPIOG (&gpio_ports[6])
+#define GPIOH (&gpio_ports[7])
+
+#define GPIO_Pin_0  ((uint16_t)0x0001)
+#define GPIO_Pin_1  ((uint16_t)0x0002)
+#define GPIO_Pin_2  ((uint16_t)0x0004)
+#define GPIO_Pin_3  ((uint16_t)0x0008)
+#define GPIO_Pin_4  ((uint16_t)0x0010)
+#define GPIO_Pin_5  ((uint16_t)0x0020)
+#define GPIO_Pin_6  ((uint16_t)0x0040)
+#define GPIO_Pin_7  ((uint16_t)0x0080)
+#define GPIO_Pin_8  ((uint16_t)0x0100)
+#define GPIO_Pin_9  ((uint16_t)0x0200)
+#define GPIO_Pin_10 ((uint16_t)0x0400)
+#define GPIO_Pin_11 ((uint16_t)0x0800)
+#define GPIO_Pin_12 ((uint16_t)0x1000)
+#define GPIO_Pin_13 ((uint16_t)0x2000)
+#define GPIO_Pin_14 ((uint16_t)0x4000)
+#define GPIO_Pin_15 ((uint16_t)0x8000)
+
+typedef enum { Bit_RESET = 0, Bit_SET } BitAction;
+
+void GPIO_WriteBit(GPIO_TypeDef *port, uint16_t pin, BitAction val);
+void GPIO_ToggleBits(GPIO_TypeDef *port, uint16_t pin);
+uint8_t GPIO_ReadInputDataBit(GPIO_TypeDef *port, uint16_t pin);
+
+//------------------------------------------------------------------------------
+// EXTI
+
+struct EXTI_TypeDef
+{
+    volatile uint32_t IMR;
+    volatile uint32_t EMR;
+    volatile uint32_t RTSR;
+    volatile uint32_t FTSR;
+    volatile uint32_t SWIER;
+    volatile uint32_t PR;
+};
+
+extern EXTI_TypeDef exti_regs;
+
+#define EXTI (&exti_regs)
+
+#define EXTI_Line0  ((uint32_t)0x00001)
+#define EXTI_Line1  ((uint32_t)0x00002)
+#define EXTI_Line2  ((uint32_t)0x00004)
+#define EXTI_Line3  ((uint32_t)0x00008)
+#define EXTI_Line4  ((uint32_t)0x00010)
+#define EXTI_Line5  ((uint32_t)0x00020)
+#define EXTI_Line6  ((uint32_t)0x00040)
+#define EXTI_Line7  ((uint32_t)0x00080)
+#define EXTI_Line8  ((uint32_t)0x00100)
+#define EXTI_Line9  ((uint32_t)0x00200)
+#define EXTI_Line10 ((uint32_t)0x00400)
+#define EXTI_Line11 ((uint32_t)0x00800)
+#define EXTI_Line12 ((uint32_t)0x01000)
+#define EXTI_Line13 ((uint32_t)0x02000)
+#define EXTI_Line14 ((uint32_t)0x04000)
+#define EXTI_Line15 ((uint32_t)0x08000)
+
+#define IS_GET_EXTI_LINE(LINE) ((LINE) && !((LINE) & ((LINE) - 1)) && (LINE) <= EXTI_Line15)
+
+typedef enum { EXTI_Mode_Interrupt = 0x00, EXTI_Mode_Event = 0x04 } EXTIMode_TypeDef;
+
+typedef enum
+{
+    EXTI_Trigger_Rising         = 0x08,
+    EXTI_Trigger_Falling        = 0x0C,
+    EXTI_Trigger_Rising_Falling = 0x10,
+} EXTITrigger_TypeDef;
+
+typedef struct
+{
+    uint32_t            EXTI_Line;
+    EXTIMode_TypeDef    EXTI_Mode;
+    EXTITrigger_TypeDef EXTI_Trigger;
+    FunctionalState     EXTI_LineCmd;
+} EXTI_InitTypeDef;
+
+void EXTI_Init(EXTI_InitTypeDef *init);
+void EXTI_ClearFlag(uint32_t line);
+
+// Real family wrapper, relies on definitions above
+#include "stm32f4xx_exti_wrap.hpp"
+
+#endif // STM32_DEVICE_MOCK_HPP_
@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+
+# Decodes binary log stream, produced by ecl::log_ring::drain_raw().
+#
+# Stream holds only addresses of format strings and string arguments,
+# so the ELF file of the firmware that produced the stream is required
+# to render messages.
+#
+# Usage example:
+#   log_decode.py firmware.elf log.bin
+#   cat /dev/ttyUSB0 | log_decode.py firmware.elf -
+#
+# Record layout is described in lib/log/export/ecl/log.hpp.
+
+import argparse
+import struct
+import sys
+
+#-------------------------------------------------------------------------------
+# ELF access
+
+SHT_NOBITS  = 8
+SHF_ALLOC   = 0x2
+
+class Elf:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+
+        if self.data[:4] != b'\x7fELF':
+            raise ValueError(path + ' is not an ELF file')
+
+        self.is64 = self.data[4] == 2
+        self.endian = '<' if self.data[5] == 1 else '>'
+        self.sections = []
+
+        if self.is64:
+            shoff, = struct.unpack_from(self.endian + 'Q', self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(self.endian + 'HH', self.data, 0x3a)
+            sh_fmt = 'IIQQQQ'
+        else:
+            shoff, = struct.unpack_from(self.endian + 'I', self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(self.endian + 'HH', self.data, 0x2e)
+            sh_fmt = 'IIIIII'
+
+        for i in range(shnum):
+            _, sh_type, flags, addr, offset, size = \
+                struct.unpack_from(self.endian + sh_fmt, self.data, shoff + i * shentsize)
+
+            if flags & SHF_ALLOC and sh_type != SHT_NOBITS:
+                self.sections.append((addr, offset, size))
+
+    def string(self, addr):
+        for start, offset, size in self.sections:
+            if start <= addr < start + size:
+                pos = offset + addr - start
+                end = self.data.index(b'\0', pos)
+                return self.data[pos:end].decode('utf-8', 'replace')
+
+        return '<unknown string at 0x{:x}>'.format(addr)
+
+#-------------------------------------------------------------------------------
+# Record decoding
+
+REC_MSG     = 1
+REC_PAD     = 2
+REC_DROPPED = 3
+
+ARG_I32, ARG_U32, ARG_I64, ARG_U64, ARG_CHR, ARG_BOOL, ARG_STR, ARG_PTR = range(1, 9)
+
+def render(elf, fmt, args):
+    out = ''
+    i = 0
+    arg = 0
+
+    while i < len(fmt):
+        if fmt.startswith('{{', i):
+            out += '{'
+            i += 2
+            continue
+
+        hex_fmt = fmt.startswith('{x}', i)
+        if not hex_fmt and not fmt.startswith('{}', i):
+            out += fmt[i]
+            i += 1
+            continue
+
+        i += 3 if hex_fmt else 2
+
+        if arg >= len(args):
+            out += '{?}'
+            continue
+
+        tag, value = args[arg]
+        arg += 1
+
+        if tag == ARG_STR:
+            out += elf.string(value)
+        elif tag == ARG_PTR:
+            out += '0x{:0{}x}'.format(value, 16 if elf.is64 else 8)
+        elif tag == ARG_CHR:
+            out += chr(value & 0xff)
+        elif tag == ARG_BOOL:
+            out += 'true' if value else 'false'
+        elif hex_fmt:
+            # Same as ecl::ostream, negative values are printed as two's complement
+            bits = 64 if tag in (ARG_I64, ARG_U64) else 32
+            out += '{:x}'.format(value & ((1 << bits) - 1))
+        else:
+            out += str(value)
+
+    return out
+
+def decode(elf, stream):
+    word_fmt = elf.endian + 'I'
+    ptr_words = 2 if elf.is64 else 1
+    buf = b''
+
+    while True:
+        chunk = stream.read(4096)
+        if not chunk:
+            break
+
+        buf += chunk
+
+        while len(buf) >= 4:
+            hdr, = struct.unpack_from(word_fmt, buf, 0)
+            length = (hdr & 0xffff) * 4
+            kind = hdr >> 24
+
+            if length < 8 or kind not in (REC_MSG, REC_PAD, REC_DROPPED):
+                # Lost synchronization, skip a word
+                buf = buf[4:]
+                continue
+
+            if len(buf) < length:
+                break
+
+            words = struct.unpack_from(elf.endian + 'I' * (length // 4), buf, 0)
+            buf = buf[length:]
+
+            if kind == REC_DROPPED:
+                yield '<{} messages dropped>'.format(words[1])
+            elif kind == REC_MSG:
+                yield decode_msg(elf, words, ptr_words)
+
+def read_value(words, pos, cnt):
+    value = 0
+    for i in range(cnt):
+        value |= words[pos + i] << (32 * i)
+    return value, pos + cnt
+
+def decode_msg(elf, words, ptr_words):
+    argc = (words[0] >> 16) & 0xff
+    tags = words[1]
+    fmt_addr, pos = read_value(words, 2, ptr_words)
+    args = []
+
+    for _ in range(argc):
+        tag = tags & 0xf
+        tags >>= 4
+
+        if tag in (ARG_I64, ARG_U64):
+            value, pos = read_value(words, pos, 2)
+        elif tag in (ARG_STR, ARG_PTR):
+            value, pos = read_value(words, pos, ptr_words)
+        else:
+            value, pos = read_value(words, pos, 1)
+
+        # Restore sign
+        if tag == ARG_I32 and value & 0x80000000:
+            value -= 1 << 32
+        elif tag == ARG_I64 and value & (1 << 63):
+            value -= 1 << 64
+
+        args.append((tag, value))
+
+    return render(elf, elf.string(fmt_addr), args)
+
+#-------------------------------------------------------------------------------
+
+parser = argparse.ArgumentParser(description='Decodes binary log stream produced by ecl::log_ring.')
+parser.add_argument('elf', help='ELF file of the firmware that produced the stream')
+parser.add_argument('input', help='Binary log stream, - for stdin')
+args = parser.parse_args()
+
+elf = Elf(args.elf)
+stream = sys.stdin.buffer if args.input == '-' else open(args.input, 'rb')
+
+for line in decode(elf, stream):
+    print(line)